@@ -0,0 +1,166 @@
+#include "BarrierBatch.h"
+
+namespace {
+	using Kokoro::Graphics::ResourceUseInfo;
+
+	const VkPipelineStageFlags GraphicsShaderStages = VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_TESSELLATION_CONTROL_SHADER_BIT |
+		VK_PIPELINE_STAGE_TESSELLATION_EVALUATION_SHADER_BIT | VK_PIPELINE_STAGE_GEOMETRY_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+	const VkPipelineStageFlags DepthStages = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+
+	//Indexed by ResourceUse
+	const ResourceUseInfo UseTable[] = {
+		{ VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0, VK_IMAGE_LAYOUT_UNDEFINED, false },
+		{ VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, false },
+		{ VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, true },
+		{ GraphicsShaderStages, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false },
+		{ VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false },
+		{ GraphicsShaderStages | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false },
+		{ VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL, false },
+		{ VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL, true },
+		{ VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL, true },
+		{ GraphicsShaderStages, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL, false },
+		{ GraphicsShaderStages, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL, true },
+		{ VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, true },
+		{ DepthStages, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, true },
+		{ DepthStages | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, false },
+		{ VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_INPUT_ATTACHMENT_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false },
+		//Presentation is ordered by the semaphore, the barrier only has to make the layout change
+		{ VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, false },
+	};
+	static_assert(sizeof(UseTable) / sizeof(UseTable[0]) == (size_t)Kokoro::Graphics::ResourceUse::Count, "UseTable must cover every ResourceUse.");
+
+	//Stages of features the device doesn't have, barriers may not name them
+	VkPipelineStageFlags UnsupportedStages = 0;
+}
+
+const Kokoro::Graphics::ResourceUseInfo& Kokoro::Graphics::ResourceUseConv::GetInfo(ResourceUse u) {
+	return UseTable[(size_t)u];
+}
+
+Kokoro::Graphics::ResourceUse Kokoro::Graphics::ResourceUseConv::FromLayout(VkImageLayout layout) {
+	switch (layout) {
+	case VK_IMAGE_LAYOUT_GENERAL:
+		return ResourceUse::StorageReadWriteGraphics;
+	case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:
+		return ResourceUse::ColorAttachment;
+	case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL:
+	case VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL_KHR:
+	case VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_STENCIL_READ_ONLY_OPTIMAL:
+	case VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_STENCIL_ATTACHMENT_OPTIMAL:
+		return ResourceUse::DepthAttachment;
+	case VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL:
+	case VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL_KHR:
+		return ResourceUse::DepthReadOnly;
+	case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
+		return ResourceUse::Sampled;
+	case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:
+		return ResourceUse::TransferSrc;
+	case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:
+		return ResourceUse::TransferDst;
+	case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR:
+		return ResourceUse::Present;
+	default:
+		return ResourceUse::Undefined;
+	}
+}
+
+void Kokoro::Graphics::ResourceUseConv::SetUnsupportedStages(VkPipelineStageFlags stages) {
+	UnsupportedStages = stages;
+}
+
+VkPipelineStageFlags Kokoro::Graphics::ResourceUseConv::SupportedStages(VkPipelineStageFlags stages) {
+	return stages & ~UnsupportedStages;
+}
+
+VkAccessFlags Kokoro::Graphics::ResourceUseConv::Writes(VkAccessFlags access) {
+	return access & (VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_HOST_WRITE_BIT | VK_ACCESS_MEMORY_WRITE_BIT);
+}
+
+Kokoro::Graphics::BarrierBatch::BarrierBatch() {
+	srcStages = 0;
+	dstStages = 0;
+	barrierCnt = 0;
+	callCnt = 0;
+}
+
+void Kokoro::Graphics::BarrierBatch::AddImage(VkImage img, const VkImageSubresourceRange& range, VkImageLayout oldLayout, VkImageLayout newLayout, VkPipelineStageFlags srcStage, VkAccessFlags srcAccess, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess) {
+	VkImageMemoryBarrier b = {};
+	b.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	b.srcAccessMask = srcAccess;
+	b.dstAccessMask = dstAccess;
+	b.oldLayout = oldLayout;
+	b.newLayout = newLayout;
+	b.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	b.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	b.image = img;
+	b.subresourceRange = range;
+	images.push_back(b);
+	srcStages |= srcStage;
+	dstStages |= dstStage;
+}
+
+void Kokoro::Graphics::BarrierBatch::AddBuffer(VkBuffer buf, VkDeviceSize off, VkDeviceSize len, ResourceUse from, ResourceUse to) {
+	auto& src = ResourceUseConv::GetInfo(from);
+	auto& dst = ResourceUseConv::GetInfo(to);
+	if (!src.writes) {
+		//Reads only have to finish before the next access starts
+		AddExecution(src.stages, dst.stages);
+		return;
+	}
+
+	VkBufferMemoryBarrier b = {};
+	b.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	b.srcAccessMask = ResourceUseConv::Writes(src.access);
+	b.dstAccessMask = dst.access;
+	b.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	b.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	b.buffer = buf;
+	b.offset = off;
+	b.size = len;
+	buffers.push_back(b);
+	srcStages |= src.stages;
+	dstStages |= dst.stages;
+}
+
+void Kokoro::Graphics::BarrierBatch::AddExecution(VkPipelineStageFlags srcStage, VkPipelineStageFlags dstStage) {
+	srcStages |= srcStage;
+	dstStages |= dstStage;
+}
+
+bool Kokoro::Graphics::BarrierBatch::IsEmpty() {
+	return images.empty() && buffers.empty() && srcStages == 0 && dstStages == 0;
+}
+
+void Kokoro::Graphics::BarrierBatch::Flush(VkCommandBuffer cmd) {
+	if (IsEmpty())
+		return;
+
+	//Neither mask may be empty, a barrier out of nothing waits on the top of the pipe
+	VkPipelineStageFlags src = ResourceUseConv::SupportedStages(srcStages);
+	VkPipelineStageFlags dst = ResourceUseConv::SupportedStages(dstStages);
+	if (src == 0)
+		src = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+	if (dst == 0)
+		dst = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+	vkCmdPipelineBarrier(cmd, src, dst, 0, 0, nullptr, static_cast<uint32_t>(buffers.size()), buffers.data(), static_cast<uint32_t>(images.size()), images.data());
+
+	barrierCnt += static_cast<uint32_t>(buffers.size() + images.size());
+	callCnt++;
+	images.clear();
+	buffers.clear();
+	srcStages = 0;
+	dstStages = 0;
+}
+
+uint32_t Kokoro::Graphics::BarrierBatch::GetBarrierCount() {
+	return barrierCnt;
+}
+
+uint32_t Kokoro::Graphics::BarrierBatch::GetCallCount() {
+	return callCnt;
+}
+
+void Kokoro::Graphics::BarrierBatch::ResetCounters() {
+	barrierCnt = 0;
+	callCnt = 0;
+}
@@ -0,0 +1,79 @@
+#pragma once
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#define VK_USE_PLATFORM_WIN32_KHR
+#endif
+#include "vulkan/vulkan.h"
+#include <vector>
+
+namespace Kokoro::Graphics {
+	//How a pass is about to use a resource, each one maps to the narrowest stages, accesses and layout that cover it.
+	enum class ResourceUse {
+		Undefined,
+		TransferSrc,
+		TransferDst,
+		SampledGraphics,
+		SampledCompute,
+		//Sampled from any shader stage
+		Sampled,
+		StorageReadCompute,
+		StorageWriteCompute,
+		StorageReadWriteCompute,
+		StorageReadGraphics,
+		StorageReadWriteGraphics,
+		ColorAttachment,
+		DepthAttachment,
+		DepthReadOnly,
+		InputAttachment,
+		Present,
+		Count,
+	};
+
+	struct ResourceUseInfo {
+		VkPipelineStageFlags stages;
+		VkAccessFlags access;
+		VkImageLayout layout;
+		bool writes;
+	};
+
+	class ResourceUseConv {
+	public:
+		static const ResourceUseInfo& GetInfo(ResourceUse u);
+		//The write bits of access, the only ones a barrier has to make available.
+		static VkAccessFlags Writes(VkAccessFlags access);
+		//Use whose accesses match what an image left in layout is ready for, Undefined if none does.
+		static ResourceUse FromLayout(VkImageLayout layout);
+		//Set by the device, stages like the geometry shader can only be waited on when their feature is enabled.
+		static void SetUnsupportedStages(VkPipelineStageFlags stages);
+		static VkPipelineStageFlags SupportedStages(VkPipelineStageFlags stages);
+	};
+
+	//Collects the barriers a pass needs and records them with a single vkCmdPipelineBarrier.
+	class BarrierBatch
+	{
+	private:
+		std::vector<VkImageMemoryBarrier> images;
+		std::vector<VkBufferMemoryBarrier> buffers;
+		VkPipelineStageFlags srcStages;
+		VkPipelineStageFlags dstStages;
+
+		uint32_t barrierCnt;
+		uint32_t callCnt;
+	public:
+		BarrierBatch();
+
+		void AddImage(VkImage img, const VkImageSubresourceRange& range, VkImageLayout oldLayout, VkImageLayout newLayout, VkPipelineStageFlags srcStage, VkAccessFlags srcAccess, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess);
+		void AddBuffer(VkBuffer buf, VkDeviceSize off, VkDeviceSize len, ResourceUse from, ResourceUse to);
+		//Execution dependency with no memory barrier attached, for reads followed by writes.
+		void AddExecution(VkPipelineStageFlags srcStage, VkPipelineStageFlags dstStage);
+		bool IsEmpty();
+		//Records everything queued so far into cmd and clears the batch, nothing is recorded when the batch is empty.
+		void Flush(VkCommandBuffer cmd);
+
+		//Barriers recorded and vkCmdPipelineBarrier calls made since the last ResetCounters.
+		uint32_t GetBarrierCount();
+		uint32_t GetCallCount();
+		void ResetCounters();
+	};
+}
@@ -0,0 +1,167 @@
+#include "BindlessHeap.h"
+#include <algorithm>
+
+Kokoro::Graphics::BindlessHeap::BindlessHeap() {
+	locked = false;
+}
+
+Kokoro::Graphics::BindlessHeap::~BindlessHeap() {
+	if (locked) {
+		delete textureSlots;
+		delete bufferSlots;
+		delete writes;
+		vkDestroyDescriptorPool(GraphicsDevice::GetDevice(), desc_pool, nullptr);
+		vkDestroyDescriptorSetLayout(GraphicsDevice::GetDevice(), desc_set_layout, nullptr);
+	}
+}
+
+VkDescriptorSetLayout Kokoro::Graphics::BindlessHeap::GetLayout() {
+	return desc_set_layout;
+}
+
+VkDescriptorSet Kokoro::Graphics::BindlessHeap::GetSet() {
+	return set;
+}
+
+void Kokoro::Graphics::BindlessHeap::Build(uint32_t textureCount, uint32_t bufferCount, uint32_t framesInFlight) {
+	if (!locked) {
+		if (!GraphicsDevice::IsExtensionEnabled(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME))
+			throw gcnew System::NotSupportedException("Bindless descriptors require VK_EXT_descriptor_indexing.");
+
+		auto idxFeats = GraphicsDevice::GetDescriptorIndexingFeatures();
+		if (!idxFeats.descriptorBindingPartiallyBound)
+			throw gcnew System::NotSupportedException("Bindless descriptors require descriptorBindingPartiallyBound.");
+		if (!idxFeats.descriptorBindingSampledImageUpdateAfterBind)
+			throw gcnew System::NotSupportedException("Bindless descriptors require descriptorBindingSampledImageUpdateAfterBind.");
+		if (!idxFeats.descriptorBindingStorageBufferUpdateAfterBind)
+			throw gcnew System::NotSupportedException("Bindless descriptors require descriptorBindingStorageBufferUpdateAfterBind.");
+
+		VkPhysicalDeviceDescriptorIndexingPropertiesEXT idxProps = {};
+		idxProps.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES_EXT;
+		VkPhysicalDeviceProperties2 props2 = {};
+		props2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+		props2.pNext = &idxProps;
+		vkGetPhysicalDeviceProperties2(GraphicsDevice::GetPhysicalDevice(), &props2);
+
+		textureCount = std::min({ textureCount, idxProps.maxDescriptorSetUpdateAfterBindSampledImages, idxProps.maxDescriptorSetUpdateAfterBindSamplers, idxProps.maxPerStageDescriptorUpdateAfterBindSampledImages });
+		bufferCount = std::min({ bufferCount, idxProps.maxDescriptorSetUpdateAfterBindStorageBuffers, idxProps.maxPerStageDescriptorUpdateAfterBindStorageBuffers });
+
+		VkDescriptorSetLayoutBinding bindings[2] = {};
+		bindings[0].binding = TextureBinding;
+		bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		bindings[0].descriptorCount = textureCount;
+		bindings[0].stageFlags = VK_SHADER_STAGE_ALL;
+		bindings[0].pImmutableSamplers = nullptr;
+		bindings[1].binding = BufferBinding;
+		bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[1].descriptorCount = bufferCount;
+		bindings[1].stageFlags = VK_SHADER_STAGE_ALL;
+		bindings[1].pImmutableSamplers = nullptr;
+
+		VkDescriptorBindingFlagsEXT bindingFlags[2] = {
+			VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT,
+			VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT,
+		};
+
+		VkDescriptorSetLayoutBindingFlagsCreateInfoEXT flagsCreatInfo = {};
+		flagsCreatInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT;
+		flagsCreatInfo.bindingCount = 2;
+		flagsCreatInfo.pBindingFlags = bindingFlags;
+
+		VkDescriptorSetLayoutCreateInfo creatInfo = {};
+		creatInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		creatInfo.pNext = &flagsCreatInfo;
+		creatInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT;
+		creatInfo.bindingCount = 2;
+		creatInfo.pBindings = bindings;
+
+		pin_ptr<VkDescriptorSetLayout> desc_set_layout_ptr = &desc_set_layout;
+		if (vkCreateDescriptorSetLayout(GraphicsDevice::GetDevice(), &creatInfo, nullptr, desc_set_layout_ptr) != VK_SUCCESS)
+			throw gcnew System::Exception("Failed to create bindless descriptor set layout.");
+
+		VkDescriptorPoolSize psize[2] = {};
+		psize[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		psize[0].descriptorCount = textureCount;
+		psize[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		psize[1].descriptorCount = bufferCount;
+
+		VkDescriptorPoolCreateInfo poolCreatInfo = {};
+		poolCreatInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		poolCreatInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT;
+		poolCreatInfo.maxSets = 1;
+		poolCreatInfo.poolSizeCount = 2;
+		poolCreatInfo.pPoolSizes = psize;
+
+		pin_ptr<VkDescriptorPool> desc_pool_ptr = &desc_pool;
+		if (vkCreateDescriptorPool(GraphicsDevice::GetDevice(), &poolCreatInfo, nullptr, desc_pool_ptr) != VK_SUCCESS)
+			throw gcnew System::Exception("Failed to create bindless descriptor pool.");
+
+		VkDescriptorSetLayout layout = desc_set_layout;
+		VkDescriptorSetAllocateInfo desc_set_alloc_info = {};
+		desc_set_alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		desc_set_alloc_info.descriptorPool = desc_pool;
+		desc_set_alloc_info.descriptorSetCount = 1;
+		desc_set_alloc_info.pSetLayouts = &layout;
+
+		pin_ptr<VkDescriptorSet> set_ptr = &set;
+		if (vkAllocateDescriptorSets(GraphicsDevice::GetDevice(), &desc_set_alloc_info, set_ptr) != VK_SUCCESS)
+			throw gcnew System::Exception("Failed to allocate bindless descriptor set.");
+
+		textureSlots = new SlotAllocator(textureCount, framesInFlight);
+		bufferSlots = new SlotAllocator(bufferCount, framesInFlight);
+		writes = new DescriptorWriteBatch();
+		locked = true;
+	}
+}
+
+uint32_t Kokoro::Graphics::BindlessHeap::AddTexture(ImageView^ img, Sampler^ sampler) {
+	if (!locked)
+		throw gcnew System::Exception("Bindless heap has not been built.");
+
+	auto slot = textureSlots->Allocate();
+	if (slot == SlotAllocator::InvalidSlot)
+		throw gcnew System::OutOfMemoryException("Bindless texture slots exhausted.");
+
+	writes->WriteImage(set, TextureBinding, slot, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, sampler->GetSampler(), img->GetImageView(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	return slot;
+}
+
+uint32_t Kokoro::Graphics::BindlessHeap::AddBuffer(GPUBuffer^ buf, size_t off, size_t len) {
+	if (!locked)
+		throw gcnew System::Exception("Bindless heap has not been built.");
+
+	auto slot = bufferSlots->Allocate();
+	if (slot == SlotAllocator::InvalidSlot)
+		throw gcnew System::OutOfMemoryException("Bindless buffer slots exhausted.");
+
+	writes->WriteBuffer(set, BufferBinding, slot, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, buf->GetBuffer(), off, len);
+	return slot;
+}
+
+void Kokoro::Graphics::BindlessHeap::ReleaseTexture(uint32_t slot) {
+	//Partially bound arrays allow the stale descriptor to stay until the slot is rewritten
+	if (!locked)
+		throw gcnew System::Exception("Bindless heap has not been built.");
+	if (!textureSlots->Release(slot))
+		throw gcnew System::ArgumentException("Texture slot " + slot + " is not allocated.");
+}
+
+void Kokoro::Graphics::BindlessHeap::ReleaseBuffer(uint32_t slot) {
+	if (!locked)
+		throw gcnew System::Exception("Bindless heap has not been built.");
+	if (!bufferSlots->Release(slot))
+		throw gcnew System::ArgumentException("Buffer slot " + slot + " is not allocated.");
+}
+
+void Kokoro::Graphics::BindlessHeap::Commit() {
+	if (locked)
+		writes->Flush(GraphicsDevice::GetDevice());
+}
+
+void Kokoro::Graphics::BindlessHeap::AdvanceFrame() {
+	if (locked) {
+		Commit();
+		textureSlots->AdvanceFrame();
+		bufferSlots->AdvanceFrame();
+	}
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include "GraphicsDevice.h"
+#include "ImageView.h"
+#include "Sampler.h"
+#include "GPUBuffer.h"
+#include "DescriptorWriteBatch.h"
+#include "SlotAllocator.h"
+
+namespace Kokoro::Graphics {
+	//A single descriptor set holding large partially bound, update-after-bind arrays, indexed from shaders by slot.
+	//Binding 0 is an array of combined image samplers, binding 1 an array of storage buffers.
+	ref class BindlessHeap
+	{
+	private:
+		VkDescriptorSetLayout desc_set_layout;
+		VkDescriptorPool desc_pool;
+		VkDescriptorSet set;
+		SlotAllocator* textureSlots;
+		SlotAllocator* bufferSlots;
+		DescriptorWriteBatch* writes;
+		bool locked;
+	internal:
+		VkDescriptorSetLayout GetLayout();
+		VkDescriptorSet GetSet();
+	public:
+		literal uint32_t TextureBinding = 0;
+		literal uint32_t BufferBinding = 1;
+
+		BindlessHeap();
+		~BindlessHeap();
+		void Build(uint32_t textureCount, uint32_t bufferCount, uint32_t framesInFlight);
+
+		uint32_t AddTexture(ImageView^ img, Sampler^ sampler);
+		uint32_t AddBuffer(GPUBuffer^ buf, size_t off, size_t len);
+		void ReleaseTexture(uint32_t slot);
+		void ReleaseBuffer(uint32_t slot);
+
+		//Submits pending slot writes, must be called before the set is used by a submission.
+		void Commit();
+		//Commits and recycles slots released framesInFlight frames ago.
+		void AdvanceFrame();
+	};
+}
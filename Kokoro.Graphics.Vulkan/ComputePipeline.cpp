@@ -0,0 +1,263 @@
+#include "ComputePipeline.h"
+#include "SpecializedShaderModule.h"
+#include "ShaderModule.h"
+#include "DescriptorSet.h"
+#include "GPUBuffer.h"
+#include <vector>
+
+Kokoro::Graphics::ComputePipeline::ComputePipeline() {
+	descSets = gcnew List<DescriptorSet^>();
+	pushConstants = gcnew List<PushConstantRange>();
+	shader = nullptr;
+	LocalSizeX = 1;
+	LocalSizeY = 1;
+	LocalSizeZ = 1;
+	RequiredSubgroupSize = 0;
+
+	pipeline = VK_NULL_HANDLE;
+	pipelineLayout = VK_NULL_HANDLE;
+	rebuildTask = nullptr;
+	locked = false;
+}
+
+Kokoro::Graphics::ComputePipeline::~ComputePipeline() {
+	auto dev = GraphicsDevice::GetDevice();
+	if (rebuildTask != nullptr) {
+		//A faulted rebuild created nothing
+		try {
+			rebuildTask->Wait();
+			vkDestroyPipeline(dev, rebuiltPipeline, nullptr);
+			vkDestroyPipelineLayout(dev, rebuiltLayout, nullptr);
+		}
+		catch (AggregateException^) {}
+	}
+	if (locked)
+		shader->parent->RemoveDependent(this);
+	if (shader != nullptr)
+		shader->ReleasePipelineRef();
+
+	if (pipeline != VK_NULL_HANDLE)
+		vkDestroyPipeline(dev, pipeline, nullptr);
+	if (pipelineLayout != VK_NULL_HANDLE)
+		vkDestroyPipelineLayout(dev, pipelineLayout, nullptr);
+}
+
+void Kokoro::Graphics::ComputePipeline::SetShader(SpecializedShaderModule^ s) {
+	if (locked)
+		throw gcnew System::Exception("Pipeline has already been built.");
+	if (s->sType != ShaderType::Compute)
+		throw gcnew System::ArgumentException("ComputePipeline requires a compute shader.");
+	//Rebuilds read the variant for as long as the pipeline lives
+	s->AddPipelineRef();
+	if (shader != nullptr)
+		shader->ReleasePipelineRef();
+	shader = s;
+	UpdateLocalSize();
+}
+
+void Kokoro::Graphics::ComputePipeline::UpdateLocalSize() {
+	uint32_t x, y, z;
+	shader->GetLocalSize(&x, &y, &z);
+	if (x != 0) {
+		LocalSizeX = x;
+		LocalSizeY = y;
+		LocalSizeZ = z;
+	}
+}
+
+void Kokoro::Graphics::ComputePipeline::AddDescriptorSet(DescriptorSet^ set) {
+	if (locked)
+		throw gcnew System::Exception("Pipeline has already been built.");
+	descSets->Add(set);
+}
+
+void Kokoro::Graphics::ComputePipeline::AddPushConstantRange(PushConstantRange range) {
+	if (locked)
+		throw gcnew System::Exception("Pipeline has already been built.");
+	pushConstants->Add(range);
+}
+
+VkPipeline Kokoro::Graphics::ComputePipeline::GetPipeline() {
+	return pipeline;
+}
+
+VkPipelineLayout Kokoro::Graphics::ComputePipeline::GetLayout() {
+	return pipelineLayout;
+}
+
+void Kokoro::Graphics::ComputePipeline::ReflectLayout(std::vector<VkPushConstantRange>& pushRanges) {
+	for (auto& b : shader->reflection->GetBindings())
+		if (b.set >= static_cast<uint32_t>(descSets->Count))
+			throw gcnew System::Exception("Shader uses descriptor set " + b.set + " but only " + descSets->Count + " were added.");
+
+	if (pushConstants->Count == 0) {
+		VkPushConstantRange r;
+		if (shader->reflection->GetPushConstantRange(&r))
+			pushRanges.push_back(r);
+		return;
+	}
+	pushRanges.resize(pushConstants->Count);
+	for (int i = 0; i < pushConstants->Count; i++) {
+		pushRanges[i].stageFlags = ShaderTypeConv::Convert(pushConstants[i].Stages);
+		pushRanges[i].offset = pushConstants[i].Offset;
+		pushRanges[i].size = pushConstants[i].Size;
+	}
+}
+
+void Kokoro::Graphics::ComputePipeline::Create(VkPipeline* outPipeline, VkPipelineLayout* outLayout) {
+	if (shader == nullptr)
+		throw gcnew System::Exception("Pipeline requires a shader.");
+
+	VkPipelineShaderStageCreateInfo stage = *shader->GetCreateInfo();
+	//A rebuild may see a different size than LocalSize, which is only updated once it finishes
+	uint32_t localX, localY, localZ;
+	shader->GetLocalSize(&localX, &localY, &localZ);
+	if (localX == 0) {
+		localX = LocalSizeX;
+		localY = LocalSizeY;
+		localZ = LocalSizeZ;
+	}
+	bool fullSubgroups = (stage.flags & VK_PIPELINE_SHADER_STAGE_CREATE_REQUIRE_FULL_SUBGROUPS_BIT_EXT) != 0;
+	if (fullSubgroups && !GraphicsDevice::SupportsComputeFullSubgroups())
+		throw gcnew System::NotSupportedException("Device does not support computeFullSubgroups.");
+
+	VkPipelineShaderStageRequiredSubgroupSizeCreateInfoEXT subgroupCreatInfo = {};
+	subgroupCreatInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_REQUIRED_SUBGROUP_SIZE_CREATE_INFO_EXT;
+	if (RequiredSubgroupSize != 0) {
+		auto props = GraphicsDevice::GetSubgroupSizeProperties();
+		if ((props.requiredSubgroupSizeStages & VK_SHADER_STAGE_COMPUTE_BIT) == 0)
+			throw gcnew System::NotSupportedException("Device does not support requiring a compute subgroup size.");
+		if ((RequiredSubgroupSize & (RequiredSubgroupSize - 1)) != 0 || RequiredSubgroupSize < props.minSubgroupSize || RequiredSubgroupSize > props.maxSubgroupSize)
+			throw gcnew System::ArgumentOutOfRangeException("RequiredSubgroupSize");
+		if (localX * localY * localZ > RequiredSubgroupSize * props.maxComputeWorkgroupSubgroups)
+			throw gcnew System::ArgumentOutOfRangeException("LocalSizeX", "Workgroup needs more subgroups than the device allows.");
+		if (fullSubgroups && localX % RequiredSubgroupSize != 0)
+			throw gcnew System::ArgumentException("LocalSizeX must be a multiple of RequiredSubgroupSize when full subgroups are required.");
+
+		//A required size can't be combined with a varying one
+		subgroupCreatInfo.requiredSubgroupSize = RequiredSubgroupSize;
+		subgroupCreatInfo.pNext = const_cast<void*>(stage.pNext);
+		stage.pNext = &subgroupCreatInfo;
+		stage.flags &= ~VK_PIPELINE_SHADER_STAGE_CREATE_ALLOW_VARYING_SUBGROUP_SIZE_BIT_EXT;
+	}
+
+	std::vector<VkDescriptorSetLayout> setLayouts(descSets->Count);
+	for (int i = 0; i < descSets->Count; i++)
+		setLayouts[i] = descSets[i]->GetLayout();
+
+	std::vector<VkPushConstantRange> pushRanges;
+	ReflectLayout(pushRanges);
+
+	VkPipelineLayoutCreateInfo layoutCreatInfo = {};
+	layoutCreatInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	layoutCreatInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+	layoutCreatInfo.pSetLayouts = setLayouts.data();
+	layoutCreatInfo.pushConstantRangeCount = static_cast<uint32_t>(pushRanges.size());
+	layoutCreatInfo.pPushConstantRanges = pushRanges.data();
+
+	auto dev = GraphicsDevice::GetDevice();
+	VkPipelineLayout newLayout = VK_NULL_HANDLE;
+	if (vkCreatePipelineLayout(dev, &layoutCreatInfo, nullptr, &newLayout) != VK_SUCCESS)
+		throw gcnew System::Exception("Failed to create pipeline layout.");
+
+	VkComputePipelineCreateInfo computeCreatInfo = {};
+	computeCreatInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	computeCreatInfo.flags = VK_PIPELINE_CREATE_DISPATCH_BASE;
+	computeCreatInfo.stage = stage;
+	computeCreatInfo.layout = newLayout;
+	computeCreatInfo.basePipelineHandle = VK_NULL_HANDLE;
+	computeCreatInfo.basePipelineIndex = -1;
+
+	VkPipeline newPipeline = VK_NULL_HANDLE;
+	if (vkCreateComputePipelines(dev, GraphicsDevice::GetPipelineCache(), 1, &computeCreatInfo, nullptr, &newPipeline) != VK_SUCCESS) {
+		vkDestroyPipelineLayout(dev, newLayout, nullptr);
+		throw gcnew System::Exception("Failed to create compute pipeline.");
+	}
+
+	*outPipeline = newPipeline;
+	*outLayout = newLayout;
+}
+
+void Kokoro::Graphics::ComputePipeline::Build() {
+	if (!locked) {
+		shader->parent->BeginBuild();
+		try {
+			VkPipeline newPipeline = VK_NULL_HANDLE;
+			VkPipelineLayout newLayout = VK_NULL_HANDLE;
+			Create(&newPipeline, &newLayout);
+			pipeline = newPipeline;
+			pipelineLayout = newLayout;
+			locked = true;
+		}
+		finally {
+			shader->parent->EndBuild(locked ? this : nullptr);
+		}
+	}
+}
+
+void Kokoro::Graphics::ComputePipeline::RebuildPending() {
+	VkPipeline newPipeline = VK_NULL_HANDLE;
+	VkPipelineLayout newLayout = VK_NULL_HANDLE;
+	Create(&newPipeline, &newLayout);
+	rebuiltPipeline = newPipeline;
+	rebuiltLayout = newLayout;
+}
+
+void Kokoro::Graphics::ComputePipeline::BeginRebuild() {
+	if (locked && rebuildTask == nullptr)
+		rebuildTask = Task::Factory->StartNew(gcnew System::Action(this, &ComputePipeline::RebuildPending));
+}
+
+bool Kokoro::Graphics::ComputePipeline::FinishRebuild() {
+	if (rebuildTask == nullptr)
+		return false;
+	if (!rebuildTask->IsCompleted)
+		return true;
+
+	auto t = rebuildTask;
+	rebuildTask = nullptr;
+	if (t->IsFaulted)
+		throw t->Exception->InnerException;
+
+	//Frames in flight may still use the old objects
+	GraphicsDevice::DeferDestroy(DeferredObjectType::Pipeline, (uint64_t)pipeline);
+	GraphicsDevice::DeferDestroy(DeferredObjectType::PipelineLayout, (uint64_t)pipelineLayout);
+	pipeline = rebuiltPipeline;
+	pipelineLayout = rebuiltLayout;
+	//The reloaded shader may declare a different workgroup size
+	UpdateLocalSize();
+	return false;
+}
+
+uint32_t Kokoro::Graphics::ComputePipeline::GroupCount(uint32_t threads, uint32_t localSize) {
+	return (threads + localSize - 1) / localSize;
+}
+
+void Kokoro::Graphics::ComputePipeline::Bind(VkCommandBuffer cmd) {
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+}
+
+void Kokoro::Graphics::ComputePipeline::Dispatch1D(VkCommandBuffer cmd, uint32_t threadsX) {
+	vkCmdDispatch(cmd, GroupCount(threadsX, LocalSizeX), 1, 1);
+}
+
+void Kokoro::Graphics::ComputePipeline::Dispatch2D(VkCommandBuffer cmd, uint32_t threadsX, uint32_t threadsY) {
+	vkCmdDispatch(cmd, GroupCount(threadsX, LocalSizeX), GroupCount(threadsY, LocalSizeY), 1);
+}
+
+void Kokoro::Graphics::ComputePipeline::Dispatch3D(VkCommandBuffer cmd, uint32_t threadsX, uint32_t threadsY, uint32_t threadsZ) {
+	vkCmdDispatch(cmd, GroupCount(threadsX, LocalSizeX), GroupCount(threadsY, LocalSizeY), GroupCount(threadsZ, LocalSizeZ));
+}
+
+void Kokoro::Graphics::ComputePipeline::DispatchGroups(VkCommandBuffer cmd, uint32_t groupsX, uint32_t groupsY, uint32_t groupsZ) {
+	vkCmdDispatch(cmd, groupsX, groupsY, groupsZ);
+}
+
+void Kokoro::Graphics::ComputePipeline::DispatchBase(VkCommandBuffer cmd, uint32_t baseX, uint32_t baseY, uint32_t baseZ, uint32_t groupsX, uint32_t groupsY, uint32_t groupsZ) {
+	vkCmdDispatchBase(cmd, baseX, baseY, baseZ, groupsX, groupsY, groupsZ);
+}
+
+void Kokoro::Graphics::ComputePipeline::DispatchIndirect(VkCommandBuffer cmd, GPUBuffer^ buf, size_t offset) {
+	//buf holds a VkDispatchIndirectCommand at offset
+	vkCmdDispatchIndirect(cmd, buf->GetBuffer(), offset);
+}
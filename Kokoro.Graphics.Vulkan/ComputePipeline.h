@@ -0,0 +1,65 @@
+#pragma once
+#include "GraphicsDevice.h"
+#include "GraphicsPipeline.h"
+#include "ShaderType.h"
+
+using namespace System::Collections::Generic;
+
+namespace Kokoro::Graphics {
+	ref class SpecializedShaderModule;
+	ref class DescriptorSet;
+	ref class GPUBuffer;
+	ref class ComputePipeline : public IShaderDependent
+	{
+	private:
+		VkPipeline pipeline;
+		VkPipelineLayout pipelineLayout;
+		SpecializedShaderModule^ shader;
+		List<DescriptorSet^>^ descSets;
+		List<PushConstantRange>^ pushConstants;
+		Task^ rebuildTask;
+		VkPipeline rebuiltPipeline;
+		VkPipelineLayout rebuiltLayout;
+		bool locked;
+
+		void ReflectLayout(std::vector<VkPushConstantRange>& pushRanges);
+		//Takes LocalSize from the shader's specialized workgroup size.
+		void UpdateLocalSize();
+		void Create(VkPipeline* outPipeline, VkPipelineLayout* outLayout);
+		void RebuildPending();
+	internal:
+		VkPipeline GetPipeline();
+		VkPipelineLayout GetLayout();
+
+		void Bind(VkCommandBuffer cmd);
+		//Group counts are derived from the thread counts and the LocalSize properties.
+		void Dispatch1D(VkCommandBuffer cmd, uint32_t threadsX);
+		void Dispatch2D(VkCommandBuffer cmd, uint32_t threadsX, uint32_t threadsY);
+		void Dispatch3D(VkCommandBuffer cmd, uint32_t threadsX, uint32_t threadsY, uint32_t threadsZ);
+		void DispatchGroups(VkCommandBuffer cmd, uint32_t groupsX, uint32_t groupsY, uint32_t groupsZ);
+		void DispatchBase(VkCommandBuffer cmd, uint32_t baseX, uint32_t baseY, uint32_t baseZ, uint32_t groupsX, uint32_t groupsY, uint32_t groupsZ);
+		void DispatchIndirect(VkCommandBuffer cmd, GPUBuffer^ buf, size_t offset);
+	public:
+		//Must match the workgroup size declared by the shader.
+		property uint32_t LocalSizeX;
+		property uint32_t LocalSizeY;
+		property uint32_t LocalSizeZ;
+		//0 lets the driver pick, otherwise a power of two within the device's subgroup size range.
+		property uint32_t RequiredSubgroupSize;
+
+		ComputePipeline();
+		~ComputePipeline();
+		//Also takes LocalSize from the shader's workgroup size, including specialized dimensions.
+		void SetShader(SpecializedShaderModule^ s);
+		void AddDescriptorSet(DescriptorSet^ set);
+		//Without explicit ranges, push constant ranges are derived from the shader's reflection.
+		void AddPushConstantRange(PushConstantRange range);
+
+		void Build();
+
+		static uint32_t GroupCount(uint32_t threads, uint32_t localSize);
+
+		virtual void BeginRebuild();
+		virtual bool FinishRebuild();
+	};
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include "GraphicsDevice.h"
+
+namespace Kokoro::Graphics {
+	public enum class DepthFunc {
+		Never,
+		Less,
+		Equal,
+		LessEqual,
+		Greater,
+		NotEqual,
+		GreaterEqual,
+		Always,
+	};
+
+	class DepthFuncConv {
+	public:
+		static VkCompareOp Convert(DepthFunc f) {
+			switch (f) {
+			case DepthFunc::Never:
+				return VK_COMPARE_OP_NEVER;
+			case DepthFunc::Less:
+				return VK_COMPARE_OP_LESS;
+			case DepthFunc::Equal:
+				return VK_COMPARE_OP_EQUAL;
+			case DepthFunc::LessEqual:
+				return VK_COMPARE_OP_LESS_OR_EQUAL;
+			case DepthFunc::Greater:
+				return VK_COMPARE_OP_GREATER;
+			case DepthFunc::NotEqual:
+				return VK_COMPARE_OP_NOT_EQUAL;
+			case DepthFunc::GreaterEqual:
+				return VK_COMPARE_OP_GREATER_OR_EQUAL;
+			case DepthFunc::Always:
+				return VK_COMPARE_OP_ALWAYS;
+			default:
+				return (VkCompareOp)0;
+			}
+		}
+	};
+}
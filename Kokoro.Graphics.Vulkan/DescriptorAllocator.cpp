@@ -0,0 +1,133 @@
+#include "DescriptorAllocator.h"
+#include <algorithm>
+
+//Descriptors reserved per set for each type in a generic pool
+static const struct {
+	VkDescriptorType type;
+	float perSet;
+} DefaultPoolRatios[] = {
+	{ VK_DESCRIPTOR_TYPE_SAMPLER, 0.5f },
+	{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4.0f },
+	{ VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 4.0f },
+	{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1.0f },
+	{ VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER, 1.0f },
+	{ VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER, 1.0f },
+	{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2.0f },
+	{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2.0f },
+	{ VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, 0.5f },
+};
+
+Kokoro::Graphics::DescriptorAllocator::DescriptorAllocator(bool freeable, uint32_t setsPerPool) {
+	this->freeable = freeable;
+	this->setsPerPool = setsPerPool;
+	curPool = VK_NULL_HANDLE;
+}
+
+VkResult Kokoro::Graphics::DescriptorAllocator::CreatePool(VkDevice dev, const VkDescriptorPoolSize* setSizes, uint32_t setSizeCnt, VkDescriptorPool* pool) {
+	std::vector<VkDescriptorPoolSize> psize;
+	for (auto& r : DefaultPoolRatios) {
+		VkDescriptorPoolSize sz;
+		sz.type = r.type;
+		sz.descriptorCount = static_cast<uint32_t>(r.perSet * setsPerPool);
+		for (uint32_t i = 0; i < setSizeCnt; i++)
+			if (setSizes[i].type == r.type)
+				sz.descriptorCount = std::max(sz.descriptorCount, setSizes[i].descriptorCount * setsPerPool);
+		psize.push_back(sz);
+	}
+
+	VkDescriptorPoolCreateInfo poolCreatInfo = {};
+	poolCreatInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolCreatInfo.flags = freeable ? VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT : 0;
+	poolCreatInfo.maxSets = setsPerPool;
+	poolCreatInfo.poolSizeCount = static_cast<uint32_t>(psize.size());
+	poolCreatInfo.pPoolSizes = psize.data();
+
+	return vkCreateDescriptorPool(dev, &poolCreatInfo, nullptr, pool);
+}
+
+VkResult Kokoro::Graphics::DescriptorAllocator::NextPool(VkDevice dev, const VkDescriptorPoolSize* setSizes, uint32_t setSizeCnt) {
+	if (!freePools.empty()) {
+		curPool = freePools.back();
+		freePools.pop_back();
+	}
+	else {
+		auto res = CreatePool(dev, setSizes, setSizeCnt, &curPool);
+		if (res != VK_SUCCESS) {
+			curPool = VK_NULL_HANDLE;
+			return res;
+		}
+	}
+	usedPools.push_back(curPool);
+	return VK_SUCCESS;
+}
+
+VkResult Kokoro::Graphics::DescriptorAllocator::Allocate(VkDevice dev, VkDescriptorSetLayout layout, const VkDescriptorPoolSize* setSizes, uint32_t setSizeCnt, VkDescriptorPool* pool, VkDescriptorSet* set) {
+	VkResult res = VK_SUCCESS;
+	if (curPool == VK_NULL_HANDLE) {
+		res = NextPool(dev, setSizes, setSizeCnt);
+		if (res != VK_SUCCESS)
+			return res;
+	}
+
+	VkDescriptorSetAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &layout;
+
+	for (int attempt = 0; attempt < 3; attempt++) {
+		allocInfo.descriptorPool = curPool;
+		res = vkAllocateDescriptorSets(dev, &allocInfo, set);
+		if (res == VK_SUCCESS) {
+			*pool = curPool;
+			return res;
+		}
+		if (res != VK_ERROR_OUT_OF_POOL_MEMORY && res != VK_ERROR_FRAGMENTED_POOL)
+			return res;
+		if (attempt == 2)
+			break;
+
+		//Chain on another pool, recycled pools might be too small for this layout so the last attempt always gets a fresh one
+		if (attempt == 1) {
+			res = CreatePool(dev, setSizes, setSizeCnt, &curPool);
+			if (res != VK_SUCCESS) {
+				curPool = VK_NULL_HANDLE;
+				return res;
+			}
+			usedPools.push_back(curPool);
+		}
+		else {
+			res = NextPool(dev, setSizes, setSizeCnt);
+			if (res != VK_SUCCESS)
+				return res;
+		}
+	}
+	return res;
+}
+
+void Kokoro::Graphics::DescriptorAllocator::Free(VkDevice dev, VkDescriptorPool pool, VkDescriptorSet set) {
+	if (freeable)
+		vkFreeDescriptorSets(dev, pool, 1, &set);
+}
+
+void Kokoro::Graphics::DescriptorAllocator::Reset(VkDevice dev) {
+	for (auto p : usedPools) {
+		vkResetDescriptorPool(dev, p, 0);
+		freePools.push_back(p);
+	}
+	usedPools.clear();
+	curPool = VK_NULL_HANDLE;
+}
+
+void Kokoro::Graphics::DescriptorAllocator::Destroy(VkDevice dev) {
+	for (auto p : usedPools)
+		vkDestroyDescriptorPool(dev, p, nullptr);
+	for (auto p : freePools)
+		vkDestroyDescriptorPool(dev, p, nullptr);
+	usedPools.clear();
+	freePools.clear();
+	curPool = VK_NULL_HANDLE;
+}
+
+uint32_t Kokoro::Graphics::DescriptorAllocator::GetPoolCount() {
+	return static_cast<uint32_t>(usedPools.size() + freePools.size());
+}
@@ -0,0 +1,34 @@
+#pragma once
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#define VK_USE_PLATFORM_WIN32_KHR
+#endif
+#include "vulkan/vulkan.h"
+#include <vector>
+
+namespace Kokoro::Graphics {
+	//Allocates descriptor sets of any layout from a chain of shared pools, a new pool is chained on when the current one runs out.
+	//Freeable allocators back long lived sets, the others are meant to be Reset wholesale once per frame.
+	class DescriptorAllocator
+	{
+	private:
+		std::vector<VkDescriptorPool> usedPools;
+		std::vector<VkDescriptorPool> freePools;
+		VkDescriptorPool curPool;
+		bool freeable;
+		uint32_t setsPerPool;
+
+		VkResult CreatePool(VkDevice dev, const VkDescriptorPoolSize* setSizes, uint32_t setSizeCnt, VkDescriptorPool* pool);
+		VkResult NextPool(VkDevice dev, const VkDescriptorPoolSize* setSizes, uint32_t setSizeCnt);
+	public:
+		DescriptorAllocator(bool freeable, uint32_t setsPerPool);
+
+		//setSizes describes one set of the layout, it ensures a freshly chained pool can hold at least setsPerPool such sets.
+		VkResult Allocate(VkDevice dev, VkDescriptorSetLayout layout, const VkDescriptorPoolSize* setSizes, uint32_t setSizeCnt, VkDescriptorPool* pool, VkDescriptorSet* set);
+		void Free(VkDevice dev, VkDescriptorPool pool, VkDescriptorSet set);
+		void Reset(VkDevice dev);
+		void Destroy(VkDevice dev);
+		uint32_t GetPoolCount();
+	};
+}
@@ -0,0 +1,109 @@
+#include "DescriptorLayoutCache.h"
+#include <algorithm>
+#include <functional>
+
+static inline void HashCombine(size_t& seed, size_t v) {
+	seed ^= v + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
+
+bool Kokoro::Graphics::DescriptorLayoutCache::LayoutKey::operator==(const LayoutKey& other) const {
+	if (flags != other.flags || bindings.size() != other.bindings.size())
+		return false;
+	for (size_t i = 0; i < bindings.size(); i++) {
+		auto& a = bindings[i];
+		auto& b = other.bindings[i];
+		if (a.binding != b.binding || a.descriptorType != b.descriptorType || a.descriptorCount != b.descriptorCount ||
+			a.stageFlags != b.stageFlags)
+			return false;
+	}
+	return samplers == other.samplers;
+}
+
+size_t Kokoro::Graphics::DescriptorLayoutCache::LayoutKeyHash::operator()(const LayoutKey& k) const {
+	size_t seed = std::hash<uint32_t>()(k.flags);
+	for (auto& b : k.bindings) {
+		HashCombine(seed, std::hash<uint32_t>()(b.binding));
+		HashCombine(seed, std::hash<uint32_t>()(static_cast<uint32_t>(b.descriptorType)));
+		HashCombine(seed, std::hash<uint32_t>()(b.descriptorCount));
+		HashCombine(seed, std::hash<uint32_t>()(b.stageFlags));
+	}
+	for (auto& s : k.samplers) {
+		HashCombine(seed, s.size());
+		for (auto h : s)
+			HashCombine(seed, std::hash<uint64_t>()((uint64_t)h));
+	}
+	return seed;
+}
+
+Kokoro::Graphics::DescriptorLayoutCache::DescriptorLayoutCache(SamplerCache* samplerCache) {
+	this->samplerCache = samplerCache;
+	hits = 0;
+	misses = 0;
+}
+
+VkResult Kokoro::Graphics::DescriptorLayoutCache::Get(VkDevice dev, VkDescriptorSetLayoutCreateFlags flags, const VkDescriptorSetLayoutBinding* bindings, uint32_t bindingCnt, VkDescriptorSetLayout* layout) {
+	LayoutKey key;
+	key.flags = flags;
+	key.bindings.assign(bindings, bindings + bindingCnt);
+	std::sort(key.bindings.begin(), key.bindings.end(), [](const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b) {
+		return a.binding < b.binding;
+		});
+	key.samplers.resize(key.bindings.size());
+	for (size_t i = 0; i < key.bindings.size(); i++) {
+		auto& b = key.bindings[i];
+		if (b.pImmutableSamplers != nullptr)
+			key.samplers[i].assign(b.pImmutableSamplers, b.pImmutableSamplers + b.descriptorCount);
+		b.pImmutableSamplers = nullptr;
+	}
+
+	auto it = layouts.find(key);
+	if (it != layouts.end()) {
+		hits++;
+		*layout = it->second;
+		return VK_SUCCESS;
+	}
+
+	std::vector<VkDescriptorSetLayoutBinding> creatBindings(key.bindings);
+	for (size_t i = 0; i < creatBindings.size(); i++)
+		if (!key.samplers[i].empty())
+			creatBindings[i].pImmutableSamplers = key.samplers[i].data();
+
+	VkDescriptorSetLayoutCreateInfo creatInfo = {};
+	creatInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	creatInfo.flags = flags;
+	creatInfo.bindingCount = static_cast<uint32_t>(creatBindings.size());
+	creatInfo.pBindings = creatBindings.data();
+
+	auto res = vkCreateDescriptorSetLayout(dev, &creatInfo, nullptr, layout);
+	if (res != VK_SUCCESS)
+		return res;
+
+	for (auto& s : key.samplers)
+		for (auto h : s)
+			samplerCache->AddRef(h);
+	misses++;
+	layouts[key] = *layout;
+	return VK_SUCCESS;
+}
+
+uint32_t Kokoro::Graphics::DescriptorLayoutCache::GetLayoutCount() {
+	return static_cast<uint32_t>(layouts.size());
+}
+
+uint32_t Kokoro::Graphics::DescriptorLayoutCache::GetHitCount() {
+	return hits;
+}
+
+uint32_t Kokoro::Graphics::DescriptorLayoutCache::GetMissCount() {
+	return misses;
+}
+
+void Kokoro::Graphics::DescriptorLayoutCache::Destroy(VkDevice dev) {
+	for (auto& l : layouts) {
+		vkDestroyDescriptorSetLayout(dev, l.second, nullptr);
+		for (auto& s : l.first.samplers)
+			for (auto h : s)
+				samplerCache->Release(dev, h);
+	}
+	layouts.clear();
+}
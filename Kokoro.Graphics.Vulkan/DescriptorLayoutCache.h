@@ -0,0 +1,42 @@
+#pragma once
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#define VK_USE_PLATFORM_WIN32_KHR
+#endif
+#include "vulkan/vulkan.h"
+#include "SamplerCache.h"
+#include <vector>
+#include <unordered_map>
+
+namespace Kokoro::Graphics {
+	//Device-wide store of descriptor set layouts, identical binding lists share one VkDescriptorSetLayout.
+	class DescriptorLayoutCache
+	{
+	private:
+		struct LayoutKey {
+			VkDescriptorSetLayoutCreateFlags flags;
+			//pImmutableSamplers is always null here, the handles are copied into samplers, parallel to bindings.
+			//SamplerCache gives equal descriptions one handle and the layout holds a reference on it, so a handle
+			//can't be recycled for a different sampler while its key is in the map.
+			std::vector<VkDescriptorSetLayoutBinding> bindings;
+			std::vector<std::vector<VkSampler>> samplers;
+			bool operator==(const LayoutKey& other) const;
+		};
+		struct LayoutKeyHash {
+			size_t operator()(const LayoutKey& k) const;
+		};
+		std::unordered_map<LayoutKey, VkDescriptorSetLayout, LayoutKeyHash> layouts;
+		//Immutable samplers are referenced for as long as the layout using them lives
+		SamplerCache* samplerCache;
+		uint32_t hits;
+		uint32_t misses;
+	public:
+		DescriptorLayoutCache(SamplerCache* samplerCache);
+		VkResult Get(VkDevice dev, VkDescriptorSetLayoutCreateFlags flags, const VkDescriptorSetLayoutBinding* bindings, uint32_t bindingCnt, VkDescriptorSetLayout* layout);
+		uint32_t GetLayoutCount();
+		uint32_t GetHitCount();
+		uint32_t GetMissCount();
+		void Destroy(VkDevice dev);
+	};
+}
@@ -1,14 +1,55 @@
 #include "DescriptorSet.h"
+#include "ShaderModule.h"
 #include <vector>
 
-VkDescriptorSetLayout Kokoro::Graphics::DescriptorSet::GetLayout()
-{
-	return desc_set_layout;
+static PFN_vkCmdPushDescriptorSetKHR cmdPushDescriptorSet = nullptr;
+
+static size_t GetTemplateElementSize(VkDescriptorType type) {
+	switch (type) {
+	case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+	case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
+	case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC:
+	case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC:
+		return sizeof(VkDescriptorBufferInfo);
+	case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
+	case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
+		return sizeof(VkBufferView);
+	default:
+		return sizeof(VkDescriptorImageInfo);
+	}
+}
+
+static bool DescriptorTypeFromVk(VkDescriptorType type, Kokoro::Graphics::DescriptorType* out) {
+	using Kokoro::Graphics::DescriptorType;
+	switch (type) {
+	case VK_DESCRIPTOR_TYPE_SAMPLER: *out = DescriptorType::Sampler; return true;
+	case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER: *out = DescriptorType::CombinedImageSampler; return true;
+	case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE: *out = DescriptorType::SampledImage; return true;
+	case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE: *out = DescriptorType::StorageImage; return true;
+	case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER: *out = DescriptorType::UniformTexelBuffer; return true;
+	case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER: *out = DescriptorType::StorageTexelBuffer; return true;
+	case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER: *out = DescriptorType::UniformBuffer; return true;
+	case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER: *out = DescriptorType::StorageBuffer; return true;
+	case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT: *out = DescriptorType::InputAttachment; return true;
+	default: return false;
+	}
 }
 
-VkDescriptorPool Kokoro::Graphics::DescriptorSet::GetPool()
+static Kokoro::Graphics::ShaderType ShaderTypeFromVk(VkShaderStageFlags stages) {
+	using Kokoro::Graphics::ShaderType;
+	ShaderType s = (ShaderType)0;
+	if (stages & VK_SHADER_STAGE_VERTEX_BIT) s = s | ShaderType::Vertex;
+	if (stages & VK_SHADER_STAGE_FRAGMENT_BIT) s = s | ShaderType::Fragment;
+	if (stages & VK_SHADER_STAGE_COMPUTE_BIT) s = s | ShaderType::Compute;
+	if (stages & VK_SHADER_STAGE_GEOMETRY_BIT) s = s | ShaderType::Geometry;
+	if (stages & VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT) s = s | ShaderType::TessEval;
+	if (stages & VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT) s = s | ShaderType::TessCtrl;
+	return s;
+}
+
+VkDescriptorSetLayout Kokoro::Graphics::DescriptorSet::GetLayout()
 {
-	return desc_pool;
+	return desc_set_layout;
 }
 
 VkDescriptorSet Kokoro::Graphics::DescriptorSet::GetSet(int idx)
@@ -18,6 +59,21 @@ VkDescriptorSet Kokoro::Graphics::DescriptorSet::GetSet(int idx)
 	return sets[idx];
 }
 
+void Kokoro::Graphics::DescriptorSet::AppendLayoutKey(PipelineStateKey& key)
+{
+	if (!locked)
+		throw gcnew System::Exception("Descriptor set has not been built.");
+
+	key.Append((uint64_t)push_native);
+	key.Append((uint64_t)layouts->Count);
+	for (int i = 0; i < layouts->Count; i++) {
+		key.Append((uint64_t)layouts[i]->BindingIndex << 32 | (uint64_t)layouts[i]->Type);
+		key.Append((uint64_t)layouts[i]->Count << 32 | (uint64_t)layouts[i]->Stages);
+		//Immutable samplers are referenced by the layout cache for the device's lifetime, so their handles are stable
+		key.Append((uint64_t)(layouts[i]->Immutable == nullptr ? VK_NULL_HANDLE : layouts[i]->Immutable->GetSampler()));
+	}
+}
+
 int Kokoro::Graphics::DescriptorSet::GetSetCount()
 {
 	return set_cnt;
@@ -26,184 +82,428 @@ int Kokoro::Graphics::DescriptorSet::GetSetCount()
 Kokoro::Graphics::DescriptorSet::DescriptorSet() {
 	layouts = gcnew List<DescriptorLayout^>();
 	pool_entries = gcnew List<PoolEntry^>();
+	desc_template = VK_NULL_HANDLE;
+	template_sz = 0;
 	locked = false;
 }
 
 Kokoro::Graphics::DescriptorSet::~DescriptorSet() {
 	if (locked) {
+		//Writes still queued for this set are dropped, other sets' writes stay batched
+		if (writeBatch != nullptr && writeBatch->GetPendingCount() != 0 && !PushDescriptor)
+			for (int i = 0; i < set_cnt; i++)
+				if (sets[i] != VK_NULL_HANDLE)
+					writeBatch->Discard(sets[i]);
+		//Per frame sets are reclaimed when their frame's pools are reset, the layout belongs to the device cache
+		if (PushDescriptor)
+			delete push_writes;
+		else if (!PerFrame)
+			for (int i = 0; i < set_cnt; i++)
+				GraphicsDevice::GetDescriptorAllocator()->Free(GraphicsDevice::GetDevice(), set_pools[i], sets[i]);
 		delete[] sets;
-		vkDestroyDescriptorPool(GraphicsDevice::GetDevice(), desc_pool, nullptr);
-		vkDestroyDescriptorSetLayout(GraphicsDevice::GetDevice(), desc_set_layout, nullptr);
+		delete[] set_pools;
+		vkDestroyDescriptorUpdateTemplate(GraphicsDevice::GetDevice(), desc_template, nullptr);
 		delete layouts;
 		delete pool_entries;
 	}
 }
 
 void Kokoro::Graphics::DescriptorSet::Add(int bindingIndex, DescriptorType type, int count, ShaderType stage) {
+	Add(bindingIndex, type, count, stage, nullptr);
+}
+
+void Kokoro::Graphics::DescriptorSet::Add(int bindingIndex, DescriptorType type, int count, ShaderType stage, Sampler^ immutableSampler) {
+	if (locked)
+		throw gcnew System::Exception("Descriptor set has already been built.");
+	if (immutableSampler != nullptr && type != DescriptorType::Sampler && type != DescriptorType::CombinedImageSampler)
+		throw gcnew System::ArgumentException("Immutable samplers require a Sampler or CombinedImageSampler binding.");
+
 	auto l = gcnew DescriptorLayout;
 	l->BindingIndex = bindingIndex;
 	l->Type = type;
 	l->Count = count;
 	l->Stages = stage;
+	l->Immutable = immutableSampler;
 	layouts->Add(l);
 
 	int i = 0;
 	for (; i < pool_entries->Count; i++)
 		if (pool_entries[i]->Type == type) {
-			pool_entries[i]->Count++;
+			pool_entries[i]->Count += count;
 			break;
 		}
 	if (i == pool_entries->Count) {
 		auto p = gcnew PoolEntry;
-		p->Count = 1;
+		p->Count = count;
 		p->Type = type;
 		pool_entries->Add(p);
 	}
 }
 
+void Kokoro::Graphics::DescriptorSet::AddFromShaders(int setIndex, ... array<ShaderModule^>^ shaders) {
+	std::vector<const SpirvReflection*> stages(shaders->Length);
+	for (int i = 0; i < shaders->Length; i++)
+		stages[i] = shaders[i]->reflection;
+
+	std::vector<SpirvReflection::Binding> bindings;
+	std::vector<VkPushConstantRange> ranges;
+	if (!SpirvReflection::Merge(stages.data(), static_cast<uint32_t>(stages.size()), bindings, ranges))
+		throw gcnew System::Exception("Shader stages declare conflicting descriptor types for the same binding.");
+
+	for (auto& b : bindings) {
+		if (b.set != static_cast<uint32_t>(setIndex) || b.count == 0)
+			continue;
+		DescriptorType type;
+		if (!DescriptorTypeFromVk(b.type, &type))
+			throw gcnew System::NotSupportedException("Unsupported descriptor type in shader.");
+		Add(static_cast<int>(b.binding), type, static_cast<int>(b.count), ShaderTypeFromVk(b.stages));
+	}
+}
+
 void Kokoro::Graphics::DescriptorSet::Build(int pool_sz)
 {
 	if (!locked) {
 		std::vector<VkDescriptorSetLayoutBinding> bindings(layouts->Count);
+		std::vector<std::vector<VkSampler>> immutableSamplers(layouts->Count);
 		for (int i = 0; i < layouts->Count; i++) {
 			bindings[i].binding = static_cast<uint32_t>(layouts[i]->BindingIndex);
 			bindings[i].descriptorCount = static_cast<uint32_t>(layouts[i]->Count);
 			bindings[i].descriptorType = DescriptorTypeConv::Convert(layouts[i]->Type);
 			bindings[i].stageFlags = ShaderTypeConv::Convert(layouts[i]->Stages);
 			bindings[i].pImmutableSamplers = nullptr;
+			if (layouts[i]->Immutable != nullptr) {
+				layouts[i]->Immutable->Build();
+				immutableSamplers[i].assign(layouts[i]->Count, layouts[i]->Immutable->GetSampler());
+				bindings[i].pImmutableSamplers = immutableSamplers[i].data();
+			}
 		}
 
-		VkDescriptorSetLayoutCreateInfo creatInfo = {};
-		creatInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-		creatInfo.flags = 0;
-		creatInfo.bindingCount = static_cast<uint32_t>(bindings.size());
-		creatInfo.pBindings = bindings.data();
+		push_native = false;
+		if (PushDescriptor && GraphicsDevice::IsExtensionEnabled(VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME)) {
+			VkPhysicalDevicePushDescriptorPropertiesKHR pushProps = {};
+			pushProps.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PUSH_DESCRIPTOR_PROPERTIES_KHR;
+			VkPhysicalDeviceProperties2 props2 = {};
+			props2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+			props2.pNext = &pushProps;
+			vkGetPhysicalDeviceProperties2(GraphicsDevice::GetPhysicalDevice(), &props2);
+
+			uint32_t desc_cnt = 0;
+			for (auto& b : bindings)
+				desc_cnt += b.descriptorCount;
+			push_native = desc_cnt <= pushProps.maxPushDescriptors;
+			if (push_native && cmdPushDescriptorSet == nullptr)
+				cmdPushDescriptorSet = (PFN_vkCmdPushDescriptorSetKHR)vkGetDeviceProcAddr(GraphicsDevice::GetDevice(), "vkCmdPushDescriptorSetKHR");
+		}
 
+		VkDescriptorSetLayoutCreateFlags layout_flags = push_native ? VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR : 0;
 		pin_ptr<VkDescriptorSetLayout> desc_set_layout_ptr = &desc_set_layout;
-		if (vkCreateDescriptorSetLayout(GraphicsDevice::GetDevice(), &creatInfo, nullptr, desc_set_layout_ptr) != VK_SUCCESS)
+		if (GraphicsDevice::GetDescriptorLayoutCache()->Get(GraphicsDevice::GetDevice(), layout_flags, bindings.data(), static_cast<uint32_t>(bindings.size()), desc_set_layout_ptr) != VK_SUCCESS)
 			throw gcnew System::Exception("Failed to create descriptor set.");
 
-		std::vector<VkDescriptorPoolSize> psize(pool_entries->Count);
-		for (int i = 0; i < pool_entries->Count; i++) {
-			psize[i].type = DescriptorTypeConv::Convert(pool_entries[i]->Type);
-			psize[i].descriptorCount = static_cast<uint32_t>(pool_entries[i]->Count);
+		set_cnt = pool_sz;
+		sets = new VkDescriptorSet[set_cnt];
+		set_pools = new VkDescriptorPool[set_cnt];
+		for (int i = 0; i < set_cnt; i++) {
+			sets[i] = VK_NULL_HANDLE;
+			set_pools[i] = VK_NULL_HANDLE;
+		}
+		if (PushDescriptor)
+			push_writes = new DescriptorWriteBatch();
+		else if (!PerFrame)
+			AllocateSets(GraphicsDevice::GetDescriptorAllocator());
+
+		if (PushDescriptor) {
+			locked = true;
+			return;
 		}
 
-		VkDescriptorPoolCreateInfo poolCreatInfo = {};
-		poolCreatInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-		poolCreatInfo.flags = 0;
-		poolCreatInfo.maxSets = static_cast<uint32_t>(pool_sz);
-		poolCreatInfo.poolSizeCount = static_cast<uint32_t>(psize.size());
-		poolCreatInfo.pPoolSizes = psize.data();
-
-		pin_ptr<VkDescriptorPool> desc_pool_ptr = &desc_pool;
-		if (vkCreateDescriptorPool(GraphicsDevice::GetDevice(), &poolCreatInfo, nullptr, desc_pool_ptr) != VK_SUCCESS)
-			throw gcnew System::Exception("Failed to create descriptor pool.");
+		//The layout is fixed from here on, so describe it once as an update template
+		template_sz = 0;
+		std::vector<VkDescriptorUpdateTemplateEntry> template_entries(layouts->Count);
+		for (int i = 0; i < layouts->Count; i++) {
+			auto type = DescriptorTypeConv::Convert(layouts[i]->Type);
+			auto stride = GetTemplateElementSize(type);
+			layouts[i]->TemplateOffset = template_sz;
+
+			template_entries[i].dstBinding = static_cast<uint32_t>(layouts[i]->BindingIndex);
+			template_entries[i].dstArrayElement = 0;
+			template_entries[i].descriptorCount = static_cast<uint32_t>(layouts[i]->Count);
+			template_entries[i].descriptorType = type;
+			template_entries[i].offset = template_sz;
+			template_entries[i].stride = stride;
+			template_sz += stride * layouts[i]->Count;
+		}
 
-		set_cnt = pool_sz;
-		std::vector<VkDescriptorSetLayout> layout_sets(set_cnt);
-		for (int i = 0; i < set_cnt; i++)
-			layout_sets[i] = desc_set_layout;
+		//A template needs at least one entry, empty sets have nothing to update anyway
+		if (template_entries.empty()) {
+			locked = true;
+			return;
+		}
 
-		VkDescriptorSetAllocateInfo desc_set_alloc_info = {};
-		desc_set_alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-		desc_set_alloc_info.descriptorPool = desc_pool;
-		desc_set_alloc_info.descriptorSetCount = static_cast<uint32_t>(set_cnt);
-		desc_set_alloc_info.pSetLayouts = layout_sets.data();
+		VkDescriptorUpdateTemplateCreateInfo templateCreatInfo = {};
+		templateCreatInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO;
+		templateCreatInfo.flags = 0;
+		templateCreatInfo.descriptorUpdateEntryCount = static_cast<uint32_t>(template_entries.size());
+		templateCreatInfo.pDescriptorUpdateEntries = template_entries.data();
+		templateCreatInfo.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+		templateCreatInfo.descriptorSetLayout = desc_set_layout;
 
-		sets = new VkDescriptorSet[set_cnt];
-		if (vkAllocateDescriptorSets(GraphicsDevice::GetDevice(), &desc_set_alloc_info, sets) != VK_SUCCESS)
-			throw gcnew System::Exception("Failed to allocate descriptor sets.");
+		pin_ptr<VkDescriptorUpdateTemplate> desc_template_ptr = &desc_template;
+		if (vkCreateDescriptorUpdateTemplate(GraphicsDevice::GetDevice(), &templateCreatInfo, nullptr, desc_template_ptr) != VK_SUCCESS)
+			throw gcnew System::Exception("Failed to create descriptor update template.");
 
 		locked = true;
 	}
 }
 
-void Kokoro::Graphics::DescriptorSet::Set(int set, int binding, int idx, ImageView^ img, Sampler^ sampler)
+void Kokoro::Graphics::DescriptorSet::GetPoolSizes(std::vector<VkDescriptorPoolSize>& psize)
 {
-	if (set >= set_cnt)
-		throw gcnew System::IndexOutOfRangeException("set is out of range.");
+	psize.resize(pool_entries->Count);
+	for (int i = 0; i < pool_entries->Count; i++) {
+		psize[i].type = DescriptorTypeConv::Convert(pool_entries[i]->Type);
+		psize[i].descriptorCount = static_cast<uint32_t>(pool_entries[i]->Count);
+	}
+}
 
-	VkDescriptorImageInfo img_info = {};
-	img_info.sampler = sampler->GetSampler();
-	img_info.imageView = img->GetImageView();
-	img_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+void Kokoro::Graphics::DescriptorSet::AllocateSets(DescriptorAllocator* allocator)
+{
+	std::vector<VkDescriptorPoolSize> psize;
+	GetPoolSizes(psize);
 
-	VkWriteDescriptorSet desc_write = {};
-	desc_write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-	desc_write.dstSet = sets[set];
-	desc_write.dstBinding = static_cast<uint32_t>(binding);
-	desc_write.dstArrayElement = static_cast<uint32_t>(idx);
-	desc_write.descriptorCount = 1;
-	desc_write.pImageInfo = &img_info;
-	desc_write.pBufferInfo = nullptr;
-	desc_write.pTexelBufferView = nullptr;
+	for (int i = 0; i < set_cnt; i++)
+		if (allocator->Allocate(GraphicsDevice::GetDevice(), desc_set_layout, psize.data(), static_cast<uint32_t>(psize.size()), &set_pools[i], &sets[i]) != VK_SUCCESS)
+			throw gcnew System::Exception("Failed to allocate descriptor sets.");
+}
+
+void Kokoro::Graphics::DescriptorSet::AllocateFrameSets()
+{
+	if (!locked)
+		throw gcnew System::Exception("Descriptor set has not been built.");
+	if (!PerFrame || PushDescriptor)
+		throw gcnew System::InvalidOperationException("Only per frame descriptor sets can be reallocated.");
 
-	vkUpdateDescriptorSets(GraphicsDevice::GetDevice(), 1, &desc_write, 0, nullptr);
+	AllocateSets(GraphicsDevice::GetFrameDescriptorAllocator());
 }
 
-void Kokoro::Graphics::DescriptorSet::SetImageView(int set, int binding, int idx, ImageView^ img, bool rw)
+Kokoro::Graphics::DescriptorWriteBatch* Kokoro::Graphics::DescriptorSet::GetWriteBatch()
+{
+	if (writeBatch == nullptr)
+		writeBatch = new DescriptorWriteBatch();
+	return writeBatch;
+}
+
+void Kokoro::Graphics::DescriptorSet::SubmitWrites()
+{
+	if (!batching)
+		GetWriteBatch()->Flush(GraphicsDevice::GetDevice());
+}
+
+Kokoro::Graphics::DescriptorWriteBatch* Kokoro::Graphics::DescriptorSet::BeginWrite(int set, VkDescriptorSet* target)
 {
 	if (set >= set_cnt)
 		throw gcnew System::IndexOutOfRangeException("set is out of range.");
 
-	VkDescriptorImageInfo img_info = {};
-	img_info.sampler = nullptr;
-	img_info.imageView = img->GetImageView();
-	img_info.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+	//Push descriptor writes are held until the set is pushed into a command buffer
+	if (PushDescriptor) {
+		*target = VK_NULL_HANDLE;
+		return push_writes;
+	}
+	*target = sets[set];
+	return GetWriteBatch();
+}
+
+void Kokoro::Graphics::DescriptorSet::EndWrite()
+{
+	if (!PushDescriptor)
+		SubmitWrites();
+}
 
-	VkWriteDescriptorSet desc_write = {};
-	desc_write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-	desc_write.dstSet = sets[set];
-	desc_write.dstBinding = static_cast<uint32_t>(binding);
-	desc_write.dstArrayElement = static_cast<uint32_t>(idx);
-	desc_write.descriptorCount = 1;
-	desc_write.pImageInfo = &img_info;
-	desc_write.pBufferInfo = nullptr;
-	desc_write.pTexelBufferView = nullptr;
+void Kokoro::Graphics::DescriptorSet::Push(VkCommandBuffer cmd, VkPipelineBindPoint bindPoint, VkPipelineLayout pipelineLayout, uint32_t setIndex)
+{
+	if (!locked)
+		throw gcnew System::Exception("Descriptor set has not been built.");
+	if (!PushDescriptor)
+		throw gcnew System::InvalidOperationException("Only push descriptor sets can be pushed.");
 
-	vkUpdateDescriptorSets(GraphicsDevice::GetDevice(), 1, &desc_write, 0, nullptr);
+	if (push_native) {
+		push_writes->Push(cmd, bindPoint, pipelineLayout, setIndex, cmdPushDescriptorSet);
+	}
+	else {
+		//Without VK_KHR_push_descriptor, write into a set from the current frame's pools and bind that instead
+		std::vector<VkDescriptorPoolSize> psize;
+		GetPoolSizes(psize);
+
+		VkDescriptorPool pool;
+		VkDescriptorSet set;
+		if (GraphicsDevice::GetFrameDescriptorAllocator()->Allocate(GraphicsDevice::GetDevice(), desc_set_layout, psize.data(), static_cast<uint32_t>(psize.size()), &pool, &set) != VK_SUCCESS)
+			throw gcnew System::Exception("Failed to allocate descriptor sets.");
+
+		push_writes->FlushTo(GraphicsDevice::GetDevice(), set);
+		vkCmdBindDescriptorSets(cmd, bindPoint, pipelineLayout, setIndex, 1, &set, 0, nullptr);
+	}
 }
 
-void Kokoro::Graphics::DescriptorSet::Set(int set, int binding, int idx, GPUBuffer^ buf, size_t off, size_t len)
+VkDescriptorType Kokoro::Graphics::DescriptorSet::GetBindingType(int binding)
 {
-	if (set >= set_cnt)
-		throw gcnew System::IndexOutOfRangeException("set is out of range.");
+	for (int i = 0; i < layouts->Count; i++)
+		if (layouts[i]->BindingIndex == binding)
+			return DescriptorTypeConv::Convert(layouts[i]->Type);
+	throw gcnew System::ArgumentOutOfRangeException("binding", "binding is not part of this descriptor set.");
+}
+
+void Kokoro::Graphics::DescriptorSet::BeginBatch()
+{
+	batching = true;
+}
+
+void Kokoro::Graphics::DescriptorSet::FlushBatch()
+{
+	batching = false;
+	GetWriteBatch()->Flush(GraphicsDevice::GetDevice());
+}
 
-	VkDescriptorBufferInfo buf_info = {};
-	buf_info.buffer = buf->GetBuffer();
-	buf_info.offset = off;
-	buf_info.range = len;
+uint32_t Kokoro::Graphics::DescriptorSet::GetFrameDescriptorCount()
+{
+	return GetWriteBatch()->GetDescriptorCount();
+}
+
+uint32_t Kokoro::Graphics::DescriptorSet::GetFrameWriteCount()
+{
+	return GetWriteBatch()->GetWriteCount();
+}
+
+uint32_t Kokoro::Graphics::DescriptorSet::GetFrameUpdateCallCount()
+{
+	return GetWriteBatch()->GetUpdateCallCount();
+}
+
+void Kokoro::Graphics::DescriptorSet::ResetFrameCounters()
+{
+	GetWriteBatch()->ResetCounters();
+}
+
+void Kokoro::Graphics::DescriptorSet::Set(int set, int binding, int idx, ImageView^ img, Sampler^ sampler)
+{
+	auto layout = (ImageFormatConv::Aspect(img->Format) & VK_IMAGE_ASPECT_DEPTH_BIT) ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	VkDescriptorSet target;
+	BeginWrite(set, &target)->WriteImage(target, static_cast<uint32_t>(binding), static_cast<uint32_t>(idx), GetBindingType(binding), sampler == nullptr ? VK_NULL_HANDLE : sampler->GetSampler(), img->GetImageView(), layout);
+	EndWrite();
+}
 
-	VkWriteDescriptorSet desc_write = {};
-	desc_write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-	desc_write.dstSet = sets[set];
-	desc_write.dstBinding = static_cast<uint32_t>(binding);
-	desc_write.dstArrayElement = static_cast<uint32_t>(idx);
-	desc_write.descriptorCount = 1;
-	desc_write.pImageInfo = nullptr;
-	desc_write.pBufferInfo = &buf_info;
-	desc_write.pTexelBufferView = nullptr;
+void Kokoro::Graphics::DescriptorSet::SetImageView(int set, int binding, int idx, ImageView^ img, bool rw)
+{
+	//Storage images and images also written elsewhere while sampled are in GENERAL, depth is read in its read-only layout
+	auto type = GetBindingType(binding);
+	VkImageLayout layout;
+	if (type == VK_DESCRIPTOR_TYPE_STORAGE_IMAGE || rw)
+		layout = VK_IMAGE_LAYOUT_GENERAL;
+	else if (ImageFormatConv::Aspect(img->Format) & VK_IMAGE_ASPECT_DEPTH_BIT)
+		layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+	else
+		layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	VkDescriptorSet target;
+	BeginWrite(set, &target)->WriteImage(target, static_cast<uint32_t>(binding), static_cast<uint32_t>(idx), type, nullptr, img->GetImageView(), layout);
+	EndWrite();
+}
 
-	vkUpdateDescriptorSets(GraphicsDevice::GetDevice(), 1, &desc_write, 0, nullptr);
+void Kokoro::Graphics::DescriptorSet::Set(int set, int binding, int idx, GPUBuffer^ buf, size_t off, size_t len)
+{
+	VkDescriptorSet target;
+	BeginWrite(set, &target)->WriteBuffer(target, static_cast<uint32_t>(binding), static_cast<uint32_t>(idx), GetBindingType(binding), buf->GetBuffer(), off, len);
+	EndWrite();
 }
 
 void Kokoro::Graphics::DescriptorSet::SetBufferView(int set, int binding, int idx, GPUBuffer^ buf)
+{
+	VkDescriptorSet target;
+	BeginWrite(set, &target)->WriteTexelBuffer(target, static_cast<uint32_t>(binding), static_cast<uint32_t>(idx), GetBindingType(binding), buf->GetView());
+	EndWrite();
+}
+
+size_t Kokoro::Graphics::DescriptorSet::GetTemplateSize()
+{
+	if (!locked)
+		throw gcnew System::Exception("Descriptor set has not been built.");
+	return template_sz;
+}
+
+size_t Kokoro::Graphics::DescriptorSet::GetTemplateOffset(int binding, int idx)
+{
+	if (!locked)
+		throw gcnew System::Exception("Descriptor set has not been built.");
+	for (int i = 0; i < layouts->Count; i++)
+		if (layouts[i]->BindingIndex == binding) {
+			if (idx >= layouts[i]->Count)
+				throw gcnew System::IndexOutOfRangeException("idx is out of range.");
+			return layouts[i]->TemplateOffset + GetTemplateElementSize(DescriptorTypeConv::Convert(layouts[i]->Type)) * idx;
+		}
+	throw gcnew System::ArgumentOutOfRangeException("binding", "binding is not part of this descriptor set.");
+}
+
+void Kokoro::Graphics::DescriptorSet::UpdateFromTemplate(int set, const void* data)
 {
 	if (set >= set_cnt)
 		throw gcnew System::IndexOutOfRangeException("set is out of range.");
+	if (desc_template == VK_NULL_HANDLE)
+		return;
 
-	auto view = buf->GetView();
+	vkUpdateDescriptorSetWithTemplate(GraphicsDevice::GetDevice(), sets[set], desc_template, data);
+}
+
+void Kokoro::Graphics::DescriptorSet::UpdateFromTemplate(int set, IntPtr data)
+{
+	UpdateFromTemplate(set, data.ToPointer());
+}
 
-	VkWriteDescriptorSet desc_write = {};
-	desc_write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-	desc_write.dstSet = sets[set];
-	desc_write.dstBinding = static_cast<uint32_t>(binding);
-	desc_write.dstArrayElement = static_cast<uint32_t>(idx);
-	desc_write.descriptorCount = 1;
-	desc_write.pImageInfo = nullptr;
-	desc_write.pBufferInfo = nullptr;
-	desc_write.pTexelBufferView = &view;
+Kokoro::Graphics::DescriptorSet::UpdateTimings Kokoro::Graphics::DescriptorSet::BenchmarkUpdates(int set, IntPtr data, int iterations)
+{
+	if (!locked)
+		throw gcnew System::Exception("Descriptor set has not been built.");
+	if (PushDescriptor || set >= set_cnt || sets[set] == VK_NULL_HANDLE)
+		throw gcnew System::InvalidOperationException("Only allocated descriptor sets can be benchmarked.");
+
+	//The per-binding path as Set* used it before batching, one vkUpdateDescriptorSets per binding read from the same packed block
+	auto bytes = static_cast<const uint8_t*>(data.ToPointer());
+	std::vector<VkWriteDescriptorSet> writes(layouts->Count);
+	for (int i = 0; i < layouts->Count; i++) {
+		auto type = DescriptorTypeConv::Convert(layouts[i]->Type);
+		auto entry = bytes + layouts[i]->TemplateOffset;
+		writes[i] = {};
+		writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writes[i].dstSet = sets[set];
+		writes[i].dstBinding = static_cast<uint32_t>(layouts[i]->BindingIndex);
+		writes[i].descriptorCount = static_cast<uint32_t>(layouts[i]->Count);
+		writes[i].descriptorType = type;
+		switch (type) {
+		case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+		case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
+		case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC:
+		case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC:
+			writes[i].pBufferInfo = reinterpret_cast<const VkDescriptorBufferInfo*>(entry);
+			break;
+		case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
+		case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
+			writes[i].pTexelBufferView = reinterpret_cast<const VkBufferView*>(entry);
+			break;
+		default:
+			writes[i].pImageInfo = reinterpret_cast<const VkDescriptorImageInfo*>(entry);
+			break;
+		}
+	}
 
-	vkUpdateDescriptorSets(GraphicsDevice::GetDevice(), 1, &desc_write, 0, nullptr);
+	auto dev = GraphicsDevice::GetDevice();
+	auto watch = System::Diagnostics::Stopwatch::StartNew();
+	for (int n = 0; n < iterations; n++)
+		for (auto& w : writes)
+			vkUpdateDescriptorSets(dev, 1, &w, 0, nullptr);
+	watch->Stop();
+
+	UpdateTimings timings;
+	timings.PerBindingMs = watch->Elapsed.TotalMilliseconds;
+	watch->Restart();
+	for (int n = 0; n < iterations; n++)
+		UpdateFromTemplate(set, data.ToPointer());
+	watch->Stop();
+	timings.TemplateMs = watch->Elapsed.TotalMilliseconds;
+	return timings;
 }
@@ -4,6 +4,7 @@
 #include "ImageView.h"
 #include "Sampler.h"
 #include "GPUBuffer.h"
+#include "DescriptorWriteBatch.h"
 
 using namespace System::Collections::Generic;
 
@@ -65,8 +66,15 @@ namespace Kokoro::Graphics {
 		}
 	};
 
+	ref class ShaderModule;
 	ref class DescriptorSet
 	{
+	public:
+		value struct UpdateTimings {
+		public:
+			double PerBindingMs;
+			double TemplateMs;
+		};
 	private:
 		ref struct DescriptorLayout {
 		public:
@@ -74,6 +82,8 @@ namespace Kokoro::Graphics {
 			property DescriptorType Type;
 			property int Count;
 			property ShaderType Stages;
+			property size_t TemplateOffset;
+			property Sampler^ Immutable;
 		};
 		ref struct PoolEntry {
 		public:
@@ -86,23 +96,71 @@ namespace Kokoro::Graphics {
 
 		bool locked;
 		VkDescriptorSetLayout desc_set_layout;
-		VkDescriptorPool desc_pool;
 		VkDescriptorSet* sets;
+		VkDescriptorPool* set_pools;
 		int set_cnt;
+		VkDescriptorUpdateTemplate desc_template;
+		size_t template_sz;
+		DescriptorWriteBatch* push_writes;
+		bool push_native;
+
+		static DescriptorWriteBatch* writeBatch;
+		static bool batching;
+		static DescriptorWriteBatch* GetWriteBatch();
+		static void SubmitWrites();
+		VkDescriptorType GetBindingType(int binding);
+		void GetPoolSizes(std::vector<VkDescriptorPoolSize>& psize);
+		void AllocateSets(DescriptorAllocator* allocator);
+		DescriptorWriteBatch* BeginWrite(int set, VkDescriptorSet* target);
+		void EndWrite();
 	internal:
 		VkDescriptorSetLayout GetLayout();
-		VkDescriptorPool GetPool();
+		//Encodes the layout's bindings rather than its handle, for pipeline state keys.
+		void AppendLayoutKey(PipelineStateKey& key);
 		VkDescriptorSet GetSet(int idx);
 		int GetSetCount();
+		void UpdateFromTemplate(int set, const void* data);
+		//Records every binding written so far into cmd, the set index passed to Set* is ignored for push descriptor sets.
+		void Push(VkCommandBuffer cmd, VkPipelineBindPoint bindPoint, VkPipelineLayout pipelineLayout, uint32_t setIndex);
 	public:
+		//Per frame sets are not allocated by Build, AllocateFrameSets must be called every frame after GraphicsDevice::AdvanceFrame.
+		property bool PerFrame;
+		//Push descriptor sets are written straight into the command buffer by Push, falling back to per frame sets without VK_KHR_push_descriptor.
+		property bool PushDescriptor;
+
 		DescriptorSet();
 		~DescriptorSet();
 		void Add(int bindingIndex, DescriptorType type, int count, ShaderType stages);
+		//Bakes immutableSampler into the layout for every element of a Sampler or CombinedImageSampler binding,
+		//the sampler passed to Set is ignored for such bindings.
+		void Add(int bindingIndex, DescriptorType type, int count, ShaderType stages, Sampler^ immutableSampler);
+		//Adds every binding the shaders declare in set setIndex, each visible only to the stages that use it.
+		//Runtime sized arrays are skipped, they belong to the BindlessHeap.
+		void AddFromShaders(int setIndex, ... array<ShaderModule^>^ shaders);
 		void Build(int pool_sz);
+		void AllocateFrameSets();
 		void Set(int set, int binding, int idx, ImageView^ img, Sampler^ sampler);
 		void Set(int set, int binding, int idx, GPUBuffer^ buf, size_t off, size_t len);
+		//rw images are expected in GENERAL, depth images in DEPTH_STENCIL_READ_ONLY_OPTIMAL.
 		void SetImageView(int set, int binding, int idx, ImageView^ img, bool rw);
 		void SetBufferView(int set, int binding, int idx, GPUBuffer^ buf);
+
+		//Template updates rewrite the whole set from a packed block of VkDescriptorImageInfo/VkDescriptorBufferInfo/VkBufferView
+		//entries, laid out in binding order as reported by GetTemplateOffset. They are applied immediately, not batched.
+		size_t GetTemplateSize();
+		size_t GetTemplateOffset(int binding, int idx);
+		void UpdateFromTemplate(int set, IntPtr data);
+		//Rewrites set iterations times from the same packed block, once per binding through vkUpdateDescriptorSets and once
+		//through the template, and reports the time each took. The set must not be in use by the GPU.
+		UpdateTimings BenchmarkUpdates(int set, IntPtr data, int iterations);
+
+		//While batching, Set* calls are queued and submitted together by FlushBatch.
+		static void BeginBatch();
+		static void FlushBatch();
+		static uint32_t GetFrameDescriptorCount();
+		static uint32_t GetFrameWriteCount();
+		static uint32_t GetFrameUpdateCallCount();
+		static void ResetFrameCounters();
 	};
 }
 
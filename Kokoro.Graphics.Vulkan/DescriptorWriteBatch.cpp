@@ -0,0 +1,174 @@
+#include "DescriptorWriteBatch.h"
+#include <algorithm>
+#include <functional>
+
+Kokoro::Graphics::DescriptorWriteBatch::DescriptorWriteBatch() {
+	descriptorCnt = 0;
+	writeCnt = 0;
+	updateCallCnt = 0;
+}
+
+Kokoro::Graphics::DescriptorWriteBatch::PendingWrite& Kokoro::Graphics::DescriptorWriteBatch::Queue(VkDescriptorSet set, uint32_t binding, uint32_t element, VkDescriptorType type, WriteKind kind) {
+	PendingWrite w = {};
+	w.set = set;
+	w.binding = binding;
+	w.element = element;
+	w.type = type;
+	w.kind = kind;
+	w.seq = static_cast<uint32_t>(pending.size());
+	pending.push_back(w);
+	return pending.back();
+}
+
+void Kokoro::Graphics::DescriptorWriteBatch::WriteImage(VkDescriptorSet set, uint32_t binding, uint32_t element, VkDescriptorType type, VkSampler sampler, VkImageView view, VkImageLayout layout) {
+	auto& w = Queue(set, binding, element, type, WriteKind::Image);
+	w.img.sampler = sampler;
+	w.img.imageView = view;
+	w.img.imageLayout = layout;
+}
+
+void Kokoro::Graphics::DescriptorWriteBatch::WriteBuffer(VkDescriptorSet set, uint32_t binding, uint32_t element, VkDescriptorType type, VkBuffer buf, VkDeviceSize off, VkDeviceSize len) {
+	auto& w = Queue(set, binding, element, type, WriteKind::Buffer);
+	w.buf.buffer = buf;
+	w.buf.offset = off;
+	w.buf.range = len;
+}
+
+void Kokoro::Graphics::DescriptorWriteBatch::WriteTexelBuffer(VkDescriptorSet set, uint32_t binding, uint32_t element, VkDescriptorType type, VkBufferView view) {
+	auto& w = Queue(set, binding, element, type, WriteKind::TexelBuffer);
+	w.texel = view;
+}
+
+size_t Kokoro::Graphics::DescriptorWriteBatch::GetPendingCount() {
+	return pending.size();
+}
+
+void Kokoro::Graphics::DescriptorWriteBatch::Discard(VkDescriptorSet set) {
+	pending.erase(std::remove_if(pending.begin(), pending.end(), [set](const PendingWrite& w) { return w.set == set; }), pending.end());
+}
+
+void Kokoro::Graphics::DescriptorWriteBatch::BuildWrites(bool retain) {
+	//Order by destination so that consecutive array elements end up adjacent, later writes to the same element win
+	std::less<VkDescriptorSet> set_less;
+	std::sort(pending.begin(), pending.end(), [&set_less](const PendingWrite& a, const PendingWrite& b) {
+		if (a.set != b.set) return set_less(a.set, b.set);
+		if (a.binding != b.binding) return a.binding < b.binding;
+		if (a.element != b.element) return a.element < b.element;
+		return a.seq < b.seq;
+		});
+
+	imgInfos.clear();
+	bufInfos.clear();
+	texelViews.clear();
+	writes.clear();
+	imgInfos.reserve(pending.size());
+	bufInfos.reserve(pending.size());
+	texelViews.reserve(pending.size());
+	writes.reserve(pending.size());
+
+	size_t kept = 0;
+	for (size_t i = 0; i < pending.size(); i++) {
+		auto& p = pending[i];
+		if (i + 1 < pending.size() && pending[i + 1].set == p.set && pending[i + 1].binding == p.binding && pending[i + 1].element == p.element)
+			continue;	//Superseded by a later write
+		if (retain) {
+			pending[kept] = p;
+			pending[kept].seq = static_cast<uint32_t>(kept);
+			kept++;
+		}
+
+		bool extend = false;
+		if (!writes.empty()) {
+			auto& prev = writes.back();
+			extend = prev.dstSet == p.set && prev.dstBinding == p.binding && prev.descriptorType == p.type &&
+				prev.dstArrayElement + prev.descriptorCount == p.element;
+			if (extend) {
+				switch (p.kind) {
+				case WriteKind::Image: extend = prev.pImageInfo != nullptr; break;
+				case WriteKind::Buffer: extend = prev.pBufferInfo != nullptr; break;
+				case WriteKind::TexelBuffer: extend = prev.pTexelBufferView != nullptr; break;
+				}
+			}
+		}
+
+		if (!extend) {
+			VkWriteDescriptorSet desc_write = {};
+			desc_write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			desc_write.dstSet = p.set;
+			desc_write.dstBinding = p.binding;
+			desc_write.dstArrayElement = p.element;
+			desc_write.descriptorCount = 0;
+			desc_write.descriptorType = p.type;
+			desc_write.pImageInfo = nullptr;
+			desc_write.pBufferInfo = nullptr;
+			desc_write.pTexelBufferView = nullptr;
+
+			//The info arrays are reserved up front so these pointers stay valid until the update is submitted
+			switch (p.kind) {
+			case WriteKind::Image: desc_write.pImageInfo = imgInfos.data() + imgInfos.size(); break;
+			case WriteKind::Buffer: desc_write.pBufferInfo = bufInfos.data() + bufInfos.size(); break;
+			case WriteKind::TexelBuffer: desc_write.pTexelBufferView = texelViews.data() + texelViews.size(); break;
+			}
+			writes.push_back(desc_write);
+		}
+
+		switch (p.kind) {
+		case WriteKind::Image: imgInfos.push_back(p.img); break;
+		case WriteKind::Buffer: bufInfos.push_back(p.buf); break;
+		case WriteKind::TexelBuffer: texelViews.push_back(p.texel); break;
+		}
+		writes.back().descriptorCount++;
+		descriptorCnt++;
+	}
+
+	writeCnt += static_cast<uint32_t>(writes.size());
+	pending.resize(kept);
+}
+
+void Kokoro::Graphics::DescriptorWriteBatch::Flush(VkDevice dev) {
+	if (pending.empty())
+		return;
+
+	BuildWrites(false);
+	vkUpdateDescriptorSets(dev, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+	updateCallCnt++;
+}
+
+void Kokoro::Graphics::DescriptorWriteBatch::FlushTo(VkDevice dev, VkDescriptorSet set) {
+	if (pending.empty())
+		return;
+
+	BuildWrites(true);
+	for (auto& w : writes)
+		w.dstSet = set;
+	vkUpdateDescriptorSets(dev, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+	updateCallCnt++;
+}
+
+void Kokoro::Graphics::DescriptorWriteBatch::Push(VkCommandBuffer cmd, VkPipelineBindPoint bindPoint, VkPipelineLayout layout, uint32_t set, PFN_vkCmdPushDescriptorSetKHR pushFn) {
+	if (pending.empty())
+		return;
+
+	BuildWrites(true);
+	for (auto& w : writes)
+		w.dstSet = VK_NULL_HANDLE;
+	pushFn(cmd, bindPoint, layout, set, static_cast<uint32_t>(writes.size()), writes.data());
+}
+
+uint32_t Kokoro::Graphics::DescriptorWriteBatch::GetDescriptorCount() {
+	return descriptorCnt;
+}
+
+uint32_t Kokoro::Graphics::DescriptorWriteBatch::GetWriteCount() {
+	return writeCnt;
+}
+
+uint32_t Kokoro::Graphics::DescriptorWriteBatch::GetUpdateCallCount() {
+	return updateCallCnt;
+}
+
+void Kokoro::Graphics::DescriptorWriteBatch::ResetCounters() {
+	descriptorCnt = 0;
+	writeCnt = 0;
+	updateCallCnt = 0;
+}
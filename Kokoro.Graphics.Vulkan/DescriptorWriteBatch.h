@@ -0,0 +1,69 @@
+#pragma once
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#define VK_USE_PLATFORM_WIN32_KHR
+#endif
+#include "vulkan/vulkan.h"
+#include <vector>
+
+namespace Kokoro::Graphics {
+	//Collects descriptor writes and submits them with a single vkUpdateDescriptorSets call.
+	//Writes to consecutive array elements of the same binding are coalesced into one VkWriteDescriptorSet.
+	class DescriptorWriteBatch
+	{
+	private:
+		enum class WriteKind {
+			Image,
+			Buffer,
+			TexelBuffer,
+		};
+		struct PendingWrite {
+			VkDescriptorSet set;
+			uint32_t binding;
+			uint32_t element;
+			VkDescriptorType type;
+			WriteKind kind;
+			uint32_t seq;
+			VkDescriptorImageInfo img;
+			VkDescriptorBufferInfo buf;
+			VkBufferView texel;
+		};
+
+		std::vector<PendingWrite> pending;
+		std::vector<VkDescriptorImageInfo> imgInfos;
+		std::vector<VkDescriptorBufferInfo> bufInfos;
+		std::vector<VkBufferView> texelViews;
+		std::vector<VkWriteDescriptorSet> writes;
+
+		uint32_t descriptorCnt;
+		uint32_t writeCnt;
+		uint32_t updateCallCnt;
+
+		//retain keeps the latest write to every element queued for the next build instead of clearing them
+		void BuildWrites(bool retain);
+		PendingWrite& Queue(VkDescriptorSet set, uint32_t binding, uint32_t element, VkDescriptorType type, WriteKind kind);
+	public:
+		DescriptorWriteBatch();
+
+		void WriteImage(VkDescriptorSet set, uint32_t binding, uint32_t element, VkDescriptorType type, VkSampler sampler, VkImageView view, VkImageLayout layout);
+		void WriteBuffer(VkDescriptorSet set, uint32_t binding, uint32_t element, VkDescriptorType type, VkBuffer buf, VkDeviceSize off, VkDeviceSize len);
+		void WriteTexelBuffer(VkDescriptorSet set, uint32_t binding, uint32_t element, VkDescriptorType type, VkBufferView view);
+		size_t GetPendingCount();
+		//Drops the pending writes to set, for sets freed before the batch is flushed.
+		void Discard(VkDescriptorSet set);
+		void Flush(VkDevice dev);
+		//FlushTo and Push treat the batch as the full state of one set: every element written so far is sent each time,
+		//and later writes replace earlier ones to the same element. Use Discard to forget a set's state.
+		//Submits the writes against a different set, used when writes were queued before the set existed.
+		void FlushTo(VkDevice dev, VkDescriptorSet set);
+		//Records the writes into cmd with vkCmdPushDescriptorSetKHR instead of updating a set.
+		void Push(VkCommandBuffer cmd, VkPipelineBindPoint bindPoint, VkPipelineLayout layout, uint32_t set, PFN_vkCmdPushDescriptorSetKHR pushFn);
+
+		//Descriptors written, VkWriteDescriptorSet entries submitted and vkUpdateDescriptorSets calls made since the last ResetCounters.
+		uint32_t GetDescriptorCount();
+		uint32_t GetWriteCount();
+		uint32_t GetUpdateCallCount();
+		void ResetCounters();
+	};
+}
@@ -0,0 +1,137 @@
+#include "DynamicStateTracker.h"
+#include <cstring>
+
+Kokoro::Graphics::DynamicStateTracker::DynamicStateTracker(VkDevice dev) {
+	cmd = VK_NULL_HANDLE;
+	pipeline = VK_NULL_HANDLE;
+	valid = 0;
+	viewport = {};
+	scissor = {};
+	lineWidth = 0.0f;
+	raster = {};
+	issuedCnt = 0;
+	skippedCnt = 0;
+
+#ifdef VK_EXT_extended_dynamic_state
+	cmdSetCullMode = (PFN_vkCmdSetCullModeEXT)vkGetDeviceProcAddr(dev, "vkCmdSetCullModeEXT");
+	cmdSetFrontFace = (PFN_vkCmdSetFrontFaceEXT)vkGetDeviceProcAddr(dev, "vkCmdSetFrontFaceEXT");
+	cmdSetPrimitiveTopology = (PFN_vkCmdSetPrimitiveTopologyEXT)vkGetDeviceProcAddr(dev, "vkCmdSetPrimitiveTopologyEXT");
+	cmdSetDepthTestEnable = (PFN_vkCmdSetDepthTestEnableEXT)vkGetDeviceProcAddr(dev, "vkCmdSetDepthTestEnableEXT");
+	cmdSetDepthWriteEnable = (PFN_vkCmdSetDepthWriteEnableEXT)vkGetDeviceProcAddr(dev, "vkCmdSetDepthWriteEnableEXT");
+	cmdSetDepthCompareOp = (PFN_vkCmdSetDepthCompareOpEXT)vkGetDeviceProcAddr(dev, "vkCmdSetDepthCompareOpEXT");
+#endif
+#ifdef VK_EXT_extended_dynamic_state2
+	cmdSetRasterizerDiscardEnable = (PFN_vkCmdSetRasterizerDiscardEnableEXT)vkGetDeviceProcAddr(dev, "vkCmdSetRasterizerDiscardEnableEXT");
+#endif
+#ifdef VK_EXT_extended_dynamic_state3
+	cmdSetPolygonMode = (PFN_vkCmdSetPolygonModeEXT)vkGetDeviceProcAddr(dev, "vkCmdSetPolygonModeEXT");
+	cmdSetDepthClampEnable = (PFN_vkCmdSetDepthClampEnableEXT)vkGetDeviceProcAddr(dev, "vkCmdSetDepthClampEnableEXT");
+#endif
+}
+
+void Kokoro::Graphics::DynamicStateTracker::Begin(VkCommandBuffer cmd) {
+	this->cmd = cmd;
+	pipeline = VK_NULL_HANDLE;
+	valid = 0;
+}
+
+bool Kokoro::Graphics::DynamicStateTracker::Changed(uint32_t bit, bool differs) {
+	if ((valid & bit) && !differs) {
+		skippedCnt++;
+		return false;
+	}
+	valid |= bit;
+	issuedCnt++;
+	return true;
+}
+
+void Kokoro::Graphics::DynamicStateTracker::BindPipeline(VkPipeline p, uint32_t dynamicMask) {
+	//State baked into the new pipeline leaves the matching dynamic state undefined
+	valid &= dynamicMask;
+	if (p == pipeline) {
+		skippedCnt++;
+		return;
+	}
+	pipeline = p;
+	issuedCnt++;
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, p);
+}
+
+void Kokoro::Graphics::DynamicStateTracker::SetViewport(const VkViewport& v) {
+	if (!Changed(DynamicViewport, memcmp(&v, &viewport, sizeof(v)) != 0))
+		return;
+	viewport = v;
+	vkCmdSetViewport(cmd, 0, 1, &v);
+}
+
+void Kokoro::Graphics::DynamicStateTracker::SetScissor(const VkRect2D& s) {
+	if (!Changed(DynamicScissor, memcmp(&s, &scissor, sizeof(s)) != 0))
+		return;
+	scissor = s;
+	vkCmdSetScissor(cmd, 0, 1, &s);
+}
+
+void Kokoro::Graphics::DynamicStateTracker::SetLineWidth(float w) {
+	if (!Changed(DynamicLineWidth, w != lineWidth))
+		return;
+	lineWidth = w;
+	vkCmdSetLineWidth(cmd, w);
+}
+
+void Kokoro::Graphics::DynamicStateTracker::SetRasterState(const RasterState& r, uint32_t mask) {
+#ifdef VK_EXT_extended_dynamic_state
+	if ((mask & DynamicCullMode) && Changed(DynamicCullMode, r.cullMode != raster.cullMode)) {
+		raster.cullMode = r.cullMode;
+		cmdSetCullMode(cmd, r.cullMode);
+	}
+	if ((mask & DynamicFrontFace) && Changed(DynamicFrontFace, r.frontFace != raster.frontFace)) {
+		raster.frontFace = r.frontFace;
+		cmdSetFrontFace(cmd, r.frontFace);
+	}
+	if ((mask & DynamicTopology) && Changed(DynamicTopology, r.topology != raster.topology)) {
+		raster.topology = r.topology;
+		cmdSetPrimitiveTopology(cmd, r.topology);
+	}
+	if ((mask & DynamicDepthTest) && Changed(DynamicDepthTest, r.depthTest != raster.depthTest)) {
+		raster.depthTest = r.depthTest;
+		cmdSetDepthTestEnable(cmd, r.depthTest ? VK_TRUE : VK_FALSE);
+	}
+	if ((mask & DynamicDepthWrite) && Changed(DynamicDepthWrite, r.depthWrite != raster.depthWrite)) {
+		raster.depthWrite = r.depthWrite;
+		cmdSetDepthWriteEnable(cmd, r.depthWrite ? VK_TRUE : VK_FALSE);
+	}
+	if ((mask & DynamicDepthCompare) && Changed(DynamicDepthCompare, r.depthCompare != raster.depthCompare)) {
+		raster.depthCompare = r.depthCompare;
+		cmdSetDepthCompareOp(cmd, r.depthCompare);
+	}
+#endif
+#ifdef VK_EXT_extended_dynamic_state2
+	if ((mask & DynamicRasterizerDiscard) && Changed(DynamicRasterizerDiscard, r.rasterizerDiscard != raster.rasterizerDiscard)) {
+		raster.rasterizerDiscard = r.rasterizerDiscard;
+		cmdSetRasterizerDiscardEnable(cmd, r.rasterizerDiscard ? VK_TRUE : VK_FALSE);
+	}
+#endif
+#ifdef VK_EXT_extended_dynamic_state3
+	if ((mask & DynamicPolygonMode) && Changed(DynamicPolygonMode, r.polygonMode != raster.polygonMode)) {
+		raster.polygonMode = r.polygonMode;
+		cmdSetPolygonMode(cmd, r.polygonMode);
+	}
+	if ((mask & DynamicDepthClamp) && Changed(DynamicDepthClamp, r.depthClamp != raster.depthClamp)) {
+		raster.depthClamp = r.depthClamp;
+		cmdSetDepthClampEnable(cmd, r.depthClamp ? VK_TRUE : VK_FALSE);
+	}
+#endif
+}
+
+uint32_t Kokoro::Graphics::DynamicStateTracker::GetIssuedCount() {
+	return issuedCnt;
+}
+
+uint32_t Kokoro::Graphics::DynamicStateTracker::GetSkippedCount() {
+	return skippedCnt;
+}
+
+void Kokoro::Graphics::DynamicStateTracker::ResetCounters() {
+	issuedCnt = 0;
+	skippedCnt = 0;
+}
@@ -0,0 +1,96 @@
+#pragma once
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#define VK_USE_PLATFORM_WIN32_KHR
+#endif
+#include "vulkan/vulkan.h"
+#include "VulkanExtensions.h"
+
+namespace Kokoro::Graphics {
+	//Pipeline state that can be left out of a pipeline and set while recording instead.
+	enum DynamicStateBits : uint32_t {
+		DynamicViewport = 1 << 0,
+		DynamicScissor = 1 << 1,
+		DynamicLineWidth = 1 << 2,
+		//VK_EXT_extended_dynamic_state
+		DynamicCullMode = 1 << 3,
+		DynamicFrontFace = 1 << 4,
+		//Within the topology class the pipeline was built with
+		DynamicTopology = 1 << 5,
+		DynamicDepthTest = 1 << 6,
+		DynamicDepthWrite = 1 << 7,
+		DynamicDepthCompare = 1 << 8,
+		//VK_EXT_extended_dynamic_state2
+		DynamicRasterizerDiscard = 1 << 9,
+		//VK_EXT_extended_dynamic_state3
+		DynamicPolygonMode = 1 << 10,
+		DynamicDepthClamp = 1 << 11,
+
+		DynamicCoreStates = DynamicViewport | DynamicScissor | DynamicLineWidth,
+	};
+
+	struct RasterState {
+		VkCullModeFlags cullMode;
+		VkFrontFace frontFace;
+		VkPrimitiveTopology topology;
+		bool depthTest;
+		bool depthWrite;
+		VkCompareOp depthCompare;
+		bool rasterizerDiscard;
+		VkPolygonMode polygonMode;
+		bool depthClamp;
+	};
+
+	//Records dynamic state into one command buffer at a time and drops calls that wouldn't change anything.
+	class DynamicStateTracker
+	{
+	private:
+		VkCommandBuffer cmd;
+		VkPipeline pipeline;
+		//States whose current value is known to be set on cmd
+		uint32_t valid;
+		VkViewport viewport;
+		VkRect2D scissor;
+		float lineWidth;
+		RasterState raster;
+
+		uint32_t issuedCnt;
+		uint32_t skippedCnt;
+
+#ifdef VK_EXT_extended_dynamic_state
+		PFN_vkCmdSetCullModeEXT cmdSetCullMode;
+		PFN_vkCmdSetFrontFaceEXT cmdSetFrontFace;
+		PFN_vkCmdSetPrimitiveTopologyEXT cmdSetPrimitiveTopology;
+		PFN_vkCmdSetDepthTestEnableEXT cmdSetDepthTestEnable;
+		PFN_vkCmdSetDepthWriteEnableEXT cmdSetDepthWriteEnable;
+		PFN_vkCmdSetDepthCompareOpEXT cmdSetDepthCompareOp;
+#endif
+#ifdef VK_EXT_extended_dynamic_state2
+		PFN_vkCmdSetRasterizerDiscardEnableEXT cmdSetRasterizerDiscardEnable;
+#endif
+#ifdef VK_EXT_extended_dynamic_state3
+		PFN_vkCmdSetPolygonModeEXT cmdSetPolygonMode;
+		PFN_vkCmdSetDepthClampEnableEXT cmdSetDepthClampEnable;
+#endif
+
+		bool Changed(uint32_t bit, bool differs);
+	public:
+		DynamicStateTracker(VkDevice dev);
+
+		//Forgets everything known about the previous command buffer.
+		void Begin(VkCommandBuffer cmd);
+		//dynamicMask is the set of states the pipeline leaves dynamic, everything else is invalidated by the bind.
+		void BindPipeline(VkPipeline pipeline, uint32_t dynamicMask);
+		void SetViewport(const VkViewport& v);
+		void SetScissor(const VkRect2D& s);
+		void SetLineWidth(float w);
+		//Only the states in mask are recorded.
+		void SetRasterState(const RasterState& r, uint32_t mask);
+
+		//Commands recorded and commands filtered as redundant since the last ResetCounters.
+		uint32_t GetIssuedCount();
+		uint32_t GetSkippedCount();
+		void ResetCounters();
+	};
+}
@@ -10,6 +10,8 @@ uint32_t Kokoro::Graphics::MemoryUsageConv::Convert(MemoryUsage s) {
 		return VMA_MEMORY_USAGE_GPU_ONLY;
 	case MemoryUsage::CpuToGpu:
 		return VMA_MEMORY_USAGE_CPU_TO_GPU;
+	case MemoryUsage::GpuLazilyAllocated:
+		return VMA_MEMORY_USAGE_GPU_LAZILY_ALLOCATED;
 	default:
 		return 0;
 	}
@@ -1,11 +1,185 @@
 #include "Framebuffer.h"
+#include <algorithm>
 
 Kokoro::Graphics::Framebuffer::Framebuffer()
 {
-	throw gcnew System::NotImplementedException();
+	Images = gcnew List<ImageView^>();
+	owners = gcnew List<Image^>();
+	swapchainIdx = -1;
+	heldDescs = new std::vector<FramebufferAttachmentDesc>();
+	framebuffer = VK_NULL_HANDLE;
+	heldPass = VK_NULL_HANDLE;
+	heldWidth = 0;
+	heldHeight = 0;
+	heldGeneration = 0;
+	tracker = nullptr;
+	renderExtent = {};
+	Layers = 1;
 }
 
 Kokoro::Graphics::Framebuffer::~Framebuffer()
 {
-	throw gcnew System::NotImplementedException();
+	ReleaseHeld();
+	delete heldDescs;
+	delete tracker;
+}
+
+void Kokoro::Graphics::Framebuffer::AddAttachment(Image^ img, ImageView^ view)
+{
+	if (img == nullptr || view == nullptr)
+		throw gcnew System::ArgumentNullException(img == nullptr ? "img" : "view");
+	Images->Add(view);
+	owners->Add(img);
+}
+
+void Kokoro::Graphics::Framebuffer::AddSwapchainAttachment()
+{
+	if (swapchainIdx != -1)
+		throw gcnew System::InvalidOperationException("Framebuffer already has a swapchain attachment.");
+	swapchainIdx = Images->Count;
+	Images->Add(nullptr);
+	owners->Add(nullptr);
+}
+
+void Kokoro::Graphics::Framebuffer::SetAttachment(int idx, Image^ img, ImageView^ view)
+{
+	if (idx < 0 || idx >= Images->Count || idx == swapchainIdx)
+		throw gcnew System::ArgumentOutOfRangeException("idx");
+	if (img == nullptr || view == nullptr)
+		throw gcnew System::ArgumentNullException(img == nullptr ? "img" : "view");
+	Images[idx] = view;
+	owners[idx] = img;
+}
+
+void Kokoro::Graphics::Framebuffer::ReleaseHeld()
+{
+	//Command buffers still in flight may reference it
+	if (framebuffer != VK_NULL_HANDLE)
+		GraphicsDevice::DeferDestroy(DeferredObjectType::CachedFramebuffer, (uint64_t)framebuffer);
+	framebuffer = VK_NULL_HANDLE;
+	heldPass = VK_NULL_HANDLE;
+	heldDescs->clear();
+}
+
+VkFramebuffer Kokoro::Graphics::Framebuffer::Acquire(const std::vector<FramebufferAttachmentDesc>& descs, uint32_t w, uint32_t h, bool imageless)
+{
+	VkFramebuffer fbuf;
+	auto result = GraphicsDevice::GetFramebufferCache()->Acquire(GraphicsDevice::GetDevice(), RenderPass->GetRenderPass(), w, h, Layers, descs.data(), static_cast<uint32_t>(descs.size()), imageless, &fbuf);
+	if (result != VK_SUCCESS)
+		throw gcnew System::Exception("Failed to create framebuffer.");
+	return fbuf;
+}
+
+void Kokoro::Graphics::Framebuffer::Begin(VkCommandBuffer cmd, const VkClearValue* clearValues, uint32_t clearValueCnt, VkSubpassContents contents)
+{
+	if (RenderPass == nullptr || RenderPass->GetRenderPass() == VK_NULL_HANDLE)
+		throw gcnew System::InvalidOperationException("Framebuffer needs a built RenderPass.");
+	if (Layers == 0 || (Layers != 1 && RenderPass->GetSubpassCount() != 0 && RenderPass->GetViewMask(0) != 0))
+		throw gcnew System::ArgumentException("Multiview framebuffers must have a single layer, the views select the attachment layers.");
+
+	std::vector<FramebufferAttachmentDesc> descs(Images->Count);
+	std::vector<VkImageView> views(Images->Count);
+	uint32_t w = UINT32_MAX;
+	uint32_t h = UINT32_MAX;
+	for (int i = 0; i < Images->Count; i++) {
+		descs[i] = i == swapchainIdx ? GraphicsDevice::GetSwapchainAttachment(GraphicsDevice::GetCurrentFrameID()) : owners[i]->GetAttachmentDesc(Images[i]);
+		views[i] = descs[i].view;
+		w = std::min(w, descs[i].width);
+		h = std::min(h, descs[i].height);
+	}
+	if (Width != 0)
+		w = Width;
+	if (Height != 0)
+		h = Height;
+	if (Images->Count == 0 && (w == UINT32_MAX || h == UINT32_MAX))
+		throw gcnew System::ArgumentException("Framebuffers without attachments need an explicit size.");
+
+	//Barriers can't be recorded inside the pass, so the trackers are brought to its initial layouts first.
+	//UNDEFINED ones drop the contents, earlier accesses still have to finish before the pass writes.
+	BarrierBatch batch;
+	for (int i = 0; i < Images->Count; i++) {
+		if (i == swapchainIdx)
+			continue;
+		auto v = Images[i];
+		auto layout = RenderPass->GetInitialLayout(i);
+		bool discard = layout == VK_IMAGE_LAYOUT_UNDEFINED;
+		auto use = ResourceUseConv::FromLayout(layout);
+		if (discard)
+			use = (descs[i].usage & VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT) != 0 ? ResourceUse::DepthAttachment : ResourceUse::ColorAttachment;
+		else if (ResourceUseConv::GetInfo(use).layout != layout)
+			throw gcnew System::NotSupportedException("Attachment initial layout has no matching ResourceUse.");
+		owners[i]->Transition(batch, use, v->BaseLevel, v->LevelCount, v->BaseLayer, v->LayerCount, discard);
+	}
+	batch.Flush(cmd);
+
+	if (tracker == nullptr)
+		tracker = new DynamicStateTracker(GraphicsDevice::GetDevice());
+	tracker->Begin(cmd);
+	renderExtent = { w, h };
+
+	VkRenderPassBeginInfo beginInfo = {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+	beginInfo.renderPass = RenderPass->GetRenderPass();
+	beginInfo.renderArea.offset = { 0, 0 };
+	beginInfo.renderArea.extent = { w, h };
+	beginInfo.clearValueCount = clearValueCnt;
+	beginInfo.pClearValues = clearValues;
+
+	if (!GraphicsDevice::SupportsImagelessFramebuffers()) {
+		//Every set of views has its own framebuffer, held until the frame retires
+		beginInfo.framebuffer = Acquire(descs, w, h, false);
+		GraphicsDevice::DeferDestroy(DeferredObjectType::CachedFramebuffer, (uint64_t)beginInfo.framebuffer);
+		vkCmdBeginRenderPass(cmd, &beginInfo, contents);
+		return;
+	}
+
+#ifdef VK_KHR_imageless_framebuffer
+	//Only the views change between matching attachments, the held framebuffer stays valid for them
+	for (auto& d : descs)
+		d.view = VK_NULL_HANDLE;
+	auto cache = GraphicsDevice::GetFramebufferCache();
+	bool stale = heldPass != beginInfo.renderPass || heldWidth != w || heldHeight != h || *heldDescs != descs;
+	if (framebuffer == VK_NULL_HANDLE || stale || heldGeneration != cache->GetGeneration()) {
+		ReleaseHeld();
+		heldGeneration = cache->GetGeneration();
+		framebuffer = Acquire(descs, w, h, true);
+		heldPass = beginInfo.renderPass;
+		heldWidth = w;
+		heldHeight = h;
+		*heldDescs = descs;
+	}
+
+	VkRenderPassAttachmentBeginInfoKHR attachmentBeginInfo = {};
+	attachmentBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_ATTACHMENT_BEGIN_INFO_KHR;
+	attachmentBeginInfo.attachmentCount = static_cast<uint32_t>(views.size());
+	attachmentBeginInfo.pAttachments = views.data();
+	beginInfo.pNext = &attachmentBeginInfo;
+	beginInfo.framebuffer = framebuffer;
+	vkCmdBeginRenderPass(cmd, &beginInfo, contents);
+#endif
+}
+
+void Kokoro::Graphics::Framebuffer::End(VkCommandBuffer cmd)
+{
+	vkCmdEndRenderPass(cmd);
+
+	//The pass made the layout changes itself, the trackers have to catch up before the images are used again
+	for (int i = 0; i < Images->Count; i++) {
+		if (i == swapchainIdx)
+			continue;
+		auto v = Images[i];
+		owners[i]->Assume(RenderPass->GetFinalLayout(i), v->BaseLevel, v->LevelCount, v->BaseLayer, v->LayerCount);
+	}
+}
+
+Kokoro::Graphics::DynamicStateTracker* Kokoro::Graphics::Framebuffer::GetStateTracker()
+{
+	if (tracker == nullptr)
+		throw gcnew System::InvalidOperationException("Framebuffer has not begun a render pass.");
+	return tracker;
+}
+
+VkExtent2D Kokoro::Graphics::Framebuffer::GetRenderExtent()
+{
+	return renderExtent;
 }
@@ -1,19 +1,59 @@
 #pragma once
 #include "GraphicsDevice.h"
+#include "Image.h"
 #include "ImageView.h"
+#include "RenderPass.h"
+#include "DynamicStateTracker.h"
+#include <vector>
 
 using namespace System::Collections::Generic;
 
 namespace Kokoro::Graphics {
+	//Attachments of a render pass, in the pass's attachment order. Framebuffer handles come from the device-wide
+	//FramebufferCache: with imageless framebuffers one handle serves every set of views with the same formats,
+	//usage and size, so swapping views or swapchain images doesn't create anything.
 	ref class Framebuffer
 	{
 	private:
 		List<ImageView^>^ Images;
+		List<Image^>^ owners;
+		//Index of the swapchain attachment, -1 if there is none
+		int swapchainIdx;
+		//What the held framebuffer was acquired for, compared on every Begin
+		std::vector<FramebufferAttachmentDesc>* heldDescs;
+		VkFramebuffer framebuffer;
+		VkRenderPass heldPass;
+		uint32_t heldWidth;
+		uint32_t heldHeight;
+		uint32_t heldGeneration;
+		//Restarted on every Begin, pipelines bound inside the pass record their dynamic state through it
+		DynamicStateTracker* tracker;
+		VkExtent2D renderExtent;
+
+		void ReleaseHeld();
+		VkFramebuffer Acquire(const std::vector<FramebufferAttachmentDesc>& descs, uint32_t w, uint32_t h, bool imageless);
+	internal:
+		//Begins RenderPass over the whole framebuffer, the swapchain attachment is the image of the current frame.
+		void Begin(VkCommandBuffer cmd, const VkClearValue* clearValues, uint32_t clearValueCnt, VkSubpassContents contents);
+		//Ends the pass and records the final layout of every attachment with its image's state tracker.
+		void End(VkCommandBuffer cmd);
+		//State tracker and render area of the pass started by the last Begin.
+		DynamicStateTracker* GetStateTracker();
+		VkExtent2D GetRenderExtent();
 	public:
+		property Kokoro::Graphics::RenderPass^ RenderPass;
+		//0 uses the smallest extent of the attachments
+		property uint32_t Width;
+		property uint32_t Height;
+		property uint32_t Layers;
+
 		Framebuffer();
 		~Framebuffer();
 
-		void AddAttachment();
+		void AddAttachment(Image^ img, ImageView^ view);
+		//Attachment backed by whichever swapchain image belongs to the frame being recorded.
+		void AddSwapchainAttachment();
+		//Swaps the view an attachment renders to. With imageless framebuffers matching views reuse the same handle.
+		void SetAttachment(int idx, Image^ img, ImageView^ view);
 	};
 }
-
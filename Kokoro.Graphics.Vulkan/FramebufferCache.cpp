@@ -0,0 +1,248 @@
+#include "FramebufferCache.h"
+#include "PipelineStateCache.h"
+#include <algorithm>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+	struct FramebufferEntry {
+		VkFramebuffer framebuffer;
+		uint32_t refCount;
+		VkRenderPass pass;
+		std::vector<VkImageView> views;
+	};
+
+	//Kept out of the header so the managed translation units never see <mutex>
+	struct CacheState {
+		std::mutex lock;
+		std::unordered_map<std::string, FramebufferEntry> entries;
+		std::unordered_map<VkFramebuffer, std::string> keys;
+		//Invalidated framebuffers still referenced, destroyed with their last Release
+		std::unordered_map<VkFramebuffer, uint32_t> detached;
+		VkExtent2D swapchainExtent;
+		uint32_t generation;
+		uint64_t hits;
+		uint64_t misses;
+	};
+
+	void Drop(CacheState* s, VkDevice dev, std::unordered_map<std::string, FramebufferEntry>::iterator it) {
+		auto& e = it->second;
+		if (e.refCount == 0)
+			vkDestroyFramebuffer(dev, e.framebuffer, nullptr);
+		else
+			s->detached[e.framebuffer] = e.refCount;
+		s->keys.erase(e.framebuffer);
+		s->entries.erase(it);
+	}
+
+	//Bumps the generation if anything was dropped, so holders acquire their framebuffer again
+	template<typename Pred>
+	void DropIf(CacheState* s, VkDevice dev, Pred pred) {
+		bool dropped = false;
+		for (auto it = s->entries.begin(); it != s->entries.end();) {
+			auto cur = it++;
+			if (pred(cur->second)) {
+				Drop(s, dev, cur);
+				dropped = true;
+			}
+		}
+		if (dropped)
+			s->generation++;
+	}
+
+	VkResult CreateFramebuffer(VkDevice dev, VkRenderPass pass, uint32_t width, uint32_t height, uint32_t layers, const Kokoro::Graphics::FramebufferAttachmentDesc* attachments, uint32_t attachmentCnt, bool imageless, VkFramebuffer* framebuffer) {
+		VkFramebufferCreateInfo fbufCreatInfo = {};
+		fbufCreatInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+		fbufCreatInfo.renderPass = pass;
+		fbufCreatInfo.attachmentCount = attachmentCnt;
+		fbufCreatInfo.width = width;
+		fbufCreatInfo.height = height;
+		fbufCreatInfo.layers = layers;
+
+		if (!imageless) {
+			std::vector<VkImageView> views(attachmentCnt);
+			for (uint32_t i = 0; i < attachmentCnt; i++)
+				views[i] = attachments[i].view;
+			fbufCreatInfo.pAttachments = views.data();
+			return vkCreateFramebuffer(dev, &fbufCreatInfo, nullptr, framebuffer);
+		}
+
+#ifdef VK_KHR_imageless_framebuffer
+		//Views are supplied at vkCmdBeginRenderPass, the framebuffer only records what they'll look like
+		std::vector<VkFramebufferAttachmentImageInfoKHR> infos(attachmentCnt);
+		for (uint32_t i = 0; i < attachmentCnt; i++) {
+			infos[i] = {};
+			infos[i].sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_ATTACHMENT_IMAGE_INFO_KHR;
+			infos[i].flags = attachments[i].flags;
+			infos[i].usage = attachments[i].usage;
+			infos[i].width = attachments[i].width;
+			infos[i].height = attachments[i].height;
+			infos[i].layerCount = attachments[i].layerCount;
+			//Has to match the image's VkImageFormatListCreateInfoKHR, swapchain images have none
+			infos[i].viewFormatCount = attachments[i].viewFormatCount;
+			infos[i].pViewFormats = attachments[i].viewFormats;
+		}
+		VkFramebufferAttachmentsCreateInfoKHR attachmentsCreatInfo = {};
+		attachmentsCreatInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_ATTACHMENTS_CREATE_INFO_KHR;
+		attachmentsCreatInfo.attachmentImageInfoCount = attachmentCnt;
+		attachmentsCreatInfo.pAttachmentImageInfos = infos.data();
+		fbufCreatInfo.pNext = &attachmentsCreatInfo;
+		fbufCreatInfo.flags = VK_FRAMEBUFFER_CREATE_IMAGELESS_BIT_KHR;
+		return vkCreateFramebuffer(dev, &fbufCreatInfo, nullptr, framebuffer);
+#else
+		return VK_ERROR_EXTENSION_NOT_PRESENT;
+#endif
+	}
+}
+
+bool Kokoro::Graphics::FramebufferAttachmentDesc::operator==(const FramebufferAttachmentDesc& other) const {
+	if (viewFormatCount != other.viewFormatCount || !std::equal(viewFormats, viewFormats + viewFormatCount, other.viewFormats))
+		return false;
+	return format == other.format && usage == other.usage && flags == other.flags && width == other.width && height == other.height && layerCount == other.layerCount && view == other.view;
+}
+
+Kokoro::Graphics::FramebufferCache::FramebufferCache() {
+	auto s = new CacheState();
+	s->swapchainExtent = { 0, 0 };
+	s->generation = 0;
+	s->hits = 0;
+	s->misses = 0;
+	state = s;
+}
+
+Kokoro::Graphics::FramebufferCache::~FramebufferCache() {
+	delete static_cast<CacheState*>(state);
+}
+
+VkResult Kokoro::Graphics::FramebufferCache::Acquire(VkDevice dev, VkRenderPass pass, uint32_t width, uint32_t height, uint32_t layers, const FramebufferAttachmentDesc* attachments, uint32_t attachmentCnt, bool imageless, VkFramebuffer* framebuffer) {
+	PipelineStateKey key;
+	key.Append((uint64_t)pass);
+	key.Append((uint64_t)width << 32 | height);
+	key.Append((uint64_t)layers << 32 | attachmentCnt);
+	key.Append((uint64_t)imageless);
+	for (uint32_t i = 0; i < attachmentCnt; i++) {
+		auto& a = attachments[i];
+		key.Append((uint64_t)a.format << 32 | a.usage);
+		key.Append((uint64_t)a.flags << 32 | a.layerCount);
+		key.Append((uint64_t)a.width << 32 | a.height);
+		key.Append((uint64_t)a.viewFormatCount);
+		for (uint32_t j = 0; j < a.viewFormatCount; j++)
+			key.Append((uint64_t)a.viewFormats[j]);
+		key.Append(imageless ? 0 : (uint64_t)a.view);
+	}
+
+	auto s = static_cast<CacheState*>(state);
+	std::lock_guard<std::mutex> guard(s->lock);
+
+	auto it = s->entries.find(key.GetData());
+	if (it != s->entries.end()) {
+		s->hits++;
+		it->second.refCount++;
+		*framebuffer = it->second.framebuffer;
+		return VK_SUCCESS;
+	}
+
+	auto res = CreateFramebuffer(dev, pass, width, height, layers, attachments, attachmentCnt, imageless, framebuffer);
+	if (res != VK_SUCCESS)
+		return res;
+	s->misses++;
+
+	FramebufferEntry e;
+	e.framebuffer = *framebuffer;
+	e.refCount = 1;
+	e.pass = pass;
+	for (uint32_t i = 0; i < attachmentCnt && !imageless; i++)
+		e.views.push_back(attachments[i].view);
+	s->entries.emplace(key.GetData(), e);
+	s->keys.emplace(*framebuffer, key.GetData());
+	return VK_SUCCESS;
+}
+
+void Kokoro::Graphics::FramebufferCache::Release(VkDevice dev, VkFramebuffer framebuffer) {
+	auto s = static_cast<CacheState*>(state);
+	std::lock_guard<std::mutex> guard(s->lock);
+
+	auto k = s->keys.find(framebuffer);
+	if (k != s->keys.end()) {
+		s->entries[k->second].refCount--;
+		return;
+	}
+	auto d = s->detached.find(framebuffer);
+	if (d != s->detached.end() && --d->second == 0) {
+		vkDestroyFramebuffer(dev, framebuffer, nullptr);
+		s->detached.erase(d);
+	}
+}
+
+void Kokoro::Graphics::FramebufferCache::Invalidate(VkDevice dev) {
+	auto s = static_cast<CacheState*>(state);
+	std::lock_guard<std::mutex> guard(s->lock);
+	DropIf(s, dev, [](const FramebufferEntry&) { return true; });
+}
+
+void Kokoro::Graphics::FramebufferCache::SetSwapchainExtent(VkDevice dev, VkExtent2D extent) {
+	auto s = static_cast<CacheState*>(state);
+	{
+		std::lock_guard<std::mutex> guard(s->lock);
+		if (s->swapchainExtent.width == extent.width && s->swapchainExtent.height == extent.height)
+			return;
+		s->swapchainExtent = extent;
+	}
+	Invalidate(dev);
+}
+
+void Kokoro::Graphics::FramebufferCache::InvalidateViews(VkDevice dev, const VkImageView* views, uint32_t viewCnt) {
+	auto s = static_cast<CacheState*>(state);
+	std::lock_guard<std::mutex> guard(s->lock);
+	DropIf(s, dev, [views, viewCnt](const FramebufferEntry& e) {
+		for (auto v : e.views)
+			for (uint32_t i = 0; i < viewCnt; i++)
+				if (v == views[i])
+					return true;
+		return false;
+	});
+}
+
+void Kokoro::Graphics::FramebufferCache::InvalidateRenderPass(VkDevice dev, VkRenderPass pass) {
+	auto s = static_cast<CacheState*>(state);
+	std::lock_guard<std::mutex> guard(s->lock);
+	DropIf(s, dev, [pass](const FramebufferEntry& e) { return e.pass == pass; });
+}
+
+uint32_t Kokoro::Graphics::FramebufferCache::GetGeneration() {
+	auto s = static_cast<CacheState*>(state);
+	std::lock_guard<std::mutex> guard(s->lock);
+	return s->generation;
+}
+
+uint32_t Kokoro::Graphics::FramebufferCache::GetFramebufferCount() {
+	auto s = static_cast<CacheState*>(state);
+	std::lock_guard<std::mutex> guard(s->lock);
+	return static_cast<uint32_t>(s->entries.size());
+}
+
+uint64_t Kokoro::Graphics::FramebufferCache::GetHitCount() {
+	auto s = static_cast<CacheState*>(state);
+	std::lock_guard<std::mutex> guard(s->lock);
+	return s->hits;
+}
+
+uint64_t Kokoro::Graphics::FramebufferCache::GetMissCount() {
+	auto s = static_cast<CacheState*>(state);
+	std::lock_guard<std::mutex> guard(s->lock);
+	return s->misses;
+}
+
+void Kokoro::Graphics::FramebufferCache::Destroy(VkDevice dev) {
+	auto s = static_cast<CacheState*>(state);
+	std::lock_guard<std::mutex> guard(s->lock);
+
+	for (auto& e : s->entries)
+		vkDestroyFramebuffer(dev, e.second.framebuffer, nullptr);
+	for (auto& d : s->detached)
+		vkDestroyFramebuffer(dev, d.first, nullptr);
+	s->entries.clear();
+	s->keys.clear();
+	s->detached.clear();
+}
@@ -0,0 +1,57 @@
+#pragma once
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#define VK_USE_PLATFORM_WIN32_KHR
+#endif
+#include "vulkan/vulkan.h"
+
+namespace Kokoro::Graphics {
+	//Everything about an attachment a framebuffer depends on. view is only part of the key for framebuffers with images.
+	struct FramebufferAttachmentDesc {
+		VkFormat format;
+		VkImageUsageFlags usage;
+		VkImageCreateFlags flags;
+		uint32_t width;
+		uint32_t height;
+		uint32_t layerCount;
+		//The image's VkImageFormatListCreateInfoKHR, owned by it, count is 0 when it has none
+		uint32_t viewFormatCount;
+		const VkFormat* viewFormats;
+		VkImageView view;
+
+		bool operator==(const FramebufferAttachmentDesc& other) const;
+	};
+
+	//Device-wide map from render pass, extent and attachments to a refcounted VkFramebuffer.
+	//Imageless framebuffers (VK_KHR_imageless_framebuffer) only depend on the attachments' formats, usage and size,
+	//so one serves every swapchain image and every target with matching properties. Without the extension each set of
+	//views gets its own framebuffer. Unreferenced framebuffers stay cached until they're invalidated.
+	class FramebufferCache
+	{
+	private:
+		void* state;
+	public:
+		FramebufferCache();
+		~FramebufferCache();
+
+		//Returns a framebuffer matching the description, creating it if needed, either way holding a new reference.
+		VkResult Acquire(VkDevice dev, VkRenderPass pass, uint32_t width, uint32_t height, uint32_t layers, const FramebufferAttachmentDesc* attachments, uint32_t attachmentCnt, bool imageless, VkFramebuffer* framebuffer);
+		void Release(VkDevice dev, VkFramebuffer framebuffer);
+
+		//Drops every framebuffer, unreferenced ones are destroyed right away and the rest with their last Release.
+		//Holders compare GetGeneration to find out their framebuffer has to be acquired again.
+		void Invalidate(VkDevice dev);
+		//Invalidates the cache when the swapchain extent changes, since swapchain sized framebuffers are then stale.
+		void SetSwapchainExtent(VkDevice dev, VkExtent2D extent);
+		//Drops the framebuffers built from any of the views or from pass, before their handles can be reused.
+		void InvalidateViews(VkDevice dev, const VkImageView* views, uint32_t viewCnt);
+		void InvalidateRenderPass(VkDevice dev, VkRenderPass pass);
+		uint32_t GetGeneration();
+
+		uint32_t GetFramebufferCount();
+		uint64_t GetHitCount();
+		uint64_t GetMissCount();
+		void Destroy(VkDevice dev);
+	};
+}
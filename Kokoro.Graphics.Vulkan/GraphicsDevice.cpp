@@ -1,4 +1,7 @@
 #include "GraphicsDevice.h"
+#include "ShaderHotReload.h"
+#include "DynamicStateTracker.h"
+#include "MipGenerator.h"
 #include "GLFW/glfw3.h"
 
 #include <iostream>
@@ -7,6 +10,7 @@
 #include <string>
 #include <set>
 #include <algorithm>
+#include <cstring>
 
 using namespace Runtime::InteropServices;
 using namespace Kokoro::Graphics;
@@ -20,6 +24,33 @@ const std::vector<const char*> deviceExtns = {
 	VK_EXT_SUBGROUP_SIZE_CONTROL_EXTENSION_NAME,
 };
 
+//Enabled when the device supports them, features depending on them check IsExtensionEnabled
+const std::vector<const char*> optionalDeviceExtns = {
+	VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME,
+	VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME,
+#ifdef VK_EXT_graphics_pipeline_library
+	VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME,
+	VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME,
+#endif
+#ifdef VK_EXT_extended_dynamic_state
+	VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME,
+#endif
+#ifdef VK_KHR_depth_stencil_resolve
+	VK_KHR_CREATE_RENDERPASS_2_EXTENSION_NAME,
+	VK_KHR_DEPTH_STENCIL_RESOLVE_EXTENSION_NAME,
+#endif
+#ifdef VK_KHR_imageless_framebuffer
+	VK_KHR_IMAGE_FORMAT_LIST_EXTENSION_NAME,
+	VK_KHR_IMAGELESS_FRAMEBUFFER_EXTENSION_NAME,
+#endif
+#ifdef VK_EXT_extended_dynamic_state2
+	VK_EXT_EXTENDED_DYNAMIC_STATE_2_EXTENSION_NAME,
+#endif
+#ifdef VK_EXT_extended_dynamic_state3
+	VK_EXT_EXTENDED_DYNAMIC_STATE_3_EXTENSION_NAME,
+#endif
+};
+
 #pragma unmanaged
 static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(
 	VkDebugUtilsMessageSeverityFlagBitsEXT severity,
@@ -52,6 +83,24 @@ static std::vector<VkImage> swapChainImages;
 static std::vector<VkImageView> swapChainViews;
 static VkSurfaceFormatKHR surface_fmt;
 static VkExtent2D surface_extent;
+static std::set<std::string> enabledExtns;
+static std::vector<DescriptorAllocator*> frameDescAllocators;
+static VkPhysicalDeviceSubgroupSizeControlPropertiesEXT subgroupSizeProps;
+static bool computeFullSubgroups;
+static bool pipelineLibraries;
+static uint32_t dynamicStates;
+static VkPhysicalDeviceDescriptorIndexingFeaturesEXT descIndexingFeatures;
+static VkPhysicalDeviceMultiviewFeatures multiviewFeats;
+static uint32_t maxMultiviewViews;
+static uint32_t eyeCount = 1;
+static uint32_t depthResolveModes;
+static uint32_t stencilResolveModes;
+static bool independentResolve;
+static bool independentResolveNone;
+static bool imagelessFramebuffers;
+static bool textureCompressionBC;
+static bool storageImageExtendedFormats;
+static std::vector<std::vector<std::pair<DeferredObjectType, uint64_t>>> deferredDestroys;
 
 
 void Kokoro::Graphics::GraphicsDevice::SetNames(String^ appName, String^ engineName)
@@ -67,6 +116,33 @@ void Kokoro::Graphics::GraphicsDevice::Destroy()
 		for (auto imgView : swapChainViews)
 			vkDestroyImageView(device, imgView, nullptr);
 		vkDestroySwapchainKHR(device, swapchain, nullptr);
+		for (auto fAlloc : frameDescAllocators) {
+			fAlloc->Destroy(device);
+			delete fAlloc;
+		}
+		frameDescAllocators.clear();
+		ShaderHotReload::Disable();
+		MipGenerator::Destroy();
+		for (uint32_t i = 0; i < deferredDestroys.size(); i++)
+			FlushDeferred(i);
+		deferredDestroys.clear();
+		framebufferCache->Destroy(device);
+		delete framebufferCache;
+		pipelineStateCache->Destroy(device);
+		delete pipelineStateCache;
+		pipelineLibraryCache->Destroy(device);
+		delete pipelineLibraryCache;
+		shaderRegistry->Destroy(device);
+		delete shaderRegistry;
+		vkDestroyPipelineCache(device, pipelineCache, nullptr);
+		descAllocator->Destroy(device);
+		delete descAllocator;
+		descLayoutCache->Destroy(device);
+		delete descLayoutCache;
+		samplerCache->Destroy(device);
+		delete samplerCache;
+		renderPassCache->Destroy(device);
+		delete renderPassCache;
 		delete allocator;
 		vkDestroyDevice(device, nullptr);
 		if (validationEnabled) DestroyDebugUtilsMessengerEXT(instance, debugMessenger, nullptr);
@@ -339,7 +415,16 @@ void Kokoro::Graphics::GraphicsDevice::CreateInstance(bool enableValidation)
 	if (transferFamily != graphicsFamily)queueFams[idx++] = static_cast<uint32_t>(transferFamily);
 	if (presentFamily != graphicsFamily)queueFams[idx++] = static_cast<uint32_t>(presentFamily);
 
+	VkPhysicalDeviceFeatures availFeats = {};
+	vkGetPhysicalDeviceFeatures(physDevice, &availFeats);
+	textureCompressionBC = availFeats.textureCompressionBC == VK_TRUE;
+	storageImageExtendedFormats = availFeats.shaderStorageImageExtendedFormats == VK_TRUE;
+
 	VkPhysicalDeviceFeatures devFeats = {};
+	devFeats.textureCompressionBC = availFeats.textureCompressionBC;
+	devFeats.shaderStorageImageExtendedFormats = availFeats.shaderStorageImageExtendedFormats;
+	devFeats.geometryShader = availFeats.geometryShader;
+	ResourceUseConv::SetUnsupportedStages(availFeats.geometryShader ? 0 : VK_PIPELINE_STAGE_GEOMETRY_SHADER_BIT);
 	devFeats.multiDrawIndirect = VK_TRUE;
 	devFeats.tessellationShader = VK_TRUE;
 	devFeats.fragmentStoresAndAtomics = VK_TRUE;
@@ -348,14 +433,196 @@ void Kokoro::Graphics::GraphicsDevice::CreateInstance(bool enableValidation)
 		devFeats.robustBufferAccess = VK_TRUE;
 	}
 
+	uint32_t extn_cnt = 0;
+	vkEnumerateDeviceExtensionProperties(physDevice, nullptr, &extn_cnt, nullptr);
+	std::vector<VkExtensionProperties> availExtns(extn_cnt);
+	vkEnumerateDeviceExtensionProperties(physDevice, nullptr, &extn_cnt, availExtns.data());
+
+	std::vector<const char*> devExtns(deviceExtns.begin(), deviceExtns.end());
+	for (const auto& optExtn : optionalDeviceExtns)
+		for (const auto& extn : availExtns)
+			if (strcmp(optExtn, extn.extensionName) == 0) {
+				devExtns.push_back(optExtn);
+				break;
+			}
+	enabledExtns.clear();
+	enabledExtns.insert(devExtns.begin(), devExtns.end());
+
+	void* devFeatChain = nullptr;
+
+	VkPhysicalDeviceDescriptorIndexingFeaturesEXT descIndexingFeats = {};
+	descIndexingFeats.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+	descIndexingFeatures = descIndexingFeats;
+	if (IsExtensionEnabled(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME)) {
+		//Enable everything the device reports, the bindless heap relies on partially bound update-after-bind arrays
+		VkPhysicalDeviceFeatures2 feats2 = {};
+		feats2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		feats2.pNext = &descIndexingFeats;
+		vkGetPhysicalDeviceFeatures2(physDevice, &feats2);
+
+		descIndexingFeatures = descIndexingFeats;
+		descIndexingFeatures.pNext = nullptr;
+		descIndexingFeats.pNext = devFeatChain;
+		devFeatChain = &descIndexingFeats;
+	}
+
+	//Subgroup size control is a required extension, enable whichever of its features the device reports
+	VkPhysicalDeviceSubgroupSizeControlFeaturesEXT subgroupSizeFeats = {};
+	subgroupSizeFeats.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SUBGROUP_SIZE_CONTROL_FEATURES_EXT;
+	{
+		VkPhysicalDeviceFeatures2 feats2 = {};
+		feats2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		feats2.pNext = &subgroupSizeFeats;
+		vkGetPhysicalDeviceFeatures2(physDevice, &feats2);
+
+		subgroupSizeFeats.pNext = devFeatChain;
+		devFeatChain = &subgroupSizeFeats;
+
+		subgroupSizeProps = {};
+		subgroupSizeProps.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SUBGROUP_SIZE_CONTROL_PROPERTIES_EXT;
+		VkPhysicalDeviceProperties2 props2 = {};
+		props2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+		props2.pNext = &subgroupSizeProps;
+		vkGetPhysicalDeviceProperties2(physDevice, &props2);
+		if (!subgroupSizeFeats.subgroupSizeControl)
+			subgroupSizeProps.requiredSubgroupSizeStages = 0;
+		computeFullSubgroups = subgroupSizeFeats.computeFullSubgroups == VK_TRUE;
+	}
+
+	//Multiview is core in 1.1, it lets stereo passes draw both eyes with one set of commands
+	VkPhysicalDeviceMultiviewFeatures mvFeats = {};
+	mvFeats.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MULTIVIEW_FEATURES;
+	{
+		VkPhysicalDeviceFeatures2 feats2 = {};
+		feats2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		feats2.pNext = &mvFeats;
+		vkGetPhysicalDeviceFeatures2(physDevice, &feats2);
+
+		multiviewFeats = mvFeats;
+		multiviewFeats.pNext = nullptr;
+		mvFeats.pNext = devFeatChain;
+		devFeatChain = &mvFeats;
+
+		VkPhysicalDeviceMultiviewProperties mvProps = {};
+		mvProps.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MULTIVIEW_PROPERTIES;
+		VkPhysicalDeviceProperties2 props2 = {};
+		props2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+		props2.pNext = &mvProps;
+		vkGetPhysicalDeviceProperties2(physDevice, &props2);
+		maxMultiviewViews = multiviewFeats.multiview ? mvProps.maxMultiviewViewCount : 1;
+	}
+
+	//Depth resolve is a property of the extension, there are no features to enable
+	depthResolveModes = 0;
+	stencilResolveModes = 0;
+	independentResolve = false;
+	independentResolveNone = false;
+#ifdef VK_KHR_depth_stencil_resolve
+	if (IsExtensionEnabled(VK_KHR_DEPTH_STENCIL_RESOLVE_EXTENSION_NAME) && IsExtensionEnabled(VK_KHR_CREATE_RENDERPASS_2_EXTENSION_NAME)) {
+		VkPhysicalDeviceDepthStencilResolvePropertiesKHR resolveProps = {};
+		resolveProps.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DEPTH_STENCIL_RESOLVE_PROPERTIES_KHR;
+		VkPhysicalDeviceProperties2 props2 = {};
+		props2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+		props2.pNext = &resolveProps;
+		vkGetPhysicalDeviceProperties2(physDevice, &props2);
+		depthResolveModes = resolveProps.supportedDepthResolveModes;
+		stencilResolveModes = resolveProps.supportedStencilResolveModes;
+		independentResolve = resolveProps.independentResolve == VK_TRUE;
+		independentResolveNone = resolveProps.independentResolveNone == VK_TRUE;
+	}
+#endif
+
+	//Lets one framebuffer serve every swapchain image, the views are only named when the pass begins
+	imagelessFramebuffers = false;
+#ifdef VK_KHR_imageless_framebuffer
+	VkPhysicalDeviceImagelessFramebufferFeaturesKHR imagelessFeats = {};
+	imagelessFeats.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_IMAGELESS_FRAMEBUFFER_FEATURES_KHR;
+	if (IsExtensionEnabled(VK_KHR_IMAGELESS_FRAMEBUFFER_EXTENSION_NAME) && IsExtensionEnabled(VK_KHR_IMAGE_FORMAT_LIST_EXTENSION_NAME)) {
+		VkPhysicalDeviceFeatures2 feats2 = {};
+		feats2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		feats2.pNext = &imagelessFeats;
+		vkGetPhysicalDeviceFeatures2(physDevice, &feats2);
+
+		imagelessFeats.pNext = devFeatChain;
+		devFeatChain = &imagelessFeats;
+		imagelessFramebuffers = imagelessFeats.imagelessFramebuffer == VK_TRUE;
+	}
+#endif
+
+	pipelineLibraries = false;
+#ifdef VK_EXT_graphics_pipeline_library
+	VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT pipelineLibraryFeats = {};
+	pipelineLibraryFeats.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT;
+	if (IsExtensionEnabled(VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME) && IsExtensionEnabled(VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME)) {
+		VkPhysicalDeviceFeatures2 feats2 = {};
+		feats2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		feats2.pNext = &pipelineLibraryFeats;
+		vkGetPhysicalDeviceFeatures2(physDevice, &feats2);
+
+		pipelineLibraryFeats.pNext = devFeatChain;
+		devFeatChain = &pipelineLibraryFeats;
+		pipelineLibraries = pipelineLibraryFeats.graphicsPipelineLibrary == VK_TRUE;
+	}
+#endif
+
+	dynamicStates = DynamicCoreStates;
+#ifdef VK_EXT_extended_dynamic_state
+	VkPhysicalDeviceExtendedDynamicStateFeaturesEXT dynStateFeats = {};
+	dynStateFeats.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_FEATURES_EXT;
+	if (IsExtensionEnabled(VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME)) {
+		VkPhysicalDeviceFeatures2 feats2 = {};
+		feats2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		feats2.pNext = &dynStateFeats;
+		vkGetPhysicalDeviceFeatures2(physDevice, &feats2);
+
+		dynStateFeats.pNext = devFeatChain;
+		devFeatChain = &dynStateFeats;
+		if (dynStateFeats.extendedDynamicState)
+			dynamicStates |= DynamicCullMode | DynamicFrontFace | DynamicTopology | DynamicDepthTest | DynamicDepthWrite | DynamicDepthCompare;
+	}
+#endif
+#ifdef VK_EXT_extended_dynamic_state2
+	VkPhysicalDeviceExtendedDynamicState2FeaturesEXT dynState2Feats = {};
+	dynState2Feats.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_2_FEATURES_EXT;
+	if (IsExtensionEnabled(VK_EXT_EXTENDED_DYNAMIC_STATE_2_EXTENSION_NAME)) {
+		VkPhysicalDeviceFeatures2 feats2 = {};
+		feats2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		feats2.pNext = &dynState2Feats;
+		vkGetPhysicalDeviceFeatures2(physDevice, &feats2);
+
+		dynState2Feats.pNext = devFeatChain;
+		devFeatChain = &dynState2Feats;
+		if (dynState2Feats.extendedDynamicState2)
+			dynamicStates |= DynamicRasterizerDiscard;
+	}
+#endif
+#ifdef VK_EXT_extended_dynamic_state3
+	VkPhysicalDeviceExtendedDynamicState3FeaturesEXT dynState3Feats = {};
+	dynState3Feats.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_3_FEATURES_EXT;
+	if (IsExtensionEnabled(VK_EXT_EXTENDED_DYNAMIC_STATE_3_EXTENSION_NAME)) {
+		VkPhysicalDeviceFeatures2 feats2 = {};
+		feats2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		feats2.pNext = &dynState3Feats;
+		vkGetPhysicalDeviceFeatures2(physDevice, &feats2);
+
+		dynState3Feats.pNext = devFeatChain;
+		devFeatChain = &dynState3Feats;
+		if (dynState3Feats.extendedDynamicState3PolygonMode)
+			dynamicStates |= DynamicPolygonMode;
+		if (dynState3Feats.extendedDynamicState3DepthClampEnable)
+			dynamicStates |= DynamicDepthClamp;
+	}
+#endif
+
 	VkDeviceCreateInfo devCreatInfo = {};
 	devCreatInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+	devCreatInfo.pNext = devFeatChain;
 	devCreatInfo.queueCreateInfoCount = static_cast<uint32_t>(qCreatInfos.size());
 	devCreatInfo.pQueueCreateInfos = qCreatInfos.data();
 	devCreatInfo.pEnabledFeatures = &devFeats;
 
-	devCreatInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtns.size());
-	devCreatInfo.ppEnabledExtensionNames = deviceExtns.data();
+	devCreatInfo.enabledExtensionCount = static_cast<uint32_t>(devExtns.size());
+	devCreatInfo.ppEnabledExtensionNames = devExtns.data();
 
 	if (enableValidation) {
 		devCreatInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
@@ -372,6 +639,25 @@ void Kokoro::Graphics::GraphicsDevice::CreateInstance(bool enableValidation)
 	}
 
 	allocator = VmaWrapper::Create(physDevice, device);
+	samplerCache = new SamplerCache();
+	renderPassCache = new RenderPassCache();
+	framebufferCache = new FramebufferCache();
+	descLayoutCache = new DescriptorLayoutCache(samplerCache);
+	descAllocator = new DescriptorAllocator(true, 256);
+
+	//Shared by every pipeline build, vkCreate*Pipelines synchronizes access to it internally
+	VkPipelineCacheCreateInfo pipelineCacheCreatInfo = {};
+	pipelineCacheCreatInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	pipelineCacheCreatInfo.initialDataSize = 0;
+	pipelineCacheCreatInfo.pInitialData = nullptr;
+
+	pin_ptr<VkPipelineCache> pipelineCache_ptr = &pipelineCache;
+	result = vkCreatePipelineCache(device, &pipelineCacheCreatInfo, nullptr, pipelineCache_ptr);
+	if (result != VK_SUCCESS)
+		throw gcnew System::Exception("Failed to create pipeline cache.");
+	pipelineStateCache = new PipelineStateCache();
+	pipelineLibraryCache = new PipelineStateCache();
+	shaderRegistry = new ShaderRegistry();
 
 	pin_ptr<VkQueue> graph_q_hndl = &graphicsQueue;
 	pin_ptr<VkQueue> comp_q_hndl = &computeQueue;
@@ -433,6 +719,11 @@ void Kokoro::Graphics::GraphicsDevice::CreateInstance(bool enableValidation)
 	vkGetSwapchainImagesKHR(device, swapchain, swapchain_img_cnt_ptr, swapChainImages.data());
 
 	surface_extent = cur_extent;
+	curFrame = 0;
+	for (uint32_t i = 0; i < swapchain_img_cnt; i++)
+		frameDescAllocators.push_back(new DescriptorAllocator(false, 128));
+	deferredDestroys.resize(swapchain_img_cnt);
+
 	for (size_t i = 0; i < swapChainImages.size(); i++) {
 		VkImageViewCreateInfo imgViewCreatInfo = {};
 		imgViewCreatInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -452,6 +743,7 @@ void Kokoro::Graphics::GraphicsDevice::CreateInstance(bool enableValidation)
 		if (result != VK_SUCCESS)
 			throw gcnew System::Exception("Failed to create image views.");
 	}
+	framebufferCache->SetSwapchainExtent(device, surface_extent);
 
 	initialized = true;
 }
@@ -465,9 +757,9 @@ void Kokoro::Graphics::GraphicsDevice::DestroyBuffer(VkBuffer buf, WVmaAllocatio
 	allocator->DestroyBuffer(buf, alloc);
 }
 
-int Kokoro::Graphics::GraphicsDevice::CreateImage(VkImageCreateInfo* creatInfo, VkImage* img, WVmaAllocation* alloc) {
+int Kokoro::Graphics::GraphicsDevice::CreateImage(VkImageCreateInfo* creatInfo, MemoryUsage memUsage, VkImage* img, WVmaAllocation* alloc) {
 	pin_ptr<uint32_t> queueFams_ptr = &queueFams[0];
-	return allocator->CreateImage(creatInfo, queueFams_ptr, queueFams->Length, img, alloc);
+	return allocator->CreateImage(creatInfo, memUsage, queueFams_ptr, queueFams->Length, img, alloc);
 }
 
 void Kokoro::Graphics::GraphicsDevice::DestroyImage(VkImage img, WVmaAllocation alloc) {
@@ -478,10 +770,196 @@ VkDevice Kokoro::Graphics::GraphicsDevice::GetDevice() {
 	return device;
 }
 
+DescriptorLayoutCache* Kokoro::Graphics::GraphicsDevice::GetDescriptorLayoutCache() {
+	return descLayoutCache;
+}
+
+DescriptorAllocator* Kokoro::Graphics::GraphicsDevice::GetDescriptorAllocator() {
+	return descAllocator;
+}
+
+DescriptorAllocator* Kokoro::Graphics::GraphicsDevice::GetFrameDescriptorAllocator() {
+	return frameDescAllocators[curFrame];
+}
+
+VkPipelineCache Kokoro::Graphics::GraphicsDevice::GetPipelineCache() {
+	return pipelineCache;
+}
+
+PipelineStateCache* Kokoro::Graphics::GraphicsDevice::GetPipelineStateCache() {
+	return pipelineStateCache;
+}
+
+VkPhysicalDeviceSubgroupSizeControlPropertiesEXT Kokoro::Graphics::GraphicsDevice::GetSubgroupSizeProperties() {
+	return subgroupSizeProps;
+}
+
+bool Kokoro::Graphics::GraphicsDevice::SupportsComputeFullSubgroups() {
+	return computeFullSubgroups;
+}
+
+bool Kokoro::Graphics::GraphicsDevice::SupportsPipelineLibraries() {
+	return pipelineLibraries;
+}
+
+uint32_t Kokoro::Graphics::GraphicsDevice::GetSupportedDynamicStates() {
+	return dynamicStates;
+}
+
+VkPhysicalDeviceDescriptorIndexingFeaturesEXT Kokoro::Graphics::GraphicsDevice::GetDescriptorIndexingFeatures() {
+	return descIndexingFeatures;
+}
+
+VkPhysicalDeviceMultiviewFeatures Kokoro::Graphics::GraphicsDevice::GetMultiviewFeatures() {
+	return multiviewFeats;
+}
+
+uint32_t Kokoro::Graphics::GraphicsDevice::GetMaxMultiviewViewCount() {
+	return maxMultiviewViews;
+}
+
+uint32_t Kokoro::Graphics::GraphicsDevice::GetDepthResolveModes() {
+	return depthResolveModes;
+}
+
+uint32_t Kokoro::Graphics::GraphicsDevice::GetStencilResolveModes() {
+	return stencilResolveModes;
+}
+
+bool Kokoro::Graphics::GraphicsDevice::SupportsIndependentResolve() {
+	return independentResolve;
+}
+
+bool Kokoro::Graphics::GraphicsDevice::SupportsIndependentResolveNone() {
+	return independentResolveNone;
+}
+
+uint32_t Kokoro::Graphics::GraphicsDevice::EyeCount::get() {
+	return eyeCount;
+}
+
+void Kokoro::Graphics::GraphicsDevice::EyeCount::set(uint32_t v) {
+	if (v == 0)
+		throw gcnew System::ArgumentOutOfRangeException("EyeCount");
+	//Before the device exists the count is checked when the first stereo pass is built
+	if (device != VK_NULL_HANDLE && v > maxMultiviewViews)
+		throw gcnew System::NotSupportedException("Device can't render " + v + " views in one pass.");
+	eyeCount = v;
+}
+
+PipelineStateCache* Kokoro::Graphics::GraphicsDevice::GetPipelineLibraryCache() {
+	return pipelineLibraryCache;
+}
+
+ShaderRegistry* Kokoro::Graphics::GraphicsDevice::GetShaderRegistry() {
+	return shaderRegistry;
+}
+
+SamplerCache* Kokoro::Graphics::GraphicsDevice::GetSamplerCache() {
+	return samplerCache;
+}
+
+RenderPassCache* Kokoro::Graphics::GraphicsDevice::GetRenderPassCache() {
+	return renderPassCache;
+}
+
+FramebufferCache* Kokoro::Graphics::GraphicsDevice::GetFramebufferCache() {
+	return framebufferCache;
+}
+
+bool Kokoro::Graphics::GraphicsDevice::SupportsImagelessFramebuffers() {
+	return imagelessFramebuffers;
+}
+
+bool Kokoro::Graphics::GraphicsDevice::SupportsTextureCompressionBC() {
+	return textureCompressionBC;
+}
+
+bool Kokoro::Graphics::GraphicsDevice::SupportsStorageImageExtendedFormats() {
+	return storageImageExtendedFormats;
+}
+
+FramebufferAttachmentDesc Kokoro::Graphics::GraphicsDevice::GetSwapchainAttachment(uint32_t idx) {
+	FramebufferAttachmentDesc desc;
+	desc.format = surface_fmt.format;
+	desc.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+	desc.flags = 0;
+	desc.width = surface_extent.width;
+	desc.height = surface_extent.height;
+	desc.layerCount = 1;
+	desc.viewFormatCount = 0;
+	desc.viewFormats = nullptr;
+	desc.view = swapChainViews[idx];
+	return desc;
+}
+
+VkPhysicalDevice Kokoro::Graphics::GraphicsDevice::GetPhysicalDevice() {
+	return physDevice;
+}
+
+bool Kokoro::Graphics::GraphicsDevice::IsExtensionEnabled(const char* name) {
+	return enabledExtns.count(name) != 0;
+}
+
 uint32_t Kokoro::Graphics::GraphicsDevice::GetWidth() {
 	return static_cast<uint32_t>(window->GetWidth());
 }
 
 uint32_t Kokoro::Graphics::GraphicsDevice::GetHeight() {
 	return static_cast<uint32_t>(window->GetHeight());
+}
+
+uint32_t Kokoro::Graphics::GraphicsDevice::GetMaxFramesInFlight() {
+	return swapchain_img_cnt;
+}
+
+uint32_t Kokoro::Graphics::GraphicsDevice::GetCurrentFrameID() {
+	return curFrame;
+}
+
+void Kokoro::Graphics::GraphicsDevice::AdvanceFrame() {
+	//The caller guarantees the frame being reused has retired on the GPU
+	curFrame = (curFrame + 1) % swapchain_img_cnt;
+	frameDescAllocators[curFrame]->Reset(device);
+	FlushDeferred(curFrame);
+	//Swapchain sized framebuffers go stale once the swapchain is recreated at a new extent
+	framebufferCache->SetSwapchainExtent(device, surface_extent);
+
+	//Reloaded shaders swap their pipelines in here, between frames
+	ShaderHotReload::Update();
+}
+
+void Kokoro::Graphics::GraphicsDevice::DeferDestroy(DeferredObjectType type, uint64_t handle) {
+	deferredDestroys[curFrame].push_back(std::make_pair(type, handle));
+}
+
+void Kokoro::Graphics::GraphicsDevice::FlushDeferred(uint32_t frame) {
+	for (auto& d : deferredDestroys[frame]) {
+		switch (d.first) {
+		case DeferredObjectType::Pipeline:
+			vkDestroyPipeline(device, (VkPipeline)d.second, nullptr);
+			break;
+		case DeferredObjectType::CachedPipeline:
+			pipelineStateCache->Release((VkPipeline)d.second);
+			break;
+		case DeferredObjectType::PipelineLayout:
+			vkDestroyPipelineLayout(device, (VkPipelineLayout)d.second, nullptr);
+			break;
+		case DeferredObjectType::ShaderModule:
+			shaderRegistry->Release(device, (VkShaderModule)d.second);
+			break;
+		case DeferredObjectType::CachedFramebuffer:
+			framebufferCache->Release(device, (VkFramebuffer)d.second);
+			break;
+		case DeferredObjectType::CachedSampler:
+			samplerCache->Release(device, (VkSampler)d.second);
+			break;
+		case DeferredObjectType::CachedRenderPass:
+			//Framebuffers made for the pass go with it, before its handle can be reused
+			if (renderPassCache->Release(device, (VkRenderPass)d.second))
+				framebufferCache->InvalidateRenderPass(device, (VkRenderPass)d.second);
+			break;
+		}
+	}
+	deferredDestroys[frame].clear();
 }
\ No newline at end of file
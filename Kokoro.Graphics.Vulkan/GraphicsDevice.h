@@ -6,14 +6,37 @@
 #endif
 #define VMA_VULKAN_VERSION 1001000 // Vulkan 1.1
 #include "vulkan/vulkan.h"
+#include "VulkanExtensions.h"
 
 #include "VmaWrapper.h"
 #include "GameWindow.h"
 #include "MemoryUsage.h"
+#include "DescriptorLayoutCache.h"
+#include "DescriptorAllocator.h"
+#include "PipelineStateCache.h"
+#include "ShaderRegistry.h"
+#include "SamplerCache.h"
+#include "RenderPassCache.h"
+#include "FramebufferCache.h"
 
 using namespace System;
 
 namespace Kokoro::Graphics {
+	enum class DeferredObjectType {
+		Pipeline,
+		//Released back to the PipelineStateCache rather than destroyed
+		CachedPipeline,
+		PipelineLayout,
+		//Released back to the ShaderRegistry
+		ShaderModule,
+		//Released back to the FramebufferCache
+		CachedFramebuffer,
+		//Released back to the SamplerCache
+		CachedSampler,
+		//Released back to the RenderPassCache, framebuffers made for it go with its last reference
+		CachedRenderPass,
+	};
+
 	public ref class GraphicsDevice
 	{
 	private:
@@ -43,19 +66,83 @@ namespace Kokoro::Graphics {
 		//static VmaAllocator allocator;
 		static VmaWrapper* allocator;
 
+		static DescriptorLayoutCache* descLayoutCache;
+		static DescriptorAllocator* descAllocator;
+		static uint32_t curFrame;
+		static VkPipelineCache pipelineCache;
+		static PipelineStateCache* pipelineStateCache;
+		static PipelineStateCache* pipelineLibraryCache;
+		static ShaderRegistry* shaderRegistry;
+		static SamplerCache* samplerCache;
+		static RenderPassCache* renderPassCache;
+		static FramebufferCache* framebufferCache;
+
+		static void FlushDeferred(uint32_t frame);
 		static bool extnsSupported(VkPhysicalDevice device);
 		static int rateDevice(VkPhysicalDevice device);
 
 	internal:
 		static VkDevice GetDevice();
+		static VkPhysicalDevice GetPhysicalDevice();
+		static bool IsExtensionEnabled(const char* name);
+		//requiredSubgroupSizeStages is cleared when the device lacks the subgroupSizeControl feature
+		static VkPhysicalDeviceSubgroupSizeControlPropertiesEXT GetSubgroupSizeProperties();
+		static bool SupportsComputeFullSubgroups();
+		//True when VK_EXT_graphics_pipeline_library and its graphicsPipelineLibrary feature are enabled.
+		static bool SupportsPipelineLibraries();
+		//DynamicStateBits usable on this device, the core states are always included.
+		static uint32_t GetSupportedDynamicStates();
+		//Every member is false when VK_EXT_descriptor_indexing isn't enabled.
+		static VkPhysicalDeviceDescriptorIndexingFeaturesEXT GetDescriptorIndexingFeatures();
+		//Every member is false when the device can't render more than one view per pass.
+		static VkPhysicalDeviceMultiviewFeatures GetMultiviewFeatures();
+		static uint32_t GetMaxMultiviewViewCount();
+		//VkResolveModeFlagsKHR usable for depth and stencil resolve attachments, 0 without VK_KHR_depth_stencil_resolve.
+		static uint32_t GetDepthResolveModes();
+		static uint32_t GetStencilResolveModes();
+		//Whether depth and stencil may resolve with different modes, or with only one of them set to None.
+		static bool SupportsIndependentResolve();
+		static bool SupportsIndependentResolveNone();
+		//False when the device lacks VK_KHR_imageless_framebuffer, framebuffers are then built per set of views.
+		static bool SupportsImagelessFramebuffers();
+		//Whether BC1-7 images can be created and sampled, enabled whenever the device has it.
+		static bool SupportsTextureCompressionBC();
+		//Whether shaders may declare storage images with the formats beyond the core set, like r8 or rg16f.
+		static bool SupportsStorageImageExtendedFormats();
+		//Describes swapchain image idx as a framebuffer attachment.
+		static FramebufferAttachmentDesc GetSwapchainAttachment(uint32_t idx);
 		static int CreateBuffer(VkBufferCreateInfo* creatInfo, MemoryUsage memUsage, bool persistent_map, VkBuffer* buf, WVmaAllocation* alloc);
 		static void DestroyBuffer(VkBuffer buf, WVmaAllocation alloc);
-		static int CreateImage(VkImageCreateInfo* creatInfo, VkImage* img, WVmaAllocation* alloc);
+		static int CreateImage(VkImageCreateInfo* creatInfo, MemoryUsage memUsage, VkImage* img, WVmaAllocation* alloc);
 		static void DestroyImage(VkImage img, WVmaAllocation alloc);
+		static DescriptorLayoutCache* GetDescriptorLayoutCache();
+		static DescriptorAllocator* GetDescriptorAllocator();
+		static DescriptorAllocator* GetFrameDescriptorAllocator();
+		static VkPipelineCache GetPipelineCache();
+		static PipelineStateCache* GetPipelineStateCache();
+		//Graphics pipeline library parts, keyed by the subset of state each part depends on
+		static PipelineStateCache* GetPipelineLibraryCache();
+		static ShaderRegistry* GetShaderRegistry();
+		static SamplerCache* GetSamplerCache();
+		static RenderPassCache* GetRenderPassCache();
+		static FramebufferCache* GetFramebufferCache();
+		//Destroys handle once every frame currently in flight has retired.
+		static void DeferDestroy(DeferredObjectType type, uint64_t handle);
 
 	public:
+		//Compile shaders from GLSL through the SPIR-V cache instead of loading prebuilt binaries.
+		static property bool RebuildShaders;
+		//Views rendered by a stereo pass, 2 for VR. Shaders see it as EYECOUNT, so it should be set before they're loaded.
+		static property uint32_t EyeCount {
+			uint32_t get();
+			void set(uint32_t v);
+		}
+
 		static uint32_t GetWidth();
 		static uint32_t GetHeight();
+		static uint32_t GetMaxFramesInFlight();
+		static uint32_t GetCurrentFrameID();
+		static void AdvanceFrame();
 		static void SetNames(String^ appName, String^ engineName);
 		static void Destroy();
 		static void CreateInstance(bool enableValidation);
@@ -1,5 +1,33 @@
 #include "GraphicsPipeline.h"
 #include "SpecializedShaderModule.h"
+#include "ShaderModule.h"
+#include "DescriptorSet.h"
+#include "RenderPass.h"
+#include "Framebuffer.h"
+#include "ShaderHotReload.h"
+#include <vector>
+
+namespace Kokoro::Graphics {
+	//Every create info of a graphics pipeline, shared by the monolithic and pipeline library paths.
+	//Holds pointers into itself, so it must stay where it was filled.
+	struct GraphicsPipelineState {
+		VkPipelineVertexInputStateCreateInfo vInput;
+		VkPipelineInputAssemblyStateCreateInfo ia;
+		VkViewport vport;
+		VkRect2D scissor;
+		VkPipelineViewportStateCreateInfo vportState;
+		VkPipelineRasterizationStateCreateInfo ras;
+		VkPipelineMultisampleStateCreateInfo ms;
+		VkPipelineDepthStencilStateCreateInfo depth;
+		std::vector<VkPipelineColorBlendAttachmentState> colAttachments;
+		VkPipelineColorBlendStateCreateInfo colBlend;
+		std::vector<VkDynamicState> dynStates;
+		VkPipelineDynamicStateCreateInfo dyn;
+		std::vector<VkPipelineShaderStageCreateInfo> stages;
+		std::vector<VkDescriptorSetLayout> setLayouts;
+		VkPipelineLayoutCreateInfo layout;
+	};
+}
 
 Kokoro::Graphics::GraphicsPipeline::GraphicsPipeline() {
 	shaders = gcnew List<SpecializedShaderModule^>();
@@ -17,98 +45,706 @@ Kokoro::Graphics::GraphicsPipeline::GraphicsPipeline() {
 	AlphaBlend->DestFactor = BlendFactor::OneMinusSourceAlpha;
 	AlphaBlend->SrcFactor = BlendFactor::SourceAlpha;
 	AlphaBlend->Op = BlendOp::Add;
+	BlendEnable = true;
 
 	Fill = FillMode::Fill;
 
+	DepthTest = false;
+	DepthWrite = false;
+	DepthCompare = DepthFunc::Greater;
+	DepthClamp = false;
+	RenderPass = nullptr;
+	Subpass = 0;
+
+	descSets = gcnew List<DescriptorSet^>();
+	pushConstants = gcnew List<PushConstantRange>();
+	attachmentBlends = gcnew Dictionary<uint32_t, AttachmentBlend>();
+	pipeline = VK_NULL_HANDLE;
+	pipelineLayout = VK_NULL_HANDLE;
+	rebuildTask = nullptr;
+	pipelineOwned = false;
+	DynamicRasterState = false;
+	dynamicMask = DynamicViewport;
 	locked = false;
 }
 
+Kokoro::Graphics::GraphicsPipeline::~GraphicsPipeline() {
+	if (rebuildTask != nullptr) {
+		//A faulted rebuild created nothing
+		try {
+			rebuildTask->Wait();
+			GraphicsDevice::GetPipelineStateCache()->Release(rebuiltPipeline);
+		}
+		catch (AggregateException^) {}
+	}
+	for (int i = 0; locked && i < shaders->Count; i++)
+		shaders[i]->parent->RemoveDependent(this);
+	for (int i = 0; i < shaders->Count; i++)
+		shaders[i]->ReleasePipelineRef();
+
+	//Optimized pipelines and their layouts are owned by the state cache, they are destroyed on eviction
+	if (pipelineOwned) {
+		vkDestroyPipeline(GraphicsDevice::GetDevice(), pipeline, nullptr);
+		vkDestroyPipelineLayout(GraphicsDevice::GetDevice(), pipelineLayout, nullptr);
+	}
+	else if (pipeline != VK_NULL_HANDLE)
+		GraphicsDevice::GetPipelineStateCache()->Release(pipeline);
+}
+
 void Kokoro::Graphics::GraphicsPipeline::SetShader(SpecializedShaderModule^ s) {
+	if (locked)
+		throw gcnew System::Exception("Pipeline has already been built.");
+	//Rebuilds read the variant for as long as the pipeline lives
+	s->AddPipelineRef();
 	shaders->Add(s);
 }
 
+void Kokoro::Graphics::GraphicsPipeline::AddDescriptorSet(DescriptorSet^ set) {
+	if (locked)
+		throw gcnew System::Exception("Pipeline has already been built.");
+	descSets->Add(set);
+}
+
+void Kokoro::Graphics::GraphicsPipeline::AddPushConstantRange(PushConstantRange range) {
+	if (locked)
+		throw gcnew System::Exception("Pipeline has already been built.");
+	pushConstants->Add(range);
+}
+
+void Kokoro::Graphics::GraphicsPipeline::SetAttachmentBlend(uint32_t attachment, AttachmentBlend blend) {
+	if (locked)
+		throw gcnew System::Exception("Pipeline has already been built.");
+	attachmentBlends[attachment] = blend;
+}
+
+VkPipeline Kokoro::Graphics::GraphicsPipeline::GetPipeline() {
+	return pipeline;
+}
+
+VkPipelineLayout Kokoro::Graphics::GraphicsPipeline::GetLayout() {
+	return pipelineLayout;
+}
+
+uint32_t Kokoro::Graphics::GraphicsPipeline::GetDynamicMask() {
+	return dynamicMask;
+}
+
+void Kokoro::Graphics::GraphicsPipeline::Bind(DynamicStateTracker* tracker, uint32_t w, uint32_t h) {
+	tracker->BindPipeline(pipeline, dynamicMask);
+
+	VkViewport vport = {};
+	vport.width = static_cast<float>(w);
+	vport.height = static_cast<float>(h);
+	vport.minDepth = 0.0f;
+	vport.maxDepth = 1.0f;
+	tracker->SetViewport(vport);
+	if (dynamicMask & DynamicScissor) {
+		VkRect2D scissor = {};
+		scissor.extent = { w, h };
+		tracker->SetScissor(scissor);
+	}
+	if (dynamicMask & DynamicLineWidth)
+		tracker->SetLineWidth(LineWidth);
+
+	//Dynamic fields follow the current property values, no rebuild needed
+	RasterState r;
+	r.cullMode = CullModeConv::Convert(Cull);
+	r.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+	r.topology = TopologyTypeConv::Convert(Topology);
+	r.depthTest = DepthTest;
+	r.depthWrite = DepthWrite;
+	r.depthCompare = DepthFuncConv::Convert(DepthCompare);
+	r.rasterizerDiscard = RasterizerDiscard;
+	r.polygonMode = FillModeConv::Convert(Fill);
+	r.depthClamp = DepthClamp;
+	tracker->SetRasterState(r, dynamicMask);
+}
+
+void Kokoro::Graphics::GraphicsPipeline::Bind(Framebuffer^ fb) {
+	auto extent = fb->GetRenderExtent();
+	Bind(fb->GetStateTracker(), extent.width, extent.height);
+}
+
+void Kokoro::Graphics::GraphicsPipeline::ReflectLayout(std::vector<VkPushConstantRange>& pushRanges) {
+	std::vector<const SpirvReflection*> stages(shaders->Count);
+	for (int i = 0; i < shaders->Count; i++)
+		stages[i] = shaders[i]->reflection;
+
+	std::vector<SpirvReflection::Binding> bindings;
+	std::vector<VkPushConstantRange> reflectedRanges;
+	if (!SpirvReflection::Merge(stages.data(), static_cast<uint32_t>(stages.size()), bindings, reflectedRanges))
+		throw gcnew System::Exception("Shader stages declare conflicting descriptor types for the same binding.");
+	for (auto& b : bindings)
+		if (b.set >= static_cast<uint32_t>(descSets->Count))
+			throw gcnew System::Exception("Shaders use descriptor set " + b.set + " but only " + descSets->Count + " were added.");
+
+	if (pushConstants->Count == 0) {
+		pushRanges = reflectedRanges;
+		return;
+	}
+	pushRanges.resize(pushConstants->Count);
+	for (int i = 0; i < pushConstants->Count; i++) {
+		pushRanges[i].stageFlags = ShaderTypeConv::Convert(pushConstants[i].Stages);
+		pushRanges[i].offset = pushConstants[i].Offset;
+		pushRanges[i].size = pushConstants[i].Size;
+	}
+}
+
+void Kokoro::Graphics::GraphicsPipeline::AppendLayoutKey(PipelineStateKey& key, const std::vector<VkPushConstantRange>& pushRanges) {
+	key.Append((uint64_t)descSets->Count);
+	for (int i = 0; i < descSets->Count; i++)
+		descSets[i]->AppendLayoutKey(key);
+	key.Append((uint64_t)pushRanges.size());
+	for (auto& r : pushRanges) {
+		key.Append((uint64_t)r.stageFlags);
+		key.Append((uint64_t)r.offset << 32 | r.size);
+	}
+}
+
+//Dynamic topology may only switch within the class of topology the pipeline was built with
+static uint64_t TopologyClass(Kokoro::Graphics::TopologyType t) {
+	switch (t) {
+	case Kokoro::Graphics::TopologyType::Line:
+	case Kokoro::Graphics::TopologyType::LineStrip:
+		return 1;
+	case Kokoro::Graphics::TopologyType::Point:
+		return 2;
+	default:
+		return 0;
+	}
+}
+
+static void AppendDynamicStates(uint32_t mask, std::vector<VkDynamicState>& states) {
+	struct { uint32_t bit; VkDynamicState state; } table[] = {
+		{ Kokoro::Graphics::DynamicViewport, VK_DYNAMIC_STATE_VIEWPORT },
+		{ Kokoro::Graphics::DynamicScissor, VK_DYNAMIC_STATE_SCISSOR },
+		{ Kokoro::Graphics::DynamicLineWidth, VK_DYNAMIC_STATE_LINE_WIDTH },
+#ifdef VK_EXT_extended_dynamic_state
+		{ Kokoro::Graphics::DynamicCullMode, VK_DYNAMIC_STATE_CULL_MODE_EXT },
+		{ Kokoro::Graphics::DynamicFrontFace, VK_DYNAMIC_STATE_FRONT_FACE_EXT },
+		{ Kokoro::Graphics::DynamicTopology, VK_DYNAMIC_STATE_PRIMITIVE_TOPOLOGY_EXT },
+		{ Kokoro::Graphics::DynamicDepthTest, VK_DYNAMIC_STATE_DEPTH_TEST_ENABLE_EXT },
+		{ Kokoro::Graphics::DynamicDepthWrite, VK_DYNAMIC_STATE_DEPTH_WRITE_ENABLE_EXT },
+		{ Kokoro::Graphics::DynamicDepthCompare, VK_DYNAMIC_STATE_DEPTH_COMPARE_OP_EXT },
+#endif
+#ifdef VK_EXT_extended_dynamic_state2
+		{ Kokoro::Graphics::DynamicRasterizerDiscard, VK_DYNAMIC_STATE_RASTERIZER_DISCARD_ENABLE_EXT },
+#endif
+#ifdef VK_EXT_extended_dynamic_state3
+		{ Kokoro::Graphics::DynamicPolygonMode, VK_DYNAMIC_STATE_POLYGON_MODE_EXT },
+		{ Kokoro::Graphics::DynamicDepthClamp, VK_DYNAMIC_STATE_DEPTH_CLAMP_ENABLE_EXT },
+#endif
+	};
+	for (auto& e : table)
+		if (mask & e.bit)
+			states.push_back(e.state);
+}
+
+//State left dynamic is excluded from the keys, so pipelines differing only in it are shared
+void Kokoro::Graphics::GraphicsPipeline::AppendVertexInputKey(PipelineStateKey& key) {
+	key.Append((uint64_t)dynamicMask);
+	key.Append((dynamicMask & DynamicTopology) ? TopologyClass(Topology) : (uint64_t)Topology);
+}
+
+void Kokoro::Graphics::GraphicsPipeline::AppendPreRasterKey(PipelineStateKey& key, uint32_t w, uint32_t h) {
+	key.Append((uint64_t)dynamicMask);
+	if (!(dynamicMask & DynamicScissor))
+		key.Append((uint64_t)w << 32 | h);
+	if (!(dynamicMask & DynamicRasterizerDiscard))
+		key.Append((uint64_t)RasterizerDiscard);
+	if (!(dynamicMask & DynamicLineWidth)) {
+		float lineWidth = LineWidth;
+		key.Append(&lineWidth, sizeof(lineWidth));
+	}
+	if (!(dynamicMask & DynamicCullMode))
+		key.Append((uint64_t)Cull);
+	if (!(dynamicMask & DynamicPolygonMode))
+		key.Append((uint64_t)Fill);
+	if (!(dynamicMask & DynamicDepthClamp))
+		key.Append((uint64_t)DepthClamp);
+}
+
+void Kokoro::Graphics::GraphicsPipeline::AppendFragmentKey(PipelineStateKey& key) {
+	key.Append((uint64_t)dynamicMask);
+	if (!(dynamicMask & DynamicDepthTest))
+		key.Append((uint64_t)DepthTest);
+	if (!(dynamicMask & DynamicDepthWrite))
+		key.Append((uint64_t)DepthWrite);
+	if (!(dynamicMask & DynamicDepthCompare))
+		key.Append((uint64_t)DepthCompare);
+}
+
+void Kokoro::Graphics::GraphicsPipeline::AppendOutputKey(PipelineStateKey& key) {
+	key.Append((uint64_t)BlendEnable);
+	key.Append((uint64_t)ColorBlend->SrcFactor << 32 | (uint64_t)ColorBlend->DestFactor << 16 | (uint64_t)ColorBlend->Op);
+	key.Append((uint64_t)AlphaBlend->SrcFactor << 32 | (uint64_t)AlphaBlend->DestFactor << 16 | (uint64_t)AlphaBlend->Op);
+
+	//Dictionary order isn't stable, walk the subpass's attachments instead
+	auto colCnt = RenderPass->GetColorAttachmentCount(Subpass);
+	for (uint32_t i = 0; i < colCnt; i++) {
+		AttachmentBlend b;
+		if (!attachmentBlends->TryGetValue(i, b))
+			continue;
+		key.Append((uint64_t)i << 32 | (uint64_t)b.Enable);
+		key.Append((uint64_t)b.Color.SrcFactor << 32 | (uint64_t)b.Color.DestFactor << 16 | (uint64_t)b.Color.Op);
+		key.Append((uint64_t)b.Alpha.SrcFactor << 32 | (uint64_t)b.Alpha.DestFactor << 16 | (uint64_t)b.Alpha.Op);
+	}
+}
+
+void Kokoro::Graphics::GraphicsPipeline::AppendStateKey(PipelineStateKey& key, const std::vector<VkPushConstantRange>& pushRanges, uint32_t w, uint32_t h) {
+	AppendVertexInputKey(key);
+	AppendPreRasterKey(key, w, h);
+	AppendFragmentKey(key);
+	AppendOutputKey(key);
+
+	key.Append((uint64_t)Subpass);
+	RenderPass->AppendCompatibilityKey(key);
+	AppendLayoutKey(key, pushRanges);
+
+	key.Append((uint64_t)shaders->Count);
+	for (int i = 0; i < shaders->Count; i++)
+		shaders[i]->AppendStateKey(key);
+}
+
+void Kokoro::Graphics::GraphicsPipeline::FillState(GraphicsPipelineState& s, const std::vector<VkPushConstantRange>& pushRanges, uint32_t w, uint32_t h) {
+	s.vInput = {};
+	s.vInput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	s.vInput.vertexBindingDescriptionCount = 0;
+	s.vInput.pVertexBindingDescriptions = nullptr;
+	s.vInput.vertexAttributeDescriptionCount = 0;
+	s.vInput.pVertexAttributeDescriptions = nullptr;
+
+	s.ia = {};
+	s.ia.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	s.ia.flags = 0;
+	s.ia.topology = TopologyTypeConv::Convert(Topology);
+	s.ia.primitiveRestartEnable = VK_FALSE;
+
+	s.vport = {};
+	s.vport.x = 0.0f;
+	s.vport.y = 0.0f;
+	s.vport.width = static_cast<float>(w);
+	s.vport.height = static_cast<float>(h);
+	s.vport.minDepth = 0.0f;
+	s.vport.maxDepth = 1.0f;
+
+	s.scissor = {};
+	s.scissor.offset = { 0,0 };
+	s.scissor.extent = {
+		w, h
+	};
+
+	s.vportState = {};
+	s.vportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	s.vportState.viewportCount = 1;
+	s.vportState.pViewports = &s.vport;
+	s.vportState.scissorCount = 1;
+	s.vportState.pScissors = &s.scissor;
+
+	s.ras = {};
+	s.ras.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	s.ras.depthClampEnable = DepthClamp ? VK_TRUE : VK_FALSE;
+	s.ras.rasterizerDiscardEnable = RasterizerDiscard ? VK_TRUE : VK_FALSE;
+	s.ras.polygonMode = FillModeConv::Convert(Fill);
+	s.ras.lineWidth = LineWidth;
+	s.ras.cullMode = CullModeConv::Convert(Cull);
+	s.ras.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+	s.ras.depthBiasEnable = VK_FALSE;
+	s.ras.depthBiasConstantFactor = 0.0f;
+	s.ras.depthBiasClamp = 0.0f;
+	s.ras.depthBiasSlopeFactor = 0.0f;
+
+	s.ms = {};
+	s.ms.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	s.ms.sampleShadingEnable = VK_FALSE;
+	//Always what the subpass's attachments were created with, the compatibility key covers it
+	s.ms.rasterizationSamples = RenderPass->GetSampleCount(Subpass);
+	s.ms.minSampleShading = 1.0f;
+	s.ms.pSampleMask = nullptr;
+	s.ms.alphaToCoverageEnable = VK_FALSE;
+	s.ms.alphaToOneEnable = VK_FALSE;
+
+	s.depth = {};
+	s.depth.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	s.depth.depthTestEnable = DepthTest ? VK_TRUE : VK_FALSE;
+	s.depth.depthWriteEnable = DepthWrite ? VK_TRUE : VK_FALSE;
+	s.depth.depthCompareOp = DepthFuncConv::Convert(DepthCompare);
+	s.depth.depthBoundsTestEnable = VK_FALSE;
+	s.depth.stencilTestEnable = VK_FALSE;
+	s.depth.minDepthBounds = 0.0f;
+	s.depth.maxDepthBounds = 1.0f;
+
+	VkPipelineColorBlendAttachmentState colCreatInfo = {};
+	colCreatInfo.alphaBlendOp = BlendOpConv::Convert(AlphaBlend->Op);
+	colCreatInfo.srcAlphaBlendFactor = BlendFactorConv::Convert(AlphaBlend->SrcFactor);
+	colCreatInfo.dstAlphaBlendFactor = BlendFactorConv::Convert(AlphaBlend->DestFactor);
+	colCreatInfo.colorBlendOp = BlendOpConv::Convert(ColorBlend->Op);
+	colCreatInfo.srcColorBlendFactor = BlendFactorConv::Convert(ColorBlend->SrcFactor);
+	colCreatInfo.dstColorBlendFactor = BlendFactorConv::Convert(ColorBlend->DestFactor);
+	colCreatInfo.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+	colCreatInfo.blendEnable = BlendEnable ? VK_TRUE : VK_FALSE;
+
+	//Color attachments without their own blend state share the pipeline's
+	s.colAttachments.assign(RenderPass->GetColorAttachmentCount(Subpass), colCreatInfo);
+	for (uint32_t i = 0; i < s.colAttachments.size(); i++) {
+		AttachmentBlend b;
+		if (!attachmentBlends->TryGetValue(i, b))
+			continue;
+		auto& a = s.colAttachments[i];
+		a.blendEnable = b.Enable ? VK_TRUE : VK_FALSE;
+		a.colorBlendOp = BlendOpConv::Convert(b.Color.Op);
+		a.srcColorBlendFactor = BlendFactorConv::Convert(b.Color.SrcFactor);
+		a.dstColorBlendFactor = BlendFactorConv::Convert(b.Color.DestFactor);
+		a.alphaBlendOp = BlendOpConv::Convert(b.Alpha.Op);
+		a.srcAlphaBlendFactor = BlendFactorConv::Convert(b.Alpha.SrcFactor);
+		a.dstAlphaBlendFactor = BlendFactorConv::Convert(b.Alpha.DestFactor);
+	}
+
+	s.colBlend = {};
+	s.colBlend.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	s.colBlend.logicOpEnable = VK_FALSE;
+	s.colBlend.logicOp = VK_LOGIC_OP_COPY;
+	s.colBlend.attachmentCount = static_cast<uint32_t>(s.colAttachments.size());
+	s.colBlend.pAttachments = s.colAttachments.data();
+
+	s.dynStates.clear();
+	AppendDynamicStates(dynamicMask, s.dynStates);
+	s.dyn = {};
+	s.dyn.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	s.dyn.dynamicStateCount = static_cast<uint32_t>(s.dynStates.size());
+	s.dyn.pDynamicStates = s.dynStates.data();
+
+	s.stages.resize(shaders->Count);
+	for (int i = 0; i < shaders->Count; i++)
+		s.stages[i] = *shaders[i]->GetCreateInfo();
+
+	s.setLayouts.resize(descSets->Count);
+	for (int i = 0; i < descSets->Count; i++)
+		s.setLayouts[i] = descSets[i]->GetLayout();
+
+	s.layout = {};
+	s.layout.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	s.layout.setLayoutCount = static_cast<uint32_t>(s.setLayouts.size());
+	s.layout.pSetLayouts = s.setLayouts.data();
+	s.layout.pushConstantRangeCount = static_cast<uint32_t>(pushRanges.size());
+	s.layout.pPushConstantRanges = pushRanges.data();
+}
+
+#ifdef VK_EXT_graphics_pipeline_library
+static const uint32_t LibraryPartCount = 4;
+
+void Kokoro::Graphics::GraphicsPipeline::AcquireLibraries(const GraphicsPipelineState& s, const std::vector<VkPushConstantRange>& pushRanges, uint32_t w, uint32_t h, VkPipeline* libs) {
+	static const VkGraphicsPipelineLibraryFlagsEXT parts[LibraryPartCount] = {
+		VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT,
+		VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT,
+		VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT,
+		VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT,
+	};
+
+	//Each part is keyed only by the state it consumes, so permutations that differ elsewhere share it
+	PipelineStateKey keys[LibraryPartCount];
+	for (uint32_t i = 0; i < LibraryPartCount; i++)
+		keys[i].Append((uint64_t)parts[i]);
+	AppendVertexInputKey(keys[0]);
+	AppendPreRasterKey(keys[1], w, h);
+	AppendFragmentKey(keys[2]);
+	AppendOutputKey(keys[3]);
+
+	for (uint32_t i = 1; i < LibraryPartCount; i++) {
+		keys[i].Append((uint64_t)Subpass);
+		RenderPass->AppendCompatibilityKey(keys[i]);
+	}
+	AppendLayoutKey(keys[1], pushRanges);
+	AppendLayoutKey(keys[2], pushRanges);
+
+	std::vector<VkPipelineShaderStageCreateInfo> preRasterStages;
+	std::vector<VkPipelineShaderStageCreateInfo> fragmentStages;
+	for (int i = 0; i < shaders->Count; i++) {
+		bool frag = s.stages[i].stage == VK_SHADER_STAGE_FRAGMENT_BIT;
+		shaders[i]->AppendStateKey(keys[frag ? 2 : 1]);
+		(frag ? fragmentStages : preRasterStages).push_back(s.stages[i]);
+	}
+
+	auto dev = GraphicsDevice::GetDevice();
+	auto libCache = GraphicsDevice::GetPipelineLibraryCache();
+	for (uint32_t i = 0; i < LibraryPartCount; i++) {
+		VkPipelineLayout partLayout = VK_NULL_HANDLE;
+		if (libCache->Acquire(keys[i], &libs[i], &partLayout))
+			continue;
+
+		VkGraphicsPipelineLibraryCreateInfoEXT libCreatInfo = {};
+		libCreatInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_LIBRARY_CREATE_INFO_EXT;
+		libCreatInfo.flags = parts[i];
+
+		VkGraphicsPipelineCreateInfo partCreatInfo = {};
+		partCreatInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+		partCreatInfo.pNext = &libCreatInfo;
+		partCreatInfo.flags = VK_PIPELINE_CREATE_LIBRARY_BIT_KHR | VK_PIPELINE_CREATE_RETAIN_LINK_TIME_OPTIMIZATION_INFO_BIT_EXT;
+		partCreatInfo.pDynamicState = &s.dyn;
+		partCreatInfo.basePipelineHandle = VK_NULL_HANDLE;
+		partCreatInfo.basePipelineIndex = -1;
+		switch (i) {
+		case 0:
+			partCreatInfo.pVertexInputState = &s.vInput;
+			partCreatInfo.pInputAssemblyState = &s.ia;
+			break;
+		case 1:
+			partCreatInfo.stageCount = static_cast<uint32_t>(preRasterStages.size());
+			partCreatInfo.pStages = preRasterStages.data();
+			partCreatInfo.pViewportState = &s.vportState;
+			partCreatInfo.pRasterizationState = &s.ras;
+			break;
+		case 2:
+			partCreatInfo.stageCount = static_cast<uint32_t>(fragmentStages.size());
+			partCreatInfo.pStages = fragmentStages.data();
+			partCreatInfo.pDepthStencilState = &s.depth;
+			partCreatInfo.pMultisampleState = &s.ms;
+			break;
+		case 3:
+			partCreatInfo.pColorBlendState = &s.colBlend;
+			partCreatInfo.pMultisampleState = &s.ms;
+			break;
+		}
+		if (i != 0) {
+			partCreatInfo.renderPass = RenderPass->GetRenderPass();
+			partCreatInfo.subpass = Subpass;
+		}
+		if (i == 1 || i == 2) {
+			if (vkCreatePipelineLayout(dev, &s.layout, nullptr, &partLayout) != VK_SUCCESS)
+				throw gcnew System::Exception("Failed to create pipeline layout.");
+			partCreatInfo.layout = partLayout;
+		}
+
+		if (vkCreateGraphicsPipelines(dev, GraphicsDevice::GetPipelineCache(), 1, &partCreatInfo, nullptr, &libs[i]) != VK_SUCCESS) {
+			vkDestroyPipelineLayout(dev, partLayout, nullptr);
+			for (uint32_t j = 0; j < i; j++)
+				libCache->Release(libs[j]);
+			throw gcnew System::Exception("Failed to create graphics pipeline library.");
+		}
+		libCache->Insert(dev, keys[i], &libs[i], &partLayout);
+	}
+}
+#endif
+
+bool Kokoro::Graphics::GraphicsPipeline::Create(uint32_t w, uint32_t h, bool fastLink, VkPipeline* outPipeline, VkPipelineLayout* outLayout) {
+	if (RenderPass == nullptr)
+		throw gcnew System::Exception("Pipeline requires a render pass.");
+
+	//The view mask itself comes from the subpass, the device just has to support it for every stage used
+	if (RenderPass->GetViewMask(Subpass) != 0) {
+		auto mv = GraphicsDevice::GetMultiviewFeatures();
+		if (!mv.multiview)
+			throw gcnew System::NotSupportedException("Device does not support multiview.");
+		for (int i = 0; i < shaders->Count; i++) {
+			auto t = shaders[i]->sType;
+			if (t == ShaderType::Geometry && !mv.multiviewGeometryShader)
+				throw gcnew System::NotSupportedException("Device does not support geometry shaders with multiview.");
+			if ((t == ShaderType::TessCtrl || t == ShaderType::TessEval) && !mv.multiviewTessellationShader)
+				throw gcnew System::NotSupportedException("Device does not support tessellation shaders with multiview.");
+		}
+	}
+
+	std::vector<VkPushConstantRange> pushRanges;
+	ReflectLayout(pushRanges);
+
+	PipelineStateKey key;
+	AppendStateKey(key, pushRanges, w, h);
+
+	auto stateCache = GraphicsDevice::GetPipelineStateCache();
+	VkPipeline newPipeline = VK_NULL_HANDLE;
+	VkPipelineLayout newLayout = VK_NULL_HANDLE;
+	if (stateCache->Acquire(key, &newPipeline, &newLayout)) {
+		*outPipeline = newPipeline;
+		*outLayout = newLayout;
+		return false;
+	}
+
+	GraphicsPipelineState s;
+	FillState(s, pushRanges, w, h);
+
+	auto dev = GraphicsDevice::GetDevice();
+	if (vkCreatePipelineLayout(dev, &s.layout, nullptr, &newLayout) != VK_SUCCESS)
+		throw gcnew System::Exception("Failed to create pipeline layout.");
+
+#ifdef VK_EXT_graphics_pipeline_library
+	if (GraphicsDevice::SupportsPipelineLibraries()) {
+		VkPipeline libs[LibraryPartCount];
+		try {
+			AcquireLibraries(s, pushRanges, w, h, libs);
+		}
+		catch (System::Exception^) {
+			vkDestroyPipelineLayout(dev, newLayout, nullptr);
+			throw;
+		}
+
+		VkPipelineLibraryCreateInfoKHR linkCreatInfo = {};
+		linkCreatInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LIBRARY_CREATE_INFO_KHR;
+		linkCreatInfo.libraryCount = LibraryPartCount;
+		linkCreatInfo.pLibraries = libs;
+
+		//A fast link skips cross-stage optimization, the optimized link is done in the background
+		VkGraphicsPipelineCreateInfo linkedCreatInfo = {};
+		linkedCreatInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+		linkedCreatInfo.pNext = &linkCreatInfo;
+		linkedCreatInfo.flags = fastLink ? 0 : VK_PIPELINE_CREATE_LINK_TIME_OPTIMIZATION_BIT_EXT;
+		linkedCreatInfo.layout = newLayout;
+		linkedCreatInfo.basePipelineHandle = VK_NULL_HANDLE;
+		linkedCreatInfo.basePipelineIndex = -1;
+
+		VkResult res = vkCreateGraphicsPipelines(dev, GraphicsDevice::GetPipelineCache(), 1, &linkedCreatInfo, nullptr, &newPipeline);
+		//Linked pipelines don't reference their libraries, unused parts stay cached until evicted
+		for (uint32_t i = 0; i < LibraryPartCount; i++)
+			GraphicsDevice::GetPipelineLibraryCache()->Release(libs[i]);
+		if (res != VK_SUCCESS) {
+			vkDestroyPipelineLayout(dev, newLayout, nullptr);
+			throw gcnew System::Exception("Failed to link graphics pipeline.");
+		}
+
+		//Fast-linked pipelines are owned by the caller until they are replaced, only optimized ones are shared
+		*outPipeline = newPipeline;
+		*outLayout = newLayout;
+		if (fastLink)
+			return true;
+		stateCache->Insert(dev, key, outPipeline, outLayout);
+		return false;
+	}
+#endif
+
+	VkGraphicsPipelineCreateInfo graphicsCreatInfo = {};
+	graphicsCreatInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	graphicsCreatInfo.stageCount = static_cast<uint32_t>(s.stages.size());
+	graphicsCreatInfo.pStages = s.stages.data();
+	graphicsCreatInfo.pVertexInputState = &s.vInput;
+	graphicsCreatInfo.pInputAssemblyState = &s.ia;
+	graphicsCreatInfo.pTessellationState = nullptr;
+	graphicsCreatInfo.pViewportState = &s.vportState;
+	graphicsCreatInfo.pRasterizationState = &s.ras;
+	graphicsCreatInfo.pMultisampleState = &s.ms;
+	graphicsCreatInfo.pDepthStencilState = &s.depth;
+	graphicsCreatInfo.pColorBlendState = &s.colBlend;
+	graphicsCreatInfo.pDynamicState = &s.dyn;
+	graphicsCreatInfo.layout = newLayout;
+	graphicsCreatInfo.renderPass = RenderPass->GetRenderPass();
+	graphicsCreatInfo.subpass = Subpass;
+	graphicsCreatInfo.basePipelineHandle = VK_NULL_HANDLE;
+	graphicsCreatInfo.basePipelineIndex = -1;
+
+	if (vkCreateGraphicsPipelines(dev, GraphicsDevice::GetPipelineCache(), 1, &graphicsCreatInfo, nullptr, &newPipeline) != VK_SUCCESS) {
+		vkDestroyPipelineLayout(dev, newLayout, nullptr);
+		throw gcnew System::Exception("Failed to create graphics pipeline.");
+	}
+
+	stateCache->Insert(dev, key, &newPipeline, &newLayout);
+	*outPipeline = newPipeline;
+	*outLayout = newLayout;
+	return false;
+}
+
 void Kokoro::Graphics::GraphicsPipeline::Build(uint32_t w, uint32_t h) {
 	if (!locked) {
-		VkPipelineVertexInputStateCreateInfo vInputCreatInfo = {};
-		vInputCreatInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-		vInputCreatInfo.vertexBindingDescriptionCount = 0;
-		vInputCreatInfo.pVertexBindingDescriptions = nullptr;
-		vInputCreatInfo.vertexAttributeDescriptionCount = 0;
-		vInputCreatInfo.pVertexAttributeDescriptions = nullptr;
-
-		VkPipelineInputAssemblyStateCreateInfo iaCreatInfo = {};
-		iaCreatInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-		iaCreatInfo.flags = 0;
-		iaCreatInfo.topology = TopologyTypeConv::Convert(Topology);
-		iaCreatInfo.primitiveRestartEnable = VK_FALSE;
-
-		VkViewport vport = {};
-		vport.x = 0.0f;
-		vport.y = 0.0f;
-		vport.width = static_cast<float>(w);
-		vport.height = static_cast<float>(h);
-		vport.minDepth = 0.0f;
-		vport.maxDepth = 1.0f;
+		dynamicMask = DynamicViewport;
+		if (DynamicRasterState)
+			dynamicMask = GraphicsDevice::GetSupportedDynamicStates();
 
-		VkRect2D scissor = {};
-		scissor.offset = { 0,0 };
-		scissor.extent = {
-			w, h
-		};
-
-		VkPipelineViewportStateCreateInfo vportCreatInfo = {};
-		vportCreatInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-		vportCreatInfo.viewportCount = 1;
-		vportCreatInfo.pViewports = &vport;
-		vportCreatInfo.scissorCount = 1;
-		vportCreatInfo.pScissors = &scissor;
-
-		VkPipelineRasterizationStateCreateInfo rasCreatInfo = {};
-		rasCreatInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-		rasCreatInfo.depthClampEnable = VK_FALSE;
-		rasCreatInfo.rasterizerDiscardEnable = RasterizerDiscard ? VK_TRUE : VK_FALSE;
-		rasCreatInfo.polygonMode = FillModeConv::Convert(Fill);
-		rasCreatInfo.lineWidth = LineWidth;
-		rasCreatInfo.cullMode = CullModeConv::Convert(Cull);
-		rasCreatInfo.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
-		rasCreatInfo.depthBiasEnable = VK_FALSE;
-		rasCreatInfo.depthBiasConstantFactor = 0.0f;
-		rasCreatInfo.depthBiasClamp = 0.0f;
-		rasCreatInfo.depthBiasSlopeFactor = 0.0f;
-
-		VkPipelineMultisampleStateCreateInfo msCreatInfo = {};
-		msCreatInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-		msCreatInfo.sampleShadingEnable = VK_FALSE;
-		msCreatInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
-		msCreatInfo.minSampleShading = 1.0f;
-		msCreatInfo.pSampleMask = nullptr;
-		msCreatInfo.alphaToCoverageEnable = VK_FALSE;
-		msCreatInfo.alphaToOneEnable = VK_FALSE;
-
-		VkPipelineDepthStencilStateCreateInfo dpthCreatInfo = {};
-		dpthCreatInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
-
-		VkPipelineColorBlendAttachmentState colCreatInfo = {};
-		colCreatInfo.alphaBlendOp = BlendOpConv::Convert(AlphaBlend->Op);
-		colCreatInfo.srcAlphaBlendFactor = BlendFactorConv::Convert(AlphaBlend->SrcFactor);
-		colCreatInfo.dstAlphaBlendFactor = BlendFactorConv::Convert(AlphaBlend->DestFactor);
-		colCreatInfo.colorBlendOp = BlendOpConv::Convert(ColorBlend->Op);
-		colCreatInfo.srcColorBlendFactor = BlendFactorConv::Convert(ColorBlend->SrcFactor);
-		colCreatInfo.dstColorBlendFactor = BlendFactorConv::Convert(ColorBlend->DestFactor);
-		colCreatInfo.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-		colCreatInfo.blendEnable = VK_TRUE;
-
-		VkPipelineColorBlendStateCreateInfo colBlendCreatInfo = {};
-		colBlendCreatInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-
-		VkDynamicState dynState = VK_DYNAMIC_STATE_VIEWPORT;
-		VkPipelineDynamicStateCreateInfo dynCreatInfo = {};
-		dynCreatInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-		dynCreatInfo.dynamicStateCount = 1;
-		dynCreatInfo.pDynamicStates = &dynState;
-
-		VkPipelineLayoutCreateInfo pipelineCreatInfo = {};
-		pipelineCreatInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-		//pipelineCreatInfo.s
-	}
-}
\ No newline at end of file
+		//Builds may run on worker threads, the modules can't be reloaded until they're done reading them
+		for (int i = 0; i < shaders->Count; i++)
+			shaders[i]->parent->BeginBuild();
+		try {
+			VkPipeline newPipeline = VK_NULL_HANDLE;
+			VkPipelineLayout newLayout = VK_NULL_HANDLE;
+			pipelineOwned = Create(w, h, true, &newPipeline, &newLayout);
+			pipeline = newPipeline;
+			pipelineLayout = newLayout;
+			builtW = w;
+			builtH = h;
+			locked = true;
+
+			//Swapped for the optimized link at a frame boundary once it is ready
+			if (pipelineOwned) {
+				BeginRebuild();
+				ShaderHotReload::QueueRebuild(this);
+			}
+		}
+		finally {
+			for (int i = 0; i < shaders->Count; i++)
+				shaders[i]->parent->EndBuild(locked ? this : nullptr);
+		}
+	}
+}
+
+void Kokoro::Graphics::GraphicsPipeline::RebuildPending() {
+	VkPipeline newPipeline = VK_NULL_HANDLE;
+	VkPipelineLayout newLayout = VK_NULL_HANDLE;
+	Create(builtW, builtH, false, &newPipeline, &newLayout);
+	rebuiltPipeline = newPipeline;
+	rebuiltLayout = newLayout;
+}
+
+void Kokoro::Graphics::GraphicsPipeline::BeginRebuild() {
+	if (locked && rebuildTask == nullptr)
+		rebuildTask = Task::Factory->StartNew(gcnew System::Action(this, &GraphicsPipeline::RebuildPending));
+}
+
+bool Kokoro::Graphics::GraphicsPipeline::FinishRebuild() {
+	if (rebuildTask == nullptr)
+		return false;
+	if (!rebuildTask->IsCompleted)
+		return true;
+
+	auto t = rebuildTask;
+	rebuildTask = nullptr;
+	if (t->IsFaulted)
+		throw t->Exception->InnerException;
+
+	//The old pipeline may still be referenced by frames in flight, its cache reference is dropped once they retire
+	if (pipelineOwned) {
+		GraphicsDevice::DeferDestroy(DeferredObjectType::Pipeline, (uint64_t)pipeline);
+		GraphicsDevice::DeferDestroy(DeferredObjectType::PipelineLayout, (uint64_t)pipelineLayout);
+	}
+	else
+		GraphicsDevice::DeferDestroy(DeferredObjectType::CachedPipeline, (uint64_t)pipeline);
+	pipeline = rebuiltPipeline;
+	pipelineLayout = rebuiltLayout;
+	pipelineOwned = false;
+	return false;
+}
+
+void Kokoro::Graphics::GraphicsPipeline::BuildPending() {
+	Build(pendingW, pendingH);
+}
+
+System::Threading::Tasks::Task^ Kokoro::Graphics::GraphicsPipeline::BuildAsync(uint32_t w, uint32_t h) {
+	//std::thread/std::future are unavailable under /clr, so builds are scheduled on the .NET thread pool
+	pendingW = w;
+	pendingH = h;
+	return Task::Factory->StartNew(gcnew System::Action(this, &GraphicsPipeline::BuildPending));
+}
+
+uint64_t Kokoro::Graphics::GraphicsPipeline::GetCacheHitCount() {
+	return GraphicsDevice::GetPipelineStateCache()->GetHitCount();
+}
+
+uint64_t Kokoro::Graphics::GraphicsPipeline::GetCacheMissCount() {
+	return GraphicsDevice::GetPipelineStateCache()->GetMissCount();
+}
+
+uint32_t Kokoro::Graphics::GraphicsPipeline::GetCachedPipelineCount() {
+	return GraphicsDevice::GetPipelineStateCache()->GetPipelineCount();
+}
+
+void Kokoro::Graphics::GraphicsPipeline::ResetCacheCounters() {
+	GraphicsDevice::GetPipelineStateCache()->ResetCounters();
+}
+
+uint32_t Kokoro::Graphics::GraphicsPipeline::EvictUnused() {
+	//The caller guarantees no evicted pipeline is still referenced by in-flight command buffers
+	auto dev = GraphicsDevice::GetDevice();
+	return GraphicsDevice::GetPipelineStateCache()->Evict(dev) + GraphicsDevice::GetPipelineLibraryCache()->Evict(dev);
+}
+
+array<System::Threading::Tasks::Task^>^ Kokoro::Graphics::GraphicsPipeline::BuildAll(array<GraphicsPipeline^>^ pipelines, uint32_t w, uint32_t h) {
+	auto tasks = gcnew array<Task^>(pipelines->Length);
+	for (int i = 0; i < pipelines->Length; i++)
+		tasks[i] = pipelines[i]->BuildAsync(w, h);
+	return tasks;
+}
@@ -2,8 +2,13 @@
 #include "GraphicsDevice.h"
 #include "ShaderType.h"
 #include "TopologyType.h"
+#include "DepthFunc.h"
+#include "ShaderModule.h"
+#include "DynamicStateTracker.h"
+#include <vector>
 
 using namespace System::Collections::Generic;
+using namespace System::Threading::Tasks;
 using namespace Kokoro::Math;
 
 namespace Kokoro::Graphics {
@@ -101,15 +106,70 @@ namespace Kokoro::Graphics {
 		property BlendOp Op;
 	};
 
+	//Blend state of one color attachment, overriding the pipeline's defaults for it.
+	public value struct AttachmentBlend {
+		property bool Enable;
+		property BlendEqn Color;
+		property BlendEqn Alpha;
+	};
+
+	public value struct PushConstantRange {
+		property ShaderType Stages;
+		property uint32_t Offset;
+		property uint32_t Size;
+	};
+
 	ref class SpecializedShaderModule;
-	ref class GraphicsPipeline
+	ref class DescriptorSet;
+	ref class RenderPass;
+	ref class Framebuffer;
+	struct GraphicsPipelineState;
+	ref class GraphicsPipeline : public IShaderDependent
 	{
 	private:
 		VkPipeline pipeline;
 		VkPipelineLayout pipelineLayout;
 		List<SpecializedShaderModule^>^ shaders;
+		List<DescriptorSet^>^ descSets;
+		List<PushConstantRange>^ pushConstants;
+		Dictionary<uint32_t, AttachmentBlend>^ attachmentBlends;
+		uint32_t pendingW;
+		uint32_t pendingH;
+		uint32_t builtW;
+		uint32_t builtH;
+		Task^ rebuildTask;
+		VkPipeline rebuiltPipeline;
+		VkPipelineLayout rebuiltLayout;
+		//Set while pipeline is a fast-linked library pipeline that isn't shared through the state cache
+		bool pipelineOwned;
+		//DynamicStateBits left out of the pipeline, fixed at Build
+		uint32_t dynamicMask;
 		bool locked;
+
+		void BuildPending();
+		void RebuildPending();
+		//Returns true if the result is a fast-linked pipeline owned by the caller.
+		bool Create(uint32_t w, uint32_t h, bool fastLink, VkPipeline* outPipeline, VkPipelineLayout* outLayout);
+		void FillState(GraphicsPipelineState& s, const std::vector<VkPushConstantRange>& pushRanges, uint32_t w, uint32_t h);
+#ifdef VK_EXT_graphics_pipeline_library
+		//Vertex input, pre-rasterization, fragment shader and fragment output parts, each holding a library cache reference.
+		void AcquireLibraries(const GraphicsPipelineState& s, const std::vector<VkPushConstantRange>& pushRanges, uint32_t w, uint32_t h, VkPipeline* libs);
+#endif
+		void AppendVertexInputKey(PipelineStateKey& key);
+		void AppendPreRasterKey(PipelineStateKey& key, uint32_t w, uint32_t h);
+		void AppendFragmentKey(PipelineStateKey& key);
+		void AppendOutputKey(PipelineStateKey& key);
+		void AppendLayoutKey(PipelineStateKey& key, const std::vector<VkPushConstantRange>& pushRanges);
+		void AppendStateKey(PipelineStateKey& key, const std::vector<VkPushConstantRange>& pushRanges, uint32_t w, uint32_t h);
+		void ReflectLayout(std::vector<VkPushConstantRange>& pushRanges);
 	internal:
+		VkPipeline GetPipeline();
+		VkPipelineLayout GetLayout();
+		uint32_t GetDynamicMask();
+		//Binds the pipeline and records its dynamic state from the current property values, skipping redundant commands.
+		void Bind(DynamicStateTracker* tracker, uint32_t w, uint32_t h);
+		//Binds inside the pass fb last began, covering its render area.
+		void Bind(Framebuffer^ fb);
 	public:
 		property TopologyType Topology;
 		property bool RasterizerDiscard;
@@ -117,12 +177,42 @@ namespace Kokoro::Graphics {
 		property CullMode Cull;
 		property BlendEqn^ ColorBlend;
 		property BlendEqn^ AlphaBlend;
+		//Whether ColorBlend and AlphaBlend apply to color attachments without their own SetAttachmentBlend state.
+		property bool BlendEnable;
 		property FillMode Fill;
+		property bool DepthTest;
+		property bool DepthWrite;
+		property DepthFunc DepthCompare;
+		property bool DepthClamp;
+		property Kokoro::Graphics::RenderPass^ RenderPass;
+		property uint32_t Subpass;
+		//Leaves scissor, line width and whatever raster and depth state the device's extended dynamic state support allows
+		//out of the pipeline, so changing them doesn't require a rebuild. Must be set before Build, the state is recorded by Bind.
+		property bool DynamicRasterState;
 
 		GraphicsPipeline();
+		~GraphicsPipeline();
 		void SetShader(SpecializedShaderModule^ s);
+		void AddDescriptorSet(DescriptorSet^ set);
+		//Without explicit ranges, push constant ranges are derived from the shaders' reflection.
+		void AddPushConstantRange(PushConstantRange range);
+		//attachment indexes the subpass's color attachments.
+		void SetAttachmentBlend(uint32_t attachment, AttachmentBlend blend);
 
 		void Build(uint32_t w, uint32_t h);
+		//Compiles on the thread pool, the pipeline must not be modified until the task completes.
+		Task^ BuildAsync(uint32_t w, uint32_t h);
+		static array<Task^>^ BuildAll(array<GraphicsPipeline^>^ pipelines, uint32_t w, uint32_t h);
+
+		//Pipelines with identical state share one VkPipeline through a device-wide cache.
+		static uint64_t GetCacheHitCount();
+		static uint64_t GetCacheMissCount();
+		static uint32_t GetCachedPipelineCount();
+		static void ResetCacheCounters();
+		static uint32_t EvictUnused();
+
+		virtual void BeginRebuild();
+		virtual bool FinishRebuild();
 	};
 }
 
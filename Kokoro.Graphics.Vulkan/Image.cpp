@@ -1,4 +1,6 @@
 #include "Image.h"
+#include <algorithm>
+#include <vector>
 
 Kokoro::Graphics::Image::Image()
 {
@@ -10,16 +12,40 @@ Kokoro::Graphics::Image::Image()
 	Dimensions = 2;
 	Format = ImageFormat::R8G8B8A8Unorm;
 	Usage = ImageUsage::Sampled | ImageUsage::TransferDst;
+	Samples = 1;
+	views = nullptr;
+	state = nullptr;
+	createFlags = 0;
+	viewFormats = gcnew List<ImageFormat>();
+	listedFormats = nullptr;
+	listedFormatCnt = 0;
+	viewObjects = gcnew Dictionary<uint64_t, ImageView^>();
 	locked = false;
 }
 
 Kokoro::Graphics::Image::~Image()
 {
-	if (!locked) {
+	if (locked) {
+		//Framebuffers built from the views can't outlive them
+		std::vector<VkImageView> handles;
+		views->GetViews(handles);
+		GraphicsDevice::GetFramebufferCache()->InvalidateViews(GraphicsDevice::GetDevice(), handles.data(), static_cast<uint32_t>(handles.size()));
+		views->Destroy(GraphicsDevice::GetDevice());
+		delete views;
+		delete state;
+		delete[] listedFormats;
 		GraphicsDevice::DestroyImage(img, img_alloc);
 	}
 }
 
+void Kokoro::Graphics::Image::AddViewFormat(ImageFormat format)
+{
+	if (locked)
+		throw gcnew System::Exception("Image has already been built.");
+	if (format != Format && !viewFormats->Contains(format))
+		viewFormats->Add(format);
+}
+
 void Kokoro::Graphics::Image::Build()
 {
 	if (!locked) {
@@ -33,13 +59,13 @@ void Kokoro::Graphics::Image::Build()
 			break;
 		case 2:
 			creatInfo.imageType = VK_IMAGE_TYPE_2D;
-			if (Layers > 1)
-				creatInfo.flags |= VK_IMAGE_CREATE_2D_ARRAY_COMPATIBLE_BIT;
 			if (Cubemappable)
 				creatInfo.flags |= VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT;
 			break;
 		case 3:
 			creatInfo.imageType = VK_IMAGE_TYPE_3D;
+			//Lets slices be viewed as a 2D array, 2D images need no flag for that
+			creatInfo.flags |= VK_IMAGE_CREATE_2D_ARRAY_COMPATIBLE_BIT;
 			break;
 		}
 		creatInfo.format = ImageFormatConv::Convert(Format);
@@ -50,20 +76,198 @@ void Kokoro::Graphics::Image::Build()
 		};
 		creatInfo.mipLevels = Levels;
 		creatInfo.arrayLayers = Layers;
-		creatInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		creatInfo.samples = SampleCountConv::Convert(Samples);
 		creatInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
 		creatInfo.usage = ImageUsageConverter::Convert(Usage);
+
+		//Imageless framebuffers match views against the image's format list, so attachments list every format they're viewed in
+		std::vector<VkFormat> formats;
+#ifdef VK_KHR_image_format_list
+		VkImageFormatListCreateInfoKHR fmtList = {};
+		fmtList.sType = VK_STRUCTURE_TYPE_IMAGE_FORMAT_LIST_CREATE_INFO_KHR;
+		VkImageUsageFlags attachmentUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
+		if ((creatInfo.usage & attachmentUsage) != 0 && GraphicsDevice::SupportsImagelessFramebuffers()) {
+			formats.push_back(creatInfo.format);
+			for each (ImageFormat f in viewFormats)
+				formats.push_back(ImageFormatConv::Convert(f));
+			fmtList.viewFormatCount = static_cast<uint32_t>(formats.size());
+			fmtList.pViewFormats = formats.data();
+			creatInfo.pNext = &fmtList;
+		}
+#endif
+
+		if (creatInfo.samples == 0)
+			throw gcnew System::ArgumentException("Samples must be a power of two no larger than 64.");
+		if (creatInfo.samples != VK_SAMPLE_COUNT_1_BIT) {
+			if (Dimensions != 2 || Levels != 1 || Cubemappable)
+				throw gcnew System::ArgumentException("Multisampled images must be 2D with a single level.");
+			VkImageFormatProperties fmtProps;
+			if (vkGetPhysicalDeviceImageFormatProperties(GraphicsDevice::GetPhysicalDevice(), creatInfo.format, creatInfo.imageType, creatInfo.tiling, creatInfo.usage, creatInfo.flags, &fmtProps) != VK_SUCCESS || (fmtProps.sampleCounts & creatInfo.samples) == 0)
+				throw gcnew System::NotSupportedException("Device does not support " + Samples + " samples for this format and usage.");
+		}
+
+		//Transient images can only be rendered to and read as input attachments
+		bool transient = (Usage & ImageUsage::Transient) != ImageUsage::None;
+		if (transient && (Usage & (ImageUsage::Sampled | ImageUsage::Storage | ImageUsage::TransferSrc | ImageUsage::TransferDst)) != ImageUsage::None)
+			throw gcnew System::ArgumentException("Transient images can only have attachment usages.");
 		creatInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
 		creatInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		createFlags = creatInfo.flags;
 
 		pin_ptr<VkImage> img_ptr = &img;
 		pin_ptr<WVmaAllocation> img_alloc_ptr = &img_alloc;
-		if (GraphicsDevice::CreateImage(&creatInfo, img_ptr, img_alloc_ptr) != VK_SUCCESS)
+		if (GraphicsDevice::CreateImage(&creatInfo, transient ? MemoryUsage::GpuLazilyAllocated : MemoryUsage::GpuOnly, img_ptr, img_alloc_ptr) != VK_SUCCESS)
 			throw gcnew System::Exception("Failed to create image.");
+		listedFormatCnt = static_cast<uint32_t>(formats.size());
+		if (listedFormatCnt != 0) {
+			listedFormats = new VkFormat[listedFormatCnt];
+			std::copy(formats.begin(), formats.end(), listedFormats);
+		}
+		views = new ImageViewCache(img);
+		state = new ImageStateTracker(img, ImageFormatConv::Aspect(Format), Levels, Layers);
 		locked = true;
 	}
 }
 
 VkImage Kokoro::Graphics::Image::GetImage() {
 	return img;
-}
\ No newline at end of file
+}
+
+FramebufferAttachmentDesc Kokoro::Graphics::Image::GetAttachmentDesc(ImageView^ view) {
+	if (!locked)
+		throw gcnew System::Exception("Image has not been built.");
+
+	FramebufferAttachmentDesc desc;
+	desc.format = ImageFormatConv::Convert(view->Format);
+	desc.usage = ImageUsageConverter::Convert(Usage);
+	desc.flags = createFlags;
+	desc.width = std::max(1, Width >> view->BaseLevel);
+	desc.height = std::max(1, Height >> view->BaseLevel);
+	desc.layerCount = static_cast<uint32_t>(view->LayerCount);
+	desc.viewFormatCount = listedFormatCnt;
+	desc.viewFormats = listedFormats;
+	desc.view = view->GetImageView();
+	return desc;
+}
+
+VkImageView Kokoro::Graphics::Image::GetViewHandle(VkImageViewType type, VkFormat format, const VkImageSubresourceRange& range) {
+	if (!locked)
+		throw gcnew System::Exception("Image has not been built.");
+
+	VkImageView view;
+	if (views->Get(GraphicsDevice::GetDevice(), type, format, range, &view) != VK_SUCCESS)
+		throw gcnew System::Exception("Failed to create image view.");
+	return view;
+}
+
+Kokoro::Graphics::ImageView^ Kokoro::Graphics::Image::GetView(ImageViewType type, ImageFormat format, int baseLevel, int levelCount, int baseLayer, int layerCount) {
+	if (baseLevel < 0 || levelCount < 1 || baseLevel + levelCount > Levels)
+		throw gcnew System::ArgumentOutOfRangeException("levelCount");
+	if (baseLayer < 0 || layerCount < 1 || baseLayer + layerCount > Layers)
+		throw gcnew System::ArgumentOutOfRangeException("layerCount");
+
+	VkImageSubresourceRange range;
+	range.aspectMask = ImageFormatConv::ViewAspect(format);
+	range.baseMipLevel = baseLevel;
+	range.levelCount = levelCount;
+	range.baseArrayLayer = baseLayer;
+	range.layerCount = layerCount;
+	auto vkFormat = ImageFormatConv::Convert(format);
+	if (listedFormatCnt != 0 && std::find(listedFormats, listedFormats + listedFormatCnt, vkFormat) == listedFormats + listedFormatCnt)
+		throw gcnew System::ArgumentException("The image can only be viewed in its own format and those passed to AddViewFormat.");
+	auto view = GetViewHandle(ImageViewTypeConverter::Convert(type), vkFormat, range);
+
+	ImageView^ obj;
+	if (!viewObjects->TryGetValue((uint64_t)view, obj)) {
+		obj = gcnew ImageView(view, format, type, baseLevel, levelCount, baseLayer, layerCount);
+		viewObjects[(uint64_t)view] = obj;
+	}
+	return obj;
+}
+
+Kokoro::Graphics::ImageView^ Kokoro::Graphics::Image::GetView(ImageViewType type) {
+	return GetView(type, Format, 0, Levels, 0, Layers);
+}
+
+Kokoro::Graphics::ImageView^ Kokoro::Graphics::Image::GetLevelView(ImageViewType type, int level) {
+	return GetView(type, Format, level, 1, 0, Layers);
+}
+
+void Kokoro::Graphics::Image::Transition(BarrierBatch& batch, ResourceUse use, int baseLevel, int levelCount, int baseLayer, int layerCount, bool discard) {
+	if (!locked)
+		throw gcnew System::Exception("Image has not been built.");
+	if (baseLevel < 0 || levelCount < 1 || baseLevel + levelCount > Levels)
+		throw gcnew System::ArgumentOutOfRangeException("levelCount");
+	if (baseLayer < 0 || layerCount < 1 || baseLayer + layerCount > Layers)
+		throw gcnew System::ArgumentOutOfRangeException("layerCount");
+	state->Transition(batch, baseLevel, levelCount, baseLayer, layerCount, use, discard);
+}
+
+void Kokoro::Graphics::Image::Transition(BarrierBatch& batch, ResourceUse use, bool discard) {
+	Transition(batch, use, 0, Levels, 0, Layers, discard);
+}
+
+void Kokoro::Graphics::Image::Assume(ResourceUse use, int baseLevel, int levelCount, int baseLayer, int layerCount) {
+	if (!locked)
+		throw gcnew System::Exception("Image has not been built.");
+	if (baseLevel < 0 || levelCount < 1 || baseLevel + levelCount > Levels)
+		throw gcnew System::ArgumentOutOfRangeException("levelCount");
+	if (baseLayer < 0 || layerCount < 1 || baseLayer + layerCount > Layers)
+		throw gcnew System::ArgumentOutOfRangeException("layerCount");
+	state->Assume(baseLevel, levelCount, baseLayer, layerCount, use);
+}
+
+void Kokoro::Graphics::Image::Assume(VkImageLayout layout, int baseLevel, int levelCount, int baseLayer, int layerCount) {
+	if (!locked)
+		throw gcnew System::Exception("Image has not been built.");
+	if (baseLevel < 0 || levelCount < 1 || baseLevel + levelCount > Levels)
+		throw gcnew System::ArgumentOutOfRangeException("levelCount");
+	if (baseLayer < 0 || layerCount < 1 || baseLayer + layerCount > Layers)
+		throw gcnew System::ArgumentOutOfRangeException("layerCount");
+	state->Assume(baseLevel, levelCount, baseLayer, layerCount, ResourceUseConv::FromLayout(layout), layout);
+}
+
+VkImageLayout Kokoro::Graphics::Image::GetLayout(int level, int layer) {
+	if (!locked)
+		return VK_IMAGE_LAYOUT_UNDEFINED;
+	return state->GetLayout(level, layer);
+}
+
+void Kokoro::Graphics::Image::GenerateMips(VkCommandBuffer cmd, MipReduction reduction, ResourceUse finalUse) {
+	if (!locked)
+		throw gcnew System::Exception("Image has not been built.");
+	if (Levels < 2)
+		throw gcnew System::InvalidOperationException("Image has no mip levels to generate.");
+	if (Dimensions != 2)
+		throw gcnew System::NotSupportedException("Mip generation is only supported for 2D images.");
+
+	auto transfer = ImageUsage::TransferSrc | ImageUsage::TransferDst;
+	if (reduction == MipReduction::Average && (Usage & transfer) == transfer && MipGenerator::SupportsBlit(Format))
+		MipGenerator::Blit(cmd, this, finalUse);
+	else if ((Usage & ImageUsage::Storage) != ImageUsage::None)
+		MipGenerator::Downsample(cmd, this, reduction, finalUse);
+	else
+		throw gcnew System::InvalidOperationException("Mip generation needs Storage usage, or both transfer usages for averaging.");
+}
+
+uint32_t Kokoro::Graphics::Image::GetViewCount() {
+	if (!locked)
+		return 0;
+	return views->GetViewCount();
+}
+
+Kokoro::Graphics::Image^ Kokoro::Graphics::Image::CreateEyeTarget(ImageFormat format, int width, int height, ImageUsage usage) {
+	return CreateEyeTarget(format, width, height, usage, 1);
+}
+
+Kokoro::Graphics::Image^ Kokoro::Graphics::Image::CreateEyeTarget(ImageFormat format, int width, int height, ImageUsage usage, int samples) {
+	auto img = gcnew Image();
+	img->Width = width;
+	img->Height = height;
+	img->Layers = GraphicsDevice::EyeCount;
+	img->Format = format;
+	img->Usage = usage;
+	img->Samples = samples;
+	img->Build();
+	return img;
+}
@@ -2,17 +2,30 @@
 #include "GraphicsDevice.h"
 
 #include "ImageFormat.h"
+#include "ImageView.h"
+#include "ImageViewCache.h"
+#include "ImageStateTracker.h"
+#include "MipGenerator.h"
+
+using namespace System::Collections::Generic;
 
 namespace Kokoro::Graphics {
 	enum class ImageUsage {
 		None = 0,
 		Sampled = (1 << 0),
 		TransferDst = (1 << 1),
-		Storage = (1 << 2)
+		Storage = (1 << 2),
+		TransferSrc = (1 << 3),
+		ColorAttachment = (1 << 4),
+		DepthAttachment = (1 << 5),
+		//Contents only live within a render pass, backed by lazily allocated memory where the device has it
+		Transient = (1 << 6),
+		//Read by a later subpass of the pass that rendered it, without leaving tile memory
+		InputAttachment = (1 << 7),
 	};
 	inline ImageUsage operator |(ImageUsage lhs, ImageUsage rhs)
 	{
-		return static_cast<ImageUsage>(static_cast<char>(lhs) | static_cast<char>(rhs));
+		return static_cast<ImageUsage>(static_cast<uint32_t>(lhs) | static_cast<uint32_t>(rhs));
 	}
 	inline ImageUsage& operator |= (ImageUsage& lhs, ImageUsage rhs)
 	{
@@ -21,7 +34,7 @@ namespace Kokoro::Graphics {
 	}
 	inline ImageUsage operator &(ImageUsage lhs, ImageUsage rhs)
 	{
-		return static_cast<ImageUsage>(static_cast<char>(lhs) & static_cast<char>(rhs));
+		return static_cast<ImageUsage>(static_cast<uint32_t>(lhs) & static_cast<uint32_t>(rhs));
 	}
 	inline ImageUsage& operator &= (ImageUsage& lhs, ImageUsage rhs)
 	{
@@ -39,6 +52,16 @@ namespace Kokoro::Graphics {
 				f |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
 			if ((s & ImageUsage::Storage) != ImageUsage::None)
 				f |= VK_IMAGE_USAGE_STORAGE_BIT;
+			if ((s & ImageUsage::TransferSrc) != ImageUsage::None)
+				f |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+			if ((s & ImageUsage::ColorAttachment) != ImageUsage::None)
+				f |= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+			if ((s & ImageUsage::DepthAttachment) != ImageUsage::None)
+				f |= VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+			if ((s & ImageUsage::Transient) != ImageUsage::None)
+				f |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+			if ((s & ImageUsage::InputAttachment) != ImageUsage::None)
+				f |= VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
 			return (VkImageUsageFlags)f;
 		}
 	};
@@ -48,9 +71,32 @@ namespace Kokoro::Graphics {
 	private:
 		VkImage img;
 		WVmaAllocation img_alloc;
+		ImageViewCache* views;
+		//Managed wrappers for the cached views, keyed by handle
+		Dictionary<uint64_t, ImageView^>^ viewObjects;
+		ImageStateTracker* state;
+		VkImageCreateFlags createFlags;
+		List<ImageFormat>^ viewFormats;
+		//VkImageFormatListCreateInfoKHR contents, attachments get one when imageless framebuffers are in use.
+		//Empty when the image can be viewed in any compatible format.
+		VkFormat* listedFormats;
+		uint32_t listedFormatCnt;
 		bool locked;
 	internal:
 		VkImage GetImage();
+		//Describes view as a framebuffer attachment, view must be one of this image's.
+		FramebufferAttachmentDesc GetAttachmentDesc(ImageView^ view);
+		VkImageView GetViewHandle(VkImageViewType type, VkFormat format, const VkImageSubresourceRange& range);
+		//Queues the barriers the range needs before it's used as use, discard drops its current contents.
+		void Transition(BarrierBatch& batch, ResourceUse use, int baseLevel, int levelCount, int baseLayer, int layerCount, bool discard);
+		void Transition(BarrierBatch& batch, ResourceUse use, bool discard);
+		//For layout changes made outside the tracker, like render pass attachment transitions.
+		void Assume(ResourceUse use, int baseLevel, int levelCount, int baseLayer, int layerCount);
+		void Assume(VkImageLayout layout, int baseLevel, int levelCount, int baseLayer, int layerCount);
+		VkImageLayout GetLayout(int level, int layer);
+		//Fills levels 1 and up from level 0. Averages are blitted when the format allows it and the image has both transfer usages,
+		//everything else goes through the compute downsampler, which needs Storage usage. The image is left ready for finalUse.
+		void GenerateMips(VkCommandBuffer cmd, MipReduction reduction, ResourceUse finalUse);
 	public:
 		property int Width;
 		property int Height;
@@ -61,10 +107,25 @@ namespace Kokoro::Graphics {
 		property ImageFormat Format;
 		property ImageUsage Usage;
 		property bool Cubemappable;
+		//Multisampled images have a single level and are resolved by a render pass, not sampled directly.
+		property int Samples;
 
 		Image();
 		~Image();
+		//Declares another format the image will be viewed in, like an sRGB view of a UNORM target. Must be called before Build.
+		//Attachments can only be viewed in their own and the declared formats when the device uses imageless framebuffers.
+		void AddViewFormat(ImageFormat format);
 		void Build();
+		//Views are created on first use and reused afterwards, all of them are destroyed with the image.
+		ImageView^ GetView(ImageViewType type, ImageFormat format, int baseLevel, int levelCount, int baseLayer, int layerCount);
+		//Every level and layer, in the image's own format.
+		ImageView^ GetView(ImageViewType type);
+		ImageView^ GetLevelView(ImageViewType type, int level);
+		uint32_t GetViewCount();
+
+		//Built 2D array with a layer per eye, rendered by passes using RenderPass::GetEyeViewMask.
+		static Image^ CreateEyeTarget(ImageFormat format, int width, int height, ImageUsage usage);
+		static Image^ CreateEyeTarget(ImageFormat format, int width, int height, ImageUsage usage, int samples);
 	};
 }
 
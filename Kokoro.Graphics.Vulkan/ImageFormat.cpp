@@ -0,0 +1,134 @@
+#include "ImageFormat.h"
+#include <cstring>
+
+namespace {
+	const VkImageAspectFlags Color = VK_IMAGE_ASPECT_COLOR_BIT;
+	const VkImageAspectFlags Depth = VK_IMAGE_ASPECT_DEPTH_BIT;
+	const VkImageAspectFlags DepthStencil = VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+
+	//Indexed by ImageFormat
+	const Kokoro::Graphics::ImageFormatInfo FormatTable[] = {
+		//format, blockDim, blockBytes, aspect, compressed, srgb
+		{ VK_FORMAT_R8G8B8A8_UNORM, 1, 4, Color, false, false },
+		{ VK_FORMAT_R8G8B8A8_SNORM, 1, 4, Color, false, false },
+		{ VK_FORMAT_D32_SFLOAT, 1, 4, Depth, false, false },
+		{ VK_FORMAT_D16_UNORM, 1, 2, Depth, false, false },
+		{ VK_FORMAT_R32_SFLOAT, 1, 4, Color, false, false },
+		{ VK_FORMAT_R8G8B8A8_SRGB, 1, 4, Color, false, true },
+		{ VK_FORMAT_B8G8R8A8_UNORM, 1, 4, Color, false, false },
+		{ VK_FORMAT_B8G8R8A8_SRGB, 1, 4, Color, false, true },
+		{ VK_FORMAT_BC1_RGBA_UNORM_BLOCK, 4, 8, Color, true, false },
+		{ VK_FORMAT_BC1_RGBA_SRGB_BLOCK, 4, 8, Color, true, true },
+		{ VK_FORMAT_BC1_RGB_UNORM_BLOCK, 4, 8, Color, true, false },
+		{ VK_FORMAT_BC1_RGB_SRGB_BLOCK, 4, 8, Color, true, true },
+		{ VK_FORMAT_BC2_UNORM_BLOCK, 4, 16, Color, true, false },
+		{ VK_FORMAT_BC2_SRGB_BLOCK, 4, 16, Color, true, true },
+		{ VK_FORMAT_BC3_UNORM_BLOCK, 4, 16, Color, true, false },
+		{ VK_FORMAT_BC3_SRGB_BLOCK, 4, 16, Color, true, true },
+		{ VK_FORMAT_BC4_UNORM_BLOCK, 4, 8, Color, true, false },
+		{ VK_FORMAT_BC4_SNORM_BLOCK, 4, 8, Color, true, false },
+		{ VK_FORMAT_BC5_UNORM_BLOCK, 4, 16, Color, true, false },
+		{ VK_FORMAT_BC5_SNORM_BLOCK, 4, 16, Color, true, false },
+		{ VK_FORMAT_BC6H_UFLOAT_BLOCK, 4, 16, Color, true, false },
+		{ VK_FORMAT_BC6H_SFLOAT_BLOCK, 4, 16, Color, true, false },
+		{ VK_FORMAT_BC7_UNORM_BLOCK, 4, 16, Color, true, false },
+		{ VK_FORMAT_BC7_SRGB_BLOCK, 4, 16, Color, true, true },
+		{ VK_FORMAT_R8_UNORM, 1, 1, Color, false, false },
+		{ VK_FORMAT_R8_SNORM, 1, 1, Color, false, false },
+		{ VK_FORMAT_R8G8_UNORM, 1, 2, Color, false, false },
+		{ VK_FORMAT_R8G8_SNORM, 1, 2, Color, false, false },
+		{ VK_FORMAT_R16_SFLOAT, 1, 2, Color, false, false },
+		{ VK_FORMAT_R16G16_SFLOAT, 1, 4, Color, false, false },
+		{ VK_FORMAT_R16G16B16A16_SFLOAT, 1, 8, Color, false, false },
+		{ VK_FORMAT_R32G32_SFLOAT, 1, 8, Color, false, false },
+		{ VK_FORMAT_R32G32B32A32_SFLOAT, 1, 16, Color, false, false },
+		{ VK_FORMAT_B10G11R11_UFLOAT_PACK32, 1, 4, Color, false, false },
+		{ VK_FORMAT_E5B9G9R9_UFLOAT_PACK32, 1, 4, Color, false, false },
+		{ VK_FORMAT_A2B10G10R10_UNORM_PACK32, 1, 4, Color, false, false },
+		{ VK_FORMAT_R16_UNORM, 1, 2, Color, false, false },
+		{ VK_FORMAT_R16G16_UNORM, 1, 4, Color, false, false },
+		{ VK_FORMAT_R16G16B16A16_UNORM, 1, 8, Color, false, false },
+		{ VK_FORMAT_R8_UINT, 1, 1, Color, false, false },
+		{ VK_FORMAT_R16_UINT, 1, 2, Color, false, false },
+		{ VK_FORMAT_R32_UINT, 1, 4, Color, false, false },
+		{ VK_FORMAT_R32_SINT, 1, 4, Color, false, false },
+		{ VK_FORMAT_R16G16_UINT, 1, 4, Color, false, false },
+		{ VK_FORMAT_R32G32_UINT, 1, 8, Color, false, false },
+		{ VK_FORMAT_R8G8B8A8_UINT, 1, 4, Color, false, false },
+		{ VK_FORMAT_R16G16B16A16_UINT, 1, 8, Color, false, false },
+		{ VK_FORMAT_R32G32B32A32_UINT, 1, 16, Color, false, false },
+		{ VK_FORMAT_D24_UNORM_S8_UINT, 1, 4, DepthStencil, false, false },
+		{ VK_FORMAT_D32_SFLOAT_S8_UINT, 1, 8, DepthStencil, false, false },
+	};
+	const uint32_t FormatCount = sizeof(FormatTable) / sizeof(FormatTable[0]);
+	static_assert(FormatCount == static_cast<uint32_t>(Kokoro::Graphics::ImageFormat::Count), "FormatTable must have one entry per ImageFormat.");
+	const Kokoro::Graphics::ImageFormatInfo UnknownFormat = { VK_FORMAT_UNDEFINED, 1, 0, 0, false, false };
+
+	//Answers for FormatPropsDevice, dropped when asked about a different physical device
+	VkPhysicalDevice FormatPropsDevice = VK_NULL_HANDLE;
+	VkFormatProperties FormatProps[FormatCount];
+	bool FormatPropsValid[FormatCount];
+}
+
+const Kokoro::Graphics::ImageFormatInfo& Kokoro::Graphics::ImageFormatConv::GetInfo(ImageFormat s) {
+	auto idx = static_cast<uint32_t>(s);
+	return idx < FormatCount ? FormatTable[idx] : UnknownFormat;
+}
+
+VkFormat Kokoro::Graphics::ImageFormatConv::Convert(ImageFormat s) {
+	return GetInfo(s).format;
+}
+
+bool Kokoro::Graphics::ImageFormatConv::FromVk(VkFormat f, ImageFormat* s) {
+	for (uint32_t i = 0; i < FormatCount; i++)
+		if (FormatTable[i].format == f) {
+			*s = static_cast<ImageFormat>(i);
+			return true;
+		}
+	return false;
+}
+
+VkImageAspectFlags Kokoro::Graphics::ImageFormatConv::Aspect(ImageFormat s) {
+	return GetInfo(s).aspect;
+}
+
+VkImageAspectFlags Kokoro::Graphics::ImageFormatConv::ViewAspect(ImageFormat s) {
+	auto aspect = GetInfo(s).aspect;
+	return (aspect & VK_IMAGE_ASPECT_DEPTH_BIT) ? VK_IMAGE_ASPECT_DEPTH_BIT : aspect;
+}
+
+size_t Kokoro::Graphics::ImageFormatConv::GetSize(ImageFormat s, uint32_t width, uint32_t height, uint32_t depth) {
+	auto& info = GetInfo(s);
+	size_t blocksX = (width + info.blockDim - 1) / info.blockDim;
+	size_t blocksY = (height + info.blockDim - 1) / info.blockDim;
+	return blocksX * blocksY * depth * info.blockBytes;
+}
+
+const VkFormatProperties& Kokoro::Graphics::ImageFormatConv::GetProperties(VkPhysicalDevice dev, ImageFormat s) {
+	static const VkFormatProperties none = {};
+	auto idx = static_cast<uint32_t>(s);
+	if (idx >= FormatCount)
+		return none;
+	if (dev != FormatPropsDevice) {
+		memset(FormatPropsValid, 0, sizeof(FormatPropsValid));
+		FormatPropsDevice = dev;
+	}
+	if (!FormatPropsValid[idx]) {
+		vkGetPhysicalDeviceFormatProperties(dev, FormatTable[idx].format, &FormatProps[idx]);
+		FormatPropsValid[idx] = true;
+	}
+	return FormatProps[idx];
+}
+
+bool Kokoro::Graphics::ImageFormatConv::Supports(VkPhysicalDevice dev, ImageFormat s, VkFormatFeatureFlags optimalFeatures) {
+	return (GetProperties(dev, s).optimalTilingFeatures & optimalFeatures) == optimalFeatures;
+}
+
+bool Kokoro::Graphics::ImageFormatConv::PickSupported(VkPhysicalDevice dev, const ImageFormat* candidates, uint32_t candidateCnt, VkFormatFeatureFlags optimalFeatures, ImageFormat* s) {
+	for (uint32_t i = 0; i < candidateCnt; i++)
+		if (Supports(dev, candidates[i], optimalFeatures)) {
+			*s = candidates[i];
+			return true;
+		}
+	return false;
+}
@@ -1,30 +1,108 @@
 #pragma once
-#include "GraphicsDevice.h"
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#define VK_USE_PLATFORM_WIN32_KHR
+#endif
+#include "vulkan/vulkan.h"
+#include <stdint.h>
 
 namespace Kokoro::Graphics {
+	//Order must match the table in ImageFormat.cpp
 	enum class ImageFormat {
 		R8G8B8A8Unorm,
 		R8G8B8A8Snorm,
 		Depth32f,
 		Depth16f,
-		//TODO: Add formats as needed
+		R32f,
+		R8G8B8A8Srgb,
+		B8G8R8A8Unorm,
+		B8G8R8A8Srgb,
+		BC1Unorm,
+		BC1Srgb,
+		BC1RgbUnorm,
+		BC1RgbSrgb,
+		BC2Unorm,
+		BC2Srgb,
+		BC3Unorm,
+		BC3Srgb,
+		BC4Unorm,
+		BC4Snorm,
+		BC5Unorm,
+		BC5Snorm,
+		BC6HUfloat,
+		BC6HSfloat,
+		BC7Unorm,
+		BC7Srgb,
+		R8Unorm,
+		R8Snorm,
+		R8G8Unorm,
+		R8G8Snorm,
+		R16f,
+		R16G16f,
+		R16G16B16A16f,
+		R32G32f,
+		R32G32B32A32f,
+		B10G11R11Ufloat,
+		E5B9G9R9Ufloat,
+		A2B10G10R10Unorm,
+		R16Unorm,
+		R16G16Unorm,
+		R16G16B16A16Unorm,
+		R8Uint,
+		R16Uint,
+		R32Uint,
+		R32Sint,
+		R16G16Uint,
+		R32G32Uint,
+		R8G8B8A8Uint,
+		R16G16B16A16Uint,
+		R32G32B32A32Uint,
+		Depth24Stencil8,
+		Depth32fStencil8,
+		//Number of formats, not a format itself
+		Count,
+	};
+
+	struct ImageFormatInfo {
+		VkFormat format;
+		//Texel block edge, 1 for uncompressed formats
+		uint32_t blockDim;
+		uint32_t blockBytes;
+		//Every aspect the format has, what barriers and attachments use
+		VkImageAspectFlags aspect;
+		bool compressed;
+		bool srgb;
 	};
 
 	class ImageFormatConv {
 	public:
-		static VkFormat Convert(ImageFormat s) {
-			switch (s) {
-			case ImageFormat::R8G8B8A8Unorm:
-				return VK_FORMAT_R8G8B8A8_UNORM;
-			case ImageFormat::R8G8B8A8Snorm:
-				return VK_FORMAT_R8G8B8A8_SNORM;
-			case ImageFormat::Depth32f:
-				return VK_FORMAT_D32_SFLOAT;
-			case ImageFormat::Depth16f:
-				return VK_FORMAT_D16_UNORM;
-			default:
-				return VK_FORMAT_UNDEFINED;
-			}
+		static const ImageFormatInfo& GetInfo(ImageFormat s);
+		static VkFormat Convert(ImageFormat s);
+		//Reverse of Convert, false for formats the enum doesn't cover.
+		static bool FromVk(VkFormat f, ImageFormat* s);
+		static VkImageAspectFlags Aspect(ImageFormat s);
+		//Views of depth-stencil formats only see depth, which is what sampling wants
+		static VkImageAspectFlags ViewAspect(ImageFormat s);
+		//Bytes of one layer of a width x height x depth level
+		static size_t GetSize(ImageFormat s, uint32_t width, uint32_t height, uint32_t depth);
+
+		//vkGetPhysicalDeviceFormatProperties, queried once per format while dev stays the same.
+		static const VkFormatProperties& GetProperties(VkPhysicalDevice dev, ImageFormat s);
+		static bool Supports(VkPhysicalDevice dev, ImageFormat s, VkFormatFeatureFlags optimalFeatures);
+		//First candidate supporting every feature with optimal tiling, candidates are best listed smallest first.
+		static bool PickSupported(VkPhysicalDevice dev, const ImageFormat* candidates, uint32_t candidateCnt, VkFormatFeatureFlags optimalFeatures, ImageFormat* s);
+	};
+
+	class SampleCountConv {
+	public:
+		//0 is treated as single sampled, anything that isn't a power of two up to 64 maps to 0.
+		static VkSampleCountFlagBits Convert(uint32_t samples) {
+			if (samples == 0)
+				return VK_SAMPLE_COUNT_1_BIT;
+			if (samples > 64 || (samples & (samples - 1)) != 0)
+				return (VkSampleCountFlagBits)0;
+			return static_cast<VkSampleCountFlagBits>(samples);
 		}
 	};
-}
\ No newline at end of file
+}
@@ -0,0 +1,157 @@
+#include "ImageStateTracker.h"
+
+bool Kokoro::Graphics::ImageStateTracker::PendingBarrier::operator==(const PendingBarrier& other) const {
+	return oldLayout == other.oldLayout && srcStages == other.srcStages && srcAccess == other.srcAccess;
+}
+
+Kokoro::Graphics::ImageStateTracker::ImageStateTracker(VkImage image, VkImageAspectFlags aspect, uint32_t levels, uint32_t layers) {
+	this->image = image;
+	this->aspect = aspect;
+	this->levels = levels;
+	this->layers = layers;
+	SubresourceState init = {};
+	init.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+	states.resize(levels * layers, init);
+	skippedCnt = 0;
+}
+
+Kokoro::Graphics::ImageStateTracker::SubresourceState& Kokoro::Graphics::ImageStateTracker::At(uint32_t level, uint32_t layer) {
+	return states[level * layers + layer];
+}
+
+void Kokoro::Graphics::ImageStateTracker::Queue(uint32_t level, uint32_t layer, const PendingBarrier& b) {
+	//Subresources are visited layer by layer, so a run of layers only ever extends the last barrier
+	if (!pending.empty()) {
+		auto& last = pending.back();
+		if (last == b && last.baseLevel == level && last.baseLayer + last.layerCount == layer) {
+			last.layerCount++;
+			return;
+		}
+	}
+	PendingBarrier p = b;
+	p.baseLevel = level;
+	p.levelCount = 1;
+	p.baseLayer = layer;
+	p.layerCount = 1;
+	pending.push_back(p);
+}
+
+void Kokoro::Graphics::ImageStateTracker::Transition(BarrierBatch& batch, uint32_t baseLevel, uint32_t levelCount, uint32_t baseLayer, uint32_t layerCount, ResourceUse use, bool discard) {
+	auto& dst = ResourceUseConv::GetInfo(use);
+	for (uint32_t level = baseLevel; level < baseLevel + levelCount; level++)
+		for (uint32_t layer = baseLayer; layer < baseLayer + layerCount; layer++) {
+			auto& s = At(level, layer);
+			PendingBarrier b = {};
+			b.oldLayout = s.layout;
+
+			if (s.layout != dst.layout) {
+				//Layout changes always need a barrier, the transition itself then counts as the last write
+				if (discard)
+					b.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+				b.srcStages = s.writeStages | s.readStages;
+				b.srcAccess = s.writeAccess;
+				Queue(level, layer, b);
+
+				s.layout = dst.layout;
+				s.written = true;
+				s.writeStages = dst.stages;
+				s.writeAccess = dst.writes ? ResourceUseConv::Writes(dst.access) : 0;
+				s.visibleStages = dst.writes ? 0 : dst.stages;
+				s.visibleAccess = dst.writes ? 0 : dst.access;
+				s.readStages = dst.writes ? 0 : dst.stages;
+			}
+			else if (!dst.writes) {
+				//Reads after reads, or after a write that's already visible to them, need nothing
+				if (!s.written || ((dst.stages & ~s.visibleStages) == 0 && (dst.access & ~s.visibleAccess) == 0)) {
+					s.readStages |= dst.stages;
+					skippedCnt++;
+					continue;
+				}
+				b.srcStages = s.writeStages;
+				b.srcAccess = s.writeAccess;
+				Queue(level, layer, b);
+
+				s.visibleStages |= dst.stages;
+				s.visibleAccess |= dst.access;
+				s.readStages |= dst.stages;
+			}
+			else {
+				if (!s.written && s.readStages == 0) {
+					skippedCnt++;
+				}
+				else if (s.writeAccess == 0) {
+					//Write after read only has to wait for the reads to finish
+					batch.AddExecution(s.writeStages | s.readStages, dst.stages);
+				}
+				else {
+					b.srcStages = s.writeStages | s.readStages;
+					b.srcAccess = s.writeAccess;
+					Queue(level, layer, b);
+				}
+
+				s.written = true;
+				s.writeStages = dst.stages;
+				s.writeAccess = ResourceUseConv::Writes(dst.access);
+				s.visibleStages = 0;
+				s.visibleAccess = 0;
+				s.readStages = 0;
+			}
+		}
+
+	//Fold identical layer runs of consecutive levels together
+	for (size_t i = 0; i < pending.size(); i++) {
+		auto& p = pending[i];
+		for (size_t j = 0; j < i; j++) {
+			auto& q = pending[j];
+			if (q.levelCount != 0 && q == p && q.baseLayer == p.baseLayer && q.layerCount == p.layerCount && q.baseLevel + q.levelCount == p.baseLevel) {
+				q.levelCount += p.levelCount;
+				p.levelCount = 0;
+				break;
+			}
+		}
+	}
+
+	for (auto& p : pending) {
+		if (p.levelCount == 0)
+			continue;
+		VkImageSubresourceRange range;
+		range.aspectMask = aspect;
+		range.baseMipLevel = p.baseLevel;
+		range.levelCount = p.levelCount;
+		range.baseArrayLayer = p.baseLayer;
+		range.layerCount = p.layerCount;
+		batch.AddImage(image, range, p.oldLayout, dst.layout, p.srcStages, p.srcAccess, dst.stages, dst.access);
+	}
+	pending.clear();
+}
+
+void Kokoro::Graphics::ImageStateTracker::Assume(uint32_t baseLevel, uint32_t levelCount, uint32_t baseLayer, uint32_t layerCount, ResourceUse use) {
+	Assume(baseLevel, levelCount, baseLayer, layerCount, use, ResourceUseConv::GetInfo(use).layout);
+}
+
+void Kokoro::Graphics::ImageStateTracker::Assume(uint32_t baseLevel, uint32_t levelCount, uint32_t baseLayer, uint32_t layerCount, ResourceUse use, VkImageLayout layout) {
+	auto& u = ResourceUseConv::GetInfo(use);
+	for (uint32_t level = baseLevel; level < baseLevel + levelCount; level++)
+		for (uint32_t layer = baseLayer; layer < baseLayer + layerCount; layer++) {
+			auto& s = At(level, layer);
+			s.layout = layout;
+			s.written = true;
+			s.writeStages = u.stages;
+			s.writeAccess = ResourceUseConv::Writes(u.access);
+			s.visibleStages = u.writes ? 0 : u.stages;
+			s.visibleAccess = u.writes ? 0 : u.access;
+			s.readStages = u.writes ? 0 : u.stages;
+		}
+}
+
+VkImageLayout Kokoro::Graphics::ImageStateTracker::GetLayout(uint32_t level, uint32_t layer) {
+	return At(level, layer).layout;
+}
+
+uint32_t Kokoro::Graphics::ImageStateTracker::GetSkippedCount() {
+	return skippedCnt;
+}
+
+void Kokoro::Graphics::ImageStateTracker::ResetCounters() {
+	skippedCnt = 0;
+}
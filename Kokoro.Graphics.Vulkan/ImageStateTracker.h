@@ -0,0 +1,66 @@
+#pragma once
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#define VK_USE_PLATFORM_WIN32_KHR
+#endif
+#include "vulkan/vulkan.h"
+#include "BarrierBatch.h"
+#include <vector>
+
+namespace Kokoro::Graphics {
+	//Layout and last access of every level and layer of one image, assuming commands execute in the order they're recorded.
+	class ImageStateTracker
+	{
+	private:
+		struct SubresourceState {
+			VkImageLayout layout;
+			//Set once the subresource has been written or transitioned, later accesses have to wait on it
+			bool written;
+			VkPipelineStageFlags writeStages;
+			VkAccessFlags writeAccess;
+			//Stages and accesses the last write has been made visible to
+			VkPipelineStageFlags visibleStages;
+			VkAccessFlags visibleAccess;
+			//Stages that read since the last write, a new write waits on them
+			VkPipelineStageFlags readStages;
+		};
+		struct PendingBarrier {
+			uint32_t baseLevel;
+			uint32_t levelCount;
+			uint32_t baseLayer;
+			uint32_t layerCount;
+			VkImageLayout oldLayout;
+			VkPipelineStageFlags srcStages;
+			VkAccessFlags srcAccess;
+			bool operator==(const PendingBarrier& other) const;
+		};
+
+		VkImage image;
+		VkImageAspectFlags aspect;
+		uint32_t levels;
+		uint32_t layers;
+		std::vector<SubresourceState> states;
+		std::vector<PendingBarrier> pending;
+
+		uint32_t skippedCnt;
+
+		SubresourceState& At(uint32_t level, uint32_t layer);
+		void Queue(uint32_t level, uint32_t layer, const PendingBarrier& b);
+	public:
+		ImageStateTracker(VkImage image, VkImageAspectFlags aspect, uint32_t levels, uint32_t layers);
+
+		//Queues the barriers the range needs before it's used as use. Neighbouring subresources needing the same barrier share one.
+		//discard drops the current contents, letting a layout change start from UNDEFINED.
+		void Transition(BarrierBatch& batch, uint32_t baseLevel, uint32_t levelCount, uint32_t baseLayer, uint32_t layerCount, ResourceUse use, bool discard);
+		//Records that something outside the tracker, like a render pass, left the range as use would.
+		void Assume(uint32_t baseLevel, uint32_t levelCount, uint32_t baseLayer, uint32_t layerCount, ResourceUse use);
+		//Same, for layouts no ResourceUse maps to exactly, use gives the accesses.
+		void Assume(uint32_t baseLevel, uint32_t levelCount, uint32_t baseLayer, uint32_t layerCount, ResourceUse use, VkImageLayout layout);
+		VkImageLayout GetLayout(uint32_t level, uint32_t layer);
+
+		//Subresource transitions found to be redundant since the last ResetCounters.
+		uint32_t GetSkippedCount();
+		void ResetCounters();
+	};
+}
@@ -1,7 +1,6 @@
 #pragma once
 #include "GraphicsDevice.h"
 #include "ImageFormat.h"
-#include "Image.h"
 
 namespace Kokoro::Graphics {
 	enum class ImageViewType {
@@ -38,6 +37,8 @@ namespace Kokoro::Graphics {
 		}
 	};
 
+	ref class Image;
+	//Views belong to the Image they were built from and are shared between every ImageView describing the same subresources.
 	ref class ImageView
 	{
 	private:
@@ -45,6 +46,7 @@ namespace Kokoro::Graphics {
 		bool locked;
 	internal:
 		VkImageView GetImageView();
+		ImageView(VkImageView view, ImageFormat format, ImageViewType type, int baseLevel, int levelCount, int baseLayer, int layerCount);
 	public:
 		property ImageFormat Format;
 		property ImageViewType ViewType;
@@ -54,7 +56,8 @@ namespace Kokoro::Graphics {
 		property int LayerCount;
 		ImageView();
 		~ImageView();
-		void Build(Image img);
+		//Only valid for as long as img is.
+		void Build(Image^ img);
 	};
 }
 
@@ -0,0 +1,83 @@
+#include "ImageViewCache.h"
+#include <cstring>
+
+bool Kokoro::Graphics::ImageViewCache::ViewKey::operator==(const ViewKey& other) const {
+	return memcmp(this, &other, sizeof(ViewKey)) == 0;
+}
+
+size_t Kokoro::Graphics::ImageViewCache::ViewKeyHash::operator()(const ViewKey& k) const {
+	const uint32_t* fields = reinterpret_cast<const uint32_t*>(&k);
+	uint64_t h = 14695981039346656037ull;
+	for (size_t i = 0; i < sizeof(ViewKey) / sizeof(uint32_t); i++)
+		h = (h ^ fields[i]) * 1099511628211ull;
+	return static_cast<size_t>(h);
+}
+
+Kokoro::Graphics::ImageViewCache::ImageViewCache(VkImage image) {
+	this->image = image;
+	hits = 0;
+	misses = 0;
+}
+
+VkResult Kokoro::Graphics::ImageViewCache::Get(VkDevice dev, VkImageViewType viewType, VkFormat format, const VkImageSubresourceRange& range, VkImageView* view) {
+	ViewKey key;
+	key.viewType = viewType;
+	key.format = format;
+	key.aspect = range.aspectMask;
+	key.baseLevel = range.baseMipLevel;
+	key.levelCount = range.levelCount;
+	key.baseLayer = range.baseArrayLayer;
+	key.layerCount = range.layerCount;
+
+	auto it = views.find(key);
+	if (it != views.end()) {
+		hits++;
+		*view = it->second;
+		return VK_SUCCESS;
+	}
+
+	VkImageViewCreateInfo creatInfo = {};
+	creatInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	creatInfo.flags = 0;
+	creatInfo.image = image;
+	creatInfo.viewType = viewType;
+	creatInfo.format = format;
+	creatInfo.components = {
+		VK_COMPONENT_SWIZZLE_IDENTITY,
+		VK_COMPONENT_SWIZZLE_IDENTITY,
+		VK_COMPONENT_SWIZZLE_IDENTITY,
+		VK_COMPONENT_SWIZZLE_IDENTITY,
+	};
+	creatInfo.subresourceRange = range;
+
+	auto res = vkCreateImageView(dev, &creatInfo, nullptr, view);
+	if (res != VK_SUCCESS)
+		return res;
+
+	misses++;
+	views[key] = *view;
+	return VK_SUCCESS;
+}
+
+void Kokoro::Graphics::ImageViewCache::GetViews(std::vector<VkImageView>& views) {
+	for (auto& v : this->views)
+		views.push_back(v.second);
+}
+
+uint32_t Kokoro::Graphics::ImageViewCache::GetViewCount() {
+	return static_cast<uint32_t>(views.size());
+}
+
+uint32_t Kokoro::Graphics::ImageViewCache::GetHitCount() {
+	return hits;
+}
+
+uint32_t Kokoro::Graphics::ImageViewCache::GetMissCount() {
+	return misses;
+}
+
+void Kokoro::Graphics::ImageViewCache::Destroy(VkDevice dev) {
+	for (auto& v : views)
+		vkDestroyImageView(dev, v.second, nullptr);
+	views.clear();
+}
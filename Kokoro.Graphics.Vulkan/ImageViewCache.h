@@ -0,0 +1,42 @@
+#pragma once
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#define VK_USE_PLATFORM_WIN32_KHR
+#endif
+#include "vulkan/vulkan.h"
+#include <unordered_map>
+#include <vector>
+
+namespace Kokoro::Graphics {
+	//Views of a single image, keyed by everything that can differ between them. All views are destroyed together with the image.
+	class ImageViewCache
+	{
+	private:
+		struct ViewKey {
+			uint32_t viewType;
+			uint32_t format;
+			uint32_t aspect;
+			uint32_t baseLevel;
+			uint32_t levelCount;
+			uint32_t baseLayer;
+			uint32_t layerCount;
+			bool operator==(const ViewKey& other) const;
+		};
+		struct ViewKeyHash {
+			size_t operator()(const ViewKey& k) const;
+		};
+		VkImage image;
+		std::unordered_map<ViewKey, VkImageView, ViewKeyHash> views;
+		uint32_t hits;
+		uint32_t misses;
+	public:
+		ImageViewCache(VkImage image);
+		VkResult Get(VkDevice dev, VkImageViewType viewType, VkFormat format, const VkImageSubresourceRange& range, VkImageView* view);
+		void GetViews(std::vector<VkImageView>& views);
+		uint32_t GetViewCount();
+		uint32_t GetHitCount();
+		uint32_t GetMissCount();
+		void Destroy(VkDevice dev);
+	};
+}
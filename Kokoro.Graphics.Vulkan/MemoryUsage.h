@@ -6,6 +6,8 @@ namespace Kokoro::Graphics {
 		CpuToGpu,
 		GpuOnly,
 		CpuOnly,
+		//Transient attachments on tilers, falls back to GpuOnly where the device has no lazily allocated memory
+		GpuLazilyAllocated,
 	};
 
 	class MemoryUsageConv {
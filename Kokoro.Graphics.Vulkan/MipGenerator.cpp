@@ -0,0 +1,355 @@
+#include "MipGenerator.h"
+#include "Image.h"
+#include "ShaderModule.h"
+#include "SpecializedShaderModule.h"
+#include "ComputePipeline.h"
+#include "DescriptorSet.h"
+#include "GPUBuffer.h"
+#include <algorithm>
+#include <string>
+
+//Each workgroup reduces a 64x64 tile of level 0 into levels 1-6, the first two levels through quad shuffles and the rest
+//through shared memory. The last workgroup of a layer to finish then reduces the whole of level 6 into levels 7-12.
+//Tiles use a 2x2 footprint, which drops the last texel of odd sized levels, so the last group also recomputes the last
+//column and row of every level with a 3 texel footprint along odd dimensions. Min and max pyramids stay conservative.
+static const char* DownsampleSource = R"(
+#extension GL_KHR_shader_subgroup_basic : require
+#extension GL_KHR_shader_subgroup_quad : require
+
+layout(local_size_x = 256) in;
+layout(constant_id = 0) const uint Reduction = 0;
+
+layout(set = 0, binding = 0, MIP_FORMAT) uniform readonly image2DArray Source;
+layout(set = 0, binding = 1, MIP_FORMAT) uniform coherent image2DArray Mips[12];
+layout(set = 0, binding = 2) coherent buffer Counters { uint Counter[]; };
+
+layout(push_constant) uniform Params {
+	ivec2 SourceSize;
+	uint MipCount;
+	uint GroupCount;
+};
+
+shared vec4 Tile[16][16];
+shared uint LastGroup;
+
+vec4 Combine(vec4 a, vec4 b) {
+	if (Reduction == 1)
+		return min(a, b);
+	if (Reduction == 2)
+		return max(a, b);
+	return a + b;
+}
+
+vec4 Reduce(vec4 a, vec4 b, vec4 c, vec4 d) {
+	vec4 r = Combine(Combine(a, b), Combine(c, d));
+	return Reduction == 0 ? r * 0.25 : r;
+}
+
+ivec2 LevelSize(uint level) {
+	return max(SourceSize >> int(level), ivec2(1));
+}
+
+//Mips is only ever indexed with literals, dynamic indexing of storage image arrays is an optional feature
+#define MIP_CASES(op) op(0) op(1) op(2) op(3) op(4) op(5) op(6) op(7) op(8) op(9) op(10) op(11)
+#define LOAD_CASE(i) case i: return imageLoad(Mips[i], c);
+#define STORE_CASE(i) case i: imageStore(Mips[i], c, v); break;
+
+vec4 Load(uint level, ivec2 p, int layer) {
+	p = min(p, LevelSize(level) - 1);
+	ivec3 c = ivec3(p, layer);
+	if (level == 0)
+		return imageLoad(Source, c);
+	switch (level - 1) {
+	MIP_CASES(LOAD_CASE)
+	}
+	return vec4(0);
+}
+
+void Store(uint level, ivec2 p, int layer, vec4 v) {
+	if (level > MipCount || any(greaterThanEqual(p, LevelSize(level))))
+		return;
+	ivec3 c = ivec3(p, layer);
+	switch (level - 1) {
+	MIP_CASES(STORE_CASE)
+	}
+}
+
+//Recomputes the last column and row of level from the finished level below
+void FixEdges(uint level, int layer) {
+	ivec2 size = LevelSize(level);
+	ivec2 odd = LevelSize(level - 1) & 1;
+	for (uint i = gl_LocalInvocationIndex; i < uint(size.x + size.y); i += gl_WorkGroupSize.x) {
+		ivec2 p = i < uint(size.y) ? ivec2(size.x - 1, int(i)) : ivec2(int(i) - size.y, size.y - 1);
+		ivec2 span = ivec2(2) + odd * ivec2(equal(p, size - 1));
+		vec4 v = Load(level - 1, p * 2, layer);
+		for (int y = 0; y < span.y; y++)
+			for (int x = 0; x < span.x; x++)
+				if (x + y != 0)
+					v = Combine(v, Load(level - 1, p * 2 + ivec2(x, y), layer));
+		Store(level, p, layer, Reduction == 0 ? v / float(span.x * span.y) : v);
+	}
+}
+
+void DownsampleTile(uint base, ivec2 tile, int layer) {
+	uint lane = gl_LocalInvocationIndex;
+	uint quad = lane & 3;
+	ivec2 inBlock = ivec2(quad & 1, quad >> 1);
+	ivec2 block = ivec2((lane >> 2) & 7, lane >> 5);
+
+	//Four passes over the 32x32 texels of level base + 1, each quad covering a 2x2 block
+	for (uint i = 0; i < 4; i++) {
+		ivec2 offset = ivec2(i & 1, i >> 1) * 16;
+		ivec2 dst = tile * 32 + offset + block * 2 + inBlock;
+		ivec2 src = dst * 2;
+		vec4 v = Reduce(Load(base, src, layer), Load(base, src + ivec2(1, 0), layer), Load(base, src + ivec2(0, 1), layer), Load(base, src + ivec2(1, 1), layer));
+		Store(base + 1, dst, layer, v);
+
+		vec4 r = Reduce(v, subgroupQuadSwapHorizontal(v), subgroupQuadSwapVertical(v), subgroupQuadSwapDiagonal(v));
+		if (quad == 0) {
+			ivec2 p = (offset >> 1) + block;
+			Store(base + 2, tile * 16 + p, layer, r);
+			Tile[p.y][p.x] = r;
+		}
+	}
+	barrier();
+
+	for (uint l = 3; l <= 6; l++) {
+		int size = 16 >> (l - 2);
+		ivec2 p = ivec2(lane % uint(size), lane / uint(size));
+		bool active = lane < uint(size * size);
+		vec4 v = vec4(0);
+		if (active)
+			v = Reduce(Tile[p.y * 2][p.x * 2], Tile[p.y * 2][p.x * 2 + 1], Tile[p.y * 2 + 1][p.x * 2], Tile[p.y * 2 + 1][p.x * 2 + 1]);
+		barrier();
+		if (active) {
+			Store(base + l, tile * size + p, layer, v);
+			Tile[p.y][p.x] = v;
+		}
+		barrier();
+	}
+}
+
+void FixLevelEdges(uint first, uint last, int layer) {
+	for (uint l = first; l <= last; l++) {
+		FixEdges(l, layer);
+		memoryBarrierImage();
+		barrier();
+	}
+}
+
+void main() {
+	int layer = int(gl_WorkGroupID.z);
+	DownsampleTile(0, ivec2(gl_WorkGroupID.xy), layer);
+
+	memoryBarrierImage();
+	barrier();
+	if (gl_LocalInvocationIndex == 0)
+		LastGroup = atomicAdd(Counter[layer], 1) == GroupCount - 1 ? 1u : 0u;
+	barrier();
+	if (LastGroup == 0)
+		return;
+
+	memoryBarrierImage();
+	FixLevelEdges(1, min(MipCount, 6u), layer);
+	if (MipCount <= 6)
+		return;
+
+	DownsampleTile(6, ivec2(0), layer);
+	memoryBarrierImage();
+	barrier();
+	FixLevelEdges(7, MipCount, layer);
+}
+)";
+
+//Largest chain the downsampler reduces in one dispatch, the source level included
+static const int MaxDownsampleLevels = 13;
+static const int MaxDownsampleLayers = 2048;
+
+//Formats in the second switch need shaderStorageImageExtendedFormats to be declared in a shader
+static const char* StorageFormatName(Kokoro::Graphics::ImageFormat fmt) {
+	using Kokoro::Graphics::ImageFormat;
+	switch (fmt) {
+	case ImageFormat::R8G8B8A8Unorm:
+		return "rgba8";
+	case ImageFormat::R8G8B8A8Snorm:
+		return "rgba8_snorm";
+	case ImageFormat::R32f:
+		return "r32f";
+	case ImageFormat::R16G16B16A16f:
+		return "rgba16f";
+	case ImageFormat::R32G32B32A32f:
+		return "rgba32f";
+	default:
+		break;
+	}
+	if (!Kokoro::Graphics::GraphicsDevice::SupportsStorageImageExtendedFormats())
+		return nullptr;
+	switch (fmt) {
+	case ImageFormat::R8Unorm:
+		return "r8";
+	case ImageFormat::R8G8Unorm:
+		return "rg8";
+	case ImageFormat::R16f:
+		return "r16f";
+	case ImageFormat::R16G16f:
+		return "rg16f";
+	case ImageFormat::R32G32f:
+		return "rg32f";
+	case ImageFormat::B10G11R11Ufloat:
+		return "r11f_g11f_b10f";
+	case ImageFormat::A2B10G10R10Unorm:
+		return "rgb10_a2";
+	default:
+		return nullptr;
+	}
+}
+
+bool Kokoro::Graphics::MipGenerator::SupportsQuadOps() {
+	if (quadSupport < 0) {
+		VkPhysicalDeviceSubgroupProperties subgroupProps = {};
+		subgroupProps.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SUBGROUP_PROPERTIES;
+		VkPhysicalDeviceProperties2 props2 = {};
+		props2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+		props2.pNext = &subgroupProps;
+		vkGetPhysicalDeviceProperties2(GraphicsDevice::GetPhysicalDevice(), &props2);
+
+		quadSupport = (subgroupProps.supportedStages & VK_SHADER_STAGE_COMPUTE_BIT) != 0 &&
+			(subgroupProps.supportedOperations & VK_SUBGROUP_FEATURE_QUAD_BIT) != 0 &&
+			subgroupProps.subgroupSize >= 4 ? 1 : 0;
+	}
+	return quadSupport != 0;
+}
+
+bool Kokoro::Graphics::MipGenerator::SupportsBlit(ImageFormat fmt) {
+	return ImageFormatConv::Supports(GraphicsDevice::GetPhysicalDevice(), fmt, VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT);
+}
+
+bool Kokoro::Graphics::MipGenerator::SupportsDownsample(ImageFormat fmt) {
+	if (StorageFormatName(fmt) == nullptr || !SupportsQuadOps())
+		return false;
+	return ImageFormatConv::Supports(GraphicsDevice::GetPhysicalDevice(), fmt, VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT);
+}
+
+Kokoro::Graphics::MipGenerator::Variant^ Kokoro::Graphics::MipGenerator::GetVariant(ImageFormat fmt, MipReduction reduction) {
+	int key = static_cast<int>(fmt) * 3 + static_cast<int>(reduction);
+	Variant^ v;
+	if (variants->TryGetValue(key, v))
+		return v;
+
+	ShaderModule^ mod;
+	if (!modules->TryGetValue(static_cast<int>(fmt), mod)) {
+		std::string src = std::string("#version 450\n#define MIP_FORMAT ") + StorageFormatName(fmt) + "\n" + DownsampleSource;
+		mod = ShaderModule::FromSource(ShaderType::Compute, "MipDownsample.comp", src.c_str());
+		modules[static_cast<int>(fmt)] = mod;
+	}
+
+	uint32_t r = static_cast<uint32_t>(reduction);
+	v = gcnew Variant();
+	v->Set = gcnew DescriptorSet();
+	v->Set->PushDescriptor = true;
+	v->Set->AddFromShaders(0, mod);
+	v->Set->Build(1);
+	v->Pipeline = gcnew ComputePipeline();
+	v->Pipeline->SetShader(mod->Specialize(IntPtr(&r), sizeof(r)));
+	v->Pipeline->AddDescriptorSet(v->Set);
+	v->Pipeline->Build();
+	variants[key] = v;
+	return v;
+}
+
+void Kokoro::Graphics::MipGenerator::Blit(VkCommandBuffer cmd, Image^ img, ResourceUse finalUse) {
+	BarrierBatch batch;
+	img->Transition(batch, ResourceUse::TransferSrc, 0, 1, 0, img->Layers, false);
+	img->Transition(batch, ResourceUse::TransferDst, 1, img->Levels - 1, 0, img->Layers, true);
+	batch.Flush(cmd);
+
+	for (int level = 1; level < img->Levels; level++) {
+		VkImageBlit region = {};
+		region.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		region.srcSubresource.mipLevel = level - 1;
+		region.srcSubresource.baseArrayLayer = 0;
+		region.srcSubresource.layerCount = img->Layers;
+		region.srcOffsets[1] = { std::max(img->Width >> (level - 1), 1), std::max(img->Height >> (level - 1), 1), 1 };
+		region.dstSubresource = region.srcSubresource;
+		region.dstSubresource.mipLevel = level;
+		region.dstOffsets[1] = { std::max(img->Width >> level, 1), std::max(img->Height >> level, 1), 1 };
+		vkCmdBlitImage(cmd, img->GetImage(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, img->GetImage(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region, VK_FILTER_LINEAR);
+
+		//Each level is read as soon as it has been written, the last one goes straight to finalUse
+		if (level + 1 < img->Levels) {
+			img->Transition(batch, ResourceUse::TransferSrc, level, 1, 0, img->Layers, false);
+			batch.Flush(cmd);
+		}
+	}
+
+	img->Transition(batch, finalUse, false);
+	batch.Flush(cmd);
+}
+
+void Kokoro::Graphics::MipGenerator::Downsample(VkCommandBuffer cmd, Image^ img, MipReduction reduction, ResourceUse finalUse) {
+	if (img->Levels > MaxDownsampleLevels || std::max(img->Width, img->Height) > (1 << (MaxDownsampleLevels - 1)))
+		throw gcnew System::NotSupportedException("Image is too large for the single pass downsampler.");
+	if (img->Layers > MaxDownsampleLayers)
+		throw gcnew System::NotSupportedException("Image has too many layers for the single pass downsampler.");
+	if (!SupportsDownsample(img->Format))
+		throw gcnew System::NotSupportedException("Device can't downsample this format in a compute shader.");
+
+	auto v = GetVariant(img->Format, reduction);
+	if (counters == nullptr)
+		counters = GPUBuffer::Allocate(SharingMode::Exclusive, BufferUsage::Storage | BufferUsage::TransferDst, MemoryUsage::GpuOnly, MaxDownsampleLayers * sizeof(uint32_t), false);
+	size_t counterSz = img->Layers * sizeof(uint32_t);
+
+	//Every call shares the counters, a previous dispatch may still be using them
+	BarrierBatch batch;
+	batch.AddBuffer(counters->GetBuffer(), 0, counterSz, ResourceUse::StorageReadWriteCompute, ResourceUse::TransferDst);
+	batch.Flush(cmd);
+	vkCmdFillBuffer(cmd, counters->GetBuffer(), 0, counterSz, 0);
+
+	//Level 0 is only read, but storage images have to be in GENERAL either way
+	batch.AddBuffer(counters->GetBuffer(), 0, counterSz, ResourceUse::TransferDst, ResourceUse::StorageReadWriteCompute);
+	img->Transition(batch, ResourceUse::StorageReadCompute, 0, 1, 0, img->Layers, false);
+	img->Transition(batch, ResourceUse::StorageReadWriteCompute, 1, img->Levels - 1, 0, img->Layers, true);
+	batch.Flush(cmd);
+
+	//Slots past the last level still need a valid view, the shader never touches them
+	v->Set->SetImageView(0, 0, 0, img->GetLevelView(ImageViewType::View2DArray, 0), false);
+	for (int i = 0; i < MaxDownsampleLevels - 1; i++)
+		v->Set->SetImageView(0, 1, i, img->GetLevelView(ImageViewType::View2DArray, std::min(i + 1, img->Levels - 1)), true);
+	v->Set->Set(0, 2, 0, counters, 0, counterSz);
+
+	struct {
+		int32_t width;
+		int32_t height;
+		uint32_t mipCount;
+		uint32_t groupCount;
+	} params;
+	uint32_t groupsX = ComputePipeline::GroupCount(img->Width, 64);
+	uint32_t groupsY = ComputePipeline::GroupCount(img->Height, 64);
+	params.width = img->Width;
+	params.height = img->Height;
+	params.mipCount = img->Levels - 1;
+	params.groupCount = groupsX * groupsY;
+
+	v->Pipeline->Bind(cmd);
+	v->Set->Push(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, v->Pipeline->GetLayout(), 0);
+	vkCmdPushConstants(cmd, v->Pipeline->GetLayout(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(params), &params);
+	v->Pipeline->DispatchGroups(cmd, groupsX, groupsY, img->Layers);
+
+	img->Transition(batch, finalUse, false);
+	batch.Flush(cmd);
+}
+
+void Kokoro::Graphics::MipGenerator::Destroy() {
+	for each (auto v in variants->Values) {
+		delete v->Pipeline;
+		delete v->Set;
+	}
+	variants->Clear();
+	for each (auto m in modules->Values)
+		delete m;
+	modules->Clear();
+	if (counters != nullptr) {
+		delete counters;
+		counters = nullptr;
+	}
+}
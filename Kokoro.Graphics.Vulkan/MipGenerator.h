@@ -0,0 +1,55 @@
+#pragma once
+#include "GraphicsDevice.h"
+#include "ImageFormat.h"
+#include "BarrierBatch.h"
+
+using namespace System::Collections::Generic;
+
+namespace Kokoro::Graphics {
+	enum class MipReduction {
+		//Box filter, what sampled textures want
+		Average,
+		//Conservative depth pyramids for reversed-Z and regular depth respectively
+		Min,
+		Max,
+	};
+
+	ref class Image;
+	ref class ShaderModule;
+	ref class ComputePipeline;
+	ref class DescriptorSet;
+	ref class GPUBuffer;
+	//Fills an image's mip chain on the GPU, either as a chain of linear blits or with a single compute dispatch
+	//that reduces every level of a 4096x4096 image at once.
+	ref class MipGenerator
+	{
+	private:
+		ref struct Variant {
+			ComputePipeline^ Pipeline;
+			DescriptorSet^ Set;
+		};
+		//Downsampler modules per storage format, specialized per reduction
+		static Dictionary<int, ShaderModule^>^ modules;
+		static Dictionary<int, Variant^>^ variants;
+		//One workgroup completion counter per array layer
+		static GPUBuffer^ counters;
+		static int quadSupport;
+
+		static MipGenerator() {
+			modules = gcnew Dictionary<int, ShaderModule^>();
+			variants = gcnew Dictionary<int, Variant^>();
+			counters = nullptr;
+			quadSupport = -1;
+		}
+		static bool SupportsQuadOps();
+		static Variant^ GetVariant(ImageFormat fmt, MipReduction reduction);
+	internal:
+		static bool SupportsBlit(ImageFormat fmt);
+		static bool SupportsDownsample(ImageFormat fmt);
+		//Level 0 is read in currentLayout, the other levels' contents are discarded. Every level ends up in finalLayout.
+		static void Blit(VkCommandBuffer cmd, Image^ img, ResourceUse finalUse);
+		static void Downsample(VkCommandBuffer cmd, Image^ img, MipReduction reduction, ResourceUse finalUse);
+	public:
+		static void Destroy();
+	};
+}
@@ -0,0 +1,150 @@
+#include "PipelineStateCache.h"
+#include <mutex>
+#include <unordered_map>
+
+namespace {
+	struct PipelineEntry {
+		VkPipeline pipeline;
+		VkPipelineLayout layout;
+		uint32_t refCount;
+	};
+
+	//Kept out of the header so the managed translation units never see <mutex>
+	struct CacheState {
+		std::mutex lock;
+		std::unordered_map<std::string, PipelineEntry> entries;
+		std::unordered_map<VkPipeline, std::string> keys;
+		uint64_t hits;
+		uint64_t misses;
+	};
+}
+
+void Kokoro::Graphics::PipelineStateKey::Append(const void* bytes, size_t len) {
+	data.append(static_cast<const char*>(bytes), len);
+}
+
+void Kokoro::Graphics::PipelineStateKey::Append(uint64_t v) {
+	Append(&v, sizeof(v));
+}
+
+const std::string& Kokoro::Graphics::PipelineStateKey::GetData() const {
+	return data;
+}
+
+Kokoro::Graphics::PipelineStateCache::PipelineStateCache() {
+	auto s = new CacheState();
+	s->hits = 0;
+	s->misses = 0;
+	state = s;
+}
+
+Kokoro::Graphics::PipelineStateCache::~PipelineStateCache() {
+	delete static_cast<CacheState*>(state);
+}
+
+bool Kokoro::Graphics::PipelineStateCache::Acquire(const PipelineStateKey& key, VkPipeline* pipeline, VkPipelineLayout* layout) {
+	auto s = static_cast<CacheState*>(state);
+	std::lock_guard<std::mutex> guard(s->lock);
+
+	auto it = s->entries.find(key.GetData());
+	if (it == s->entries.end()) {
+		s->misses++;
+		return false;
+	}
+	s->hits++;
+	it->second.refCount++;
+	*pipeline = it->second.pipeline;
+	*layout = it->second.layout;
+	return true;
+}
+
+void Kokoro::Graphics::PipelineStateCache::Insert(VkDevice dev, const PipelineStateKey& key, VkPipeline* pipeline, VkPipelineLayout* layout) {
+	auto s = static_cast<CacheState*>(state);
+	std::lock_guard<std::mutex> guard(s->lock);
+
+	auto it = s->entries.find(key.GetData());
+	if (it != s->entries.end()) {
+		//Lost a race against another build of the same state
+		vkDestroyPipeline(dev, *pipeline, nullptr);
+		vkDestroyPipelineLayout(dev, *layout, nullptr);
+		it->second.refCount++;
+		*pipeline = it->second.pipeline;
+		*layout = it->second.layout;
+		return;
+	}
+
+	PipelineEntry e = {};
+	e.pipeline = *pipeline;
+	e.layout = *layout;
+	e.refCount = 1;
+	s->entries.emplace(key.GetData(), e);
+	s->keys.emplace(*pipeline, key.GetData());
+}
+
+void Kokoro::Graphics::PipelineStateCache::Release(VkPipeline pipeline) {
+	auto s = static_cast<CacheState*>(state);
+	std::lock_guard<std::mutex> guard(s->lock);
+
+	auto k = s->keys.find(pipeline);
+	if (k == s->keys.end())
+		return;
+	auto& e = s->entries[k->second];
+	if (e.refCount > 0)
+		e.refCount--;
+}
+
+uint32_t Kokoro::Graphics::PipelineStateCache::Evict(VkDevice dev) {
+	auto s = static_cast<CacheState*>(state);
+	std::lock_guard<std::mutex> guard(s->lock);
+
+	uint32_t evicted = 0;
+	for (auto it = s->entries.begin(); it != s->entries.end();) {
+		if (it->second.refCount == 0) {
+			vkDestroyPipeline(dev, it->second.pipeline, nullptr);
+			vkDestroyPipelineLayout(dev, it->second.layout, nullptr);
+			s->keys.erase(it->second.pipeline);
+			it = s->entries.erase(it);
+			evicted++;
+		}
+		else
+			it++;
+	}
+	return evicted;
+}
+
+uint32_t Kokoro::Graphics::PipelineStateCache::GetPipelineCount() {
+	auto s = static_cast<CacheState*>(state);
+	std::lock_guard<std::mutex> guard(s->lock);
+	return static_cast<uint32_t>(s->entries.size());
+}
+
+uint64_t Kokoro::Graphics::PipelineStateCache::GetHitCount() {
+	auto s = static_cast<CacheState*>(state);
+	std::lock_guard<std::mutex> guard(s->lock);
+	return s->hits;
+}
+
+uint64_t Kokoro::Graphics::PipelineStateCache::GetMissCount() {
+	auto s = static_cast<CacheState*>(state);
+	std::lock_guard<std::mutex> guard(s->lock);
+	return s->misses;
+}
+
+void Kokoro::Graphics::PipelineStateCache::ResetCounters() {
+	auto s = static_cast<CacheState*>(state);
+	std::lock_guard<std::mutex> guard(s->lock);
+	s->hits = 0;
+	s->misses = 0;
+}
+
+void Kokoro::Graphics::PipelineStateCache::Destroy(VkDevice dev) {
+	auto s = static_cast<CacheState*>(state);
+	std::lock_guard<std::mutex> guard(s->lock);
+
+	for (auto& e : s->entries) {
+		vkDestroyPipeline(dev, e.second.pipeline, nullptr);
+		vkDestroyPipelineLayout(dev, e.second.layout, nullptr);
+	}
+	s->entries.clear();
+	s->keys.clear();
+}
@@ -0,0 +1,46 @@
+#pragma once
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#define VK_USE_PLATFORM_WIN32_KHR
+#endif
+#include "vulkan/vulkan.h"
+#include <string>
+
+namespace Kokoro::Graphics {
+	//Canonical byte encoding of every piece of state that affects pipeline creation.
+	class PipelineStateKey
+	{
+	private:
+		std::string data;
+	public:
+		void Append(const void* bytes, size_t len);
+		void Append(uint64_t v);
+		const std::string& GetData() const;
+	};
+
+	//Device-wide map from pipeline state to a refcounted VkPipeline and its layout.
+	//Unreferenced pipelines stay cached until Evict is called.
+	class PipelineStateCache
+	{
+	private:
+		void* state;
+	public:
+		PipelineStateCache();
+		~PipelineStateCache();
+
+		//Returns true and takes a reference if an identical pipeline exists.
+		bool Acquire(const PipelineStateKey& key, VkPipeline* pipeline, VkPipelineLayout* layout);
+		//Registers a newly built pipeline. If an identical one was inserted concurrently, the new objects are destroyed and replaced with the existing ones.
+		void Insert(VkDevice dev, const PipelineStateKey& key, VkPipeline* pipeline, VkPipelineLayout* layout);
+		void Release(VkPipeline pipeline);
+		//Destroys every pipeline that is no longer referenced, returns the number destroyed.
+		uint32_t Evict(VkDevice dev);
+
+		uint32_t GetPipelineCount();
+		uint64_t GetHitCount();
+		uint64_t GetMissCount();
+		void ResetCounters();
+		void Destroy(VkDevice dev);
+	};
+}
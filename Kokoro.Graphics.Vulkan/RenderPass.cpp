@@ -1,17 +1,24 @@
 #include "RenderPass.h"
 #include <vector>
+#include <algorithm>
 
 Kokoro::Graphics::RenderPass::RenderPass()
 {
 	attachments = gcnew List<AttachmentInfo>();
 	subpasses = gcnew List<SubpassInfo>();
 	subpassDeps = gcnew List<SubpassDep>();
+	renderPass = VK_NULL_HANDLE;
+	compatKey = nullptr;
 	locked = false;
+	AutoDependencies = true;
 }
 
 Kokoro::Graphics::RenderPass::~RenderPass()
 {
-
+	//Frames in flight may still be recorded against the pass
+	if (renderPass != VK_NULL_HANDLE)
+		GraphicsDevice::DeferDestroy(DeferredObjectType::CachedRenderPass, (uint64_t)renderPass);
+	delete compatKey;
 }
 
 void Kokoro::Graphics::RenderPass::AddSubpass(SubpassInfo att)
@@ -29,41 +36,266 @@ void Kokoro::Graphics::RenderPass::AddAttachment(AttachmentInfo att)
 	attachments->Add(att);
 }
 
+VkAttachmentReference2KHR Kokoro::Graphics::RenderPass::ConvertRef(AttachmentRef^ ref, bool input)
+{
+	if (ref == nullptr || ref->idx == VK_ATTACHMENT_UNUSED)
+		return RenderPassBuilder::Unused();
+	if (ref->idx >= static_cast<uint32_t>(attachments->Count))
+		throw gcnew System::ArgumentOutOfRangeException("idx", "Attachment reference is out of range.");
+	//Only input attachments need an aspect, depth-stencil ones are read as depth
+	auto aspect = input ? ImageFormatConv::ViewAspect(attachments[ref->idx].fmt) : 0;
+	return RenderPassBuilder::Ref(ref->idx, ImageLayoutConv::Convert(ref->layout), aspect);
+}
+
+uint32_t Kokoro::Graphics::RenderPass::GetAttachmentSamples(AttachmentRef^ ref)
+{
+	if (ref == nullptr || ref->idx == VK_ATTACHMENT_UNUSED)
+		return 0;
+	return SampleCountConv::Convert(attachments[ref->idx].samples);
+}
+
+void Kokoro::Graphics::RenderPass::FillSubpass(RenderPassBuilder& builder, int i)
+{
+	auto info = subpasses[i];
+	auto& sub = builder.AddSubpass();
+	for (int j = 0; info.inputAttachments != nullptr && j < info.inputAttachments->Length; j++)
+		sub.inputs.push_back(ConvertRef(info.inputAttachments[j], true));
+	for (int j = 0; info.colorAttachments != nullptr && j < info.colorAttachments->Length; j++)
+		sub.colors.push_back(ConvertRef(info.colorAttachments[j], false));
+	for (int j = 0; info.preserveAttachments != nullptr && j < info.preserveAttachments->Length; j++)
+		sub.preserves.push_back(info.preserveAttachments[j]);
+	sub.depth = ConvertRef(info.depthAttachment, false);
+	sub.viewMask = info.viewMask;
+
+	//Color and depth attachments of one subpass rasterize together, so they share a sample count
+	uint32_t samples = GetAttachmentSamples(info.depthAttachment);
+	for (int j = 0; info.colorAttachments != nullptr && j < info.colorAttachments->Length; j++) {
+		uint32_t s = GetAttachmentSamples(info.colorAttachments[j]);
+		if (s != 0 && samples != 0 && s != samples)
+			throw gcnew System::ArgumentException("Attachments of subpass " + i + " have different sample counts.");
+		if (s != 0)
+			samples = s;
+	}
+
+	if (info.resolveAttachments != nullptr) {
+		int colorCnt = info.colorAttachments == nullptr ? 0 : info.colorAttachments->Length;
+		if (info.resolveAttachments->Length != colorCnt)
+			throw gcnew System::ArgumentException("Subpass " + i + " needs one resolve attachment per color attachment.");
+		for (int j = 0; j < colorCnt; j++) {
+			auto r = info.resolveAttachments[j];
+			sub.resolves.push_back(ConvertRef(r, false));
+			if (r == nullptr || r->idx == VK_ATTACHMENT_UNUSED)
+				continue;
+			if (GetAttachmentSamples(r) != VK_SAMPLE_COUNT_1_BIT || samples <= VK_SAMPLE_COUNT_1_BIT)
+				throw gcnew System::ArgumentException("Subpass " + i + " must resolve multisampled color attachments into single sampled ones.");
+			if (attachments[r->idx].fmt != attachments[info.colorAttachments[j]->idx].fmt)
+				throw gcnew System::ArgumentException("Subpass " + i + " resolves into an attachment of a different format.");
+		}
+	}
+
+	auto depthResolve = info.depthResolveAttachment;
+	if (depthResolve != nullptr && depthResolve->idx != VK_ATTACHMENT_UNUSED) {
+		if (GetAttachmentSamples(info.depthAttachment) <= VK_SAMPLE_COUNT_1_BIT || GetAttachmentSamples(depthResolve) != VK_SAMPLE_COUNT_1_BIT)
+			throw gcnew System::ArgumentException("Subpass " + i + " must resolve a multisampled depth attachment into a single sampled one.");
+		auto depthModes = GraphicsDevice::GetDepthResolveModes();
+		auto stencilModes = GraphicsDevice::GetStencilResolveModes();
+		if ((static_cast<uint32_t>(info.depthResolveMode) & ~depthModes) != 0 || (static_cast<uint32_t>(info.stencilResolveMode) & ~stencilModes) != 0)
+			throw gcnew System::NotSupportedException("Device does not support the depth or stencil resolve mode of subpass " + i + ".");
+		if (info.depthResolveMode == ResolveMode::None && info.stencilResolveMode == ResolveMode::None)
+			throw gcnew System::ArgumentException("Subpass " + i + " has a depth resolve attachment but no resolve mode.");
+		//Formats with both aspects resolve them together unless the device allows otherwise
+		bool hasStencil = (ImageFormatConv::Aspect(attachments[depthResolve->idx].fmt) & VK_IMAGE_ASPECT_STENCIL_BIT) != 0;
+		if (hasStencil && info.depthResolveMode != info.stencilResolveMode && !GraphicsDevice::SupportsIndependentResolve()) {
+			bool oneNone = info.depthResolveMode == ResolveMode::None || info.stencilResolveMode == ResolveMode::None;
+			if (!oneNone || !GraphicsDevice::SupportsIndependentResolveNone())
+				throw gcnew System::NotSupportedException("Device can't resolve depth and stencil with different modes in subpass " + i + ".");
+		}
+		sub.depthResolve = ConvertRef(depthResolve, false);
+		sub.depthResolveMode = static_cast<uint32_t>(info.depthResolveMode);
+		sub.stencilResolveMode = static_cast<uint32_t>(info.stencilResolveMode);
+	}
+}
+
 void Kokoro::Graphics::RenderPass::Build()
 {
 	if (!locked) {
-		VkRenderPassCreateInfo rpassCreatInfo = {};
-		rpassCreatInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-
-		std::vector<VkAttachmentDescription> att(attachments->Count);
+		RenderPassBuilder builder;
 		for (int i = 0; i < attachments->Count; i++) {
-			att[i].flags = 0;
-			att[i].format = ImageFormatConv::Convert(attachments[i].fmt);
-			att[i].samples = VK_SAMPLE_COUNT_1_BIT;
-			att[i].loadOp = LoadOpConv::Convert(attachments[i].load);
-			att[i].storeOp = StoreOpConv::Convert(attachments[i].store);
-			att[i].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-			att[i].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-			att[i].initialLayout = ImageLayoutConv::Convert(attachments[i].initLayout);
-			att[i].finalLayout = ImageLayoutConv::Convert(attachments[i].finLayout);
+			VkAttachmentDescription2KHR att = {};
+			att.sType = VK_STRUCTURE_TYPE_ATTACHMENT_DESCRIPTION_2_KHR;
+			att.flags = 0;
+			att.format = ImageFormatConv::Convert(attachments[i].fmt);
+			att.samples = SampleCountConv::Convert(attachments[i].samples);
+			att.loadOp = LoadOpConv::Convert(attachments[i].load);
+			att.storeOp = StoreOpConv::Convert(attachments[i].store);
+			att.stencilLoadOp = LoadOpConv::Convert(attachments[i].stencilLoad);
+			att.stencilStoreOp = StoreOpConv::Convert(attachments[i].stencilStore);
+			att.initialLayout = ImageLayoutConv::Convert(attachments[i].initLayout);
+			att.finalLayout = ImageLayoutConv::Convert(attachments[i].finLayout);
+			if (att.samples == 0)
+				throw gcnew System::ArgumentException("Attachment " + i + " has an invalid sample count.");
+			builder.AddAttachment(att);
 		}
-		rpassCreatInfo.attachmentCount = static_cast<uint32_t>(attachments->Count);
-		rpassCreatInfo.pAttachments = att.data();
 
-		std::vector<VkSubpassDescription> sbpass(subpasses->Count);
+		//Multiview has to be used by every subpass or none of them
+		uint32_t multiviewCnt = 0;
 		for (int i = 0; i < subpasses->Count; i++) {
+			FillSubpass(builder, i);
 
+			uint32_t viewMask = subpasses[i].viewMask;
+			if (viewMask == 0)
+				continue;
+			multiviewCnt++;
+			uint32_t highest = 0;
+			for (uint32_t m = viewMask; m != 0; m >>= 1)
+				highest++;
+			if (highest > GraphicsDevice::GetMaxMultiviewViewCount())
+				throw gcnew System::NotSupportedException("Subpass " + i + " renders more views than the device supports.");
+			if ((subpasses[i].correlationMask & ~viewMask) != 0)
+				throw gcnew System::ArgumentException("Subpass " + i + " correlates views it doesn't render.");
+			if (subpasses[i].correlationMask != 0)
+				builder.AddCorrelationMask(subpasses[i].correlationMask);
 		}
-		rpassCreatInfo.subpassCount = static_cast<uint32_t>(subpasses->Count);
-		rpassCreatInfo.pSubpasses = sbpass.data();
+		if (multiviewCnt != 0 && multiviewCnt != static_cast<uint32_t>(subpasses->Count))
+			throw gcnew System::ArgumentException("Either every subpass or none of them may use multiview.");
+		if (multiviewCnt != 0 && !GraphicsDevice::GetMultiviewFeatures().multiview)
+			throw gcnew System::NotSupportedException("Device does not support multiview.");
 
-		std::vector<VkSubpassDependency> sbpassDep(subpassDeps->Count);
+		uint32_t subpassCnt = static_cast<uint32_t>(subpasses->Count);
 		for (int i = 0; i < subpassDeps->Count; i++) {
+			auto d = subpassDeps[i];
+			if ((d.src >= subpassCnt && d.src != VK_SUBPASS_EXTERNAL) || (d.dst >= subpassCnt && d.dst != VK_SUBPASS_EXTERNAL))
+				throw gcnew System::ArgumentOutOfRangeException("subpassDeps", "Dependency " + i + " references a subpass out of range.");
+			if (d.src == VK_SUBPASS_EXTERNAL && d.dst == VK_SUBPASS_EXTERNAL)
+				throw gcnew System::ArgumentException("Dependency " + i + " can't be external on both ends.");
+			if (d.src != VK_SUBPASS_EXTERNAL && d.dst != VK_SUBPASS_EXTERNAL && d.src > d.dst)
+				throw gcnew System::ArgumentException("Dependency " + i + " points to an earlier subpass.");
+			if (d.srcStage == PipelineStage::None || d.dstStage == PipelineStage::None)
+				throw gcnew System::ArgumentException("Dependency " + i + " has an empty stage mask.");
+			if ((d.depFlags & DependencyFlag::ViewLocal) != DependencyFlag::None && (d.src == VK_SUBPASS_EXTERNAL || d.dst == VK_SUBPASS_EXTERNAL || multiviewCnt == 0))
+				throw gcnew System::ArgumentException("Dependency " + i + " is view local outside of a multiview pass.");
 
+			VkSubpassDependency2KHR dep = {};
+			dep.sType = VK_STRUCTURE_TYPE_SUBPASS_DEPENDENCY_2_KHR;
+			dep.srcSubpass = d.src;
+			dep.dstSubpass = d.dst;
+			dep.srcStageMask = PipelineStageConv::Convert(d.srcStage);
+			dep.dstStageMask = PipelineStageConv::Convert(d.dstStage);
+			dep.srcAccessMask = AccessFlagConv::Convert(d.srcMask);
+			dep.dstAccessMask = AccessFlagConv::Convert(d.dstMask);
+			dep.dependencyFlags = DependencyFlagConv::Convert(d.depFlags);
+			builder.AddDependency(dep);
+		}
+		if (AutoDependencies) {
+			builder.GenerateDependencies();
+			builder.GeneratePreserves();
 		}
-		rpassCreatInfo.dependencyCount = static_cast<uint32_t>(subpassDeps->Count);
-		rpassCreatInfo.pDependencies = sbpassDep.data();
 
+		//Identical descriptions share one VkRenderPass through the device-wide cache
+		VkRenderPass newPass = VK_NULL_HANDLE;
+		auto result = GraphicsDevice::GetRenderPassCache()->Acquire(GraphicsDevice::GetDevice(), builder, &newPass);
+		if (result == VK_ERROR_EXTENSION_NOT_PRESENT)
+			throw gcnew System::NotSupportedException("Resolving depth in a render pass requires VK_KHR_depth_stencil_resolve.");
+		if (result != VK_SUCCESS)
+			throw gcnew System::Exception("Failed to create render pass.");
+		renderPass = newPass;
+		compatKey = new PipelineStateKey();
+		BuildCompatibilityKey(*compatKey);
 		locked = true;
 	}
 }
+
+VkRenderPass Kokoro::Graphics::RenderPass::GetRenderPass()
+{
+	return renderPass;
+}
+
+uint32_t Kokoro::Graphics::RenderPass::GetColorAttachmentCount(uint32_t subpass)
+{
+	if (subpass >= static_cast<uint32_t>(subpasses->Count))
+		throw gcnew System::IndexOutOfRangeException("subpass is out of range.");
+	auto colorAttachments = subpasses[subpass].colorAttachments;
+	return colorAttachments == nullptr ? 0 : static_cast<uint32_t>(colorAttachments->Length);
+}
+
+uint32_t Kokoro::Graphics::RenderPass::GetSubpassCount()
+{
+	return static_cast<uint32_t>(subpasses->Count);
+}
+
+uint32_t Kokoro::Graphics::RenderPass::GetViewMask(uint32_t subpass)
+{
+	if (subpass >= static_cast<uint32_t>(subpasses->Count))
+		throw gcnew System::IndexOutOfRangeException("subpass is out of range.");
+	return subpasses[subpass].viewMask;
+}
+
+VkImageLayout Kokoro::Graphics::RenderPass::GetInitialLayout(uint32_t attachment)
+{
+	if (attachment >= static_cast<uint32_t>(attachments->Count))
+		throw gcnew System::IndexOutOfRangeException("attachment is out of range.");
+	return ImageLayoutConv::Convert(attachments[attachment].initLayout);
+}
+
+VkImageLayout Kokoro::Graphics::RenderPass::GetFinalLayout(uint32_t attachment)
+{
+	if (attachment >= static_cast<uint32_t>(attachments->Count))
+		throw gcnew System::IndexOutOfRangeException("attachment is out of range.");
+	return ImageLayoutConv::Convert(attachments[attachment].finLayout);
+}
+
+VkSampleCountFlagBits Kokoro::Graphics::RenderPass::GetSampleCount(uint32_t subpass)
+{
+	if (subpass >= static_cast<uint32_t>(subpasses->Count))
+		throw gcnew System::IndexOutOfRangeException("subpass is out of range.");
+	auto info = subpasses[subpass];
+	uint32_t samples = GetAttachmentSamples(info.depthAttachment);
+	for (int j = 0; info.colorAttachments != nullptr && j < info.colorAttachments->Length; j++)
+		samples = std::max(samples, GetAttachmentSamples(info.colorAttachments[j]));
+	return samples == 0 ? VK_SAMPLE_COUNT_1_BIT : static_cast<VkSampleCountFlagBits>(samples);
+}
+
+uint32_t Kokoro::Graphics::RenderPass::GetEyeViewMask()
+{
+	return (1u << GraphicsDevice::EyeCount) - 1;
+}
+
+void Kokoro::Graphics::RenderPass::AppendAttachmentRef(PipelineStateKey& key, AttachmentRef^ ref)
+{
+	if (ref == nullptr || ref->idx == VK_ATTACHMENT_UNUSED)
+		key.Append((uint64_t)VK_ATTACHMENT_UNUSED);
+	else
+		key.Append((uint64_t)ImageFormatConv::Convert(attachments[ref->idx].fmt) << 8 | GetAttachmentSamples(ref));
+}
+
+void Kokoro::Graphics::RenderPass::AppendCompatibilityKey(PipelineStateKey& key)
+{
+	if (compatKey == nullptr)
+		throw gcnew System::InvalidOperationException("RenderPass must be built first.");
+	auto& data = compatKey->GetData();
+	key.Append(data.data(), data.size());
+}
+
+void Kokoro::Graphics::RenderPass::BuildCompatibilityKey(PipelineStateKey& key)
+{
+	//Compatible passes reference attachments of matching formats, load/store ops and layouts don't matter
+	key.Append((uint64_t)subpasses->Count);
+	for (int i = 0; i < subpasses->Count; i++) {
+		auto inputs = subpasses[i].inputAttachments;
+		auto colors = subpasses[i].colorAttachments;
+		key.Append((uint64_t)(inputs == nullptr ? 0 : inputs->Length));
+		for (int j = 0; inputs != nullptr && j < inputs->Length; j++)
+			AppendAttachmentRef(key, inputs[j]);
+		key.Append((uint64_t)(colors == nullptr ? 0 : colors->Length));
+		for (int j = 0; colors != nullptr && j < colors->Length; j++)
+			AppendAttachmentRef(key, colors[j]);
+		AppendAttachmentRef(key, subpasses[i].depthAttachment);
+		auto resolves = subpasses[i].resolveAttachments;
+		key.Append((uint64_t)(resolves == nullptr ? 0 : resolves->Length));
+		for (int j = 0; resolves != nullptr && j < resolves->Length; j++)
+			AppendAttachmentRef(key, resolves[j]);
+		AppendAttachmentRef(key, subpasses[i].depthResolveAttachment);
+		//Multiview passes are only compatible with ones rendering the same views
+		key.Append((uint64_t)subpasses[i].viewMask);
+	}
+}
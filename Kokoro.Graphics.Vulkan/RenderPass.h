@@ -1,6 +1,7 @@
 #pragma once
 #include "GraphicsDevice.h"
 #include "ImageFormat.h"
+#include "RenderPassBuilder.h"
 
 using namespace System::Collections::Generic;
 using namespace System::Runtime::InteropServices;
@@ -51,16 +52,104 @@ namespace Kokoro::Graphics {
 		}
 	};
 
+	//VkResolveModeFlagBitsKHR, resolving depth or stencil needs VK_KHR_depth_stencil_resolve
+	enum class ResolveMode {
+		None = 0,
+		SampleZero = 0x1,
+		Average = 0x2,
+		Min = 0x4,
+		Max = 0x8,
+	};
+
 	enum class PipelineStage {
+		None = 0,
+		TopOfPipe = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+		DrawIndirect = VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+		VertexInput = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+		VertexShader = VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+		TessellationControlShader = VK_PIPELINE_STAGE_TESSELLATION_CONTROL_SHADER_BIT,
+		TessellationEvaluationShader = VK_PIPELINE_STAGE_TESSELLATION_EVALUATION_SHADER_BIT,
+		GeometryShader = VK_PIPELINE_STAGE_GEOMETRY_SHADER_BIT,
+		FragmentShader = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+		EarlyFragmentTests = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
+		LateFragmentTests = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+		ColorAttachmentOutput = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+		ComputeShader = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		Transfer = VK_PIPELINE_STAGE_TRANSFER_BIT,
+		BottomOfPipe = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+		Host = VK_PIPELINE_STAGE_HOST_BIT,
+		AllGraphics = VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT,
+		AllCommands = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+	};
 
+	inline PipelineStage operator |(PipelineStage lhs, PipelineStage rhs)
+	{
+		return static_cast<PipelineStage>(static_cast<uint32_t>(lhs) | static_cast<uint32_t>(rhs));
+	}
+
+	class PipelineStageConv {
+	public:
+		static VkPipelineStageFlags Convert(PipelineStage s) {
+			return static_cast<VkPipelineStageFlags>(s);
+		}
 	};
 
 	enum class AccessFlag {
+		None = 0,
+		IndirectCommandRead = VK_ACCESS_INDIRECT_COMMAND_READ_BIT,
+		IndexRead = VK_ACCESS_INDEX_READ_BIT,
+		VertexAttributeRead = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT,
+		UniformRead = VK_ACCESS_UNIFORM_READ_BIT,
+		InputAttachmentRead = VK_ACCESS_INPUT_ATTACHMENT_READ_BIT,
+		ShaderRead = VK_ACCESS_SHADER_READ_BIT,
+		ShaderWrite = VK_ACCESS_SHADER_WRITE_BIT,
+		ColorAttachmentRead = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT,
+		ColorAttachmentWrite = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+		DepthStencilAttachmentRead = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT,
+		DepthStencilAttachmentWrite = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+		TransferRead = VK_ACCESS_TRANSFER_READ_BIT,
+		TransferWrite = VK_ACCESS_TRANSFER_WRITE_BIT,
+		HostRead = VK_ACCESS_HOST_READ_BIT,
+		HostWrite = VK_ACCESS_HOST_WRITE_BIT,
+		MemoryRead = VK_ACCESS_MEMORY_READ_BIT,
+		MemoryWrite = VK_ACCESS_MEMORY_WRITE_BIT,
+	};
 
+	inline AccessFlag operator |(AccessFlag lhs, AccessFlag rhs)
+	{
+		return static_cast<AccessFlag>(static_cast<uint32_t>(lhs) | static_cast<uint32_t>(rhs));
+	}
+
+	class AccessFlagConv {
+	public:
+		static VkAccessFlags Convert(AccessFlag a) {
+			return static_cast<VkAccessFlags>(a);
+		}
 	};
 
 	enum class DependencyFlag {
+		None = 0,
+		//Each pixel only depends on the same pixel of the source subpass, lets tilers keep attachments on chip
+		ByRegion = VK_DEPENDENCY_BY_REGION_BIT,
+		//Each view only depends on the same view of the source subpass
+		ViewLocal = VK_DEPENDENCY_VIEW_LOCAL_BIT,
+		DeviceGroup = VK_DEPENDENCY_DEVICE_GROUP_BIT,
+	};
+
+	inline DependencyFlag operator |(DependencyFlag lhs, DependencyFlag rhs)
+	{
+		return static_cast<DependencyFlag>(static_cast<uint32_t>(lhs) | static_cast<uint32_t>(rhs));
+	}
+	inline DependencyFlag operator &(DependencyFlag lhs, DependencyFlag rhs)
+	{
+		return static_cast<DependencyFlag>(static_cast<uint32_t>(lhs) & static_cast<uint32_t>(rhs));
+	}
 
+	class DependencyFlagConv {
+	public:
+		static VkDependencyFlags Convert(DependencyFlag d) {
+			return static_cast<VkDependencyFlags>(d);
+		}
 	};
 
 	ref class RenderPass
@@ -70,9 +159,14 @@ namespace Kokoro::Graphics {
 		public:
 			StoreOp store;
 			LoadOp load;
+			//Only used by formats with a stencil aspect
+			StoreOp stencilStore;
+			LoadOp stencilLoad;
 			ImageFormat fmt;
 			ImageLayout initLayout;
 			ImageLayout finLayout;
+			//0 is single sampled, must match the Samples of the images bound to the attachment
+			uint32_t samples;
 		};
 
 		[StructLayout(LayoutKind::Sequential)]
@@ -88,8 +182,20 @@ namespace Kokoro::Graphics {
 			array<AttachmentRef^>^ colorAttachments;
 			array<uint32_t>^ preserveAttachments;
 			AttachmentRef^ depthAttachment;
+			//Single sampled targets the multisampled color attachments are resolved into at the end of the subpass,
+			//one per color attachment with idx VK_ATTACHMENT_UNUSED for those that aren't resolved.
+			array<AttachmentRef^>^ resolveAttachments;
+			AttachmentRef^ depthResolveAttachment;
+			ResolveMode depthResolveMode;
+			ResolveMode stencilResolveMode;
+			//Views the subpass renders with multiview, bit i is layer i of every attachment. 0 disables multiview,
+			//which then has to be the case for every subpass of the pass.
+			uint32_t viewMask;
+			//Views likely to be rendered with similar geometry, letting the implementation share work between them.
+			uint32_t correlationMask;
 		};
 
+		//src and dst may be VK_SUBPASS_EXTERNAL for work outside the pass
 		value struct SubpassDep{
 		public:
 			uint32_t src;
@@ -102,11 +208,38 @@ namespace Kokoro::Graphics {
 		};
 
 	private:
+		void AppendAttachmentRef(PipelineStateKey& key, AttachmentRef^ ref);
+		void BuildCompatibilityKey(PipelineStateKey& key);
+		VkAttachmentReference2KHR ConvertRef(AttachmentRef^ ref, bool input);
+		uint32_t GetAttachmentSamples(AttachmentRef^ ref);
+		void FillSubpass(RenderPassBuilder& builder, int i);
+
 		List<AttachmentInfo>^ attachments;
 		List<SubpassInfo>^ subpasses;
 		List<SubpassDep>^ subpassDeps;
+		VkRenderPass renderPass;
+		PipelineStateKey* compatKey;
 		bool locked;
+	internal:
+		VkRenderPass GetRenderPass();
+		uint32_t GetColorAttachmentCount(uint32_t subpass);
+		uint32_t GetSubpassCount();
+		uint32_t GetViewMask(uint32_t subpass);
+		//Layout the pass expects the attachment in when it begins, UNDEFINED if it discards the contents.
+		VkImageLayout GetInitialLayout(uint32_t attachment);
+		//Layout the attachment is left in once the pass ends.
+		VkImageLayout GetFinalLayout(uint32_t attachment);
+		//Shared by every color and depth attachment of the subpass, what pipelines rasterize with.
+		VkSampleCountFlagBits GetSampleCount(uint32_t subpass);
+		//Encodes only what render pass compatibility depends on, so pipelines can be shared across compatible passes.
+		//Computed once when the pass is built.
+		void AppendCompatibilityKey(PipelineStateKey& key);
 	public:
+		//Derive the dependencies and preserve attachments the attachment references imply, on top of the ones added
+		//explicitly. Lets a deferred renderer merge its G-buffer fill and lighting passes into subpasses reading the
+		//G-buffer through input attachments, which tilers then never write out to memory. Defaults to true.
+		property bool AutoDependencies;
+
 		RenderPass();
 		~RenderPass();
 
@@ -114,6 +247,9 @@ namespace Kokoro::Graphics {
 		void AddSubpassDep(SubpassDep dep);
 		void AddAttachment(AttachmentInfo att);
 		void Build();
+
+		//View mask covering GraphicsDevice::EyeCount views, for passes rendering every eye at once.
+		static uint32_t GetEyeViewMask();
 	};
 }
 
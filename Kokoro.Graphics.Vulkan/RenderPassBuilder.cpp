@@ -0,0 +1,442 @@
+#include "RenderPassBuilder.h"
+#include "BarrierBatch.h"
+#include <algorithm>
+
+namespace {
+	const VkPipelineStageFlags DepthStages = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+	const VkPipelineStageFlags GraphicsShaderStages = VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_TESSELLATION_CONTROL_SHADER_BIT |
+		VK_PIPELINE_STAGE_TESSELLATION_EVALUATION_SHADER_BIT | VK_PIPELINE_STAGE_GEOMETRY_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+	const VkAccessFlags WriteAccess = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+	bool IsReadOnlyDepth(VkImageLayout l) {
+		return l == VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL || l == VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL_KHR;
+	}
+
+	//Whatever is expected to touch an attachment after the pass leaves it in layout
+	void GetFinalUse(VkImageLayout layout, VkPipelineStageFlags* stages, VkAccessFlags* access) {
+		switch (layout) {
+		case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
+			*stages = GraphicsShaderStages | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+			*access = VK_ACCESS_SHADER_READ_BIT;
+			break;
+		case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:
+			*stages = VK_PIPELINE_STAGE_TRANSFER_BIT;
+			*access = VK_ACCESS_TRANSFER_READ_BIT;
+			break;
+		case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:
+			*stages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+			*access = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+			break;
+		case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL:
+		case VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL_KHR:
+			*stages = DepthStages;
+			*access = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+			break;
+		case VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL:
+		case VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL_KHR:
+			*stages = DepthStages | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+			*access = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+			break;
+		case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR:
+			//Ordered by the present semaphore
+			*stages = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+			*access = 0;
+			break;
+		default:
+			*stages = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+			*access = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+			break;
+		}
+	}
+
+	//Whatever may have touched an attachment before the pass while it was in layout, only its writes need making visible
+	void GetInitialUse(VkImageLayout layout, VkPipelineStageFlags* stages, VkAccessFlags* access) {
+		GetFinalUse(layout, stages, access);
+		//Undefined contents are never read, earlier accesses only have to finish
+		*access = layout == VK_IMAGE_LAYOUT_UNDEFINED ? 0 : Kokoro::Graphics::ResourceUseConv::Writes(*access);
+	}
+
+	VkSubpassDependency2KHR MakeDependency(uint32_t src, uint32_t dst, VkPipelineStageFlags srcStages, VkAccessFlags srcAccess, VkPipelineStageFlags dstStages, VkAccessFlags dstAccess, VkDependencyFlags flags) {
+		VkSubpassDependency2KHR d = {};
+		d.sType = VK_STRUCTURE_TYPE_SUBPASS_DEPENDENCY_2_KHR;
+		d.srcSubpass = src;
+		d.dstSubpass = dst;
+		d.srcStageMask = Kokoro::Graphics::ResourceUseConv::SupportedStages(srcStages);
+		d.srcAccessMask = srcAccess;
+		d.dstStageMask = Kokoro::Graphics::ResourceUseConv::SupportedStages(dstStages);
+		d.dstAccessMask = dstAccess;
+		d.dependencyFlags = flags;
+		return d;
+	}
+}
+
+VkAttachmentReference2KHR Kokoro::Graphics::RenderPassBuilder::Ref(uint32_t idx, VkImageLayout layout, VkImageAspectFlags aspect) {
+	VkAttachmentReference2KHR r = {};
+	r.sType = VK_STRUCTURE_TYPE_ATTACHMENT_REFERENCE_2_KHR;
+	r.attachment = idx;
+	r.layout = idx == VK_ATTACHMENT_UNUSED ? VK_IMAGE_LAYOUT_UNDEFINED : layout;
+	r.aspectMask = aspect;
+	return r;
+}
+
+VkAttachmentReference2KHR Kokoro::Graphics::RenderPassBuilder::Unused() {
+	return Ref(VK_ATTACHMENT_UNUSED, VK_IMAGE_LAYOUT_UNDEFINED, 0);
+}
+
+void Kokoro::Graphics::RenderPassBuilder::AddAttachment(const VkAttachmentDescription2KHR& att) {
+	attachments.push_back(att);
+}
+
+Kokoro::Graphics::RenderPassBuilder::Subpass& Kokoro::Graphics::RenderPassBuilder::AddSubpass() {
+	Subpass s;
+	s.depth = Unused();
+	s.depthResolve = Unused();
+	s.depthResolveMode = 0;
+	s.stencilResolveMode = 0;
+	s.viewMask = 0;
+	subpasses.push_back(s);
+	return subpasses.back();
+}
+
+void Kokoro::Graphics::RenderPassBuilder::AddDependency(const VkSubpassDependency2KHR& dep) {
+	for (auto& d : dependencies)
+		if (d.srcSubpass == dep.srcSubpass && d.dstSubpass == dep.dstSubpass && d.dependencyFlags == dep.dependencyFlags && d.viewOffset == dep.viewOffset) {
+			d.srcStageMask |= dep.srcStageMask;
+			d.srcAccessMask |= dep.srcAccessMask;
+			d.dstStageMask |= dep.dstStageMask;
+			d.dstAccessMask |= dep.dstAccessMask;
+			return;
+		}
+	dependencies.push_back(dep);
+}
+
+void Kokoro::Graphics::RenderPassBuilder::AddCorrelationMask(uint32_t mask) {
+	correlationMasks.push_back(mask);
+}
+
+Kokoro::Graphics::RenderPassBuilder::AttachmentUse Kokoro::Graphics::RenderPassBuilder::GetUse(uint32_t i, uint32_t a) {
+	auto& s = subpasses[i];
+	AttachmentUse u = {};
+	u.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+	for (auto& r : s.inputs)
+		if (r.attachment == a) {
+			u.stages |= VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+			u.access |= VK_ACCESS_INPUT_ATTACHMENT_READ_BIT;
+			u.layout = r.layout;
+		}
+	for (auto& r : s.colors)
+		if (r.attachment == a) {
+			u.stages |= VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+			u.access |= VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+			u.layout = r.layout;
+		}
+	//Resolves, depth ones included, are color attachment writes at the end of the subpass
+	for (auto& r : s.resolves)
+		if (r.attachment == a) {
+			u.stages |= VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+			u.access |= VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+			u.layout = r.layout;
+		}
+	if (s.depthResolve.attachment == a) {
+		u.stages |= VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		u.access |= VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		u.layout = s.depthResolve.layout;
+	}
+	if (s.depth.attachment == a) {
+		u.stages |= DepthStages;
+		u.access |= VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+		if (!IsReadOnlyDepth(s.depth.layout))
+			u.access |= VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		u.layout = s.depth.layout;
+	}
+	return u;
+}
+
+bool Kokoro::Graphics::RenderPassBuilder::IsReferenced(uint32_t i, uint32_t a) {
+	if (GetUse(i, a).stages != 0)
+		return true;
+	auto& p = subpasses[i].preserves;
+	return std::find(p.begin(), p.end(), a) != p.end();
+}
+
+void Kokoro::Graphics::RenderPassBuilder::GenerateDependencies() {
+	for (uint32_t a = 0; a < static_cast<uint32_t>(attachments.size()); a++) {
+		//Last subpass to write the attachment and the subpasses reading it since
+		uint32_t writer = VK_SUBPASS_EXTERNAL;
+		AttachmentUse written = {};
+		std::vector<std::pair<uint32_t, AttachmentUse>> readers;
+		VkImageLayout layout = attachments[a].initialLayout;
+		uint32_t last = VK_SUBPASS_EXTERNAL;
+
+		for (uint32_t i = 0; i < static_cast<uint32_t>(subpasses.size()); i++) {
+			auto u = GetUse(i, a);
+			if (u.stages == 0)
+				continue;
+			bool writes = (u.access & WriteAccess) != 0;
+
+			if (last == VK_SUBPASS_EXTERNAL) {
+				//Waits on whatever left the attachment in its initial layout, the implicit dependency waits on nothing
+				VkPipelineStageFlags srcStages;
+				VkAccessFlags srcAccess;
+				GetInitialUse(attachments[a].initialLayout, &srcStages, &srcAccess);
+				//Presentation is ordered by the acquire semaphore, which waits at the stage of the first use
+				if (srcStages == VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT)
+					srcStages = u.stages;
+				AddDependency(MakeDependency(VK_SUBPASS_EXTERNAL, i, srcStages, srcAccess, u.stages, u.access, 0));
+			}
+			else {
+				//Attachment data only flows between the same pixel, and with multiview the same view
+				VkDependencyFlags flags = VK_DEPENDENCY_BY_REGION_BIT;
+				if (subpasses[i].viewMask != 0)
+					flags |= VK_DEPENDENCY_VIEW_LOCAL_BIT;
+				if (writer != VK_SUBPASS_EXTERNAL && writer != i)
+					AddDependency(MakeDependency(writer, i, written.stages, written.access & WriteAccess, u.stages, u.access, flags));
+				//Writes and layout transitions have to wait for earlier reads to finish
+				if (writes || u.layout != layout)
+					for (auto& r : readers)
+						if (r.first != i)
+							AddDependency(MakeDependency(r.first, i, r.second.stages, 0, u.stages, u.access, flags));
+			}
+
+			if (writes) {
+				writer = i;
+				written = u;
+				readers.clear();
+			}
+			else
+				readers.push_back({ i, u });
+			layout = u.layout;
+			last = i;
+		}
+
+		if (last == VK_SUBPASS_EXTERNAL)
+			continue;
+		//The store and final layout transition happen after the last use, whatever comes next waits on them
+		VkPipelineStageFlags dstStages;
+		VkAccessFlags dstAccess;
+		GetFinalUse(attachments[a].finalLayout, &dstStages, &dstAccess);
+		VkPipelineStageFlags srcStages = 0;
+		VkAccessFlags srcAccess = 0;
+		if (writer != VK_SUBPASS_EXTERNAL) {
+			srcStages |= written.stages;
+			srcAccess |= written.access & WriteAccess;
+		}
+		for (auto& r : readers)
+			srcStages |= r.second.stages;
+		AddDependency(MakeDependency(last, VK_SUBPASS_EXTERNAL, srcStages, srcAccess, dstStages, dstAccess, 0));
+	}
+}
+
+void Kokoro::Graphics::RenderPassBuilder::GeneratePreserves() {
+	for (uint32_t a = 0; a < static_cast<uint32_t>(attachments.size()); a++) {
+		uint32_t first = VK_SUBPASS_EXTERNAL;
+		uint32_t last = VK_SUBPASS_EXTERNAL;
+		for (uint32_t i = 0; i < static_cast<uint32_t>(subpasses.size()); i++)
+			if (GetUse(i, a).stages != 0) {
+				if (first == VK_SUBPASS_EXTERNAL)
+					first = i;
+				last = i;
+			}
+		if (first == VK_SUBPASS_EXTERNAL)
+			continue;
+		for (uint32_t i = first + 1; i < last; i++)
+			if (!IsReferenced(i, a))
+				subpasses[i].preserves.push_back(a);
+	}
+}
+
+bool Kokoro::Graphics::RenderPassBuilder::RequiresRenderPass2() {
+	for (auto& s : subpasses)
+		if (s.depthResolve.attachment != VK_ATTACHMENT_UNUSED)
+			return true;
+	return false;
+}
+
+void Kokoro::Graphics::RenderPassBuilder::AppendKey(PipelineStateKey& key) {
+	auto appendRef = [&key](const VkAttachmentReference2KHR& r) {
+		key.Append((uint64_t)r.attachment << 32 | r.layout);
+		key.Append((uint64_t)r.aspectMask);
+	};
+	auto appendRefs = [&key, &appendRef](const std::vector<VkAttachmentReference2KHR>& refs) {
+		key.Append((uint64_t)refs.size());
+		for (auto& r : refs)
+			appendRef(r);
+	};
+
+	key.Append((uint64_t)attachments.size());
+	for (auto& a : attachments) {
+		key.Append((uint64_t)a.flags << 32 | a.format);
+		key.Append((uint64_t)a.samples << 32 | a.loadOp << 16 | a.storeOp);
+		key.Append((uint64_t)a.stencilLoadOp << 32 | a.stencilStoreOp);
+		key.Append((uint64_t)a.initialLayout << 32 | a.finalLayout);
+	}
+	key.Append((uint64_t)subpasses.size());
+	for (auto& s : subpasses) {
+		appendRefs(s.inputs);
+		appendRefs(s.colors);
+		appendRefs(s.resolves);
+		key.Append((uint64_t)s.preserves.size());
+		for (auto p : s.preserves)
+			key.Append((uint64_t)p);
+		appendRef(s.depth);
+		appendRef(s.depthResolve);
+		key.Append((uint64_t)s.depthResolveMode << 32 | s.stencilResolveMode);
+		key.Append((uint64_t)s.viewMask);
+	}
+	key.Append((uint64_t)dependencies.size());
+	for (auto& d : dependencies) {
+		key.Append((uint64_t)d.srcSubpass << 32 | d.dstSubpass);
+		key.Append((uint64_t)d.srcStageMask << 32 | d.dstStageMask);
+		key.Append((uint64_t)d.srcAccessMask << 32 | d.dstAccessMask);
+		key.Append((uint64_t)d.dependencyFlags << 32 | static_cast<uint32_t>(d.viewOffset));
+	}
+	key.Append((uint64_t)correlationMasks.size());
+	for (auto m : correlationMasks)
+		key.Append((uint64_t)m);
+}
+
+VkResult Kokoro::Graphics::RenderPassBuilder::Create(VkDevice dev, VkRenderPass* pass) {
+	if (RequiresRenderPass2())
+		return CreateV2(dev, pass);
+	return CreateV1(dev, pass);
+}
+
+VkResult Kokoro::Graphics::RenderPassBuilder::CreateV1(VkDevice dev, VkRenderPass* pass) {
+	std::vector<VkAttachmentDescription> att(attachments.size());
+	for (size_t i = 0; i < attachments.size(); i++) {
+		auto& a = attachments[i];
+		att[i].flags = a.flags;
+		att[i].format = a.format;
+		att[i].samples = a.samples;
+		att[i].loadOp = a.loadOp;
+		att[i].storeOp = a.storeOp;
+		att[i].stencilLoadOp = a.stencilLoadOp;
+		att[i].stencilStoreOp = a.stencilStoreOp;
+		att[i].initialLayout = a.initialLayout;
+		att[i].finalLayout = a.finalLayout;
+	}
+
+	//References of every subpass are laid out back to back, sized up front so the pointers stay put
+	size_t refCnt = 0;
+	for (auto& s : subpasses)
+		refCnt += s.inputs.size() + s.colors.size() + s.resolves.size() + 1;
+	std::vector<VkAttachmentReference> refs;
+	refs.reserve(refCnt);
+	auto convert = [&refs](const std::vector<VkAttachmentReference2KHR>& src) -> const VkAttachmentReference* {
+		if (src.empty())
+			return nullptr;
+		size_t base = refs.size();
+		for (auto& r : src)
+			refs.push_back({ r.attachment, r.layout });
+		return &refs[base];
+	};
+
+	std::vector<VkSubpassDescription> sbpass(subpasses.size());
+	std::vector<uint32_t> viewMasks(subpasses.size());
+	bool multiview = false;
+	for (size_t i = 0; i < subpasses.size(); i++) {
+		auto& s = subpasses[i];
+		sbpass[i].flags = 0;
+		sbpass[i].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		sbpass[i].inputAttachmentCount = static_cast<uint32_t>(s.inputs.size());
+		sbpass[i].pInputAttachments = convert(s.inputs);
+		sbpass[i].colorAttachmentCount = static_cast<uint32_t>(s.colors.size());
+		sbpass[i].pColorAttachments = convert(s.colors);
+		sbpass[i].pResolveAttachments = convert(s.resolves);
+		sbpass[i].pDepthStencilAttachment = nullptr;
+		if (s.depth.attachment != VK_ATTACHMENT_UNUSED) {
+			refs.push_back({ s.depth.attachment, s.depth.layout });
+			sbpass[i].pDepthStencilAttachment = &refs.back();
+		}
+		sbpass[i].preserveAttachmentCount = static_cast<uint32_t>(s.preserves.size());
+		sbpass[i].pPreserveAttachments = s.preserves.empty() ? nullptr : s.preserves.data();
+		viewMasks[i] = s.viewMask;
+		multiview |= s.viewMask != 0;
+	}
+
+	std::vector<VkSubpassDependency> deps(dependencies.size());
+	std::vector<int32_t> viewOffsets(dependencies.size());
+	for (size_t i = 0; i < dependencies.size(); i++) {
+		auto& d = dependencies[i];
+		deps[i].srcSubpass = d.srcSubpass;
+		deps[i].dstSubpass = d.dstSubpass;
+		deps[i].srcStageMask = d.srcStageMask;
+		deps[i].dstStageMask = d.dstStageMask;
+		deps[i].srcAccessMask = d.srcAccessMask;
+		deps[i].dstAccessMask = d.dstAccessMask;
+		deps[i].dependencyFlags = d.dependencyFlags;
+		viewOffsets[i] = d.viewOffset;
+	}
+
+	VkRenderPassCreateInfo rpassCreatInfo = {};
+	rpassCreatInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+	rpassCreatInfo.attachmentCount = static_cast<uint32_t>(att.size());
+	rpassCreatInfo.pAttachments = att.data();
+	rpassCreatInfo.subpassCount = static_cast<uint32_t>(sbpass.size());
+	rpassCreatInfo.pSubpasses = sbpass.data();
+	rpassCreatInfo.dependencyCount = static_cast<uint32_t>(deps.size());
+	rpassCreatInfo.pDependencies = deps.data();
+
+	//The 1.1 path carries multiview state in a separate structure
+	VkRenderPassMultiviewCreateInfo multiviewCreatInfo = {};
+	multiviewCreatInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_MULTIVIEW_CREATE_INFO;
+	multiviewCreatInfo.subpassCount = static_cast<uint32_t>(viewMasks.size());
+	multiviewCreatInfo.pViewMasks = viewMasks.data();
+	multiviewCreatInfo.dependencyCount = static_cast<uint32_t>(viewOffsets.size());
+	multiviewCreatInfo.pViewOffsets = viewOffsets.data();
+	multiviewCreatInfo.correlationMaskCount = static_cast<uint32_t>(correlationMasks.size());
+	multiviewCreatInfo.pCorrelationMasks = correlationMasks.data();
+	if (multiview)
+		rpassCreatInfo.pNext = &multiviewCreatInfo;
+
+	return vkCreateRenderPass(dev, &rpassCreatInfo, nullptr, pass);
+}
+
+VkResult Kokoro::Graphics::RenderPassBuilder::CreateV2(VkDevice dev, VkRenderPass* pass) {
+#ifdef VK_KHR_depth_stencil_resolve
+	auto createRenderPass2 = (PFN_vkCreateRenderPass2KHR)vkGetDeviceProcAddr(dev, "vkCreateRenderPass2KHR");
+	if (createRenderPass2 == nullptr)
+		return VK_ERROR_EXTENSION_NOT_PRESENT;
+
+	std::vector<VkSubpassDescriptionDepthStencilResolveKHR> resolves(subpasses.size());
+	std::vector<VkSubpassDescription2KHR> sbpass(subpasses.size());
+	for (size_t i = 0; i < subpasses.size(); i++) {
+		auto& s = subpasses[i];
+		sbpass[i] = {};
+		sbpass[i].sType = VK_STRUCTURE_TYPE_SUBPASS_DESCRIPTION_2_KHR;
+		sbpass[i].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		sbpass[i].viewMask = s.viewMask;
+		sbpass[i].inputAttachmentCount = static_cast<uint32_t>(s.inputs.size());
+		sbpass[i].pInputAttachments = s.inputs.empty() ? nullptr : s.inputs.data();
+		sbpass[i].colorAttachmentCount = static_cast<uint32_t>(s.colors.size());
+		sbpass[i].pColorAttachments = s.colors.empty() ? nullptr : s.colors.data();
+		sbpass[i].pResolveAttachments = s.resolves.empty() ? nullptr : s.resolves.data();
+		sbpass[i].pDepthStencilAttachment = s.depth.attachment == VK_ATTACHMENT_UNUSED ? nullptr : &s.depth;
+		sbpass[i].preserveAttachmentCount = static_cast<uint32_t>(s.preserves.size());
+		sbpass[i].pPreserveAttachments = s.preserves.empty() ? nullptr : s.preserves.data();
+
+		if (s.depthResolve.attachment != VK_ATTACHMENT_UNUSED) {
+			resolves[i] = {};
+			resolves[i].sType = VK_STRUCTURE_TYPE_SUBPASS_DESCRIPTION_DEPTH_STENCIL_RESOLVE_KHR;
+			resolves[i].depthResolveMode = static_cast<VkResolveModeFlagBitsKHR>(s.depthResolveMode);
+			resolves[i].stencilResolveMode = static_cast<VkResolveModeFlagBitsKHR>(s.stencilResolveMode);
+			resolves[i].pDepthStencilResolveAttachment = &s.depthResolve;
+			sbpass[i].pNext = &resolves[i];
+		}
+	}
+
+	VkRenderPassCreateInfo2KHR rpassCreatInfo = {};
+	rpassCreatInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO_2_KHR;
+	rpassCreatInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+	rpassCreatInfo.pAttachments = attachments.data();
+	rpassCreatInfo.subpassCount = static_cast<uint32_t>(sbpass.size());
+	rpassCreatInfo.pSubpasses = sbpass.data();
+	rpassCreatInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+	rpassCreatInfo.pDependencies = dependencies.data();
+	rpassCreatInfo.correlatedViewMaskCount = static_cast<uint32_t>(correlationMasks.size());
+	rpassCreatInfo.pCorrelatedViewMasks = correlationMasks.data();
+	return createRenderPass2(dev, &rpassCreatInfo, nullptr, pass);
+#else
+	return VK_ERROR_EXTENSION_NOT_PRESENT;
+#endif
+}
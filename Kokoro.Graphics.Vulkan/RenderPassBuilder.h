@@ -0,0 +1,68 @@
+#pragma once
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#define VK_USE_PLATFORM_WIN32_KHR
+#endif
+#include "vulkan/vulkan.h"
+#include "PipelineStateCache.h"
+#include <vector>
+
+namespace Kokoro::Graphics {
+	//Collects a render pass in its VK_KHR_create_renderpass2 form and creates it with vkCreateRenderPass when nothing
+	//needs the newer entry point, which only depth and stencil resolve do.
+	class RenderPassBuilder
+	{
+	public:
+		struct Subpass {
+			std::vector<VkAttachmentReference2KHR> inputs;
+			std::vector<VkAttachmentReference2KHR> colors;
+			//Empty, or one per color attachment
+			std::vector<VkAttachmentReference2KHR> resolves;
+			std::vector<uint32_t> preserves;
+			VkAttachmentReference2KHR depth;
+			VkAttachmentReference2KHR depthResolve;
+			//VkResolveModeFlagBitsKHR, 0 leaves the aspect unresolved
+			uint32_t depthResolveMode;
+			uint32_t stencilResolveMode;
+			uint32_t viewMask;
+		};
+	private:
+		std::vector<VkAttachmentDescription2KHR> attachments;
+		std::vector<Subpass> subpasses;
+		std::vector<VkSubpassDependency2KHR> dependencies;
+		std::vector<uint32_t> correlationMasks;
+
+		struct AttachmentUse {
+			VkPipelineStageFlags stages;
+			VkAccessFlags access;
+			VkImageLayout layout;
+		};
+		//What subpass i does with attachment a, stages is 0 if it isn't referenced
+		AttachmentUse GetUse(uint32_t i, uint32_t a);
+		bool IsReferenced(uint32_t i, uint32_t a);
+
+		VkResult CreateV1(VkDevice dev, VkRenderPass* pass);
+		VkResult CreateV2(VkDevice dev, VkRenderPass* pass);
+	public:
+		static VkAttachmentReference2KHR Ref(uint32_t idx, VkImageLayout layout, VkImageAspectFlags aspect);
+		static VkAttachmentReference2KHR Unused();
+
+		void AddAttachment(const VkAttachmentDescription2KHR& att);
+		//Starts out with no depth attachment and no resolves, the reference is valid until the next AddSubpass.
+		Subpass& AddSubpass();
+		//Dependencies between the same subpasses with the same flags are folded into one.
+		void AddDependency(const VkSubpassDependency2KHR& dep);
+		void AddCorrelationMask(uint32_t mask);
+		//Adds the dependencies attachment reuse needs: between every writer and the later subpasses touching the
+		//attachment, and from/to VK_SUBPASS_EXTERNAL around its first and last use. Call once every subpass is added.
+		void GenerateDependencies();
+		//Preserves every attachment across the subpasses between its first and last use that don't reference it.
+		void GeneratePreserves();
+		bool RequiresRenderPass2();
+		//Everything the created pass depends on, identical keys create identical passes.
+		void AppendKey(PipelineStateKey& key);
+		//VK_ERROR_EXTENSION_NOT_PRESENT when the pass needs vkCreateRenderPass2KHR and the device lacks it.
+		VkResult Create(VkDevice dev, VkRenderPass* pass);
+	};
+}
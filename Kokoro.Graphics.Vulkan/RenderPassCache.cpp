@@ -0,0 +1,102 @@
+#include "RenderPassCache.h"
+#include <mutex>
+#include <unordered_map>
+
+namespace {
+	struct PassEntry {
+		VkRenderPass pass;
+		uint32_t refCount;
+	};
+
+	//Kept out of the header so the managed translation units never see <mutex>
+	struct CacheState {
+		std::mutex lock;
+		std::unordered_map<std::string, PassEntry> entries;
+		std::unordered_map<VkRenderPass, std::string> keys;
+		uint64_t hits;
+		uint64_t misses;
+	};
+}
+
+Kokoro::Graphics::RenderPassCache::RenderPassCache() {
+	auto s = new CacheState();
+	s->hits = 0;
+	s->misses = 0;
+	state = s;
+}
+
+Kokoro::Graphics::RenderPassCache::~RenderPassCache() {
+	delete static_cast<CacheState*>(state);
+}
+
+VkResult Kokoro::Graphics::RenderPassCache::Acquire(VkDevice dev, RenderPassBuilder& builder, VkRenderPass* pass) {
+	PipelineStateKey key;
+	builder.AppendKey(key);
+
+	auto s = static_cast<CacheState*>(state);
+	std::lock_guard<std::mutex> guard(s->lock);
+
+	auto it = s->entries.find(key.GetData());
+	if (it != s->entries.end()) {
+		s->hits++;
+		it->second.refCount++;
+		*pass = it->second.pass;
+		return VK_SUCCESS;
+	}
+
+	auto res = builder.Create(dev, pass);
+	if (res != VK_SUCCESS)
+		return res;
+	s->misses++;
+
+	PassEntry e;
+	e.pass = *pass;
+	e.refCount = 1;
+	s->entries.emplace(key.GetData(), e);
+	s->keys.emplace(*pass, key.GetData());
+	return VK_SUCCESS;
+}
+
+bool Kokoro::Graphics::RenderPassCache::Release(VkDevice dev, VkRenderPass pass) {
+	auto s = static_cast<CacheState*>(state);
+	std::lock_guard<std::mutex> guard(s->lock);
+
+	auto k = s->keys.find(pass);
+	if (k == s->keys.end())
+		return false;
+	auto it = s->entries.find(k->second);
+	if (--it->second.refCount != 0)
+		return false;
+	vkDestroyRenderPass(dev, pass, nullptr);
+	s->entries.erase(it);
+	s->keys.erase(k);
+	return true;
+}
+
+uint32_t Kokoro::Graphics::RenderPassCache::GetRenderPassCount() {
+	auto s = static_cast<CacheState*>(state);
+	std::lock_guard<std::mutex> guard(s->lock);
+	return static_cast<uint32_t>(s->entries.size());
+}
+
+uint64_t Kokoro::Graphics::RenderPassCache::GetHitCount() {
+	auto s = static_cast<CacheState*>(state);
+	std::lock_guard<std::mutex> guard(s->lock);
+	return s->hits;
+}
+
+uint64_t Kokoro::Graphics::RenderPassCache::GetMissCount() {
+	auto s = static_cast<CacheState*>(state);
+	std::lock_guard<std::mutex> guard(s->lock);
+	return s->misses;
+}
+
+void Kokoro::Graphics::RenderPassCache::Destroy(VkDevice dev) {
+	auto s = static_cast<CacheState*>(state);
+	std::lock_guard<std::mutex> guard(s->lock);
+
+	for (auto& e : s->entries)
+		vkDestroyRenderPass(dev, e.second.pass, nullptr);
+	s->entries.clear();
+	s->keys.clear();
+}
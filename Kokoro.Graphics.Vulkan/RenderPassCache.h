@@ -0,0 +1,32 @@
+#pragma once
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#define VK_USE_PLATFORM_WIN32_KHR
+#endif
+#include "vulkan/vulkan.h"
+#include "RenderPassBuilder.h"
+
+namespace Kokoro::Graphics {
+	//Device-wide map from a complete render pass description to a refcounted VkRenderPass, so passes rebuilt with the
+	//same description, like per swapchain or per frame ones, share a single object.
+	class RenderPassCache
+	{
+	private:
+		void* state;
+	public:
+		RenderPassCache();
+		~RenderPassCache();
+
+		//Returns an existing pass built from an identical description or creates one from builder, either way holding a new reference.
+		VkResult Acquire(VkDevice dev, RenderPassBuilder& builder, VkRenderPass* pass);
+		//The pass is destroyed with its last reference, returns true if it was. Go through GraphicsDevice::DeferDestroy
+		//unless no submitted command buffer can still use it.
+		bool Release(VkDevice dev, VkRenderPass pass);
+
+		uint32_t GetRenderPassCount();
+		uint64_t GetHitCount();
+		uint64_t GetMissCount();
+		void Destroy(VkDevice dev);
+	};
+}
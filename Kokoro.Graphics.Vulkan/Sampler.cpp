@@ -2,14 +2,18 @@
 
 Kokoro::Graphics::Sampler::Sampler()
 {
-
+	sampler = VK_NULL_HANDLE;
+	locked = false;
+	CompareEnable = false;
+	Compare = DepthFunc::Always;
 }
 
 Kokoro::Graphics::Sampler::~Sampler()
 {
-	if (!locked) {
-		vkDestroySampler(GraphicsDevice::GetDevice(), sampler, nullptr);
-	}
+	//Descriptor layouts using this as an immutable sampler hold their own reference, descriptor sets written
+	//with it may still be in flight
+	if (locked)
+		GraphicsDevice::DeferDestroy(DeferredObjectType::CachedSampler, (uint64_t)sampler);
 }
 
 void Kokoro::Graphics::Sampler::Build()
@@ -20,22 +24,22 @@ void Kokoro::Graphics::Sampler::Build()
 		creatInfo.flags = 0;
 		creatInfo.magFilter = LinearFilter ? VK_FILTER_LINEAR : VK_FILTER_NEAREST;
 		creatInfo.minFilter = LinearFilter ? VK_FILTER_LINEAR : VK_FILTER_NEAREST;
-		creatInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+		creatInfo.mipmapMode = LinearMipFilter ? VK_SAMPLER_MIPMAP_MODE_LINEAR : VK_SAMPLER_MIPMAP_MODE_NEAREST;
 		creatInfo.addressModeU = EdgeModeConverter::Convert(Edge);
 		creatInfo.addressModeV = EdgeModeConverter::Convert(Edge);
 		creatInfo.addressModeW = EdgeModeConverter::Convert(Edge);
 		creatInfo.mipLodBias = 0;
 		creatInfo.anisotropyEnable = AnistropicSamples == 0 ? VK_FALSE : VK_TRUE;
 		creatInfo.maxAnisotropy = AnistropicSamples;
-		creatInfo.compareEnable = VK_FALSE;
-		creatInfo.compareOp = VK_COMPARE_OP_ALWAYS;
+		creatInfo.compareEnable = CompareEnable ? VK_TRUE : VK_FALSE;
+		creatInfo.compareOp = DepthFuncConv::Convert(Compare);
 		creatInfo.minLod = MinLod;
 		creatInfo.maxLod = MaxLod;
 		creatInfo.borderColor = BorderColorConverter::Convert(Border);
 		creatInfo.unnormalizedCoordinates = UnnormalizedCoords ? VK_TRUE : VK_FALSE;
 
 		pin_ptr<VkSampler> sampler_ptr = &sampler;
-		if (vkCreateSampler(GraphicsDevice::GetDevice(), &creatInfo, nullptr, sampler_ptr) != VK_SUCCESS) {
+		if (GraphicsDevice::GetSamplerCache()->Acquire(GraphicsDevice::GetDevice(), creatInfo, sampler_ptr) != VK_SUCCESS) {
 			throw gcnew System::Exception("Failed to create sampler.");
 		}
 		locked = true;
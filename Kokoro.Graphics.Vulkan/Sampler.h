@@ -1,5 +1,6 @@
 #pragma once
 #include "GraphicsDevice.h"
+#include "DepthFunc.h"
 
 namespace Kokoro::Graphics {
 	enum class EdgeMode {
@@ -55,6 +56,7 @@ namespace Kokoro::Graphics {
 		}
 	};
 
+	//Samplers with identical state share one VkSampler through the device's SamplerCache.
 	ref class Sampler
 	{
 	private:
@@ -65,6 +67,10 @@ namespace Kokoro::Graphics {
 	public:
 		property bool UnnormalizedCoords;
 		property bool LinearFilter;
+		property bool LinearMipFilter;
+		//Makes this a depth comparison sampler using Compare.
+		property bool CompareEnable;
+		property DepthFunc Compare;
 		property EdgeMode Edge;
 		property BorderColor Border;
 		property float AnistropicSamples;
@@ -0,0 +1,155 @@
+#include "SamplerCache.h"
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+
+namespace {
+	//Every field of VkSamplerCreateInfo widened to 32 bits, so the key has no padding and compares with memcmp
+	struct SamplerKey {
+		uint32_t fields[16];
+
+		bool operator==(const SamplerKey& o) const {
+			return memcmp(fields, o.fields, sizeof(fields)) == 0;
+		}
+	};
+
+	struct SamplerKeyHash {
+		size_t operator()(const SamplerKey& k) const {
+			uint64_t h = 14695981039346656037ull;
+			for (auto f : k.fields)
+				h = (h ^ f) * 1099511628211ull;
+			return static_cast<size_t>(h);
+		}
+	};
+
+	struct SamplerEntry {
+		VkSampler sampler;
+		uint32_t refCount;
+	};
+
+	//Kept out of the header so the managed translation units never see <mutex>
+	struct CacheState {
+		std::mutex lock;
+		std::unordered_map<SamplerKey, SamplerEntry, SamplerKeyHash> entries;
+		std::unordered_map<VkSampler, SamplerKey> keys;
+		uint64_t hits;
+		uint64_t misses;
+	};
+
+	uint32_t FloatBits(float f) {
+		uint32_t b;
+		memcpy(&b, &f, sizeof(b));
+		return b;
+	}
+
+	SamplerKey MakeKey(const VkSamplerCreateInfo& c) {
+		SamplerKey k;
+		k.fields[0] = c.flags;
+		k.fields[1] = c.magFilter;
+		k.fields[2] = c.minFilter;
+		k.fields[3] = c.mipmapMode;
+		k.fields[4] = c.addressModeU;
+		k.fields[5] = c.addressModeV;
+		k.fields[6] = c.addressModeW;
+		k.fields[7] = FloatBits(c.mipLodBias);
+		k.fields[8] = c.anisotropyEnable;
+		//Anisotropy and compare op are ignored by the driver when disabled, don't let them split the cache
+		k.fields[9] = c.anisotropyEnable ? FloatBits(c.maxAnisotropy) : 0;
+		k.fields[10] = c.compareEnable;
+		k.fields[11] = c.compareEnable ? c.compareOp : 0;
+		k.fields[12] = FloatBits(c.minLod);
+		k.fields[13] = FloatBits(c.maxLod);
+		k.fields[14] = c.borderColor;
+		k.fields[15] = c.unnormalizedCoordinates;
+		return k;
+	}
+}
+
+Kokoro::Graphics::SamplerCache::SamplerCache() {
+	auto s = new CacheState();
+	s->hits = 0;
+	s->misses = 0;
+	state = s;
+}
+
+Kokoro::Graphics::SamplerCache::~SamplerCache() {
+	delete static_cast<CacheState*>(state);
+}
+
+VkResult Kokoro::Graphics::SamplerCache::Acquire(VkDevice dev, const VkSamplerCreateInfo& creatInfo, VkSampler* sampler) {
+	auto s = static_cast<CacheState*>(state);
+	std::lock_guard<std::mutex> guard(s->lock);
+
+	auto key = MakeKey(creatInfo);
+	auto it = s->entries.find(key);
+	if (it != s->entries.end()) {
+		s->hits++;
+		it->second.refCount++;
+		*sampler = it->second.sampler;
+		return VK_SUCCESS;
+	}
+
+	auto res = vkCreateSampler(dev, &creatInfo, nullptr, sampler);
+	if (res != VK_SUCCESS)
+		return res;
+	s->misses++;
+
+	SamplerEntry e;
+	e.sampler = *sampler;
+	e.refCount = 1;
+	s->entries.emplace(key, e);
+	s->keys.emplace(*sampler, key);
+	return VK_SUCCESS;
+}
+
+void Kokoro::Graphics::SamplerCache::AddRef(VkSampler sampler) {
+	auto s = static_cast<CacheState*>(state);
+	std::lock_guard<std::mutex> guard(s->lock);
+
+	auto k = s->keys.find(sampler);
+	if (k != s->keys.end())
+		s->entries[k->second].refCount++;
+}
+
+void Kokoro::Graphics::SamplerCache::Release(VkDevice dev, VkSampler sampler) {
+	auto s = static_cast<CacheState*>(state);
+	std::lock_guard<std::mutex> guard(s->lock);
+
+	auto k = s->keys.find(sampler);
+	if (k == s->keys.end())
+		return;
+	auto it = s->entries.find(k->second);
+	if (--it->second.refCount == 0) {
+		vkDestroySampler(dev, sampler, nullptr);
+		s->entries.erase(it);
+		s->keys.erase(k);
+	}
+}
+
+uint32_t Kokoro::Graphics::SamplerCache::GetSamplerCount() {
+	auto s = static_cast<CacheState*>(state);
+	std::lock_guard<std::mutex> guard(s->lock);
+	return static_cast<uint32_t>(s->entries.size());
+}
+
+uint64_t Kokoro::Graphics::SamplerCache::GetHitCount() {
+	auto s = static_cast<CacheState*>(state);
+	std::lock_guard<std::mutex> guard(s->lock);
+	return s->hits;
+}
+
+uint64_t Kokoro::Graphics::SamplerCache::GetMissCount() {
+	auto s = static_cast<CacheState*>(state);
+	std::lock_guard<std::mutex> guard(s->lock);
+	return s->misses;
+}
+
+void Kokoro::Graphics::SamplerCache::Destroy(VkDevice dev) {
+	auto s = static_cast<CacheState*>(state);
+	std::lock_guard<std::mutex> guard(s->lock);
+
+	for (auto& e : s->entries)
+		vkDestroySampler(dev, e.second.sampler, nullptr);
+	s->entries.clear();
+	s->keys.clear();
+}
@@ -0,0 +1,32 @@
+#pragma once
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#define VK_USE_PLATFORM_WIN32_KHR
+#endif
+#include "vulkan/vulkan.h"
+
+namespace Kokoro::Graphics {
+	//Device-wide map from sampler state to a refcounted VkSampler, keeps the sampler count well below maxSamplerAllocationCount.
+	//Create infos with a pNext chain are not supported.
+	class SamplerCache
+	{
+	private:
+		void* state;
+	public:
+		SamplerCache();
+		~SamplerCache();
+
+		//Returns an existing sampler with identical state or creates one, either way holding a new reference.
+		VkResult Acquire(VkDevice dev, const VkSamplerCreateInfo& creatInfo, VkSampler* sampler);
+		//Takes another reference on a sampler returned by Acquire.
+		void AddRef(VkSampler sampler);
+		//The sampler is destroyed with its last reference.
+		void Release(VkDevice dev, VkSampler sampler);
+
+		uint32_t GetSamplerCount();
+		uint64_t GetHitCount();
+		uint64_t GetMissCount();
+		void Destroy(VkDevice dev);
+	};
+}
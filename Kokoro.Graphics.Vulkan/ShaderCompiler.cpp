@@ -0,0 +1,322 @@
+#include "ShaderCompiler.h"
+#include "shaderc/shaderc.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+	//Bump when the cache file layout or compile options change
+	const uint32_t CacheFormatVersion = 1;
+
+	struct CompilerState {
+		shaderc_compiler_t compiler;
+		fs::path cacheDir;
+		std::vector<fs::path> includeDirs;
+		std::string preamble;
+		std::string versionTag;
+		std::atomic<uint32_t> hits;
+		std::atomic<uint32_t> misses;
+	};
+
+	struct IncludeData {
+		std::string name;
+		std::string content;
+		shaderc_include_result result;
+	};
+
+	//Offset just past the line of a #version directive preceded only by whitespace and comments, npos if there's none
+	size_t VersionLineEnd(const std::string& src) {
+		size_t i = 0;
+		while (i < src.size()) {
+			if (isspace(static_cast<unsigned char>(src[i])))
+				i++;
+			else if (src.compare(i, 2, "//") == 0) {
+				i = src.find('\n', i);
+				if (i == std::string::npos)
+					return std::string::npos;
+			}
+			else if (src.compare(i, 2, "/*") == 0) {
+				i = src.find("*/", i + 2);
+				if (i == std::string::npos)
+					return std::string::npos;
+				i += 2;
+			}
+			else
+				break;
+		}
+		if (i >= src.size() || src[i] != '#')
+			return std::string::npos;
+		for (i++; i < src.size() && (src[i] == ' ' || src[i] == '\t'); i++);
+		if (src.compare(i, 7, "version") != 0)
+			return std::string::npos;
+		auto end = src.find('\n', i);
+		return end == std::string::npos ? src.size() : end + 1;
+	}
+
+	bool ReadText(const fs::path& path, std::string& text) {
+		std::ifstream f(path, std::ios::binary);
+		if (!f)
+			return false;
+		std::ostringstream ss;
+		ss << f.rdbuf();
+		text = ss.str();
+		return true;
+	}
+
+	shaderc_include_result* ResolveInclude(void* user, const char* requested, int type, const char* requesting, size_t depth) {
+		auto s = static_cast<CompilerState*>(user);
+		auto inc = new IncludeData();
+
+		std::vector<fs::path> candidates;
+		if (type == shaderc_include_type_relative)
+			candidates.push_back(fs::path(requesting).parent_path() / requested);
+		for (auto& dir : s->includeDirs)
+			candidates.push_back(dir / requested);
+
+		for (auto& c : candidates)
+			if (ReadText(c, inc->content)) {
+				inc->name = fs::absolute(c).lexically_normal().string();
+				break;
+			}
+		if (inc->name.empty())
+			inc->content = std::string("Unable to resolve include ") + requested;
+
+		inc->result.source_name = inc->name.c_str();
+		inc->result.source_name_length = inc->name.size();
+		inc->result.content = inc->content.c_str();
+		inc->result.content_length = inc->content.size();
+		inc->result.user_data = inc;
+		return &inc->result;
+	}
+
+	void ReleaseInclude(void* user, shaderc_include_result* result) {
+		delete static_cast<IncludeData*>(result->user_data);
+	}
+
+	shaderc_shader_kind KindFromStage(VkShaderStageFlagBits stage) {
+		switch (stage) {
+		case VK_SHADER_STAGE_VERTEX_BIT: return shaderc_glsl_vertex_shader;
+		case VK_SHADER_STAGE_FRAGMENT_BIT: return shaderc_glsl_fragment_shader;
+		case VK_SHADER_STAGE_COMPUTE_BIT: return shaderc_glsl_compute_shader;
+		case VK_SHADER_STAGE_GEOMETRY_BIT: return shaderc_glsl_geometry_shader;
+		case VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT: return shaderc_glsl_tess_control_shader;
+		case VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT: return shaderc_glsl_tess_evaluation_shader;
+		default: return shaderc_glsl_infer_from_source;
+		}
+	}
+
+	//Two independently seeded FNV-1a passes, 128 bits is plenty to address the cache by content
+	std::string HashKey(const std::string& data) {
+		uint64_t h0 = 14695981039346656037ull;
+		uint64_t h1 = 0x84222325cbf29ce4ull;
+		for (unsigned char c : data) {
+			h0 = (h0 ^ c) * 1099511628211ull;
+			h1 = (h1 ^ c) * 0x100000001b3ull;
+			h1 ^= h1 >> 29;
+		}
+		char buf[33];
+		snprintf(buf, sizeof(buf), "%016llx%016llx", (unsigned long long)h0, (unsigned long long)h1);
+		return buf;
+	}
+
+	//shaderc only reports the SPIR-V version it emits, so identify the compiler by the binary it was loaded from.
+	//A rebuilt or updated shaderc changes its size or timestamp, which invalidates everything it compiled.
+	std::string CompilerBuildId() {
+		std::string path;
+#ifdef _WIN32
+		HMODULE mod = nullptr;
+		if (GetModuleHandleExA(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT, reinterpret_cast<LPCSTR>(&shaderc_compiler_initialize), &mod)) {
+			char buf[MAX_PATH];
+			auto len = GetModuleFileNameA(mod, buf, MAX_PATH);
+			if (len != 0 && len < MAX_PATH)
+				path.assign(buf, len);
+		}
+#else
+		Dl_info info;
+		if (dladdr(reinterpret_cast<void*>(&shaderc_compiler_initialize), &info) != 0 && info.dli_fname != nullptr)
+			path = info.dli_fname;
+#endif
+		if (path.empty())
+			return "unknown";
+
+		std::error_code ec;
+		auto sz = fs::file_size(path, ec);
+		if (ec)
+			return "unknown";
+		auto time = fs::last_write_time(path, ec);
+		if (ec)
+			return "unknown";
+		return std::to_string(sz) + "-" + std::to_string(time.time_since_epoch().count());
+	}
+
+	shaderc_compile_options_t MakeOptions(CompilerState* s, const Kokoro::Graphics::ShaderCompiler::Job& job) {
+		auto opts = shaderc_compile_options_initialize();
+		shaderc_compile_options_set_target_env(opts, shaderc_target_env_vulkan, shaderc_env_version_vulkan_1_1);
+		shaderc_compile_options_set_optimization_level(opts, shaderc_optimization_level_performance);
+		shaderc_compile_options_set_include_callbacks(opts, ResolveInclude, ReleaseInclude, s);
+		for (auto& d : job.defines) {
+			auto eq = d.find('=');
+			if (eq == std::string::npos)
+				shaderc_compile_options_add_macro_definition(opts, d.c_str(), d.size(), nullptr, 0);
+			else
+				shaderc_compile_options_add_macro_definition(opts, d.c_str(), eq, d.c_str() + eq + 1, d.size() - eq - 1);
+		}
+		return opts;
+	}
+}
+
+Kokoro::Graphics::ShaderCompiler::ShaderCompiler(const char* cacheDir) {
+	auto s = new CompilerState();
+	s->compiler = shaderc_compiler_initialize();
+	s->cacheDir = cacheDir;
+	s->hits = 0;
+	s->misses = 0;
+
+	unsigned int ver = 0, rev = 0;
+	shaderc_get_spv_version(&ver, &rev);
+	s->versionTag = std::to_string(CacheFormatVersion) + "/" + std::to_string(ver) + "." + std::to_string(rev) + "/" + CompilerBuildId();
+
+	std::error_code ec;
+	fs::create_directories(s->cacheDir, ec);
+	state = s;
+}
+
+Kokoro::Graphics::ShaderCompiler::~ShaderCompiler() {
+	auto s = static_cast<CompilerState*>(state);
+	shaderc_compiler_release(s->compiler);
+	delete s;
+}
+
+void Kokoro::Graphics::ShaderCompiler::AddIncludeDir(const char* dir) {
+	static_cast<CompilerState*>(state)->includeDirs.push_back(dir);
+}
+
+void Kokoro::Graphics::ShaderCompiler::SetPreamble(const char* preamble) {
+	static_cast<CompilerState*>(state)->preamble = preamble;
+}
+
+Kokoro::Graphics::ShaderCompiler::Result Kokoro::Graphics::ShaderCompiler::Compile(const Job& job) {
+	auto s = static_cast<CompilerState*>(state);
+	Result r = {};
+
+	std::string src = job.source;
+	if (src.empty() && !ReadText(job.path, src)) {
+		r.log = "Unable to read " + job.path;
+		return r;
+	}
+	//glslang doesn't skip a BOM, and it would hide the #version directive
+	if (src.compare(0, 3, "\xEF\xBB\xBF") == 0)
+		src.erase(0, 3);
+	if (!s->preamble.empty()) {
+		size_t versionEnd = VersionLineEnd(src);
+		if (versionEnd == std::string::npos)
+			src = s->preamble + "\n#line 1\n" + src;
+		else {
+			//The source's #version replaces the preamble's, the rest goes right after it
+			std::string preamble = s->preamble;
+			size_t preambleEnd = VersionLineEnd(preamble);
+			if (preambleEnd != std::string::npos)
+				preamble.erase(0, preambleEnd);
+			auto line = std::count(src.begin(), src.begin() + versionEnd, '\n') + 1;
+			std::string head = src.substr(0, versionEnd);
+			if (head.back() != '\n')
+				head += '\n';
+			src = head + preamble + "\n#line " + std::to_string(line) + "\n" + src.substr(versionEnd);
+		}
+	}
+
+	auto kind = KindFromStage(job.stage);
+	auto entry = job.entryPoint.empty() ? "main" : job.entryPoint.c_str();
+	auto opts = MakeOptions(s, job);
+
+	//Preprocessing resolves includes and defines, so its output identifies everything that affects the binary
+	auto pre = shaderc_compile_into_preprocessed_text(s->compiler, src.c_str(), src.size(), kind, job.path.c_str(), entry, opts);
+	if (shaderc_result_get_compilation_status(pre) != shaderc_compilation_status_success) {
+		r.log = shaderc_result_get_error_message(pre);
+		shaderc_result_release(pre);
+		shaderc_compile_options_release(opts);
+		return r;
+	}
+	std::string preprocessed(shaderc_result_get_bytes(pre), shaderc_result_get_length(pre));
+	shaderc_result_release(pre);
+
+	auto key = HashKey(s->versionTag + "\n" + std::to_string(kind) + "\n" + entry + "\n" + preprocessed);
+	auto cachePath = s->cacheDir / (key + ".spv");
+
+	std::string cachedBin;
+	if (ReadText(cachePath, cachedBin) && cachedBin.size() != 0 && cachedBin.size() % 4 == 0) {
+		r.spirv.resize(cachedBin.size() / 4);
+		memcpy(r.spirv.data(), cachedBin.data(), cachedBin.size());
+		r.success = true;
+		r.cached = true;
+		s->hits++;
+		shaderc_compile_options_release(opts);
+		return r;
+	}
+	s->misses++;
+
+	auto res = shaderc_compile_into_spv(s->compiler, src.c_str(), src.size(), kind, job.path.c_str(), entry, opts);
+	shaderc_compile_options_release(opts);
+	r.log = shaderc_result_get_error_message(res);
+	if (shaderc_result_get_compilation_status(res) != shaderc_compilation_status_success) {
+		shaderc_result_release(res);
+		return r;
+	}
+	size_t len = shaderc_result_get_length(res);
+	r.spirv.resize(len / 4);
+	memcpy(r.spirv.data(), shaderc_result_get_bytes(res), len);
+	r.success = true;
+	shaderc_result_release(res);
+
+	//Write to a unique temporary and rename so concurrent processes never observe a partial binary
+	std::stringstream tmpName;
+	tmpName << key << "." << std::this_thread::get_id() << ".tmp";
+	auto tmpPath = s->cacheDir / tmpName.str();
+	{
+		std::ofstream f(tmpPath, std::ios::binary | std::ios::trunc);
+		f.write(reinterpret_cast<const char*>(r.spirv.data()), len);
+	}
+	std::error_code ec;
+	fs::rename(tmpPath, cachePath, ec);
+	if (ec)
+		fs::remove(tmpPath, ec);
+	return r;
+}
+
+void Kokoro::Graphics::ShaderCompiler::CompileBatch(const Job* jobs, size_t jobCnt, Result* results) {
+	size_t threadCnt = std::max<size_t>(1, std::min<size_t>(std::thread::hardware_concurrency(), jobCnt));
+	std::atomic<size_t> next(0);
+
+	auto worker = [&]() {
+		for (size_t i = next++; i < jobCnt; i = next++)
+			results[i] = Compile(jobs[i]);
+	};
+
+	std::vector<std::thread> threads;
+	for (size_t t = 1; t < threadCnt; t++)
+		threads.emplace_back(worker);
+	worker();
+	for (auto& t : threads)
+		t.join();
+}
+
+uint32_t Kokoro::Graphics::ShaderCompiler::GetHitCount() {
+	return static_cast<CompilerState*>(state)->hits;
+}
+
+uint32_t Kokoro::Graphics::ShaderCompiler::GetMissCount() {
+	return static_cast<CompilerState*>(state)->misses;
+}
@@ -0,0 +1,49 @@
+#pragma once
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#define VK_USE_PLATFORM_WIN32_KHR
+#endif
+#include "vulkan/vulkan.h"
+#include <string>
+#include <vector>
+
+namespace Kokoro::Graphics {
+	//Compiles GLSL to SPIR-V with shaderc, results are cached on disk keyed by a hash of the preprocessed source.
+	//The preprocessed text already contains every include and define, so only shaders whose inputs changed recompile.
+	class ShaderCompiler
+	{
+	public:
+		struct Job {
+			std::string path;
+			VkShaderStageFlagBits stage;
+			std::string entryPoint;
+			//NAME or NAME=VALUE
+			std::vector<std::string> defines;
+			//Compiled in place of the file when set, path then only names the shader in logs and anchors relative includes
+			std::string source;
+		};
+		struct Result {
+			bool success;
+			bool cached;
+			std::vector<uint32_t> spirv;
+			std::string log;
+		};
+	private:
+		void* state;
+	public:
+		ShaderCompiler(const char* cacheDir);
+		~ShaderCompiler();
+
+		void AddIncludeDir(const char* dir);
+		//Prepended to sources that don't declare their own #version, otherwise inserted after it without the preamble's #version line.
+		void SetPreamble(const char* preamble);
+
+		Result Compile(const Job& job);
+		//Runs the jobs across all hardware threads.
+		void CompileBatch(const Job* jobs, size_t jobCnt, Result* results);
+
+		uint32_t GetHitCount();
+		uint32_t GetMissCount();
+	};
+}
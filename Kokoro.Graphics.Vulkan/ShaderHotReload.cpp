@@ -0,0 +1,138 @@
+#include "ShaderHotReload.h"
+#include "ShaderModule.h"
+
+using namespace System::IO;
+using namespace System::Runtime::InteropServices;
+using namespace System::Threading;
+
+void Kokoro::Graphics::ShaderHotReload::Enable(String^ shaderDir) {
+	if (watcher != nullptr)
+		return;
+
+	IntPtr dir = Marshal::StringToHGlobalAnsi(Path::GetFullPath(shaderDir));
+	watcher = new ShaderWatcher(ShaderModule::GetCompiler(), (const char*)dir.ToPointer(), 250);
+	Marshal::FreeHGlobal(dir);
+	modules = gcnew Dictionary<uint32_t, ShaderModule^>();
+	postponed = new std::vector<ShaderWatcher::Update>();
+}
+
+void Kokoro::Graphics::ShaderHotReload::Disable() {
+	if (watcher == nullptr)
+		return;
+
+	delete watcher;
+	watcher = nullptr;
+	for each (ShaderModule^ m in modules->Values)
+		m->watchId = 0;
+	modules = nullptr;
+	delete postponed;
+	postponed = nullptr;
+
+	//Outstanding rebuilds still have to be swapped in so their objects get released
+	while (rebuilding->Count != 0 || !queued->IsEmpty) {
+		FinishRebuilds();
+		if (rebuilding->Count != 0)
+			System::Threading::Thread::Sleep(1);
+	}
+}
+
+bool Kokoro::Graphics::ShaderHotReload::IsEnabled() {
+	return watcher != nullptr;
+}
+
+void Kokoro::Graphics::ShaderHotReload::Register(ShaderModule^ mod, const ShaderCompiler::Job& job, const uint32_t* spirv, size_t wordCnt) {
+	mod->watchId = watcher->AddJob(job, spirv, wordCnt);
+	modules->Add(mod->watchId, mod);
+}
+
+void Kokoro::Graphics::ShaderHotReload::Unregister(ShaderModule^ mod) {
+	if (watcher != nullptr) {
+		watcher->RemoveJob(mod->watchId);
+		modules->Remove(mod->watchId);
+	}
+	mod->watchId = 0;
+}
+
+void Kokoro::Graphics::ShaderHotReload::QueueRebuild(IShaderDependent^ d) {
+	queued->Enqueue(d);
+}
+
+void Kokoro::Graphics::ShaderHotReload::DrainQueued() {
+	IShaderDependent^ q;
+	while (queued->TryDequeue(q))
+		if (!rebuilding->Contains(q))
+			rebuilding->Add(q);
+}
+
+void Kokoro::Graphics::ShaderHotReload::FinishRebuilds() {
+	DrainQueued();
+
+	for (int i = rebuilding->Count - 1; i >= 0; i--) {
+		try {
+			if (rebuilding[i]->FinishRebuild())
+				continue;
+		}
+		catch (Exception^ e) {
+			//The pipeline keeps running with its previous objects
+			ReloadFailed("Pipeline rebuild failed: " + e->Message);
+		}
+		rebuilding->RemoveAt(i);
+	}
+}
+
+void Kokoro::Graphics::ShaderHotReload::Update() {
+	FinishRebuilds();
+	if (watcher == nullptr)
+		return;
+
+	std::vector<ShaderWatcher::Update> updates;
+	updates.swap(*postponed);
+	std::vector<ShaderWatcher::Update> fresh;
+	watcher->TakeUpdates(fresh);
+	for (auto& u : fresh)
+		updates.push_back(std::move(u));
+
+	for (auto& u : updates) {
+		ShaderModule^ mod;
+		if (!modules->TryGetValue(u.id, mod))
+			continue;
+		if (!u.success) {
+			ReloadFailed("Shader reload failed:\n" + gcnew String(u.log.c_str()));
+			continue;
+		}
+
+		//Builds and rebuilds read the module on worker threads, it can only change once they are done.
+		//The module's lock keeps new builds from starting until the reload is finished.
+		bool busy = false;
+		List<IShaderDependent^>^ deps = nullptr;
+		Monitor::Enter(mod->dependents);
+		try {
+			//Rebuilds queued by builds that have just ended
+			DrainQueued();
+			busy = mod->buildsInFlight != 0;
+			for each (IShaderDependent^ d in mod->dependents)
+				busy |= rebuilding->Contains(d);
+			if (!busy) {
+				mod->Reload(u.spirv.data(), u.spirv.size() * sizeof(uint32_t));
+				deps = gcnew List<IShaderDependent^>(mod->dependents);
+			}
+		}
+		catch (Exception^ e) {
+			ReloadFailed("Shader reload failed: " + e->Message);
+		}
+		finally {
+			Monitor::Exit(mod->dependents);
+		}
+		if (busy) {
+			postponed->push_back(std::move(u));
+			continue;
+		}
+		if (deps == nullptr)
+			continue;
+
+		for each (IShaderDependent^ d in deps) {
+			d->BeginRebuild();
+			rebuilding->Add(d);
+		}
+	}
+}
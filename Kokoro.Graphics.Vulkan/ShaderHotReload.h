@@ -0,0 +1,50 @@
+#pragma once
+#include "GraphicsDevice.h"
+#include "ShaderCompiler.h"
+#include "ShaderWatcher.h"
+#include <vector>
+
+using namespace System;
+using namespace System::Collections::Generic;
+using namespace System::Collections::Concurrent;
+
+namespace Kokoro::Graphics {
+	ref class ShaderModule;
+	interface class IShaderDependent;
+	//Recompiles GLSL shaders when their sources change and rebuilds the pipelines using them.
+	//Rebuilds run in the background, the new pipelines are swapped in by GraphicsDevice::AdvanceFrame.
+	public ref class ShaderHotReload
+	{
+	private:
+		static ShaderWatcher* watcher;
+		static Dictionary<uint32_t, ShaderModule^>^ modules;
+		static List<IShaderDependent^>^ rebuilding;
+		//Rebuilds started outside of Update, possibly from worker threads
+		static ConcurrentQueue<IShaderDependent^>^ queued;
+		//Updates held back while a dependent of the module is still rebuilding
+		static std::vector<ShaderWatcher::Update>* postponed;
+
+		static ShaderHotReload() {
+			rebuilding = gcnew List<IShaderDependent^>();
+			queued = gcnew ConcurrentQueue<IShaderDependent^>();
+		}
+		static void DrainQueued();
+		static void FinishRebuilds();
+	internal:
+		static bool IsEnabled();
+		//spirv is the binary the module was created from.
+		static void Register(ShaderModule^ mod, const ShaderCompiler::Job& job, const uint32_t* spirv, size_t wordCnt);
+		static void Unregister(ShaderModule^ mod);
+		//Has a rebuild that was already begun swapped in by Update, independent of whether watching is enabled.
+		static void QueueRebuild(IShaderDependent^ d);
+		static void Update();
+	public:
+		//Watches shaderDir, shaders loaded through ShaderModule::Load afterwards are reloaded on change.
+		static void Enable(String^ shaderDir);
+		static void Disable();
+
+		//Raised from GraphicsDevice::AdvanceFrame with the compiler log or exception message when a changed shader
+		//fails to compile or load, or a pipeline fails to rebuild. The previous shader and pipelines stay in use.
+		static event Action<String^>^ ReloadFailed;
+	};
+}
@@ -1,28 +1,265 @@
 #include "ShaderModule.h"
 #include "SpecializedShaderModule.h"
 #include "GraphicsDevice.h"
+#include "ShaderHotReload.h"
+#include <algorithm>
+#include <string>
 
 using namespace System::IO;
+using namespace System::Runtime::InteropServices;
+using namespace System::Threading;
+
+//Matches the preamble the C# ShaderSource prepends, engine specific values are passed as defines
+static const char* DefaultPreamble =
+	"#version 450 core\n"
+	"#extension GL_ARB_separate_shader_objects : enable\n"
+	"#extension GL_ARB_shader_draw_parameters : enable\n"
+	"#extension GL_EXT_shader_16bit_storage : enable\n"
+	"#extension GL_EXT_shader_8bit_storage : enable\n"
+	"#extension GL_EXT_shader_explicit_arithmetic_types : enable\n"
+	"#extension GL_EXT_shader_explicit_arithmetic_types_int8 : enable\n"
+	"#extension GL_EXT_shader_explicit_arithmetic_types_int16 : enable\n"
+	"#extension GL_EXT_shader_explicit_arithmetic_types_int32 : enable\n"
+	"#extension GL_EXT_shader_explicit_arithmetic_types_float16 : enable\n"
+	"#extension GL_EXT_shader_explicit_arithmetic_types_float32 : enable\n"
+	"#extension GL_EXT_multiview : enable\n"
+	"#define PI 3.14159265358979\n";
+
+static std::string ToStdString(String^ s) {
+	IntPtr p = Marshal::StringToHGlobalAnsi(s);
+	std::string r((const char*)p.ToPointer());
+	Marshal::FreeHGlobal(p);
+	return r;
+}
+
+static uint64_t HashSpecData(const void* data, size_t sz, uint64_t seed) {
+	uint64_t h = 14695981039346656037ull ^ seed;
+	for (size_t i = 0; i < sz; i++)
+		h = (h ^ ((const uint8_t*)data)[i]) * 1099511628211ull;
+	return h;
+}
+
+static Kokoro::Graphics::ShaderCompiler::Job MakeJob(Kokoro::Graphics::ShaderType sType, String^ fname, array<String^>^ defines) {
+	Kokoro::Graphics::ShaderCompiler::Job job;
+	job.path = ToStdString(Path::GetFullPath(fname));
+	job.stage = Kokoro::Graphics::ShaderTypeConv::Convert(sType);
+	job.entryPoint = "main";
+	//Stereo shaders size their per-eye data by it and index it with gl_ViewIndex
+	job.defines.push_back("EYECOUNT=" + std::to_string(Kokoro::Graphics::GraphicsDevice::EyeCount));
+	if (defines != nullptr)
+		for (int j = 0; j < defines->Length; j++)
+			job.defines.push_back(ToStdString(defines[j]));
+	return job;
+}
 
 Kokoro::Graphics::ShaderModule::ShaderModule(ShaderType sType, String^ fname) {
+	//Mapped rather than read, the pages are dropped as soon as the module exists
+	MappedFile file;
+	if (!file.Open(ToStdString(fname).c_str()))
+		throw gcnew System::IO::FileNotFoundException("Failed to map shader binary.", fname);
+	Init(sType, static_cast<const uint32_t*>(file.GetData()), file.GetSize());
+}
+
+Kokoro::Graphics::ShaderModule::ShaderModule(ShaderType sType, const uint32_t* code, size_t byteSize) {
+	Init(sType, code, byteSize);
+}
+
+void Kokoro::Graphics::ShaderModule::Init(ShaderType sType, const uint32_t* code, size_t byteSize) {
+	this->sType = sType;
+	reflection = nullptr;
 	specializationDef = gcnew List<SpecializationInfo>();
+	variants = gcnew List<SpecializedShaderModule^>();
+	variantCache = gcnew Dictionary<uint64_t, SpecializedShaderModule^>();
+	specMap = nullptr;
+	specMapCnt = 0;
+	specDataSz = 0;
+	entryPoint = IntPtr::Zero;
+	entryPointName = nullptr;
+	dependents = gcnew List<IShaderDependent^>();
+	buildsInFlight = 0;
+	watchId = 0;
+	disposed = false;
 	EntryPoint = "main";
 
-	spv = File::ReadAllBytes(fname);
-	pin_ptr<unsigned char> spv_ptr = &spv[0];
-
-	VkShaderModuleCreateInfo smCreatInfo = {};
-	smCreatInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-	smCreatInfo.codeSize = spv->Length / 4;
-	smCreatInfo.pCode = (uint32_t*)spv_ptr;
+	SpirvReflection refl;
+	shaderModule = CreateModule(code, byteSize, sType, refl);
+	reflection = new SpirvReflection(refl);
+	//Modules with several entry points default to the one for this stage
+	EntryPoint = gcnew String(refl.GetEntryPoint().c_str());
+}
 
-	pin_ptr<VkShaderModule> shaderModule_ptr = &shaderModule;
+VkShaderModule Kokoro::Graphics::ShaderModule::CreateModule(const uint32_t* code, size_t byteSize, ShaderType sType, SpirvReflection& refl) {
+	std::string err;
+	if (!ShaderRegistry::Validate(code, byteSize, err))
+		throw gcnew System::Exception("Invalid shader binary: " + gcnew String(err.c_str()));
+	if (!refl.Parse(code, byteSize / sizeof(uint32_t), ShaderTypeConv::Convert(sType)))
+		throw gcnew System::Exception("Shader reflection failed!");
+	if (refl.GetStage() != ShaderTypeConv::Convert(sType))
+		throw gcnew System::Exception("Shader stage does not match its entry point!");
 
-	if (vkCreateShaderModule(GraphicsDevice::GetDevice(), &smCreatInfo, nullptr, shaderModule_ptr) != VK_SUCCESS)
+	//Identical binaries share one module
+	auto mod = GraphicsDevice::GetShaderRegistry()->Acquire(GraphicsDevice::GetDevice(), code, byteSize);
+	if (mod == VK_NULL_HANDLE)
 		throw gcnew System::Exception("Shader failed to load!");
+	return mod;
+}
+
+void Kokoro::Graphics::ShaderModule::Reload(const uint32_t* code, size_t byteSize) {
+	SpirvReflection refl;
+	auto mod = CreateModule(code, byteSize, sType, refl);
+
+	GraphicsDevice::DeferDestroy(DeferredObjectType::ShaderModule, (uint64_t)shaderModule);
+	shaderModule = mod;
+	//Copied in place, variants hold on to the pointer
+	*reflection = refl;
+	for each (SpecializedShaderModule^ v in variants)
+		v->Retarget();
+}
+
+void Kokoro::Graphics::ShaderModule::BeginBuild() {
+	Monitor::Enter(dependents);
+	buildsInFlight++;
+	Monitor::Exit(dependents);
+}
+
+void Kokoro::Graphics::ShaderModule::EndBuild(IShaderDependent^ d) {
+	Monitor::Enter(dependents);
+	buildsInFlight--;
+	if (d != nullptr && !dependents->Contains(d))
+		dependents->Add(d);
+	Monitor::Exit(dependents);
+}
+
+void Kokoro::Graphics::ShaderModule::RemoveDependent(IShaderDependent^ d) {
+	Monitor::Enter(dependents);
+	dependents->Remove(d);
+	Monitor::Exit(dependents);
+}
+
+Kokoro::Graphics::ShaderCompiler* Kokoro::Graphics::ShaderModule::GetCompiler() {
+	if (compiler == nullptr)
+		SetCacheDirectory("ShaderCache");
+	return compiler;
+}
+
+void Kokoro::Graphics::ShaderModule::SetCacheDirectory(String^ dir) {
+	//The watcher compiles with the current compiler on its own thread
+	if (ShaderHotReload::IsEnabled())
+		throw gcnew System::InvalidOperationException("The shader cache directory can't change while hot reload is enabled.");
+	delete compiler;
+	compiler = new ShaderCompiler(ToStdString(dir).c_str());
+	compiler->SetPreamble(DefaultPreamble);
+}
+
+void Kokoro::Graphics::ShaderModule::AddIncludeDirectory(String^ dir) {
+	if (ShaderHotReload::IsEnabled())
+		throw gcnew System::InvalidOperationException("Include directories can't be added while hot reload is enabled.");
+	GetCompiler()->AddIncludeDir(ToStdString(dir).c_str());
+}
+
+uint32_t Kokoro::Graphics::ShaderModule::GetCacheHitCount() {
+	return GetCompiler()->GetHitCount();
+}
+
+uint32_t Kokoro::Graphics::ShaderModule::GetCacheMissCount() {
+	return GetCompiler()->GetMissCount();
+}
+
+uint32_t Kokoro::Graphics::ShaderModule::GetUniqueModuleCount() {
+	return GraphicsDevice::GetShaderRegistry()->GetModuleCount();
+}
+
+Kokoro::Graphics::ShaderModule^ Kokoro::Graphics::ShaderModule::FromSource(ShaderType sType, const char* name, const char* source) {
+	ShaderCompiler::Job job;
+	job.path = name;
+	job.stage = ShaderTypeConv::Convert(sType);
+	job.entryPoint = "main";
+	job.source = source;
+
+	auto r = GetCompiler()->Compile(job);
+	if (!r.success)
+		throw gcnew System::Exception("Failed to compile " + gcnew String(name) + ":\n" + gcnew String(r.log.c_str()));
+	return gcnew ShaderModule(sType, r.spirv.data(), r.spirv.size() * sizeof(uint32_t));
+}
+
+Kokoro::Graphics::ShaderModule^ Kokoro::Graphics::ShaderModule::Load(ShaderType sType, String^ fname, ... array<String^>^ defines) {
+	return LoadAll(gcnew array<ShaderType>{ sType }, gcnew array<String^>{ fname }, defines)[0];
+}
+
+array<Kokoro::Graphics::ShaderModule^>^ Kokoro::Graphics::ShaderModule::LoadAll(array<ShaderType>^ sTypes, array<String^>^ fnames, array<String^>^ defines) {
+	auto modules = gcnew array<ShaderModule^>(fnames->Length);
+
+	//Prebuilt binaries are used as is unless the source is newer, everything else goes to the compiler
+	std::vector<ShaderCompiler::Job> jobs;
+	std::vector<int> jobModules;
+	for (int i = 0; i < fnames->Length; i++) {
+		auto spvPath = Path::ChangeExtension(fnames[i], ".spv");
+		bool prebuilt = spvPath->Equals(fnames[i]) || (!GraphicsDevice::RebuildShaders && File::Exists(spvPath) &&
+			(!File::Exists(fnames[i]) || File::GetLastWriteTimeUtc(spvPath) > File::GetLastWriteTimeUtc(fnames[i])));
+		if (prebuilt) {
+			modules[i] = gcnew ShaderModule(sTypes[i], spvPath);
+			continue;
+		}
+
+		jobs.push_back(MakeJob(sTypes[i], fnames[i], defines));
+		jobModules.push_back(i);
+	}
+
+	std::vector<ShaderCompiler::Result> results(jobs.size());
+	GetCompiler()->CompileBatch(jobs.data(), jobs.size(), results.data());
+
+	std::vector<int> resultOf(fnames->Length, -1);
+	for (size_t j = 0; j < jobs.size(); j++) {
+		auto& r = results[j];
+		int i = jobModules[j];
+		if (!r.success)
+			throw gcnew System::Exception("Failed to compile " + fnames[i] + ":\n" + gcnew String(r.log.c_str()));
+
+		modules[i] = gcnew ShaderModule(sTypes[i], r.spirv.data(), r.spirv.size() * sizeof(uint32_t));
+		resultOf[i] = static_cast<int>(j);
+	}
+
+	//Prebuilt modules are watched too, their first edit swaps them over to compiled SPIR-V
+	if (ShaderHotReload::IsEnabled())
+		for (int i = 0; i < fnames->Length; i++) {
+			if (Path::GetExtension(fnames[i])->Equals(".spv") || !File::Exists(fnames[i]))
+				continue;
+			auto job = MakeJob(sTypes[i], fnames[i], defines);
+			if (resultOf[i] >= 0) {
+				auto& spirv = results[resultOf[i]].spirv;
+				ShaderHotReload::Register(modules[i], job, spirv.data(), spirv.size());
+				continue;
+			}
+			MappedFile file;
+			if (file.Open(ToStdString(Path::ChangeExtension(fnames[i], ".spv")).c_str()))
+				ShaderHotReload::Register(modules[i], job, static_cast<const uint32_t*>(file.GetData()), file.GetSize() / sizeof(uint32_t));
+		}
+	return modules;
+}
+
+uint32_t Kokoro::Graphics::ShaderModule::LocalSizeX::get() {
+	uint32_t x, y, z;
+	reflection->GetLocalSize(&x, &y, &z);
+	return x;
+}
+
+uint32_t Kokoro::Graphics::ShaderModule::LocalSizeY::get() {
+	uint32_t x, y, z;
+	reflection->GetLocalSize(&x, &y, &z);
+	return y;
+}
+
+uint32_t Kokoro::Graphics::ShaderModule::LocalSizeZ::get() {
+	uint32_t x, y, z;
+	reflection->GetLocalSize(&x, &y, &z);
+	return z;
 }
 
 void Kokoro::Graphics::ShaderModule::DefineSpecializationConstant(uint32_t id, uint32_t offset, size_t size) {
+	if (specMap != nullptr)
+		throw gcnew System::Exception("Specialization constants can't be defined after the module has been specialized.");
+	//Map entries for ids the shader doesn't declare are ignored by Vulkan, so shared layouts can be used across variants
+
 	SpecializationInfo v;
 	v.id = id;
 	v.offset = offset;
@@ -30,10 +267,87 @@ void Kokoro::Graphics::ShaderModule::DefineSpecializationConstant(uint32_t id, u
 	specializationDef->Add(v);
 }
 
+void Kokoro::Graphics::ShaderModule::FreezeSpecialization() {
+	if (entryPointName == nullptr) {
+		entryPointName = EntryPoint;
+		entryPoint = Marshal::StringToHGlobalAnsi(EntryPoint);
+	}
+	else if (!entryPointName->Equals(EntryPoint))
+		throw gcnew System::Exception("EntryPoint can't change after the module has been specialized.");
+
+	if (specMap != nullptr || specializationDef->Count == 0)
+		return;
+	specMapCnt = specializationDef->Count;
+	specMap = new VkSpecializationMapEntry[specMapCnt];
+	for (uint32_t i = 0; i < specMapCnt; i++) {
+		specMap[i].constantID = specializationDef[i].id;
+		specMap[i].offset = specializationDef[i].offset;
+		specMap[i].size = specializationDef[i].sz;
+		specDataSz = std::max(specDataSz, specMap[i].offset + specMap[i].size);
+	}
+}
+
 Kokoro::Graphics::SpecializedShaderModule^ Kokoro::Graphics::ShaderModule::Specialize(IntPtr ptr, size_t sz) {
-	return gcnew SpecializedShaderModule(this, ptr, sz);
+	if (disposed)
+		throw gcnew System::ObjectDisposedException("ShaderModule");
+	//Without explicit definitions the constants are packed tightly in ascending id order
+	if (ptr != IntPtr::Zero && specializationDef->Count == 0) {
+		uint32_t offset = 0;
+		for (auto& c : reflection->GetSpecConstants()) {
+			DefineSpecializationConstant(c.id, offset, c.size);
+			offset += c.size;
+		}
+	}
+	FreezeSpecialization();
+
+	const void* data = ptr.ToPointer();
+	if (ptr == IntPtr::Zero || specMapCnt == 0)
+		sz = 0;
+	else if (sz < specDataSz)
+		throw gcnew System::ArgumentException("Specialization data is smaller than the defined constants.");
+
+	VkPipelineShaderStageCreateFlags flags = RequireFullSubgroups ? VK_PIPELINE_SHADER_STAGE_CREATE_REQUIRE_FULL_SUBGROUPS_BIT_EXT : VK_PIPELINE_SHADER_STAGE_CREATE_ALLOW_VARYING_SUBGROUP_SIZE_BIT_EXT;
+	uint64_t key = HashSpecData(data, sz, flags);
+
+	SpecializedShaderModule^ v;
+	if (variantCache->TryGetValue(key, v) && v->Matches(data, sz, flags)) {
+		v->refCount++;
+		return v;
+	}
+
+	//A hash collision gets an uncached variant, the first one keeps the slot
+	v = gcnew SpecializedShaderModule(this, data, sz);
+	variants->Add(v);
+	if (!variantCache->ContainsKey(key)) {
+		variantCache->Add(key, v);
+		v->cacheKey = key;
+		v->cached = true;
+	}
+	return v;
 }
 
 Kokoro::Graphics::ShaderModule::~ShaderModule() {
-	vkDestroyShaderModule(GraphicsDevice::GetDevice(), shaderModule, nullptr);
+	if (disposed)
+		return;
+	disposed = true;
+	if (watchId != 0)
+		ShaderHotReload::Unregister(this);
+	//Variants remove themselves from the list as they are destroyed, ones still used by pipelines
+	//only lose their outstanding Specialize references and are freed with the last pipeline
+	for each (SpecializedShaderModule^ v in variants->ToArray()) {
+		if (v->pipelineRefs == 0)
+			v->Destroy();
+		else
+			v->refCount = 0;
+	}
+	if (variants->Count == 0)
+		Free();
+}
+
+void Kokoro::Graphics::ShaderModule::Free() {
+	delete[] specMap;
+	if (entryPoint != IntPtr::Zero)
+		Marshal::FreeHGlobal(entryPoint);
+	delete reflection;
+	GraphicsDevice::GetShaderRegistry()->Release(GraphicsDevice::GetDevice(), shaderModule);
 }
\ No newline at end of file
@@ -1,10 +1,20 @@
 #pragma once
 #include "GraphicsDevice.h"
 #include "ShaderType.h"
+#include "SpirvReflection.h"
+#include "ShaderCompiler.h"
 using namespace System;
 using namespace System::Collections::Generic;
 
 namespace Kokoro::Graphics {
+	//Pipelines that rebuild themselves when one of their shader modules is reloaded.
+	interface class IShaderDependent {
+		//Starts building replacement objects in the background from the current shader state.
+		void BeginRebuild();
+		//Swaps in the rebuilt objects once ready, returns true while the rebuild is still running.
+		bool FinishRebuild();
+	};
+
 	ref class SpecializedShaderModule;
 	ref class ShaderModule
 	{
@@ -17,15 +27,71 @@ namespace Kokoro::Graphics {
 		VkShaderModule shaderModule;
 		ShaderType sType;
 		List<SpecializationInfo>^ specializationDef;
+		SpirvReflection* reflection;
+		List<SpecializedShaderModule^>^ variants;
+		//Variants keyed by a hash of their constant data and stage flags
+		Dictionary<uint64_t, SpecializedShaderModule^>^ variantCache;
+		//Shared by every variant, fixed by the first Specialize call
+		VkSpecializationMapEntry* specMap;
+		uint32_t specMapCnt;
+		size_t specDataSz;
+		IntPtr entryPoint;
+		String^ entryPointName;
+		//Also the lock builds and reloads of the module synchronize on
+		List<IShaderDependent^>^ dependents;
+		//Pipeline builds currently reading the module, reloads are held back until they're done
+		int buildsInFlight;
+		//ShaderHotReload registration, 0 when the module isn't watched
+		uint32_t watchId;
+		//Set once deleted, the native state stays until the last variant used by a pipeline is freed
+		bool disposed;
+
+		//Brackets a pipeline build, which may run on any thread. d is registered once built, nullptr if the build failed.
+		void BeginBuild();
+		void EndBuild(IShaderDependent^ d);
+		void RemoveDependent(IShaderDependent^ d);
+		//Releases the native state shared with the variants.
+		void Free();
+		//Replaces the module with new SPIR-V, the old VkShaderModule is destroyed once in-flight frames retire.
+		void Reload(const uint32_t* code, size_t byteSize);
+		static ShaderCompiler* GetCompiler();
+		//Compiles GLSL embedded in the library itself, name only identifies it in error messages.
+		static ShaderModule^ FromSource(ShaderType sType, const char* name, const char* source);
 	private:
-		array<unsigned char>^ spv;
+		static ShaderCompiler* compiler;
+		ShaderModule(ShaderType sType, const uint32_t* code, size_t byteSize);
+		void Init(ShaderType sType, const uint32_t* code, size_t byteSize);
+		void FreezeSpecialization();
+		//Validates and reflects the SPIR-V, then takes a reference on the registry's module for it.
+		static VkShaderModule CreateModule(const uint32_t* code, size_t byteSize, ShaderType sType, SpirvReflection& refl);
 	public:
 		property String^ EntryPoint;
 		property bool RequireFullSubgroups;
+		//Workgroup size declared by a compute shader, 0 for other stages.
+		//Specialization constants may override it, see SpecializedShaderModule::GetLocalSize.
+		property uint32_t LocalSizeX { uint32_t get(); }
+		property uint32_t LocalSizeY { uint32_t get(); }
+		property uint32_t LocalSizeZ { uint32_t get(); }
 
 		ShaderModule(ShaderType sType, String^ fname);
 		~ShaderModule();
+
+		//Loads a .spv directly, or compiles GLSL through the on-disk SPIR-V cache when RebuildShaders is set
+		//or the prebuilt binary is missing or older than the source. Defines are NAME or NAME=VALUE.
+		static ShaderModule^ Load(ShaderType sType, String^ fname, ... array<String^>^ defines);
+		//Compiles every shader in parallel, defines apply to all of them.
+		static array<ShaderModule^>^ LoadAll(array<ShaderType>^ sTypes, array<String^>^ fnames, array<String^>^ defines);
+		//Must be configured before the first compile, and neither may be called while ShaderHotReload is enabled.
+		static void SetCacheDirectory(String^ dir);
+		static void AddIncludeDirectory(String^ dir);
+		static uint32_t GetCacheHitCount();
+		static uint32_t GetCacheMissCount();
+		//VkShaderModules alive in the device-wide registry, modules with identical SPIR-V count once.
+		static uint32_t GetUniqueModuleCount();
+
 		void DefineSpecializationConstant(uint32_t id, uint32_t offset, size_t size);
+		//Constants not defined with DefineSpecializationConstant are laid out in ascending id order.
+		//The data is copied, repeated requests with the same bytes return the same variant with another reference taken.
 		SpecializedShaderModule^ Specialize(IntPtr ptr, size_t sz);
 	};
 }
@@ -0,0 +1,277 @@
+#include "ShaderRegistry.h"
+#include <mutex>
+#include <unordered_map>
+#include <cstring>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+	const uint32_t SpvMagic = 0x07230203;
+
+	struct ModuleKey {
+		uint64_t h0;
+		uint64_t h1;
+		size_t size;
+
+		bool operator==(const ModuleKey& o) const {
+			return h0 == o.h0 && h1 == o.h1 && size == o.size;
+		}
+	};
+
+	struct ModuleKeyHash {
+		size_t operator()(const ModuleKey& k) const {
+			return static_cast<size_t>(k.h0 ^ k.h1);
+		}
+	};
+
+	struct ModuleEntry {
+		VkShaderModule module;
+		uint32_t refCount;
+	};
+
+	//Kept out of the header so the managed translation units never see <mutex>
+	struct RegistryState {
+		std::mutex lock;
+		std::unordered_map<ModuleKey, ModuleEntry, ModuleKeyHash> entries;
+		std::unordered_map<VkShaderModule, ModuleKey> keys;
+		uint64_t hits;
+		uint64_t misses;
+	};
+
+	//Two independently seeded FNV-1a passes, binaries aren't kept around to compare byte for byte
+	ModuleKey HashCode(const uint32_t* code, size_t byteSize) {
+		ModuleKey k;
+		k.h0 = 14695981039346656037ull;
+		k.h1 = 0x84222325cbf29ce4ull;
+		k.size = byteSize;
+		auto bytes = reinterpret_cast<const unsigned char*>(code);
+		for (size_t i = 0; i < byteSize; i++) {
+			k.h0 = (k.h0 ^ bytes[i]) * 1099511628211ull;
+			k.h1 = (k.h1 ^ bytes[i]) * 0x100000001b3ull;
+			k.h1 ^= k.h1 >> 29;
+		}
+		return k;
+	}
+}
+
+Kokoro::Graphics::MappedFile::MappedFile() {
+	data = nullptr;
+	size = 0;
+	handle = nullptr;
+}
+
+Kokoro::Graphics::MappedFile::~MappedFile() {
+	Close();
+}
+
+bool Kokoro::Graphics::MappedFile::Open(const char* path) {
+	Close();
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+		CloseHandle(file);
+		return false;
+	}
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	CloseHandle(file);
+	if (mapping == nullptr)
+		return false;
+	data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (data == nullptr) {
+		CloseHandle(mapping);
+		return false;
+	}
+	size = static_cast<size_t>(fileSize.QuadPart);
+	handle = mapping;
+#else
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return false;
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0) {
+		close(fd);
+		return false;
+	}
+	void* p = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (p == MAP_FAILED)
+		return false;
+	data = p;
+	size = static_cast<size_t>(st.st_size);
+#endif
+	return true;
+}
+
+void Kokoro::Graphics::MappedFile::Close() {
+	if (data == nullptr)
+		return;
+#ifdef _WIN32
+	UnmapViewOfFile(data);
+	CloseHandle(static_cast<HANDLE>(handle));
+#else
+	munmap(const_cast<void*>(data), size);
+#endif
+	data = nullptr;
+	size = 0;
+	handle = nullptr;
+}
+
+const void* Kokoro::Graphics::MappedFile::GetData() const {
+	return data;
+}
+
+size_t Kokoro::Graphics::MappedFile::GetSize() const {
+	return size;
+}
+
+Kokoro::Graphics::ShaderRegistry::ShaderRegistry() {
+	auto s = new RegistryState();
+	s->hits = 0;
+	s->misses = 0;
+	state = s;
+}
+
+Kokoro::Graphics::ShaderRegistry::~ShaderRegistry() {
+	delete static_cast<RegistryState*>(state);
+}
+
+bool Kokoro::Graphics::ShaderRegistry::Validate(const void* code, size_t byteSize, std::string& err) {
+	if (code == nullptr || byteSize < 5 * sizeof(uint32_t)) {
+		err = "SPIR-V binary is too small to hold a header.";
+		return false;
+	}
+	if (byteSize % sizeof(uint32_t) != 0) {
+		err = "SPIR-V binary size is not a multiple of 4 bytes.";
+		return false;
+	}
+	if (reinterpret_cast<uintptr_t>(code) % alignof(uint32_t) != 0) {
+		err = "SPIR-V binary is not 4 byte aligned.";
+		return false;
+	}
+	auto words = static_cast<const uint32_t*>(code);
+	if (words[0] != SpvMagic) {
+		err = "SPIR-V magic number mismatch, the file may be byte swapped or not SPIR-V.";
+		return false;
+	}
+	if (words[3] == 0) {
+		err = "SPIR-V id bound is zero.";
+		return false;
+	}
+
+	//Every instruction must fit in the binary
+	size_t wordCnt = byteSize / sizeof(uint32_t);
+	for (size_t i = 5; i < wordCnt;) {
+		uint32_t len = words[i] >> 16;
+		if (len == 0 || i + len > wordCnt) {
+			err = "SPIR-V instruction at word " + std::to_string(i) + " overruns the binary.";
+			return false;
+		}
+		i += len;
+	}
+	return true;
+}
+
+VkShaderModule Kokoro::Graphics::ShaderRegistry::Acquire(VkDevice dev, const uint32_t* code, size_t byteSize) {
+	auto s = static_cast<RegistryState*>(state);
+	auto key = HashCode(code, byteSize);
+
+	{
+		std::lock_guard<std::mutex> guard(s->lock);
+		auto it = s->entries.find(key);
+		if (it != s->entries.end()) {
+			s->hits++;
+			it->second.refCount++;
+			return it->second.module;
+		}
+		s->misses++;
+	}
+
+	VkShaderModuleCreateInfo smCreatInfo = {};
+	smCreatInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	smCreatInfo.codeSize = byteSize;
+	smCreatInfo.pCode = code;
+
+	VkShaderModule mod = VK_NULL_HANDLE;
+	if (vkCreateShaderModule(dev, &smCreatInfo, nullptr, &mod) != VK_SUCCESS)
+		return VK_NULL_HANDLE;
+
+	std::lock_guard<std::mutex> guard(s->lock);
+	auto it = s->entries.find(key);
+	if (it != s->entries.end()) {
+		//Lost a race against another load of the same binary
+		vkDestroyShaderModule(dev, mod, nullptr);
+		it->second.refCount++;
+		return it->second.module;
+	}
+	ModuleEntry e;
+	e.module = mod;
+	e.refCount = 1;
+	s->entries.emplace(key, e);
+	s->keys.emplace(mod, key);
+	return mod;
+}
+
+void Kokoro::Graphics::ShaderRegistry::Release(VkDevice dev, VkShaderModule mod) {
+	auto s = static_cast<RegistryState*>(state);
+	std::lock_guard<std::mutex> guard(s->lock);
+
+	auto k = s->keys.find(mod);
+	if (k == s->keys.end())
+		return;
+	auto it = s->entries.find(k->second);
+	if (--it->second.refCount == 0) {
+		vkDestroyShaderModule(dev, mod, nullptr);
+		s->entries.erase(it);
+		s->keys.erase(k);
+	}
+}
+
+bool Kokoro::Graphics::ShaderRegistry::GetCodeHash(VkShaderModule mod, uint64_t* h0, uint64_t* h1, size_t* byteSize) {
+	auto s = static_cast<RegistryState*>(state);
+	std::lock_guard<std::mutex> guard(s->lock);
+
+	auto k = s->keys.find(mod);
+	if (k == s->keys.end())
+		return false;
+	*h0 = k->second.h0;
+	*h1 = k->second.h1;
+	*byteSize = k->second.size;
+	return true;
+}
+
+uint32_t Kokoro::Graphics::ShaderRegistry::GetModuleCount() {
+	auto s = static_cast<RegistryState*>(state);
+	std::lock_guard<std::mutex> guard(s->lock);
+	return static_cast<uint32_t>(s->entries.size());
+}
+
+uint64_t Kokoro::Graphics::ShaderRegistry::GetHitCount() {
+	auto s = static_cast<RegistryState*>(state);
+	std::lock_guard<std::mutex> guard(s->lock);
+	return s->hits;
+}
+
+uint64_t Kokoro::Graphics::ShaderRegistry::GetMissCount() {
+	auto s = static_cast<RegistryState*>(state);
+	std::lock_guard<std::mutex> guard(s->lock);
+	return s->misses;
+}
+
+void Kokoro::Graphics::ShaderRegistry::Destroy(VkDevice dev) {
+	auto s = static_cast<RegistryState*>(state);
+	std::lock_guard<std::mutex> guard(s->lock);
+
+	for (auto& e : s->entries)
+		vkDestroyShaderModule(dev, e.second.module, nullptr);
+	s->entries.clear();
+	s->keys.clear();
+}
@@ -0,0 +1,54 @@
+#pragma once
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#define VK_USE_PLATFORM_WIN32_KHR
+#endif
+#include "vulkan/vulkan.h"
+#include <string>
+
+namespace Kokoro::Graphics {
+	//Read-only view of a whole file, unmapped on Close or destruction.
+	class MappedFile
+	{
+	private:
+		const void* data;
+		size_t size;
+		void* handle;
+	public:
+		MappedFile();
+		~MappedFile();
+
+		bool Open(const char* path);
+		void Close();
+		const void* GetData() const;
+		size_t GetSize() const;
+	};
+
+	//Device-wide set of VkShaderModules keyed by a hash of their SPIR-V, identical binaries share one refcounted module.
+	//The SPIR-V is only needed during Acquire, nothing is retained on the host.
+	class ShaderRegistry
+	{
+	private:
+		void* state;
+	public:
+		ShaderRegistry();
+		~ShaderRegistry();
+
+		//Checks size, alignment, magic and header bounds, err describes the first problem found.
+		static bool Validate(const void* code, size_t byteSize, std::string& err);
+
+		//Returns a module holding one reference, or VK_NULL_HANDLE if creation failed.
+		VkShaderModule Acquire(VkDevice dev, const uint32_t* code, size_t byteSize);
+		//Drops a reference, the module is destroyed with the last one.
+		void Release(VkDevice dev, VkShaderModule mod);
+		//Content hash of the SPIR-V mod was created from, stable across the handle being destroyed and reused.
+		//Returns false if mod isn't held by the registry.
+		bool GetCodeHash(VkShaderModule mod, uint64_t* h0, uint64_t* h1, size_t* byteSize);
+
+		uint32_t GetModuleCount();
+		uint64_t GetHitCount();
+		uint64_t GetMissCount();
+		void Destroy(VkDevice dev);
+	};
+}
@@ -0,0 +1,135 @@
+#include "ShaderWatcher.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+namespace {
+	struct WatchedJob {
+		Kokoro::Graphics::ShaderCompiler::Job job;
+		std::vector<uint32_t> lastSpirv;
+	};
+
+	struct WatcherState {
+		Kokoro::Graphics::ShaderCompiler* compiler;
+		fs::path dir;
+		std::chrono::milliseconds pollInterval;
+
+		std::mutex lock;
+		std::condition_variable wake;
+		bool stop;
+		uint32_t nextId;
+		std::map<uint32_t, WatchedJob> jobs;
+		std::vector<Kokoro::Graphics::ShaderWatcher::Update> updates;
+
+		std::map<std::string, fs::file_time_type> stamps;
+		std::thread thread;
+	};
+
+	//Returns true if any file was added, removed or modified since the last scan
+	bool Scan(WatcherState* s) {
+		std::map<std::string, fs::file_time_type> cur;
+		std::error_code ec;
+		for (auto it = fs::recursive_directory_iterator(s->dir, ec); !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+			if (!it->is_regular_file(ec))
+				continue;
+			auto ext = it->path().extension();
+			//Compiler output next to the sources must not retrigger a rebuild
+			if (ext == ".spv" || ext == ".glsl_out" || ext == ".tmp")
+				continue;
+			cur[it->path().string()] = it->last_write_time(ec);
+		}
+		bool changed = cur != s->stamps;
+		s->stamps.swap(cur);
+		return changed;
+	}
+
+	void WatchLoop(WatcherState* s) {
+		std::unique_lock<std::mutex> guard(s->lock);
+		while (!s->stop) {
+			s->wake.wait_for(guard, s->pollInterval, [s]() { return s->stop; });
+			if (s->stop)
+				break;
+
+			guard.unlock();
+			bool changed = Scan(s);
+			guard.lock();
+			if (!changed)
+				continue;
+
+			//Compile outside the lock so registration and TakeUpdates never wait on shaderc
+			auto snapshot = s->jobs;
+			guard.unlock();
+			for (auto& j : snapshot) {
+				auto r = s->compiler->Compile(j.second.job);
+				if (r.success && r.spirv == j.second.lastSpirv)
+					continue;
+
+				std::lock_guard<std::mutex> relock(s->lock);
+				auto live = s->jobs.find(j.first);
+				if (live == s->jobs.end())
+					continue;
+				Kokoro::Graphics::ShaderWatcher::Update u;
+				u.id = j.first;
+				u.success = r.success;
+				u.log = r.log;
+				if (r.success) {
+					live->second.lastSpirv = r.spirv;
+					u.spirv = std::move(r.spirv);
+				}
+				s->updates.push_back(std::move(u));
+			}
+			guard.lock();
+		}
+	}
+}
+
+Kokoro::Graphics::ShaderWatcher::ShaderWatcher(ShaderCompiler* compiler, const char* dir, uint32_t pollMs) {
+	auto s = new WatcherState();
+	s->compiler = compiler;
+	s->dir = dir;
+	s->pollInterval = std::chrono::milliseconds(pollMs);
+	s->stop = false;
+	s->nextId = 1;
+	Scan(s);
+	s->thread = std::thread(WatchLoop, s);
+	state = s;
+}
+
+Kokoro::Graphics::ShaderWatcher::~ShaderWatcher() {
+	auto s = static_cast<WatcherState*>(state);
+	{
+		std::lock_guard<std::mutex> guard(s->lock);
+		s->stop = true;
+	}
+	s->wake.notify_all();
+	s->thread.join();
+	delete s;
+}
+
+uint32_t Kokoro::Graphics::ShaderWatcher::AddJob(const ShaderCompiler::Job& job, const uint32_t* spirv, size_t wordCnt) {
+	auto s = static_cast<WatcherState*>(state);
+	std::lock_guard<std::mutex> guard(s->lock);
+	uint32_t id = s->nextId++;
+	s->jobs[id].job = job;
+	s->jobs[id].lastSpirv.assign(spirv, spirv + wordCnt);
+	return id;
+}
+
+void Kokoro::Graphics::ShaderWatcher::RemoveJob(uint32_t id) {
+	auto s = static_cast<WatcherState*>(state);
+	std::lock_guard<std::mutex> guard(s->lock);
+	s->jobs.erase(id);
+}
+
+void Kokoro::Graphics::ShaderWatcher::TakeUpdates(std::vector<Update>& updates) {
+	auto s = static_cast<WatcherState*>(state);
+	std::lock_guard<std::mutex> guard(s->lock);
+	updates.swap(s->updates);
+	s->updates.clear();
+}
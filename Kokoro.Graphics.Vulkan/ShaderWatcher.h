@@ -0,0 +1,31 @@
+#pragma once
+#include "ShaderCompiler.h"
+#include <string>
+#include <vector>
+
+namespace Kokoro::Graphics {
+	//Polls a shader directory on a background thread and recompiles the registered jobs whenever a file under it changes.
+	//Recompiles go through the ShaderCompiler cache, so only jobs whose preprocessed source changed produce new SPIR-V.
+	class ShaderWatcher
+	{
+	public:
+		struct Update {
+			uint32_t id;
+			bool success;
+			std::vector<uint32_t> spirv;
+			std::string log;
+		};
+	private:
+		void* state;
+	public:
+		ShaderWatcher(ShaderCompiler* compiler, const char* dir, uint32_t pollMs);
+		//Stops and joins the watcher thread.
+		~ShaderWatcher();
+
+		//spirv is the binary currently in use, identical recompiles are not reported.
+		uint32_t AddJob(const ShaderCompiler::Job& job, const uint32_t* spirv, size_t wordCnt);
+		void RemoveJob(uint32_t id);
+		//Returns the recompiles finished since the last call, failed compiles carry the compiler log.
+		void TakeUpdates(std::vector<Update>& updates);
+	};
+}
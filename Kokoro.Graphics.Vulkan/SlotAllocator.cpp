@@ -0,0 +1,59 @@
+#include "SlotAllocator.h"
+
+Kokoro::Graphics::SlotAllocator::SlotAllocator(uint32_t capacity, uint32_t framesInFlight) {
+	this->capacity = capacity;
+	this->framesInFlight = framesInFlight;
+	next = 0;
+	curFrame = 0;
+	live.resize(capacity, false);
+}
+
+uint32_t Kokoro::Graphics::SlotAllocator::Allocate() {
+	if (!freeSlots.empty()) {
+		auto slot = freeSlots.back();
+		freeSlots.pop_back();
+		live[slot] = true;
+		return slot;
+	}
+	if (next < capacity) {
+		live[next] = true;
+		return next++;
+	}
+	return InvalidSlot;
+}
+
+bool Kokoro::Graphics::SlotAllocator::Release(uint32_t slot) {
+	if (slot >= next || !live[slot])
+		return false;
+	live[slot] = false;
+	RetiredSlot r;
+	r.slot = slot;
+	r.frame = curFrame;
+	retired.push_back(r);
+	return true;
+}
+
+void Kokoro::Graphics::SlotAllocator::AdvanceFrame() {
+	curFrame++;
+
+	//Retired slots are pushed in frame order, so the ones safe to reuse are at the front
+	size_t i = 0;
+	for (; i < retired.size(); i++) {
+		if (curFrame - retired[i].frame < framesInFlight)
+			break;
+		freeSlots.push_back(retired[i].slot);
+	}
+	retired.erase(retired.begin(), retired.begin() + i);
+}
+
+uint32_t Kokoro::Graphics::SlotAllocator::GetCapacity() {
+	return capacity;
+}
+
+uint32_t Kokoro::Graphics::SlotAllocator::GetUsedCount() {
+	return next - static_cast<uint32_t>(freeSlots.size() + retired.size());
+}
+
+uint32_t Kokoro::Graphics::SlotAllocator::GetPendingCount() {
+	return static_cast<uint32_t>(retired.size());
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace Kokoro::Graphics {
+	//Hands out stable indices from a fixed range. Released slots are only reused once the
+	//frames that may still reference them have retired.
+	class SlotAllocator
+	{
+	private:
+		struct RetiredSlot {
+			uint32_t slot;
+			uint64_t frame;
+		};
+		std::vector<uint32_t> freeSlots;
+		std::vector<RetiredSlot> retired;
+		std::vector<bool> live;
+		uint32_t capacity;
+		uint32_t next;
+		uint32_t framesInFlight;
+		uint64_t curFrame;
+	public:
+		static const uint32_t InvalidSlot = UINT32_MAX;
+
+		SlotAllocator(uint32_t capacity, uint32_t framesInFlight);
+		uint32_t Allocate();
+		//Returns false if the slot isn't currently allocated, e.g. when released twice
+		bool Release(uint32_t slot);
+		void AdvanceFrame();
+		uint32_t GetCapacity();
+		//Slots handed out and not yet released
+		uint32_t GetUsedCount();
+		//Released slots waiting for their frames to retire before they can be reused
+		uint32_t GetPendingCount();
+	};
+}
@@ -1,39 +1,42 @@
 #include "SpecializedShaderModule.h"
 #include "ShaderModule.h"
+#include <cstring>
 
 using namespace System::Runtime::InteropServices;
 
-Kokoro::Graphics::SpecializedShaderModule::SpecializedShaderModule(ShaderModule^ sMod, IntPtr specData, size_t specSz) {
+Kokoro::Graphics::SpecializedShaderModule::SpecializedShaderModule(ShaderModule^ sMod, const void* data, size_t specSz) {
 	creatInfo = new VkPipelineShaderStageCreateInfo();
 	creatInfo->sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 	creatInfo->pNext = nullptr;
 	creatInfo->flags = sMod->RequireFullSubgroups ? VK_PIPELINE_SHADER_STAGE_CREATE_REQUIRE_FULL_SUBGROUPS_BIT_EXT : VK_PIPELINE_SHADER_STAGE_CREATE_ALLOW_VARYING_SUBGROUP_SIZE_BIT_EXT;
 	creatInfo->stage = ShaderTypeConv::Convert(sMod->sType);
 	creatInfo->module = sMod->shaderModule;
+	creatInfo->pName = (const char*)sMod->entryPoint.ToPointer();
 
 	sType = sMod->sType;
-	entryPoint = Marshal::StringToHGlobalAnsi(sMod->EntryPoint);
-	creatInfo->pName = (const char*)entryPoint.ToPointer();
-
-	if (specData != IntPtr::Zero && sMod->specializationDef->Count != 0) {
-		specializationInfoCnt = sMod->specializationDef->Count;
-		specMap = new VkSpecializationMapEntry[specializationInfoCnt];
-		for (int i = 0; i < specializationInfoCnt; i++) {
-			specMap[i].constantID = sMod->specializationDef[i].id;
-			specMap[i].offset = sMod->specializationDef[i].offset;
-			specMap[i].size = sMod->specializationDef[i].sz;
-		}
+	parent = sMod;
+	reflection = sMod->reflection;
+	cacheKey = 0;
+	cached = false;
+	refCount = 1;
+	pipelineRefs = 0;
+
+	if (specSz != 0) {
+		specData = new uint8_t[specSz];
+		memcpy(specData, data, specSz);
+
 		specInfo = new VkSpecializationInfo;
-		specInfo->mapEntryCount = specializationInfoCnt;
-		specInfo->pMapEntries = specMap;
+		specInfo->mapEntryCount = sMod->specMapCnt;
+		specInfo->pMapEntries = sMod->specMap;
 		specInfo->dataSize = specSz;
-		specInfo->pData = specData.ToPointer();
+		specInfo->pData = specData;
 
 		creatInfo->pSpecializationInfo = specInfo;
 	}
 	else {
+		specData = nullptr;
+		specInfo = nullptr;
 		creatInfo->pSpecializationInfo = nullptr;
-		specializationInfoCnt = 0;
 	}
 }
 
@@ -41,11 +44,96 @@ VkPipelineShaderStageCreateInfo* Kokoro::Graphics::SpecializedShaderModule::GetC
 	return creatInfo;
 }
 
-Kokoro::Graphics::SpecializedShaderModule::~SpecializedShaderModule() {
-	if (specializationInfoCnt != 0) {
-		delete specInfo;
-		delete[] specMap;
+bool Kokoro::Graphics::SpecializedShaderModule::Matches(const void* data, size_t specSz, VkPipelineShaderStageCreateFlags flags) {
+	if (creatInfo->flags != flags)
+		return false;
+	if (specInfo == nullptr)
+		return specSz == 0;
+	return specInfo->dataSize == specSz && memcmp(specData, data, specSz) == 0;
+}
+
+void Kokoro::Graphics::SpecializedShaderModule::GetLocalSize(uint32_t* x, uint32_t* y, uint32_t* z) {
+	uint32_t size[3], ids[3];
+	reflection->GetLocalSize(&size[0], &size[1], &size[2]);
+	reflection->GetLocalSizeSpecIds(&ids[0], &ids[1], &ids[2]);
+	for (int i = 0; i < 3 && specInfo != nullptr; i++)
+		for (uint32_t j = 0; j < specInfo->mapEntryCount; j++) {
+			auto& e = specInfo->pMapEntries[j];
+			if (e.constantID != ids[i] || e.offset + e.size > specInfo->dataSize)
+				continue;
+			//Workgroup sizes are 32 bit ints
+			uint32_t v = 0;
+			memcpy(&v, specData + e.offset, e.size < sizeof(v) ? e.size : sizeof(v));
+			size[i] = v;
+			break;
+		}
+	*x = size[0];
+	*y = size[1];
+	*z = size[2];
+}
+
+void Kokoro::Graphics::SpecializedShaderModule::Retarget() {
+	creatInfo->module = parent->shaderModule;
+}
+
+void Kokoro::Graphics::SpecializedShaderModule::AppendStateKey(PipelineStateKey& key) {
+	key.Append((uint64_t)creatInfo->stage);
+	key.Append((uint64_t)creatInfo->flags);
+	//Handles are reused once a reloaded or released module is destroyed, so key on the SPIR-V itself
+	uint64_t h0, h1;
+	size_t codeSz;
+	if (GraphicsDevice::GetShaderRegistry()->GetCodeHash(creatInfo->module, &h0, &h1, &codeSz)) {
+		key.Append(h0);
+		key.Append(h1);
+		key.Append((uint64_t)codeSz);
+	}
+	else
+		key.Append((uint64_t)creatInfo->module);
+	key.Append(creatInfo->pName, strlen(creatInfo->pName) + 1);
+
+	if (specInfo == nullptr) {
+		key.Append((uint64_t)0);
+		return;
+	}
+	key.Append((uint64_t)specInfo->mapEntryCount);
+	for (uint32_t i = 0; i < specInfo->mapEntryCount; i++) {
+		key.Append((uint64_t)specInfo->pMapEntries[i].constantID << 32 | specInfo->pMapEntries[i].offset);
+		key.Append((uint64_t)specInfo->pMapEntries[i].size);
 	}
-	Marshal::FreeHGlobal(entryPoint);
+	key.Append((uint64_t)specInfo->dataSize);
+	key.Append(specInfo->pData, specInfo->dataSize);
+}
+
+void Kokoro::Graphics::SpecializedShaderModule::AddPipelineRef() {
+	if (creatInfo == nullptr)
+		throw gcnew System::ObjectDisposedException("SpecializedShaderModule");
+	pipelineRefs++;
+}
+
+void Kokoro::Graphics::SpecializedShaderModule::ReleasePipelineRef() {
+	if (--pipelineRefs == 0 && refCount == 0)
+		Destroy();
+}
+
+Kokoro::Graphics::SpecializedShaderModule::~SpecializedShaderModule() {
+	if (refCount != 0 && --refCount == 0 && pipelineRefs == 0)
+		Destroy();
+}
+
+void Kokoro::Graphics::SpecializedShaderModule::Destroy() {
+	if (creatInfo == nullptr)
+		return;
+	refCount = 0;
+	parent->variants->Remove(this);
+	if (cached)
+		parent->variantCache->Remove(cacheKey);
+	//The last variant of a disposed module frees what they shared
+	if (parent->disposed && parent->variants->Count == 0)
+		parent->Free();
+	delete specInfo;
+	delete[] specData;
 	delete creatInfo;
-}
\ No newline at end of file
+	specInfo = nullptr;
+	specData = nullptr;
+	creatInfo = nullptr;
+}
@@ -1,23 +1,45 @@
 #pragma once
 #include "GraphicsDevice.h"
 #include "ShaderType.h"
+#include "SpirvReflection.h"
 
 using namespace System::Collections::Generic;
 
 namespace Kokoro::Graphics {
 	ref class ShaderModule;
+	//Cached per ShaderModule and shared by every Specialize call with the same data, each of which holds a reference.
+	//delete drops one reference, the variant is freed with the last one or along with its ShaderModule.
+	//Pipelines hold their own references, which keep the variant and its ShaderModule's state alive past either.
 	ref class SpecializedShaderModule
 	{
 	internal:
 		ShaderType sType;
-		SpecializedShaderModule(Kokoro::Graphics::ShaderModule^ sMod, IntPtr specData, size_t specSz);
+		//Owned by the ShaderModule, which must outlive this object
+		SpirvReflection* reflection;
+		Kokoro::Graphics::ShaderModule^ parent;
+		//Key in the parent's variant cache, only valid when cached is set
+		uint64_t cacheKey;
+		bool cached;
+		uint32_t refCount;
+		//Taken by pipelines using the variant, which rebuild from it until they're destroyed
+		uint32_t pipelineRefs;
+		SpecializedShaderModule(Kokoro::Graphics::ShaderModule^ sMod, const void* specData, size_t specSz);
 		VkPipelineShaderStageCreateInfo* GetCreateInfo();
+		void AppendStateKey(PipelineStateKey& key);
+		//Workgroup size with the variant's specialization constants applied, 0 if the shader declares none.
+		void GetLocalSize(uint32_t* x, uint32_t* y, uint32_t* z);
+		bool Matches(const void* specData, size_t specSz, VkPipelineShaderStageCreateFlags flags);
+		//Picks up the parent's module after a reload.
+		void Retarget();
+		void AddPipelineRef();
+		void ReleasePipelineRef();
+		//Frees the variant, pipeline references must have been released.
+		void Destroy();
 		~SpecializedShaderModule();
 	private:
 		VkSpecializationInfo* specInfo;
-		VkSpecializationMapEntry* specMap;
-		int specializationInfoCnt;
-		IntPtr entryPoint;
+		//Copy of the constant data, the map and entry point are shared with the parent
+		uint8_t* specData;
 		VkPipelineShaderStageCreateInfo* creatInfo;
 	public:
 	};
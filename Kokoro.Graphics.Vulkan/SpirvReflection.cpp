@@ -0,0 +1,450 @@
+#include "SpirvReflection.h"
+#include <algorithm>
+#include <unordered_map>
+#include <cstring>
+
+namespace {
+	const uint32_t SpvMagic = 0x07230203;
+
+	enum SpvOp : uint32_t {
+		OpEntryPoint = 15,
+		OpExecutionMode = 16,
+		OpTypeBool = 20,
+		OpTypeInt = 21,
+		OpTypeFloat = 22,
+		OpTypeVector = 23,
+		OpTypeMatrix = 24,
+		OpTypeImage = 25,
+		OpTypeSampler = 26,
+		OpTypeSampledImage = 27,
+		OpTypeArray = 28,
+		OpTypeRuntimeArray = 29,
+		OpTypeStruct = 30,
+		OpTypePointer = 32,
+		OpConstant = 43,
+		OpConstantComposite = 44,
+		OpSpecConstantTrue = 48,
+		OpSpecConstantFalse = 49,
+		OpSpecConstant = 50,
+		OpSpecConstantComposite = 51,
+		OpVariable = 59,
+		OpDecorate = 71,
+		OpMemberDecorate = 72,
+		OpExecutionModeId = 331,
+	};
+
+	enum SpvDecoration : uint32_t {
+		DecSpecId = 1,
+		DecBlock = 2,
+		DecBufferBlock = 3,
+		DecArrayStride = 6,
+		DecMatrixStride = 7,
+		DecBuiltIn = 11,
+		DecBinding = 33,
+		DecDescriptorSet = 34,
+		DecOffset = 35,
+	};
+
+	enum SpvStorageClass : uint32_t {
+		StorageUniformConstant = 0,
+		StorageUniform = 2,
+		StoragePushConstant = 9,
+		StorageStorageBuffer = 12,
+	};
+
+	const uint32_t ExecModeLocalSize = 17;
+	const uint32_t ExecModeLocalSizeId = 38;
+	const uint32_t BuiltInWorkgroupSize = 25;
+	const uint32_t DimBuffer = 5;
+	const uint32_t DimSubpassData = 6;
+
+	struct SpvId {
+		uint32_t op = 0;
+		//Operands following the result id, or following the result type for constants and variables
+		const uint32_t* args = nullptr;
+		uint32_t argCnt = 0;
+		uint32_t set = UINT32_MAX;
+		uint32_t binding = UINT32_MAX;
+		uint32_t specId = UINT32_MAX;
+		uint32_t arrayStride = 0;
+		uint32_t resultType = 0;
+		bool block = false;
+		bool bufferBlock = false;
+		bool workgroupSize = false;
+		std::vector<uint32_t> memberOffsets;
+		std::vector<uint32_t> memberMatrixStrides;
+	};
+
+	VkShaderStageFlags StageFromModel(uint32_t model) {
+		switch (model) {
+		case 0: return VK_SHADER_STAGE_VERTEX_BIT;
+		case 1: return VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
+		case 2: return VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+		case 3: return VK_SHADER_STAGE_GEOMETRY_BIT;
+		case 4: return VK_SHADER_STAGE_FRAGMENT_BIT;
+		case 5: return VK_SHADER_STAGE_COMPUTE_BIT;
+		default: return 0;
+		}
+	}
+
+	class Parser {
+	public:
+		std::vector<SpvId> ids;
+
+		uint32_t ConstantValue(uint32_t id) {
+			if (id >= ids.size())
+				return 0;
+			auto& c = ids[id];
+			if ((c.op == OpConstant || c.op == OpSpecConstant) && c.argCnt > 0)
+				return c.args[0];
+			return 0;
+		}
+
+		//UINT32_MAX unless id is a specialization constant
+		uint32_t SpecId(uint32_t id) {
+			if (id >= ids.size() || ids[id].op != OpSpecConstant)
+				return UINT32_MAX;
+			return ids[id].specId;
+		}
+
+		//Byte size of a type laid out with explicit offsets/strides, matrixStride comes from the enclosing member
+		uint32_t TypeSize(uint32_t id, uint32_t matrixStride) {
+			if (id >= ids.size())
+				return 0;
+			auto& t = ids[id];
+			switch (t.op) {
+			case OpTypeBool:
+				return 4;
+			case OpTypeInt:
+			case OpTypeFloat:
+				return t.args[0] / 8;
+			case OpTypeVector:
+				return TypeSize(t.args[0], 0) * t.args[1];
+			case OpTypeMatrix:
+				if (matrixStride != 0)
+					return matrixStride * t.args[1];
+				return TypeSize(t.args[0], 0) * t.args[1];
+			case OpTypeArray: {
+				uint32_t len = ConstantValue(t.args[1]);
+				uint32_t stride = t.arrayStride != 0 ? t.arrayStride : TypeSize(t.args[0], matrixStride);
+				return stride * len;
+			}
+			case OpTypeStruct: {
+				uint32_t sz = 0;
+				for (uint32_t m = 0; m < t.argCnt; m++) {
+					uint32_t off = m < t.memberOffsets.size() ? t.memberOffsets[m] : 0;
+					uint32_t stride = m < t.memberMatrixStrides.size() ? t.memberMatrixStrides[m] : 0;
+					sz = std::max(sz, off + TypeSize(t.args[m], stride));
+				}
+				return sz;
+			}
+			default:
+				return 0;
+			}
+		}
+	};
+}
+
+Kokoro::Graphics::SpirvReflection::SpirvReflection() {
+	stage = 0;
+	pushConstants = {};
+	localSize[0] = 0;
+	localSize[1] = 0;
+	localSize[2] = 0;
+	localSizeSpecIds[0] = UINT32_MAX;
+	localSizeSpecIds[1] = UINT32_MAX;
+	localSizeSpecIds[2] = UINT32_MAX;
+}
+
+bool Kokoro::Graphics::SpirvReflection::Parse(const uint32_t* code, size_t wordCnt, VkShaderStageFlags wantedStage) {
+	if (wordCnt < 5 || code[0] != SpvMagic)
+		return false;
+
+	Parser p;
+	p.ids.resize(code[3]);
+	stage = 0;
+	entryPoint.clear();
+	bindings.clear();
+	specConstants.clear();
+	pushConstants = {};
+	localSize[0] = 0;
+	localSize[1] = 0;
+	localSize[2] = 0;
+	localSizeSpecIds[0] = UINT32_MAX;
+	localSizeSpecIds[1] = UINT32_MAX;
+	localSizeSpecIds[2] = UINT32_MAX;
+
+	uint32_t entryId = UINT32_MAX;
+	std::vector<uint32_t> variables;
+	std::vector<uint32_t> localSizeIds;
+
+	//First pass records every id and its decorations
+	for (size_t i = 5; i < wordCnt;) {
+		uint32_t op = code[i] & 0xFFFF;
+		uint32_t len = code[i] >> 16;
+		if (len == 0 || i + len > wordCnt)
+			return false;
+		const uint32_t* w = code + i;
+
+		switch (op) {
+		case OpEntryPoint:
+			//Entry points all precede the execution modes, so the choice is final before those are read
+			if (len >= 4 && (entryId == UINT32_MAX || (stage != wantedStage && StageFromModel(w[1]) == wantedStage))) {
+				stage = StageFromModel(w[1]);
+				entryId = w[2];
+				auto name = reinterpret_cast<const char*>(w + 3);
+				entryPoint.assign(name, strnlen(name, (len - 3) * sizeof(uint32_t)));
+			}
+			break;
+		case OpExecutionMode:
+		case OpExecutionModeId:
+			if (w[1] == entryId && len >= 6) {
+				if (op == OpExecutionMode && w[2] == ExecModeLocalSize) {
+					localSize[0] = w[3];
+					localSize[1] = w[4];
+					localSize[2] = w[5];
+				}
+				else if (op == OpExecutionModeId && w[2] == ExecModeLocalSizeId)
+					localSizeIds.assign(w + 3, w + 6);
+			}
+			break;
+		case OpDecorate:
+			if (w[1] < p.ids.size()) {
+				auto& d = p.ids[w[1]];
+				switch (w[2]) {
+				case DecSpecId: d.specId = w[3]; break;
+				case DecBlock: d.block = true; break;
+				case DecBufferBlock: d.bufferBlock = true; break;
+				case DecArrayStride: d.arrayStride = w[3]; break;
+				case DecBuiltIn: d.workgroupSize = w[3] == BuiltInWorkgroupSize; break;
+				case DecBinding: d.binding = w[3]; break;
+				case DecDescriptorSet: d.set = w[3]; break;
+				}
+			}
+			break;
+		case OpMemberDecorate:
+			if (w[1] < p.ids.size() && (w[3] == DecOffset || w[3] == DecMatrixStride)) {
+				auto& v = w[3] == DecOffset ? p.ids[w[1]].memberOffsets : p.ids[w[1]].memberMatrixStrides;
+				if (v.size() <= w[2])
+					v.resize(w[2] + 1, 0);
+				v[w[2]] = w[4];
+			}
+			break;
+		case OpTypeBool:
+		case OpTypeInt:
+		case OpTypeFloat:
+		case OpTypeVector:
+		case OpTypeMatrix:
+		case OpTypeImage:
+		case OpTypeSampler:
+		case OpTypeSampledImage:
+		case OpTypeArray:
+		case OpTypeRuntimeArray:
+		case OpTypeStruct:
+		case OpTypePointer:
+			if (w[1] < p.ids.size()) {
+				auto& t = p.ids[w[1]];
+				t.op = op;
+				t.args = w + 2;
+				t.argCnt = len - 2;
+			}
+			break;
+		case OpConstant:
+		case OpConstantComposite:
+		case OpSpecConstantTrue:
+		case OpSpecConstantFalse:
+		case OpSpecConstant:
+		case OpSpecConstantComposite:
+		case OpVariable:
+			if (w[2] < p.ids.size()) {
+				auto& c = p.ids[w[2]];
+				c.op = op;
+				c.args = w + 3;
+				c.argCnt = len - 3;
+				c.resultType = w[1];
+				if (op == OpVariable)
+					variables.push_back(w[2]);
+			}
+			break;
+		}
+		i += len;
+	}
+
+	for (auto id : variables) {
+		auto& var = p.ids[id];
+		uint32_t storage = var.args[0];
+		uint32_t ptrType = var.resultType;
+		if (ptrType >= p.ids.size() || p.ids[ptrType].op != OpTypePointer)
+			return false;
+		uint32_t typeId = p.ids[ptrType].args[1];
+
+		if (storage == StoragePushConstant) {
+			auto& t = p.ids[typeId];
+			uint32_t minOff = UINT32_MAX;
+			for (auto off : t.memberOffsets)
+				minOff = std::min(minOff, off);
+			if (minOff == UINT32_MAX)
+				minOff = 0;
+			pushConstants.stageFlags = stage;
+			pushConstants.offset = minOff;
+			pushConstants.size = p.TypeSize(typeId, 0) - minOff;
+			continue;
+		}
+
+		if (storage != StorageUniformConstant && storage != StorageUniform && storage != StorageStorageBuffer)
+			continue;
+		if (var.set == UINT32_MAX || var.binding == UINT32_MAX)
+			continue;
+
+		Binding b = {};
+		b.set = var.set;
+		b.binding = var.binding;
+		b.count = 1;
+		b.stages = stage;
+
+		//Peel off arrays of descriptors
+		while (p.ids[typeId].op == OpTypeArray || p.ids[typeId].op == OpTypeRuntimeArray) {
+			auto& arr = p.ids[typeId];
+			b.count = arr.op == OpTypeRuntimeArray ? 0 : b.count * p.ConstantValue(arr.args[1]);
+			typeId = arr.args[0];
+		}
+
+		auto& t = p.ids[typeId];
+		switch (t.op) {
+		case OpTypeSampler:
+			b.type = VK_DESCRIPTOR_TYPE_SAMPLER;
+			break;
+		case OpTypeSampledImage:
+			b.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			break;
+		case OpTypeImage:
+			//Operands: sampled type, dim, depth, arrayed, ms, sampled, format
+			if (t.args[1] == DimSubpassData)
+				b.type = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+			else if (t.args[1] == DimBuffer)
+				b.type = t.args[5] == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+			else
+				b.type = t.args[5] == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+			break;
+		case OpTypeStruct:
+			if (storage == StorageStorageBuffer || t.bufferBlock)
+				b.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			else if (t.block)
+				b.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+			else
+				continue;
+			break;
+		default:
+			//e.g. acceleration structures, which descriptor sets can't describe yet
+			continue;
+		}
+		bindings.push_back(b);
+	}
+
+	for (uint32_t id = 0; id < p.ids.size(); id++) {
+		auto& c = p.ids[id];
+		if (c.specId != UINT32_MAX) {
+			SpecConstant s = {};
+			s.id = c.specId;
+			s.size = c.op == OpSpecConstant ? p.TypeSize(c.resultType, 0) : 4;
+			specConstants.push_back(s);
+		}
+		//The WorkgroupSize builtin overrides the execution mode
+		if (c.workgroupSize && (c.op == OpConstantComposite || c.op == OpSpecConstantComposite) && c.argCnt == 3) {
+			for (int i = 0; i < 3; i++) {
+				localSize[i] = p.ConstantValue(c.args[i]);
+				localSizeSpecIds[i] = p.SpecId(c.args[i]);
+			}
+		}
+	}
+	if (localSizeIds.size() == 3)
+		for (int i = 0; i < 3; i++) {
+			localSize[i] = p.ConstantValue(localSizeIds[i]);
+			localSizeSpecIds[i] = p.SpecId(localSizeIds[i]);
+		}
+
+	std::sort(bindings.begin(), bindings.end(), [](const Binding& a, const Binding& b) {
+		return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+		});
+	std::sort(specConstants.begin(), specConstants.end(), [](const SpecConstant& a, const SpecConstant& b) {
+		return a.id < b.id;
+		});
+	return stage != 0;
+}
+
+VkShaderStageFlags Kokoro::Graphics::SpirvReflection::GetStage() const {
+	return stage;
+}
+
+const std::string& Kokoro::Graphics::SpirvReflection::GetEntryPoint() const {
+	return entryPoint;
+}
+
+const std::vector<Kokoro::Graphics::SpirvReflection::Binding>& Kokoro::Graphics::SpirvReflection::GetBindings() const {
+	return bindings;
+}
+
+const std::vector<Kokoro::Graphics::SpirvReflection::SpecConstant>& Kokoro::Graphics::SpirvReflection::GetSpecConstants() const {
+	return specConstants;
+}
+
+bool Kokoro::Graphics::SpirvReflection::GetPushConstantRange(VkPushConstantRange* range) const {
+	if (pushConstants.size == 0)
+		return false;
+	*range = pushConstants;
+	return true;
+}
+
+void Kokoro::Graphics::SpirvReflection::GetLocalSize(uint32_t* x, uint32_t* y, uint32_t* z) const {
+	*x = localSize[0];
+	*y = localSize[1];
+	*z = localSize[2];
+}
+
+void Kokoro::Graphics::SpirvReflection::GetLocalSizeSpecIds(uint32_t* x, uint32_t* y, uint32_t* z) const {
+	*x = localSizeSpecIds[0];
+	*y = localSizeSpecIds[1];
+	*z = localSizeSpecIds[2];
+}
+
+bool Kokoro::Graphics::SpirvReflection::Merge(const SpirvReflection* const* stages, uint32_t stageCnt, std::vector<Binding>& mergedBindings, std::vector<VkPushConstantRange>& mergedRanges) {
+	mergedBindings.clear();
+	mergedRanges.clear();
+
+	std::unordered_map<uint64_t, size_t> slots;
+	for (uint32_t s = 0; s < stageCnt; s++) {
+		for (auto& b : stages[s]->bindings) {
+			uint64_t k = (uint64_t)b.set << 32 | b.binding;
+			auto it = slots.find(k);
+			if (it == slots.end()) {
+				slots[k] = mergedBindings.size();
+				mergedBindings.push_back(b);
+				continue;
+			}
+			auto& m = mergedBindings[it->second];
+			if (m.type != b.type)
+				return false;
+			m.stages |= b.stages;
+			m.count = (m.count == 0 || b.count == 0) ? 0 : std::max(m.count, b.count);
+		}
+
+		//Stages sharing an identical block share one range, otherwise each stage gets its own
+		VkPushConstantRange r;
+		if (stages[s]->GetPushConstantRange(&r)) {
+			bool found = false;
+			for (auto& m : mergedRanges)
+				if (m.offset == r.offset && m.size == r.size) {
+					m.stageFlags |= r.stageFlags;
+					found = true;
+					break;
+				}
+			if (!found)
+				mergedRanges.push_back(r);
+		}
+	}
+
+	std::sort(mergedBindings.begin(), mergedBindings.end(), [](const Binding& a, const Binding& b) {
+		return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+		});
+	return true;
+}
@@ -0,0 +1,57 @@
+#pragma once
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#define VK_USE_PLATFORM_WIN32_KHR
+#endif
+#include "vulkan/vulkan.h"
+#include <vector>
+#include <string>
+
+namespace Kokoro::Graphics {
+	//Extracts the resource interface of a SPIR-V module: descriptor bindings, push constants, specialization constants and workgroup size.
+	class SpirvReflection
+	{
+	public:
+		struct Binding {
+			uint32_t set;
+			uint32_t binding;
+			VkDescriptorType type;
+			//0 for runtime sized arrays
+			uint32_t count;
+			VkShaderStageFlags stages;
+		};
+		struct SpecConstant {
+			uint32_t id;
+			uint32_t size;
+		};
+	private:
+		VkShaderStageFlags stage;
+		std::string entryPoint;
+		std::vector<Binding> bindings;
+		std::vector<SpecConstant> specConstants;
+		VkPushConstantRange pushConstants;
+		uint32_t localSize[3];
+		uint32_t localSizeSpecIds[3];
+	public:
+		SpirvReflection();
+		//Reflects the first entry point for wantedStage, or the module's first entry point if none matches or wantedStage is 0.
+		//Returns false if the module is malformed, resources of types the reflector doesn't know are skipped.
+		bool Parse(const uint32_t* code, size_t wordCnt, VkShaderStageFlags wantedStage);
+
+		VkShaderStageFlags GetStage() const;
+		const std::string& GetEntryPoint() const;
+		const std::vector<Binding>& GetBindings() const;
+		const std::vector<SpecConstant>& GetSpecConstants() const;
+		//Returns false if the module declares no push constant block.
+		bool GetPushConstantRange(VkPushConstantRange* range) const;
+		//Default values, specialization may override the dimensions that have a spec id.
+		void GetLocalSize(uint32_t* x, uint32_t* y, uint32_t* z) const;
+		//UINT32_MAX for dimensions that aren't specialization constants.
+		void GetLocalSizeSpecIds(uint32_t* x, uint32_t* y, uint32_t* z) const;
+
+		//Combines the stages of a pipeline, each binding is visible only to the stages that declare it.
+		//Returns false if two stages declare the same binding with different descriptor types.
+		static bool Merge(const SpirvReflection* const* stages, uint32_t stageCnt, std::vector<Binding>& mergedBindings, std::vector<VkPushConstantRange>& mergedRanges);
+	};
+}
@@ -0,0 +1,300 @@
+#include "TextureFile.h"
+#include "ImageFormat.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+	const uint8_t Ktx2Identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+	const size_t Ktx2HeaderSize = 80;
+	const size_t Ktx2LevelIndexEntrySize = 24;
+
+	const uint32_t DdsMagic = 0x20534444;
+	const size_t DdsHeaderSize = 128;
+	const size_t DdsDx10HeaderSize = 20;
+	const uint32_t DdsPixelAlpha = 0x1;
+	const uint32_t DdsPixelFourCC = 0x4;
+	const uint32_t DdsPixelRGB = 0x40;
+	const uint32_t DdsCaps2Cubemap = 0x200;
+	const uint32_t DdsCaps2Volume = 0x200000;
+	const uint32_t DdsMiscTextureCube = 0x4;
+
+	constexpr uint32_t FourCC(char a, char b, char c, char d) {
+		return uint32_t(uint8_t(a)) | (uint32_t(uint8_t(b)) << 8) | (uint32_t(uint8_t(c)) << 16) | (uint32_t(uint8_t(d)) << 24);
+	}
+
+	template<typename T>
+	T Read(const uint8_t* base, size_t off) {
+		T v;
+		memcpy(&v, base + off, sizeof(T));
+		return v;
+	}
+
+	VkFormat FormatFromDxgi(uint32_t dxgi) {
+		switch (dxgi) {
+		case 28: return VK_FORMAT_R8G8B8A8_UNORM;
+		case 29: return VK_FORMAT_R8G8B8A8_SRGB;
+		case 70:
+		case 71: return VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+		case 72: return VK_FORMAT_BC1_RGBA_SRGB_BLOCK;
+		case 74: return VK_FORMAT_BC2_UNORM_BLOCK;
+		case 75: return VK_FORMAT_BC2_SRGB_BLOCK;
+		case 77: return VK_FORMAT_BC3_UNORM_BLOCK;
+		case 78: return VK_FORMAT_BC3_SRGB_BLOCK;
+		case 80: return VK_FORMAT_BC4_UNORM_BLOCK;
+		case 81: return VK_FORMAT_BC4_SNORM_BLOCK;
+		case 83: return VK_FORMAT_BC5_UNORM_BLOCK;
+		case 84: return VK_FORMAT_BC5_SNORM_BLOCK;
+		case 87: return VK_FORMAT_B8G8R8A8_UNORM;
+		case 91: return VK_FORMAT_B8G8R8A8_SRGB;
+		case 95: return VK_FORMAT_BC6H_UFLOAT_BLOCK;
+		case 96: return VK_FORMAT_BC6H_SFLOAT_BLOCK;
+		case 98: return VK_FORMAT_BC7_UNORM_BLOCK;
+		case 99: return VK_FORMAT_BC7_SRGB_BLOCK;
+		default: return VK_FORMAT_UNDEFINED;
+		}
+	}
+
+	VkFormat FormatFromFourCC(uint32_t fourCC) {
+		switch (fourCC) {
+		case FourCC('D', 'X', 'T', '1'): return VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+		case FourCC('D', 'X', 'T', '2'):
+		case FourCC('D', 'X', 'T', '3'): return VK_FORMAT_BC2_UNORM_BLOCK;
+		case FourCC('D', 'X', 'T', '4'):
+		case FourCC('D', 'X', 'T', '5'): return VK_FORMAT_BC3_UNORM_BLOCK;
+		case FourCC('A', 'T', 'I', '1'):
+		case FourCC('B', 'C', '4', 'U'): return VK_FORMAT_BC4_UNORM_BLOCK;
+		case FourCC('B', 'C', '4', 'S'): return VK_FORMAT_BC4_SNORM_BLOCK;
+		case FourCC('A', 'T', 'I', '2'):
+		case FourCC('B', 'C', '5', 'U'): return VK_FORMAT_BC5_UNORM_BLOCK;
+		case FourCC('B', 'C', '5', 'S'): return VK_FORMAT_BC5_SNORM_BLOCK;
+		default: return VK_FORMAT_UNDEFINED;
+		}
+	}
+}
+
+Kokoro::Graphics::TextureFile::TextureFile() {
+	format = VK_FORMAT_UNDEFINED;
+	width = 0;
+	height = 0;
+	depth = 0;
+	layers = 0;
+	faces = 0;
+}
+
+bool Kokoro::Graphics::TextureFile::GetBlockInfo(VkFormat fmt, uint32_t* blockDim, uint32_t* blockBytes) {
+	ImageFormat f;
+	if (!ImageFormatConv::FromVk(fmt, &f) || (ImageFormatConv::Aspect(f) & VK_IMAGE_ASPECT_COLOR_BIT) == 0)
+		return false;
+	auto& info = ImageFormatConv::GetInfo(f);
+	*blockDim = info.blockDim;
+	*blockBytes = info.blockBytes;
+	return true;
+}
+
+void Kokoro::Graphics::TextureFile::InitLevels(uint32_t levelCnt) {
+	uint32_t blockDim, blockBytes;
+	GetBlockInfo(format, &blockDim, &blockBytes);
+
+	levels.resize(levelCnt);
+	for (uint32_t i = 0; i < levelCnt; i++) {
+		auto& l = levels[i];
+		l.width = std::max(width >> i, 1u);
+		l.height = std::max(height >> i, 1u);
+		l.depth = std::max(depth >> i, 1u);
+		l.layerSize = size_t((l.width + blockDim - 1) / blockDim) * ((l.height + blockDim - 1) / blockDim) * l.depth * blockBytes;
+		l.layerOffsets.resize(size_t(layers) * faces);
+	}
+}
+
+bool Kokoro::Graphics::TextureFile::ParseKtx2(std::string& err) {
+	auto data = GetData();
+	size_t sz = file.GetSize();
+	if (sz < Ktx2HeaderSize) {
+		err = "Truncated KTX2 header.";
+		return false;
+	}
+
+	format = static_cast<VkFormat>(Read<uint32_t>(data, 12));
+	width = Read<uint32_t>(data, 20);
+	height = std::max(Read<uint32_t>(data, 24), 1u);
+	depth = std::max(Read<uint32_t>(data, 28), 1u);
+	layers = std::max(Read<uint32_t>(data, 32), 1u);
+	faces = Read<uint32_t>(data, 36);
+	//0 means only the base level is stored, the texture is then streamed without a mip chain
+	uint32_t levelCnt = std::max(Read<uint32_t>(data, 40), 1u);
+	uint32_t supercompression = Read<uint32_t>(data, 44);
+
+	uint32_t blockDim, blockBytes;
+	if (supercompression != 0) {
+		err = "Supercompressed KTX2 files are not supported.";
+		return false;
+	}
+	if (!GetBlockInfo(format, &blockDim, &blockBytes)) {
+		err = "Unsupported KTX2 format " + std::to_string(format) + ".";
+		return false;
+	}
+	if (width == 0 || (faces != 1 && faces != 6) || levelCnt > 32) {
+		err = "Invalid KTX2 dimensions.";
+		return false;
+	}
+	if (sz < Ktx2HeaderSize + levelCnt * Ktx2LevelIndexEntrySize) {
+		err = "Truncated KTX2 level index.";
+		return false;
+	}
+
+	InitLevels(levelCnt);
+	for (uint32_t i = 0; i < levelCnt; i++) {
+		auto entry = Ktx2HeaderSize + i * Ktx2LevelIndexEntrySize;
+		uint64_t offset = Read<uint64_t>(data, entry);
+		uint64_t length = Read<uint64_t>(data, entry + 8);
+		auto& l = levels[i];
+		if (length < l.layerSize * l.layerOffsets.size() || offset > sz || length > sz - offset) {
+			err = "KTX2 level " + std::to_string(i) + " is out of bounds.";
+			return false;
+		}
+		for (size_t j = 0; j < l.layerOffsets.size(); j++)
+			l.layerOffsets[j] = static_cast<size_t>(offset) + j * l.layerSize;
+	}
+	return true;
+}
+
+bool Kokoro::Graphics::TextureFile::ParseDds(std::string& err) {
+	auto data = GetData();
+	size_t sz = file.GetSize();
+	if (sz < DdsHeaderSize || Read<uint32_t>(data, 4) != 124) {
+		err = "Truncated DDS header.";
+		return false;
+	}
+
+	height = std::max(Read<uint32_t>(data, 12), 1u);
+	width = Read<uint32_t>(data, 16);
+	depth = 1;
+	uint32_t levelCnt = std::max(Read<uint32_t>(data, 28), 1u);
+	uint32_t pfFlags = Read<uint32_t>(data, 80);
+	uint32_t fourCC = Read<uint32_t>(data, 84);
+	uint32_t caps2 = Read<uint32_t>(data, 112);
+	layers = 1;
+	faces = (caps2 & DdsCaps2Cubemap) ? 6 : 1;
+	if (caps2 & DdsCaps2Volume)
+		depth = std::max(Read<uint32_t>(data, 24), 1u);
+
+	size_t offset = DdsHeaderSize;
+	format = VK_FORMAT_UNDEFINED;
+	if ((pfFlags & DdsPixelFourCC) && fourCC == FourCC('D', 'X', '1', '0')) {
+		if (sz < DdsHeaderSize + DdsDx10HeaderSize) {
+			err = "Truncated DDS DX10 header.";
+			return false;
+		}
+		format = FormatFromDxgi(Read<uint32_t>(data, 128));
+		if (Read<uint32_t>(data, 136) & DdsMiscTextureCube)
+			faces = 6;
+		layers = std::max(Read<uint32_t>(data, 140), 1u);
+		offset += DdsDx10HeaderSize;
+	}
+	else if (pfFlags & DdsPixelFourCC) {
+		format = FormatFromFourCC(fourCC);
+		//DXT1 without alpha uses the fourth color instead of punch through transparency
+		if (format == VK_FORMAT_BC1_RGBA_UNORM_BLOCK && !(pfFlags & DdsPixelAlpha))
+			format = VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+	}
+	else if ((pfFlags & DdsPixelRGB) && Read<uint32_t>(data, 88) == 32) {
+		//Only the two 8 bit channel orders are common enough to bother with
+		uint32_t rMask = Read<uint32_t>(data, 92);
+		if (rMask == 0x000000FF)
+			format = VK_FORMAT_R8G8B8A8_UNORM;
+		else if (rMask == 0x00FF0000)
+			format = VK_FORMAT_B8G8R8A8_UNORM;
+	}
+	if (format == VK_FORMAT_UNDEFINED) {
+		err = "Unsupported DDS pixel format.";
+		return false;
+	}
+	if (width == 0 || levelCnt > 32) {
+		err = "Invalid DDS dimensions.";
+		return false;
+	}
+
+	//DDS stores every level of a layer before moving on to the next layer
+	InitLevels(levelCnt);
+	for (size_t j = 0; j < size_t(layers) * faces; j++)
+		for (auto& l : levels) {
+			l.layerOffsets[j] = offset;
+			offset += l.layerSize;
+		}
+	if (offset > sz) {
+		err = "DDS file is truncated.";
+		return false;
+	}
+	return true;
+}
+
+bool Kokoro::Graphics::TextureFile::Open(const char* path, bool allowBC, std::string& err) {
+	Close();
+	if (!file.Open(path)) {
+		err = std::string("Unable to map ") + path;
+		return false;
+	}
+
+	bool ok;
+	if (file.GetSize() >= sizeof(Ktx2Identifier) && memcmp(GetData(), Ktx2Identifier, sizeof(Ktx2Identifier)) == 0)
+		ok = ParseKtx2(err);
+	else if (file.GetSize() >= sizeof(uint32_t) && Read<uint32_t>(GetData(), 0) == DdsMagic)
+		ok = ParseDds(err);
+	else {
+		err = "Not a KTX2 or DDS file.";
+		ok = false;
+	}
+	uint32_t blockDim, blockBytes;
+	if (ok && !allowBC && GetBlockInfo(format, &blockDim, &blockBytes) && blockDim != 1) {
+		err = "Device does not support BC compressed textures.";
+		ok = false;
+	}
+	if (!ok)
+		Close();
+	return ok;
+}
+
+void Kokoro::Graphics::TextureFile::Close() {
+	file.Close();
+	levels.clear();
+}
+
+VkFormat Kokoro::Graphics::TextureFile::GetFormat() const {
+	return format;
+}
+
+uint32_t Kokoro::Graphics::TextureFile::GetWidth() const {
+	return width;
+}
+
+uint32_t Kokoro::Graphics::TextureFile::GetHeight() const {
+	return height;
+}
+
+uint32_t Kokoro::Graphics::TextureFile::GetDepth() const {
+	return depth;
+}
+
+uint32_t Kokoro::Graphics::TextureFile::GetLayerCount() const {
+	return layers;
+}
+
+uint32_t Kokoro::Graphics::TextureFile::GetFaceCount() const {
+	return faces;
+}
+
+uint32_t Kokoro::Graphics::TextureFile::GetLevelCount() const {
+	return static_cast<uint32_t>(levels.size());
+}
+
+const Kokoro::Graphics::TextureFile::Level& Kokoro::Graphics::TextureFile::GetLevel(uint32_t level) const {
+	return levels[level];
+}
+
+size_t Kokoro::Graphics::TextureFile::GetLevelSize(uint32_t level) const {
+	return levels[level].layerSize * levels[level].layerOffsets.size();
+}
+
+const uint8_t* Kokoro::Graphics::TextureFile::GetData() const {
+	return static_cast<const uint8_t*>(file.GetData());
+}
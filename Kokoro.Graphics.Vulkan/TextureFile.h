@@ -0,0 +1,62 @@
+#pragma once
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#define VK_USE_PLATFORM_WIN32_KHR
+#endif
+#include "vulkan/vulkan.h"
+#include "ShaderRegistry.h"
+#include <string>
+#include <vector>
+
+namespace Kokoro::Graphics {
+	//KTX2 or DDS texture read in place from a memory mapped file, level data is only touched when it is uploaded.
+	//Level 0 is the largest, supercompressed KTX2 files are rejected.
+	class TextureFile
+	{
+	public:
+		struct Level {
+			uint32_t width;
+			uint32_t height;
+			uint32_t depth;
+			//Bytes of a single layer or face
+			size_t layerSize;
+			//One entry per array layer and face, faces vary fastest to match Vulkan's layer order
+			std::vector<size_t> layerOffsets;
+		};
+	private:
+		MappedFile file;
+		VkFormat format;
+		uint32_t width;
+		uint32_t height;
+		uint32_t depth;
+		uint32_t layers;
+		uint32_t faces;
+		std::vector<Level> levels;
+
+		void InitLevels(uint32_t levelCnt);
+		bool ParseKtx2(std::string& err);
+		bool ParseDds(std::string& err);
+	public:
+		TextureFile();
+
+		//Without allowBC, block compressed files fail to open instead of failing at image creation.
+		bool Open(const char* path, bool allowBC, std::string& err);
+		void Close();
+
+		VkFormat GetFormat() const;
+		uint32_t GetWidth() const;
+		uint32_t GetHeight() const;
+		uint32_t GetDepth() const;
+		uint32_t GetLayerCount() const;
+		uint32_t GetFaceCount() const;
+		uint32_t GetLevelCount() const;
+		const Level& GetLevel(uint32_t level) const;
+		//Every layer and face of the level
+		size_t GetLevelSize(uint32_t level) const;
+		const uint8_t* GetData() const;
+
+		//Texel block footprint, false for formats the loader doesn't handle.
+		static bool GetBlockInfo(VkFormat fmt, uint32_t* blockDim, uint32_t* blockBytes);
+	};
+}
@@ -0,0 +1,293 @@
+#include "TextureStreamer.h"
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace System::Runtime::InteropServices;
+
+//Levels are copied at block aligned offsets, 16 covers every supported format
+static const size_t StagingAlignment = 16;
+static const uint64_t MipTailSize = 64 * 1024;
+
+Kokoro::Graphics::StreamedTexture::StreamedTexture(TextureFile* file, size_t stagingSize) {
+	this->file = file;
+	image = nullptr;
+
+	int count = static_cast<int>(file->GetLevelCount());
+	finestLevel = 0;
+	while (finestLevel < count - 1 && GetStagingSize(finestLevel, finestLevel + 1) > stagingSize)
+		finestLevel++;
+	tailLevel = count - 1;
+	while (tailLevel > finestLevel && GetSize(tailLevel - 1) <= MipTailSize)
+		tailLevel--;
+
+	if (file->GetFaceCount() == 6)
+		viewType = file->GetLayerCount() > 1 ? ImageViewType::ViewCubeArray : ImageViewType::ViewCube;
+	else if (file->GetDepth() > 1)
+		viewType = ImageViewType::View3D;
+	else
+		viewType = file->GetLayerCount() > 1 ? ImageViewType::View2DArray : ImageViewType::View2D;
+
+	residentLevel = count;
+	targetLevel = count;
+	requestedLevel = 0;
+	requested = false;
+	lastUsed = 0;
+	version = 0;
+}
+
+void Kokoro::Graphics::StreamedTexture::Free() {
+	delete file;
+	file = nullptr;
+}
+
+uint64_t Kokoro::Graphics::StreamedTexture::GetSize(int firstLevel) {
+	uint64_t sz = 0;
+	for (int l = firstLevel; l < LevelCount; l++)
+		sz += file->GetLevelSize(l);
+	return sz;
+}
+
+size_t Kokoro::Graphics::StreamedTexture::GetStagingSize(int firstLevel, int endLevel) {
+	size_t sz = 0;
+	for (int l = firstLevel; l < endLevel; l++) {
+		auto& lvl = file->GetLevel(l);
+		sz += lvl.layerOffsets.size() * ((lvl.layerSize + StagingAlignment - 1) & ~(StagingAlignment - 1));
+	}
+	return sz;
+}
+
+int Kokoro::Graphics::StreamedTexture::LevelCount::get() {
+	return static_cast<int>(file->GetLevelCount());
+}
+
+int Kokoro::Graphics::StreamedTexture::ResidentLevel::get() {
+	return residentLevel;
+}
+
+bool Kokoro::Graphics::StreamedTexture::FullyResident::get() {
+	return residentLevel == 0;
+}
+
+uint32_t Kokoro::Graphics::StreamedTexture::Version::get() {
+	return version;
+}
+
+Kokoro::Graphics::ImageView^ Kokoro::Graphics::StreamedTexture::GetView() {
+	if (image == nullptr)
+		return nullptr;
+	return image->GetView(viewType);
+}
+
+void Kokoro::Graphics::StreamedTexture::Request(int level) {
+	if (!requested || level < requestedLevel)
+		requestedLevel = std::max(level, 0);
+	requested = true;
+}
+
+Kokoro::Graphics::TextureStreamer::TextureStreamer(size_t stagingSize, uint64_t budget) {
+	if (stagingSize < MipTailSize)
+		throw gcnew System::ArgumentOutOfRangeException("stagingSize", "The staging area must hold at least a full mip tail.");
+	this->stagingSize = (stagingSize + StagingAlignment - 1) & ~(StagingAlignment - 1);
+	Budget = budget;
+	textures = gcnew List<StreamedTexture^>();
+	retired = gcnew List<RetiredImage^>();
+	residentBytes = 0;
+	frame = 0;
+
+	//One region per frame in flight, a region is rewritten once the frame that read it has retired
+	staging = GPUBuffer::Allocate(SharingMode::Exclusive, BufferUsage::TransferSrc, MemoryUsage::CpuToGpu, this->stagingSize * GraphicsDevice::GetMaxFramesInFlight(), true);
+	void* ptr = nullptr;
+	staging->Map(0, staging->Size, &ptr);
+	stagingPtr = static_cast<uint8_t*>(ptr);
+}
+
+Kokoro::Graphics::TextureStreamer::~TextureStreamer() {
+	for each (StreamedTexture^ t in textures) {
+		delete t->image;
+		t->Free();
+	}
+	textures->Clear();
+	for each (RetiredImage^ r in retired)
+		delete r->Img;
+	retired->Clear();
+	delete staging;
+}
+
+Kokoro::Graphics::StreamedTexture^ Kokoro::Graphics::TextureStreamer::Load(String^ path) {
+	IntPtr p = Marshal::StringToHGlobalAnsi(path);
+	auto file = new TextureFile();
+	std::string err;
+	bool ok = file->Open((const char*)p.ToPointer(), GraphicsDevice::SupportsTextureCompressionBC(), err);
+	Marshal::FreeHGlobal(p);
+	if (!ok) {
+		delete file;
+		throw gcnew System::IO::InvalidDataException(path + ": " + gcnew String(err.c_str()));
+	}
+
+	ImageFormat fmt;
+	if (!ImageFormatConv::FromVk(file->GetFormat(), &fmt)) {
+		delete file;
+		throw gcnew System::NotSupportedException(path + " uses an unsupported format.");
+	}
+
+	auto tex = gcnew StreamedTexture(file, stagingSize);
+	if (tex->GetStagingSize(tex->tailLevel, tex->LevelCount) > stagingSize) {
+		tex->Free();
+		throw gcnew System::NotSupportedException(path + " has a mip tail larger than the staging area.");
+	}
+	textures->Add(tex);
+	return tex;
+}
+
+void Kokoro::Graphics::TextureStreamer::Unload(StreamedTexture^ tex) {
+	if (!textures->Remove(tex))
+		return;
+	if (tex->image != nullptr) {
+		auto r = gcnew RetiredImage();
+		r->Img = tex->image;
+		r->Frame = frame;
+		retired->Add(r);
+		tex->image = nullptr;
+	}
+	residentBytes -= tex->GetSize(tex->residentLevel);
+	tex->Free();
+}
+
+uint64_t Kokoro::Graphics::TextureStreamer::GetResidentBytes() {
+	return residentBytes;
+}
+
+int Kokoro::Graphics::TextureStreamer::CompareByUse(StreamedTexture^ a, StreamedTexture^ b) {
+	if (a->lastUsed == b->lastUsed)
+		return 0;
+	return a->lastUsed < b->lastUsed ? -1 : 1;
+}
+
+void Kokoro::Graphics::TextureStreamer::PlanResidency() {
+	uint64_t total = 0;
+	for each (StreamedTexture^ t in textures) {
+		t->targetLevel = std::max(std::min(t->requestedLevel, t->tailLevel), t->finestLevel);
+		total += t->GetSize(t->targetLevel);
+	}
+
+	//Least recently used textures give up their finest levels first, mip tails are always kept
+	textures->Sort(gcnew Comparison<StreamedTexture^>(&TextureStreamer::CompareByUse));
+	for each (StreamedTexture^ t in textures)
+		while (total > Budget && t->targetLevel < t->tailLevel) {
+			total -= t->file->GetLevelSize(t->targetLevel);
+			t->targetLevel++;
+		}
+}
+
+void Kokoro::Graphics::TextureStreamer::Resize(VkCommandBuffer cmd, StreamedTexture^ tex, int newLevel, size_t stagingBase, size_t* stagingOff) {
+	auto file = tex->file;
+	int count = tex->LevelCount;
+	int oldLevel = tex->residentLevel;
+	uint32_t layerCnt = file->GetLayerCount() * file->GetFaceCount();
+	auto& top = file->GetLevel(newLevel);
+
+	ImageFormat fmt;
+	ImageFormatConv::FromVk(file->GetFormat(), &fmt);
+	auto img = gcnew Image();
+	img->Width = top.width;
+	img->Height = top.height;
+	img->Depth = top.depth;
+	img->Levels = count - newLevel;
+	img->Layers = layerCnt;
+	img->Dimensions = file->GetDepth() > 1 ? 3 : 2;
+	img->Format = fmt;
+	img->Usage = ImageUsage::Sampled | ImageUsage::TransferDst | ImageUsage::TransferSrc;
+	img->Cubemappable = file->GetFaceCount() == 6;
+	img->Build();
+
+	//The new image starts out empty, the old one only has to stop being sampled
+	BarrierBatch batch;
+	img->Transition(batch, ResourceUse::TransferDst, true);
+	if (tex->image != nullptr)
+		tex->image->Transition(batch, ResourceUse::TransferSrc, false);
+	batch.Flush(cmd);
+
+	//Levels both images hold are copied on the GPU, the rest come straight out of the mapped file
+	if (tex->image != nullptr) {
+		std::vector<VkImageCopy> copies;
+		for (int l = std::max(newLevel, oldLevel); l < count; l++) {
+			auto& lvl = file->GetLevel(l);
+			VkImageCopy c = {};
+			c.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, static_cast<uint32_t>(l - oldLevel), 0, layerCnt };
+			c.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, static_cast<uint32_t>(l - newLevel), 0, layerCnt };
+			c.extent = { lvl.width, lvl.height, lvl.depth };
+			copies.push_back(c);
+		}
+		vkCmdCopyImage(cmd, tex->image->GetImage(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, img->GetImage(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(copies.size()), copies.data());
+	}
+
+	std::vector<VkBufferImageCopy> uploads;
+	for (int l = newLevel; l < std::min(oldLevel, count); l++) {
+		auto& lvl = file->GetLevel(l);
+		for (size_t j = 0; j < lvl.layerOffsets.size(); j++) {
+			*stagingOff = (*stagingOff + StagingAlignment - 1) & ~(StagingAlignment - 1);
+			memcpy(stagingPtr + stagingBase + *stagingOff, file->GetData() + lvl.layerOffsets[j], lvl.layerSize);
+
+			VkBufferImageCopy u = {};
+			u.bufferOffset = stagingBase + *stagingOff;
+			u.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, static_cast<uint32_t>(l - newLevel), static_cast<uint32_t>(j), 1 };
+			u.imageExtent = { lvl.width, lvl.height, lvl.depth };
+			uploads.push_back(u);
+			*stagingOff += lvl.layerSize;
+		}
+	}
+	if (!uploads.empty())
+		vkCmdCopyBufferToImage(cmd, staging->GetBuffer(), img->GetImage(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(uploads.size()), uploads.data());
+
+	img->Transition(batch, ResourceUse::Sampled, false);
+	batch.Flush(cmd);
+
+	if (tex->image != nullptr) {
+		auto r = gcnew RetiredImage();
+		r->Img = tex->image;
+		r->Frame = frame;
+		retired->Add(r);
+	}
+	residentBytes = residentBytes - tex->GetSize(oldLevel) + tex->GetSize(newLevel);
+	tex->image = img;
+	tex->residentLevel = newLevel;
+	tex->version++;
+}
+
+void Kokoro::Graphics::TextureStreamer::Update(VkCommandBuffer cmd) {
+	frame++;
+	for (int i = retired->Count - 1; i >= 0; i--)
+		if (frame - retired[i]->Frame >= GraphicsDevice::GetMaxFramesInFlight()) {
+			delete retired[i]->Img;
+			retired->RemoveAt(i);
+		}
+
+	for each (StreamedTexture^ t in textures)
+		if (t->requested) {
+			t->lastUsed = frame;
+			t->requested = false;
+		}
+	PlanResidency();
+
+	//Evictions need no staging and free memory for the uploads that follow
+	for each (StreamedTexture^ t in textures)
+		if (t->residentLevel < t->LevelCount && t->targetLevel > t->residentLevel)
+			Resize(cmd, t, t->targetLevel, 0, nullptr);
+
+	//Most recently used first, one level per texture per frame so everything sharpens evenly
+	size_t stagingBase = GraphicsDevice::GetCurrentFrameID() * stagingSize;
+	size_t stagingOff = 0;
+	for (int i = textures->Count - 1; i >= 0; i--) {
+		auto t = textures[i];
+		if (t->targetLevel >= t->residentLevel)
+			continue;
+		int next = t->residentLevel == t->LevelCount ? t->tailLevel : t->residentLevel - 1;
+		if (stagingOff + t->GetStagingSize(next, t->residentLevel) > stagingSize)
+			continue;
+		Resize(cmd, t, next, stagingBase, &stagingOff);
+	}
+	if (stagingOff != 0)
+		staging->Flush(0, VK_WHOLE_SIZE);
+}
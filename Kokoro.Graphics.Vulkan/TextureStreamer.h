@@ -0,0 +1,86 @@
+#pragma once
+#include "GraphicsDevice.h"
+#include "Image.h"
+#include "ImageView.h"
+#include "GPUBuffer.h"
+#include "TextureFile.h"
+
+using namespace System;
+using namespace System::Collections::Generic;
+
+namespace Kokoro::Graphics {
+	//Texture whose mip levels stream in lowest first from a mapped KTX2/DDS file and are dropped again under memory pressure.
+	//The backing Image is replaced whenever residency changes, Version counts the replacements.
+	ref class StreamedTexture
+	{
+	internal:
+		TextureFile* file;
+		Image^ image;
+		ImageViewType viewType;
+		//File level held in image level 0, the file's level count while nothing is resident
+		int residentLevel;
+		//Finest level the texture may reach at all, coarser than 0 if a level doesn't fit in the staging area
+		int finestLevel;
+		//Levels from here down are uploaded together, so the texture is visible on its first frame
+		int tailLevel;
+		//Level the budget allows this frame
+		int targetLevel;
+		int requestedLevel;
+		bool requested;
+		uint32_t lastUsed;
+		uint32_t version;
+
+		StreamedTexture(TextureFile* file, size_t stagingSize);
+		//Bytes of every level from firstLevel down to the smallest
+		uint64_t GetSize(int firstLevel);
+		//Staging bytes needed to upload levels [firstLevel, endLevel)
+		size_t GetStagingSize(int firstLevel, int endLevel);
+		//Closes the file, the streamer retires or destroys the image first.
+		void Free();
+	public:
+		property int LevelCount { int get(); }
+		property int ResidentLevel { int get(); }
+		property bool FullyResident { bool get(); }
+		property uint32_t Version { uint32_t get(); }
+
+		//nullptr until the mip tail is resident, refetch after Version changes.
+		ImageView^ GetView();
+		//Marks the texture as used this frame, level is the finest mip worth having.
+		void Request(int level);
+	};
+
+	ref class TextureStreamer
+	{
+	private:
+		ref struct RetiredImage {
+			Image^ Img;
+			uint32_t Frame;
+		};
+		List<StreamedTexture^>^ textures;
+		List<RetiredImage^>^ retired;
+		GPUBuffer^ staging;
+		uint8_t* stagingPtr;
+		size_t stagingSize;
+		uint64_t residentBytes;
+		uint32_t frame;
+
+		void PlanResidency();
+		void Resize(VkCommandBuffer cmd, StreamedTexture^ tex, int newLevel, size_t stagingBase, size_t* stagingOff);
+	internal:
+		//Records this frame's copies into cmd, which must be submitted before the next Update on a queue supporting transfers.
+		//Textures are left in SHADER_READ_ONLY_OPTIMAL.
+		void Update(VkCommandBuffer cmd);
+		static int CompareByUse(StreamedTexture^ a, StreamedTexture^ b);
+	public:
+		//At most stagingSize bytes are uploaded per frame, levels larger than that never become resident.
+		property uint64_t Budget;
+
+		TextureStreamer(size_t stagingSize, uint64_t budget);
+		~TextureStreamer();
+
+		StreamedTexture^ Load(String^ path);
+		//The only way to release a texture, its image is destroyed once the frames in flight have retired.
+		void Unload(StreamedTexture^ tex);
+		uint64_t GetResidentBytes();
+	};
+}
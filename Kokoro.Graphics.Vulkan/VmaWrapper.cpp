@@ -69,9 +69,9 @@ void Kokoro::Graphics::VmaWrapper::DestroyBuffer(VkBuffer buf, WVmaAllocation al
 	vmaDestroyBuffer((VmaAllocator)allocator, buf, (VmaAllocation)alloc->alloc);
 }
 
-int Kokoro::Graphics::VmaWrapper::CreateImage(VkImageCreateInfo* creatInfo, uint32_t* queueFams, uint32_t queueFamCount, VkImage* img, WVmaAllocation* alloc) {
+int Kokoro::Graphics::VmaWrapper::CreateImage(VkImageCreateInfo* creatInfo, MemoryUsage memUsage, uint32_t* queueFams, uint32_t queueFamCount, VkImage* img, WVmaAllocation* alloc) {
 	VmaAllocationCreateInfo allocCreatInfo = {};
-	allocCreatInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+	allocCreatInfo.usage = (VmaMemoryUsage)MemoryUsageConv::Convert(memUsage);
 	if (creatInfo->sharingMode == VK_SHARING_MODE_CONCURRENT) {
 		creatInfo->queueFamilyIndexCount = queueFamCount;
 		creatInfo->pQueueFamilyIndices = queueFams;
@@ -80,7 +80,13 @@ int Kokoro::Graphics::VmaWrapper::CreateImage(VkImageCreateInfo* creatInfo, uint
 		creatInfo->queueFamilyIndexCount = 0;
 	}
 
-	return vmaCreateImage((VmaAllocator)allocator, creatInfo, &allocCreatInfo, img, (VmaAllocation*)&(*alloc)->alloc, (VmaAllocationInfo*)(*alloc)->info);
+	auto result = vmaCreateImage((VmaAllocator)allocator, creatInfo, &allocCreatInfo, img, (VmaAllocation*)&(*alloc)->alloc, (VmaAllocationInfo*)(*alloc)->info);
+	//Desktop GPUs have no lazily allocated memory, transient images just live in device memory there
+	if (result == VK_ERROR_FEATURE_NOT_PRESENT && allocCreatInfo.usage == VMA_MEMORY_USAGE_GPU_LAZILY_ALLOCATED) {
+		allocCreatInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+		result = vmaCreateImage((VmaAllocator)allocator, creatInfo, &allocCreatInfo, img, (VmaAllocation*)&(*alloc)->alloc, (VmaAllocationInfo*)(*alloc)->info);
+	}
+	return result;
 }
 
 void Kokoro::Graphics::VmaWrapper::DestroyImage(VkImage img, WVmaAllocation alloc) {
@@ -34,7 +34,7 @@ namespace Kokoro::Graphics {
 		int CreateBuffer(VkBufferCreateInfo* creatInfo, MemoryUsage memUsage, bool persistent_map, uint32_t* queueFams, uint32_t queueFamCount, VkBuffer* buf, WVmaAllocation* alloc);
 		void DestroyBuffer(VkBuffer buf, WVmaAllocation alloc);
 
-		int CreateImage(VkImageCreateInfo* creatInfo, uint32_t* queueFams, uint32_t queueFamCount, VkImage* img, WVmaAllocation* alloc);
+		int CreateImage(VkImageCreateInfo* creatInfo, MemoryUsage memUsage, uint32_t* queueFams, uint32_t queueFamCount, VkImage* img, WVmaAllocation* alloc);
 		void DestroyImage(VkImage img, WVmaAllocation alloc);
 
 		~VmaWrapper();
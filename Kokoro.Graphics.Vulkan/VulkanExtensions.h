@@ -0,0 +1,269 @@
+#pragma once
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#define VK_USE_PLATFORM_WIN32_KHR
+#endif
+#include "vulkan/vulkan.h"
+
+//Extensions newer than the bundled headers (VK_HEADER_VERSION 130), as defined by the Vulkan registry.
+//The headers in include/vulkan are kept as released, each block drops out once they are updated to a version defining it.
+//Enumerants can't be added to the header's enums, so they are typed constants here. Commands are only declared as PFN
+//types, the loader bundled with these headers doesn't export them and they are fetched with vkGetDeviceProcAddr.
+
+#ifndef VK_KHR_pipeline_library
+#define VK_KHR_pipeline_library 1
+#define VK_KHR_PIPELINE_LIBRARY_SPEC_VERSION 1
+#define VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME "VK_KHR_pipeline_library"
+static const VkStructureType VK_STRUCTURE_TYPE_PIPELINE_LIBRARY_CREATE_INFO_KHR = static_cast<VkStructureType>(1000290000);
+static const VkPipelineCreateFlagBits VK_PIPELINE_CREATE_LIBRARY_BIT_KHR = static_cast<VkPipelineCreateFlagBits>(0x00000800);
+
+typedef struct VkPipelineLibraryCreateInfoKHR {
+	VkStructureType sType;
+	const void* pNext;
+	uint32_t libraryCount;
+	const VkPipeline* pLibraries;
+} VkPipelineLibraryCreateInfoKHR;
+#endif
+
+#ifndef VK_EXT_graphics_pipeline_library
+#define VK_EXT_graphics_pipeline_library 1
+#define VK_EXT_GRAPHICS_PIPELINE_LIBRARY_SPEC_VERSION 1
+#define VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME "VK_EXT_graphics_pipeline_library"
+static const VkStructureType VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT = static_cast<VkStructureType>(1000320000);
+static const VkStructureType VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_PROPERTIES_EXT = static_cast<VkStructureType>(1000320001);
+static const VkStructureType VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_LIBRARY_CREATE_INFO_EXT = static_cast<VkStructureType>(1000320002);
+static const VkPipelineCreateFlagBits VK_PIPELINE_CREATE_RETAIN_LINK_TIME_OPTIMIZATION_INFO_BIT_EXT = static_cast<VkPipelineCreateFlagBits>(0x00800000);
+static const VkPipelineCreateFlagBits VK_PIPELINE_CREATE_LINK_TIME_OPTIMIZATION_BIT_EXT = static_cast<VkPipelineCreateFlagBits>(0x00000400);
+
+typedef enum VkGraphicsPipelineLibraryFlagBitsEXT {
+	VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT = 0x00000001,
+	VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT = 0x00000002,
+	VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT = 0x00000004,
+	VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT = 0x00000008,
+	VK_GRAPHICS_PIPELINE_LIBRARY_FLAG_BITS_MAX_ENUM_EXT = 0x7FFFFFFF
+} VkGraphicsPipelineLibraryFlagBitsEXT;
+typedef VkFlags VkGraphicsPipelineLibraryFlagsEXT;
+
+typedef struct VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT {
+	VkStructureType sType;
+	void* pNext;
+	VkBool32 graphicsPipelineLibrary;
+} VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT;
+
+typedef struct VkPhysicalDeviceGraphicsPipelineLibraryPropertiesEXT {
+	VkStructureType sType;
+	void* pNext;
+	VkBool32 graphicsPipelineLibraryFastLinking;
+	VkBool32 graphicsPipelineLibraryIndependentInterpolationDecoration;
+} VkPhysicalDeviceGraphicsPipelineLibraryPropertiesEXT;
+
+typedef struct VkGraphicsPipelineLibraryCreateInfoEXT {
+	VkStructureType sType;
+	const void* pNext;
+	VkGraphicsPipelineLibraryFlagsEXT flags;
+} VkGraphicsPipelineLibraryCreateInfoEXT;
+#endif
+
+#ifndef VK_EXT_extended_dynamic_state
+#define VK_EXT_extended_dynamic_state 1
+#define VK_EXT_EXTENDED_DYNAMIC_STATE_SPEC_VERSION 1
+#define VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME "VK_EXT_extended_dynamic_state"
+static const VkStructureType VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_FEATURES_EXT = static_cast<VkStructureType>(1000267000);
+static const VkDynamicState VK_DYNAMIC_STATE_CULL_MODE_EXT = static_cast<VkDynamicState>(1000267000);
+static const VkDynamicState VK_DYNAMIC_STATE_FRONT_FACE_EXT = static_cast<VkDynamicState>(1000267001);
+static const VkDynamicState VK_DYNAMIC_STATE_PRIMITIVE_TOPOLOGY_EXT = static_cast<VkDynamicState>(1000267002);
+static const VkDynamicState VK_DYNAMIC_STATE_VIEWPORT_WITH_COUNT_EXT = static_cast<VkDynamicState>(1000267003);
+static const VkDynamicState VK_DYNAMIC_STATE_SCISSOR_WITH_COUNT_EXT = static_cast<VkDynamicState>(1000267004);
+static const VkDynamicState VK_DYNAMIC_STATE_VERTEX_INPUT_BINDING_STRIDE_EXT = static_cast<VkDynamicState>(1000267005);
+static const VkDynamicState VK_DYNAMIC_STATE_DEPTH_TEST_ENABLE_EXT = static_cast<VkDynamicState>(1000267006);
+static const VkDynamicState VK_DYNAMIC_STATE_DEPTH_WRITE_ENABLE_EXT = static_cast<VkDynamicState>(1000267007);
+static const VkDynamicState VK_DYNAMIC_STATE_DEPTH_COMPARE_OP_EXT = static_cast<VkDynamicState>(1000267008);
+static const VkDynamicState VK_DYNAMIC_STATE_DEPTH_BOUNDS_TEST_ENABLE_EXT = static_cast<VkDynamicState>(1000267009);
+static const VkDynamicState VK_DYNAMIC_STATE_STENCIL_TEST_ENABLE_EXT = static_cast<VkDynamicState>(1000267010);
+static const VkDynamicState VK_DYNAMIC_STATE_STENCIL_OP_EXT = static_cast<VkDynamicState>(1000267011);
+
+typedef struct VkPhysicalDeviceExtendedDynamicStateFeaturesEXT {
+	VkStructureType sType;
+	void* pNext;
+	VkBool32 extendedDynamicState;
+} VkPhysicalDeviceExtendedDynamicStateFeaturesEXT;
+
+typedef void (VKAPI_PTR *PFN_vkCmdSetCullModeEXT)(VkCommandBuffer commandBuffer, VkCullModeFlags cullMode);
+typedef void (VKAPI_PTR *PFN_vkCmdSetFrontFaceEXT)(VkCommandBuffer commandBuffer, VkFrontFace frontFace);
+typedef void (VKAPI_PTR *PFN_vkCmdSetPrimitiveTopologyEXT)(VkCommandBuffer commandBuffer, VkPrimitiveTopology primitiveTopology);
+typedef void (VKAPI_PTR *PFN_vkCmdSetViewportWithCountEXT)(VkCommandBuffer commandBuffer, uint32_t viewportCount, const VkViewport* pViewports);
+typedef void (VKAPI_PTR *PFN_vkCmdSetScissorWithCountEXT)(VkCommandBuffer commandBuffer, uint32_t scissorCount, const VkRect2D* pScissors);
+typedef void (VKAPI_PTR *PFN_vkCmdBindVertexBuffers2EXT)(VkCommandBuffer commandBuffer, uint32_t firstBinding, uint32_t bindingCount, const VkBuffer* pBuffers, const VkDeviceSize* pOffsets, const VkDeviceSize* pSizes, const VkDeviceSize* pStrides);
+typedef void (VKAPI_PTR *PFN_vkCmdSetDepthTestEnableEXT)(VkCommandBuffer commandBuffer, VkBool32 depthTestEnable);
+typedef void (VKAPI_PTR *PFN_vkCmdSetDepthWriteEnableEXT)(VkCommandBuffer commandBuffer, VkBool32 depthWriteEnable);
+typedef void (VKAPI_PTR *PFN_vkCmdSetDepthCompareOpEXT)(VkCommandBuffer commandBuffer, VkCompareOp depthCompareOp);
+typedef void (VKAPI_PTR *PFN_vkCmdSetDepthBoundsTestEnableEXT)(VkCommandBuffer commandBuffer, VkBool32 depthBoundsTestEnable);
+typedef void (VKAPI_PTR *PFN_vkCmdSetStencilTestEnableEXT)(VkCommandBuffer commandBuffer, VkBool32 stencilTestEnable);
+typedef void (VKAPI_PTR *PFN_vkCmdSetStencilOpEXT)(VkCommandBuffer commandBuffer, VkStencilFaceFlags faceMask, VkStencilOp failOp, VkStencilOp passOp, VkStencilOp depthFailOp, VkCompareOp compareOp);
+#endif
+
+#ifndef VK_EXT_extended_dynamic_state2
+#define VK_EXT_extended_dynamic_state2 1
+#define VK_EXT_EXTENDED_DYNAMIC_STATE_2_SPEC_VERSION 1
+#define VK_EXT_EXTENDED_DYNAMIC_STATE_2_EXTENSION_NAME "VK_EXT_extended_dynamic_state2"
+static const VkStructureType VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_2_FEATURES_EXT = static_cast<VkStructureType>(1000377000);
+static const VkDynamicState VK_DYNAMIC_STATE_PATCH_CONTROL_POINTS_EXT = static_cast<VkDynamicState>(1000377000);
+static const VkDynamicState VK_DYNAMIC_STATE_RASTERIZER_DISCARD_ENABLE_EXT = static_cast<VkDynamicState>(1000377001);
+static const VkDynamicState VK_DYNAMIC_STATE_DEPTH_BIAS_ENABLE_EXT = static_cast<VkDynamicState>(1000377002);
+static const VkDynamicState VK_DYNAMIC_STATE_LOGIC_OP_EXT = static_cast<VkDynamicState>(1000377003);
+static const VkDynamicState VK_DYNAMIC_STATE_PRIMITIVE_RESTART_ENABLE_EXT = static_cast<VkDynamicState>(1000377004);
+
+typedef struct VkPhysicalDeviceExtendedDynamicState2FeaturesEXT {
+	VkStructureType sType;
+	void* pNext;
+	VkBool32 extendedDynamicState2;
+	VkBool32 extendedDynamicState2LogicOp;
+	VkBool32 extendedDynamicState2PatchControlPoints;
+} VkPhysicalDeviceExtendedDynamicState2FeaturesEXT;
+
+typedef void (VKAPI_PTR *PFN_vkCmdSetPatchControlPointsEXT)(VkCommandBuffer commandBuffer, uint32_t patchControlPoints);
+typedef void (VKAPI_PTR *PFN_vkCmdSetRasterizerDiscardEnableEXT)(VkCommandBuffer commandBuffer, VkBool32 rasterizerDiscardEnable);
+typedef void (VKAPI_PTR *PFN_vkCmdSetDepthBiasEnableEXT)(VkCommandBuffer commandBuffer, VkBool32 depthBiasEnable);
+typedef void (VKAPI_PTR *PFN_vkCmdSetLogicOpEXT)(VkCommandBuffer commandBuffer, VkLogicOp logicOp);
+typedef void (VKAPI_PTR *PFN_vkCmdSetPrimitiveRestartEnableEXT)(VkCommandBuffer commandBuffer, VkBool32 primitiveRestartEnable);
+#endif
+
+#ifndef VK_EXT_provoking_vertex
+//Only the enum, which VK_EXT_extended_dynamic_state3 takes as a parameter
+typedef enum VkProvokingVertexModeEXT {
+	VK_PROVOKING_VERTEX_MODE_FIRST_VERTEX_EXT = 0,
+	VK_PROVOKING_VERTEX_MODE_LAST_VERTEX_EXT = 1,
+	VK_PROVOKING_VERTEX_MODE_MAX_ENUM_EXT = 0x7FFFFFFF
+} VkProvokingVertexModeEXT;
+#endif
+
+#ifndef VK_EXT_extended_dynamic_state3
+#define VK_EXT_extended_dynamic_state3 1
+#define VK_EXT_EXTENDED_DYNAMIC_STATE_3_SPEC_VERSION 2
+#define VK_EXT_EXTENDED_DYNAMIC_STATE_3_EXTENSION_NAME "VK_EXT_extended_dynamic_state3"
+static const VkStructureType VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_3_FEATURES_EXT = static_cast<VkStructureType>(1000455000);
+static const VkStructureType VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_3_PROPERTIES_EXT = static_cast<VkStructureType>(1000455001);
+static const VkDynamicState VK_DYNAMIC_STATE_TESSELLATION_DOMAIN_ORIGIN_EXT = static_cast<VkDynamicState>(1000455002);
+static const VkDynamicState VK_DYNAMIC_STATE_DEPTH_CLAMP_ENABLE_EXT = static_cast<VkDynamicState>(1000455003);
+static const VkDynamicState VK_DYNAMIC_STATE_POLYGON_MODE_EXT = static_cast<VkDynamicState>(1000455004);
+static const VkDynamicState VK_DYNAMIC_STATE_RASTERIZATION_SAMPLES_EXT = static_cast<VkDynamicState>(1000455005);
+static const VkDynamicState VK_DYNAMIC_STATE_SAMPLE_MASK_EXT = static_cast<VkDynamicState>(1000455006);
+static const VkDynamicState VK_DYNAMIC_STATE_ALPHA_TO_COVERAGE_ENABLE_EXT = static_cast<VkDynamicState>(1000455007);
+static const VkDynamicState VK_DYNAMIC_STATE_ALPHA_TO_ONE_ENABLE_EXT = static_cast<VkDynamicState>(1000455008);
+static const VkDynamicState VK_DYNAMIC_STATE_LOGIC_OP_ENABLE_EXT = static_cast<VkDynamicState>(1000455009);
+static const VkDynamicState VK_DYNAMIC_STATE_COLOR_BLEND_ENABLE_EXT = static_cast<VkDynamicState>(1000455010);
+static const VkDynamicState VK_DYNAMIC_STATE_COLOR_BLEND_EQUATION_EXT = static_cast<VkDynamicState>(1000455011);
+static const VkDynamicState VK_DYNAMIC_STATE_COLOR_WRITE_MASK_EXT = static_cast<VkDynamicState>(1000455012);
+static const VkDynamicState VK_DYNAMIC_STATE_RASTERIZATION_STREAM_EXT = static_cast<VkDynamicState>(1000455013);
+static const VkDynamicState VK_DYNAMIC_STATE_CONSERVATIVE_RASTERIZATION_MODE_EXT = static_cast<VkDynamicState>(1000455014);
+static const VkDynamicState VK_DYNAMIC_STATE_EXTRA_PRIMITIVE_OVERESTIMATION_SIZE_EXT = static_cast<VkDynamicState>(1000455015);
+static const VkDynamicState VK_DYNAMIC_STATE_DEPTH_CLIP_ENABLE_EXT = static_cast<VkDynamicState>(1000455016);
+static const VkDynamicState VK_DYNAMIC_STATE_SAMPLE_LOCATIONS_ENABLE_EXT = static_cast<VkDynamicState>(1000455017);
+static const VkDynamicState VK_DYNAMIC_STATE_COLOR_BLEND_ADVANCED_EXT = static_cast<VkDynamicState>(1000455018);
+static const VkDynamicState VK_DYNAMIC_STATE_PROVOKING_VERTEX_MODE_EXT = static_cast<VkDynamicState>(1000455019);
+static const VkDynamicState VK_DYNAMIC_STATE_LINE_RASTERIZATION_MODE_EXT = static_cast<VkDynamicState>(1000455020);
+static const VkDynamicState VK_DYNAMIC_STATE_LINE_STIPPLE_ENABLE_EXT = static_cast<VkDynamicState>(1000455021);
+static const VkDynamicState VK_DYNAMIC_STATE_DEPTH_CLIP_NEGATIVE_ONE_TO_ONE_EXT = static_cast<VkDynamicState>(1000455022);
+static const VkDynamicState VK_DYNAMIC_STATE_VIEWPORT_W_SCALING_ENABLE_NV = static_cast<VkDynamicState>(1000455023);
+static const VkDynamicState VK_DYNAMIC_STATE_VIEWPORT_SWIZZLE_NV = static_cast<VkDynamicState>(1000455024);
+static const VkDynamicState VK_DYNAMIC_STATE_COVERAGE_TO_COLOR_ENABLE_NV = static_cast<VkDynamicState>(1000455025);
+static const VkDynamicState VK_DYNAMIC_STATE_COVERAGE_TO_COLOR_LOCATION_NV = static_cast<VkDynamicState>(1000455026);
+static const VkDynamicState VK_DYNAMIC_STATE_COVERAGE_MODULATION_MODE_NV = static_cast<VkDynamicState>(1000455027);
+static const VkDynamicState VK_DYNAMIC_STATE_COVERAGE_MODULATION_TABLE_ENABLE_NV = static_cast<VkDynamicState>(1000455028);
+static const VkDynamicState VK_DYNAMIC_STATE_COVERAGE_MODULATION_TABLE_NV = static_cast<VkDynamicState>(1000455029);
+static const VkDynamicState VK_DYNAMIC_STATE_SHADING_RATE_IMAGE_ENABLE_NV = static_cast<VkDynamicState>(1000455030);
+static const VkDynamicState VK_DYNAMIC_STATE_REPRESENTATIVE_FRAGMENT_TEST_ENABLE_NV = static_cast<VkDynamicState>(1000455031);
+static const VkDynamicState VK_DYNAMIC_STATE_COVERAGE_REDUCTION_MODE_NV = static_cast<VkDynamicState>(1000455032);
+
+typedef struct VkPhysicalDeviceExtendedDynamicState3FeaturesEXT {
+	VkStructureType sType;
+	void* pNext;
+	VkBool32 extendedDynamicState3TessellationDomainOrigin;
+	VkBool32 extendedDynamicState3DepthClampEnable;
+	VkBool32 extendedDynamicState3PolygonMode;
+	VkBool32 extendedDynamicState3RasterizationSamples;
+	VkBool32 extendedDynamicState3SampleMask;
+	VkBool32 extendedDynamicState3AlphaToCoverageEnable;
+	VkBool32 extendedDynamicState3AlphaToOneEnable;
+	VkBool32 extendedDynamicState3LogicOpEnable;
+	VkBool32 extendedDynamicState3ColorBlendEnable;
+	VkBool32 extendedDynamicState3ColorBlendEquation;
+	VkBool32 extendedDynamicState3ColorWriteMask;
+	VkBool32 extendedDynamicState3RasterizationStream;
+	VkBool32 extendedDynamicState3ConservativeRasterizationMode;
+	VkBool32 extendedDynamicState3ExtraPrimitiveOverestimationSize;
+	VkBool32 extendedDynamicState3DepthClipEnable;
+	VkBool32 extendedDynamicState3SampleLocationsEnable;
+	VkBool32 extendedDynamicState3ColorBlendAdvanced;
+	VkBool32 extendedDynamicState3ProvokingVertexMode;
+	VkBool32 extendedDynamicState3LineRasterizationMode;
+	VkBool32 extendedDynamicState3LineStippleEnable;
+	VkBool32 extendedDynamicState3DepthClipNegativeOneToOne;
+	VkBool32 extendedDynamicState3ViewportWScalingEnable;
+	VkBool32 extendedDynamicState3ViewportSwizzle;
+	VkBool32 extendedDynamicState3CoverageToColorEnable;
+	VkBool32 extendedDynamicState3CoverageToColorLocation;
+	VkBool32 extendedDynamicState3CoverageModulationMode;
+	VkBool32 extendedDynamicState3CoverageModulationTableEnable;
+	VkBool32 extendedDynamicState3CoverageModulationTable;
+	VkBool32 extendedDynamicState3CoverageReductionMode;
+	VkBool32 extendedDynamicState3RepresentativeFragmentTestEnable;
+	VkBool32 extendedDynamicState3ShadingRateImageEnable;
+} VkPhysicalDeviceExtendedDynamicState3FeaturesEXT;
+
+typedef struct VkPhysicalDeviceExtendedDynamicState3PropertiesEXT {
+	VkStructureType sType;
+	void* pNext;
+	VkBool32 dynamicPrimitiveTopologyUnrestricted;
+} VkPhysicalDeviceExtendedDynamicState3PropertiesEXT;
+
+typedef struct VkColorBlendEquationEXT {
+	VkBlendFactor srcColorBlendFactor;
+	VkBlendFactor dstColorBlendFactor;
+	VkBlendOp colorBlendOp;
+	VkBlendFactor srcAlphaBlendFactor;
+	VkBlendFactor dstAlphaBlendFactor;
+	VkBlendOp alphaBlendOp;
+} VkColorBlendEquationEXT;
+
+typedef struct VkColorBlendAdvancedEXT {
+	VkBlendOp advancedBlendOp;
+	VkBool32 srcPremultiplied;
+	VkBool32 dstPremultiplied;
+	VkBlendOverlapEXT blendOverlap;
+	VkBool32 clampResults;
+} VkColorBlendAdvancedEXT;
+
+typedef void (VKAPI_PTR *PFN_vkCmdSetTessellationDomainOriginEXT)(VkCommandBuffer commandBuffer, VkTessellationDomainOrigin domainOrigin);
+typedef void (VKAPI_PTR *PFN_vkCmdSetDepthClampEnableEXT)(VkCommandBuffer commandBuffer, VkBool32 depthClampEnable);
+typedef void (VKAPI_PTR *PFN_vkCmdSetPolygonModeEXT)(VkCommandBuffer commandBuffer, VkPolygonMode polygonMode);
+typedef void (VKAPI_PTR *PFN_vkCmdSetRasterizationSamplesEXT)(VkCommandBuffer commandBuffer, VkSampleCountFlagBits rasterizationSamples);
+typedef void (VKAPI_PTR *PFN_vkCmdSetSampleMaskEXT)(VkCommandBuffer commandBuffer, VkSampleCountFlagBits samples, const VkSampleMask* pSampleMask);
+typedef void (VKAPI_PTR *PFN_vkCmdSetAlphaToCoverageEnableEXT)(VkCommandBuffer commandBuffer, VkBool32 alphaToCoverageEnable);
+typedef void (VKAPI_PTR *PFN_vkCmdSetAlphaToOneEnableEXT)(VkCommandBuffer commandBuffer, VkBool32 alphaToOneEnable);
+typedef void (VKAPI_PTR *PFN_vkCmdSetLogicOpEnableEXT)(VkCommandBuffer commandBuffer, VkBool32 logicOpEnable);
+typedef void (VKAPI_PTR *PFN_vkCmdSetColorBlendEnableEXT)(VkCommandBuffer commandBuffer, uint32_t firstAttachment, uint32_t attachmentCount, const VkBool32* pColorBlendEnables);
+typedef void (VKAPI_PTR *PFN_vkCmdSetColorBlendEquationEXT)(VkCommandBuffer commandBuffer, uint32_t firstAttachment, uint32_t attachmentCount, const VkColorBlendEquationEXT* pColorBlendEquations);
+typedef void (VKAPI_PTR *PFN_vkCmdSetColorWriteMaskEXT)(VkCommandBuffer commandBuffer, uint32_t firstAttachment, uint32_t attachmentCount, const VkColorComponentFlags* pColorWriteMasks);
+typedef void (VKAPI_PTR *PFN_vkCmdSetRasterizationStreamEXT)(VkCommandBuffer commandBuffer, uint32_t rasterizationStream);
+typedef void (VKAPI_PTR *PFN_vkCmdSetConservativeRasterizationModeEXT)(VkCommandBuffer commandBuffer, VkConservativeRasterizationModeEXT conservativeRasterizationMode);
+typedef void (VKAPI_PTR *PFN_vkCmdSetExtraPrimitiveOverestimationSizeEXT)(VkCommandBuffer commandBuffer, float extraPrimitiveOverestimationSize);
+typedef void (VKAPI_PTR *PFN_vkCmdSetDepthClipEnableEXT)(VkCommandBuffer commandBuffer, VkBool32 depthClipEnable);
+typedef void (VKAPI_PTR *PFN_vkCmdSetSampleLocationsEnableEXT)(VkCommandBuffer commandBuffer, VkBool32 sampleLocationsEnable);
+typedef void (VKAPI_PTR *PFN_vkCmdSetColorBlendAdvancedEXT)(VkCommandBuffer commandBuffer, uint32_t firstAttachment, uint32_t attachmentCount, const VkColorBlendAdvancedEXT* pColorBlendAdvanced);
+typedef void (VKAPI_PTR *PFN_vkCmdSetProvokingVertexModeEXT)(VkCommandBuffer commandBuffer, VkProvokingVertexModeEXT provokingVertexMode);
+typedef void (VKAPI_PTR *PFN_vkCmdSetLineRasterizationModeEXT)(VkCommandBuffer commandBuffer, VkLineRasterizationModeEXT lineRasterizationMode);
+typedef void (VKAPI_PTR *PFN_vkCmdSetLineStippleEnableEXT)(VkCommandBuffer commandBuffer, VkBool32 stippledLineEnable);
+typedef void (VKAPI_PTR *PFN_vkCmdSetDepthClipNegativeOneToOneEXT)(VkCommandBuffer commandBuffer, VkBool32 negativeOneToOne);
+typedef void (VKAPI_PTR *PFN_vkCmdSetViewportWScalingEnableNV)(VkCommandBuffer commandBuffer, VkBool32 viewportWScalingEnable);
+typedef void (VKAPI_PTR *PFN_vkCmdSetViewportSwizzleNV)(VkCommandBuffer commandBuffer, uint32_t firstViewport, uint32_t viewportCount, const VkViewportSwizzleNV* pViewportSwizzles);
+typedef void (VKAPI_PTR *PFN_vkCmdSetCoverageToColorEnableNV)(VkCommandBuffer commandBuffer, VkBool32 coverageToColorEnable);
+typedef void (VKAPI_PTR *PFN_vkCmdSetCoverageToColorLocationNV)(VkCommandBuffer commandBuffer, uint32_t coverageToColorLocation);
+typedef void (VKAPI_PTR *PFN_vkCmdSetCoverageModulationModeNV)(VkCommandBuffer commandBuffer, VkCoverageModulationModeNV coverageModulationMode);
+typedef void (VKAPI_PTR *PFN_vkCmdSetCoverageModulationTableEnableNV)(VkCommandBuffer commandBuffer, VkBool32 coverageModulationTableEnable);
+typedef void (VKAPI_PTR *PFN_vkCmdSetCoverageModulationTableNV)(VkCommandBuffer commandBuffer, uint32_t coverageModulationTableCount, const float* pCoverageModulationTable);
+typedef void (VKAPI_PTR *PFN_vkCmdSetShadingRateImageEnableNV)(VkCommandBuffer commandBuffer, VkBool32 shadingRateImageEnable);
+typedef void (VKAPI_PTR *PFN_vkCmdSetRepresentativeFragmentTestEnableNV)(VkCommandBuffer commandBuffer, VkBool32 representativeFragmentTestEnable);
+typedef void (VKAPI_PTR *PFN_vkCmdSetCoverageReductionModeNV)(VkCommandBuffer commandBuffer, VkCoverageReductionModeNV coverageReductionMode);
+#endif